@@ -41,9 +41,6 @@
 #include "XrdSec/XrdSecEntity.hh"
 #include "XrdNet/XrdNetIF.hh"
 #include "XrdVersion.hh"
-/*----------------------------------------------------------------------------*/
-#include "google/protobuf/io/zero_copy_stream_impl.h"
-
 /*----------------------------------------------------------------------------*/
 
 // The global OFS handle
@@ -88,14 +85,11 @@ EOSAUTHNAMESPACE_BEGIN
 EosAuthOfs::EosAuthOfs():
   XrdOfs(),
   eos::common::LogId(),
-  proxy_tid(0),
-  mSizePoolSocket(5),
+  mChannel(0),
   mLogLevel(LOG_INFO)
 {
   // Initialise the ZMQ client
   mZmqContext = new zmq::context_t(1);
-  mBackend1 = std::make_pair(std::string(""), (zmq::socket_t*)0);
-  mBackend2 = std::make_pair(std::string(""), (zmq::socket_t*)0);
 
   // Set Logging parameters
   XrdOucString unit = "auth@localhost";
@@ -113,22 +107,8 @@ EosAuthOfs::EosAuthOfs():
 //------------------------------------------------------------------------------
 EosAuthOfs::~EosAuthOfs()
 {
-  zmq::socket_t* socket;
-
-  // Kill the auth proxy thread
-  if (proxy_tid)
-  {
-    XrdSysThread::Cancel(proxy_tid);
-    XrdSysThread::Join(proxy_tid, 0);
-  }
-
-  // Release memory    
-  while (mPoolSocket.try_pop(socket))
-    delete socket;
-
-  delete mFrontend;
-  delete mBackend1.second;
-  delete mBackend2.second;
+  // Stop the IO thread and release memory
+  delete mChannel;
   delete mZmqContext;
 }
 
@@ -195,7 +175,7 @@ EosAuthOfs::Configure(XrdSysError& error)
             mgm_instance = val;
 
             if (mgm_instance.find(":") != string::npos)
-              mBackend1 = std::make_pair(mgm_instance, (zmq::socket_t*)0);
+              mBackend1 = mgm_instance;
           }
           else
           {
@@ -215,19 +195,18 @@ EosAuthOfs::Configure(XrdSysError& error)
             mgm_instance = val;
 
             if (mgm_instance.find(":") != string::npos)
-              mBackend2 = std::make_pair(mgm_instance, (zmq::socket_t*)0);
+              mBackend2 = mgm_instance;
           }
         }
 
-        // Get number of sockets in the pool by default 10
+        // Number of sockets in the pool - no longer used as all requests are
+        // multiplexed over one connection per MGM
         option_tag = "numsockets";
 
         if (!strncmp(var, option_tag.c_str(), option_tag.length()))
         {
-          if (!(val = Config.GetWord()))
-            error.Emsg("Configure ", "No number of sockets specified");
-          else
-            mSizePoolSocket = atoi(val);
+          Config.GetWord();
+          error.Say("=====> eosauth.numsockets is deprecated and ignored", "");
         }
         
         // Get log level by default LOG_INFO
@@ -266,44 +245,25 @@ EosAuthOfs::Configure(XrdSysError& error)
     }
 
     // Check and connect at least to an MGM master
-    if (!mBackend1.first.empty())
+    if (!mBackend1.empty())
     {
-      if ((XrdSysThread::Run(&proxy_tid, EosAuthOfs::StartAuthProxyThread,
-                             static_cast<void *>(this), 0, "Auth Proxy Thread")))
-      {
-        eos_err("cannot start the authentication proxy thread");
-        NoGo = 1;
-      }    
-      
-      // Create a pool of sockets connected to the master proxy service 
-      for (int i = 0; i < mSizePoolSocket; i++)
+      std::vector<std::string> endpoints;
+      endpoints.push_back(mBackend1);
+      OfsEroute.Say("=====> connected to master MGM: ", mBackend1.c_str());
+
+      // Connect to the slave if present
+      if (!mBackend2.empty())
       {
-        // Set socket receive timeout to 5 seconds
-        zmq::socket_t* socket = new zmq::socket_t(*mZmqContext, ZMQ_REQ);
-#if ZMQ_VERSION >= 20200
-        int timeout_mili = 5000;
-        socket->setsockopt(ZMQ_RCVTIMEO, &timeout_mili, sizeof timeout_mili);
-#endif
-        std::string endpoint = "inproc://proxyfrontend";
-        
-        // Try in a loop to connect to the proxyfrontend as it can take a while for
-        // the poxy thread to do the binding, therefore connect can fail
-        while (1)
-        {
-          try
-          {
-            socket->connect(endpoint.c_str());
-          }
-          catch (zmq::error_t& err)
-          {
-            eos_warning("dealing with connect exception, retrying ...");
-            continue;
-          }
+        endpoints.push_back(mBackend2);
+        OfsEroute.Say("=====> connected to slave MGM: ", mBackend2.c_str());
+      }
 
-          break;
-        }
-        
-        mPoolSocket.push(socket);
+      mChannel = new MgmChannel(mZmqContext);
+
+      if (!mChannel->Start(endpoints))
+      {
+        eos_err("cannot start the channel to the MGM nodes");
+        NoGo = 1;
       }
     }
     else
@@ -357,194 +317,6 @@ EosAuthOfs::Configure(XrdSysError& error)
 }
 
 
-//------------------------------------------------------------------------------
-// Authentication proxy thread startup function
-//------------------------------------------------------------------------------
-void*
-EosAuthOfs::StartAuthProxyThread(void *pp)
-{
-  EosAuthOfs* ofs = static_cast<EosAuthOfs*>(pp);
-  ofs->AuthProxyThread();
-  return 0;  
-}
-
-
-//------------------------------------------------------------------------------
-// Authentication proxt thread which forwards requests form the clients
-// to the proper MGM intance.
-//------------------------------------------------------------------------------
-void
-EosAuthOfs::AuthProxyThread()
-{
-  // Bind the client facing socket
-  mFrontend = new zmq::socket_t(*mZmqContext, ZMQ_ROUTER);
-  mFrontend->bind("inproc://proxyfrontend");
-
-  // Connect sockets facing the MGM nodes - master and slave
-  std::ostringstream sstr;
-  mBackend1 = std::make_pair(mBackend1.first,
-                             new zmq::socket_t(*mZmqContext, ZMQ_DEALER));
-  sstr << "tcp://" << mBackend1.first;
-  OfsEroute.Say("=====> connected to master MGM: ", mBackend1.first.c_str());
-  mBackend1.second->connect(sstr.str().c_str());
-  
-  // Connect to the slave if present
-  if (!mBackend2.first.empty())
-  {
-    sstr.str("");
-    mBackend2 = std::make_pair(mBackend2.first,
-                               new zmq::socket_t(*mZmqContext, ZMQ_DEALER));
-    sstr << "tcp://" << mBackend2.first;
-    OfsEroute.Say("=====> connected to slave MGM: ", mBackend2.first.c_str());
-    mBackend2.second->connect(sstr.str().c_str());
-  }
-  
-  // Set the master to point to the master MGM - no need for lock
-  mMaster = mBackend1.second;
-
-  int rc;
-  zmq::message_t msg;
-  
-  // Start the poxy using the first entry
-  int more;
-  size_t moresz;
-  int poll_size = 2;
-  zmq_pollitem_t items [3];
-  items[0] = {mFrontend, 0, ZMQ_POLLIN, 0};
-  items[1] = {mBackend1.second, 0, ZMQ_POLLIN, 0};
-    
-  if (!mBackend2.first.empty())
-  {
-    poll_size = 3;
-    items[2] = {mBackend2.second, 0, ZMQ_POLLIN, 0};
-  }
-  
-  // Main loop in which the proxy thread accepts request from the clients and
-  // then he forwards them to the current master MGM. The master MGM can change
-  // at any point.
-  while (true)
-  {
-    // Wait while there are either requests or replies to process
-    rc = zmq::poll(&items[0], poll_size, -1);
-    
-    if (rc < 0)
-    {
-      eos_err("error in poll");
-      return;
-    }
-
-    // Process a request
-    if (items[0].revents & ZMQ_POLLIN)
-    {
-      eos_debug("got frontend event");
-      
-      while (true)
-      {
-        if (!mFrontend->recv(&msg))
-        {
-          eos_err("error while recv on frontend");
-          return;
-        }
-      
-        try
-        {
-          moresz = sizeof more;
-          mFrontend->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-        
-        // Send request to the current master MGM
-        {
-          XrdSysMutexHelper scop_lock(mMutexMaster);
-          if (!mMaster->send(msg, more ? ZMQ_SNDMORE : 0))
-          {
-            eos_err("error while sending to master");
-            return;
-          }
-        }
-
-        if (more == 0)
-          break;
-      }
-    }
-
-    // Process a reply from the first MGM
-    if (items[1].revents & ZMQ_POLLIN)
-    {
-      eos_debug("got mBackend1 event");
-      
-      while (true)
-      {
-        if (!mBackend1.second->recv(&msg))
-        {
-          eos_err("error while recv on mBackend1");
-          return;
-        }
-        
-        moresz = sizeof more;
-        try
-        {
-          mBackend1.second->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-
-        if (!mFrontend->send(msg, more ? ZMQ_SNDMORE : 0))
-        {
-          eos_err("error while send to frontend(1)");
-          return;
-        }
-       
-        if (more == 0)
-          break;
-      }
-    }
-
-    // Process a reply from the second MGM
-    if ((poll_size == 3) && (items[2].revents & ZMQ_POLLIN))
-    {
-      eos_debug("got mBackend2 event");
-      
-      while (true)
-      {
-        if (!mBackend2.second->recv(&msg))
-        {
-          eos_err("error while recv on mBackend2");
-          return;
-        }
-        
-        moresz = sizeof more;
-        try
-        {
-          mBackend2.second->getsockopt(ZMQ_RCVMORE, &more, &moresz);
-        }
-        catch (zmq::error_t& err)
-        {
-          eos_err("exception in getsockopt");
-          return;
-        }
-
-        if (!mFrontend->send(msg, more ? ZMQ_SNDMORE : 0))
-        {
-          eos_err("error while send to frontend(2)");
-          return;
-        }
-
-        if (more == 0)
-          break;
-      }
-    }
-  }
-}
-
-
 //------------------------------------------------------------------------------
 // Get directory object
 //------------------------------------------------------------------------------
@@ -590,13 +362,12 @@ EosAuthOfs::stat(const char* path,
     return retc;
   }  
  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_stat)
      {
@@ -620,8 +391,7 @@ EosAuthOfs::stat(const char* path,
      }
   }
     
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -650,14 +420,13 @@ EosAuthOfs::stat(const char* path,
     return retc;
   }  
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_stat = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_stat)
     {
@@ -677,8 +446,7 @@ EosAuthOfs::stat(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -722,13 +490,12 @@ EosAuthOfs::fsctl(const int cmd,
     return retc;
   }  
     
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fsctl1 = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_fsctl1 = static_cast<ResponseProto*>(GetResponse(&request));
 
     if(resp_fsctl1)
     {
@@ -744,8 +511,7 @@ EosAuthOfs::fsctl(const int cmd,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -772,13 +538,12 @@ EosAuthOfs::FSctl(const int cmd,
     return retc;
   }  
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fsctl2 = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_fsctl2 = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_fsctl2)
     {
@@ -794,8 +559,7 @@ EosAuthOfs::FSctl(const int cmd,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -823,13 +587,12 @@ EosAuthOfs::chmod (const char *path,
     return retc;
   }  
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_chmod = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_chmod = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_chmod)
     {
@@ -845,8 +608,7 @@ EosAuthOfs::chmod (const char *path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -876,13 +638,12 @@ EosAuthOfs::chksum(csFunc func,
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_chksum = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_chksum = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_chksum)
     {
@@ -899,8 +660,7 @@ EosAuthOfs::chksum(csFunc func,
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -928,13 +688,12 @@ EosAuthOfs::exists(const char* path,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_exists = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_exists = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_exists)
     {
@@ -954,8 +713,7 @@ EosAuthOfs::exists(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -987,13 +745,12 @@ EosAuthOfs::mkdir (const char* path,
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
     
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_mkdir = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_mkdir = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_mkdir)
     {
@@ -1010,8 +767,7 @@ EosAuthOfs::mkdir (const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1038,13 +794,12 @@ EosAuthOfs::remdir(const char* path,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_remdir = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_remdir = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_remdir)
     {
@@ -1061,8 +816,7 @@ EosAuthOfs::remdir(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1089,13 +843,12 @@ EosAuthOfs::rem(const char* path,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_rem = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_rem = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_rem)
     {
@@ -1112,8 +865,7 @@ EosAuthOfs::rem(const char* path,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1143,13 +895,12 @@ EosAuthOfs::rename (const char *oldName,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_rename = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_rename = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_rename)
     {
@@ -1166,8 +917,7 @@ EosAuthOfs::rename (const char *oldName,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1193,13 +943,12 @@ EosAuthOfs::prepare(XrdSfsPrep& pargs,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_prepare = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_prepare = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_prepare)
     {
@@ -1216,8 +965,7 @@ EosAuthOfs::prepare(XrdSfsPrep& pargs,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1246,13 +994,12 @@ EosAuthOfs::truncate(const char* path,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
      
-  if (SendProtoBufRequest(socket, req_proto))
+  if (SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_truncate = static_cast<ResponseProto*>(GetResponse(socket));
+    ResponseProto* resp_truncate = static_cast<ResponseProto*>(GetResponse(&request));
 
     if (resp_truncate)
     {
@@ -1269,8 +1016,7 @@ EosAuthOfs::truncate(const char* path,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -1293,19 +1039,10 @@ EosAuthOfs::getStats (char *buff, int blen)
 // Send ProtocolBuffer object using ZMQ
 //------------------------------------------------------------------------------
 bool
-EosAuthOfs::SendProtoBufRequest(zmq::socket_t* socket,
+EosAuthOfs::SendProtoBufRequest(MgmChannel::Request* req,
                                 google::protobuf::Message* message)
 {
-  // Send the request
-  bool sent = false;
-  int msg_size = message->ByteSize();
-  zmq::message_t request(msg_size);
-  google::protobuf::io::ArrayOutputStream aos(request.data(), msg_size);
-
-  // Use google::protobuf::io::ArrayOutputStream which is way faster than
-  // StringOutputStream as it avoids copying data
-  message->SerializeToZeroCopyStream(&aos);
-  sent = socket->send(request, ZMQ_NOBLOCK);
+  bool sent = mChannel->Submit(req, message);
 
   if (!sent)
     eos_err("unable to send request using zmq");
@@ -1318,21 +1055,26 @@ EosAuthOfs::SendProtoBufRequest(zmq::socket_t* socket,
 // Get ProtocolBuffer response object using ZMQ
 //------------------------------------------------------------------------------
 google::protobuf::Message*
-EosAuthOfs::GetResponse(zmq::socket_t* socket)
+EosAuthOfs::GetResponse(MgmChannel::Request* req)
 {
-  zmq::message_t reply;
   ResponseProto* resp = static_cast<ResponseProto*>(0);
-  bool done = socket->recv(&reply);
+  bool done = mChannel->Wait(req);
   
   if (done)
   {
-    std::string resp_str = std::string(static_cast<char*>(reply.data()), reply.size());
+    // Parse in place from the received frame, no intermediate copy
     resp = new ResponseProto();
-    resp->ParseFromString(resp_str);
+
+    if (!resp->ParseFromArray(req->mReply.data(), req->mReply.size()))
+    {
+      eos_err("unable to parse response");
+      delete resp;
+      return static_cast<ResponseProto*>(0);
+    }
 
     // If response is redirect and the error information matches one of the MGM
     // nodes specified in the configuration, this means there was a master/slave
-    // switch and we need to update the socket to which requests are sent.
+    // switch and we need to update the MGM to which requests are sent.
     if (resp->response() == SFS_REDIRECT)
     {
       if (resp->has_error())
@@ -1362,7 +1104,7 @@ EosAuthOfs::GetResponse(zmq::socket_t* socket)
   }
   else
   {
-    eos_err("socket error/timeout during receive");
+    eos_err("error/timeout while waiting for the response");
   }
   
   return resp;
@@ -1370,34 +1112,27 @@ EosAuthOfs::GetResponse(zmq::socket_t* socket)
 
 
 //------------------------------------------------------------------------------
-// Update the socket pointing to the master MGM instance
+// Update the MGM instance to which requests are sent
 //------------------------------------------------------------------------------
 bool
 EosAuthOfs::UpdateMaster(std::string& redirect_host)
 {
   bool found = false;
-  zmq::socket_t* upd_socket;
   eos_debug("redirect_host:%s", redirect_host.c_str());
   
   // Chech if the new master was also specified in the configuration
-  if (mBackend1.first.find(redirect_host) != string::npos)
+  if (mBackend1.find(redirect_host) != string::npos)
   {
-    upd_socket = mBackend1.second;
+    mChannel->SetMaster(0);
     found = true;
   }
-  else if (mBackend2.first.find(redirect_host) != string::npos)
+  else if (!mBackend2.empty() &&
+           (mBackend2.find(redirect_host) != string::npos))
   {
-    upd_socket = mBackend2.second;
+    mChannel->SetMaster(1);
     found = true;
   }
 
-  if (found)
-  {
-    XrdSysMutexHelper scop_lock(mMutexMaster);
-    if (mMaster != upd_socket)
-      mMaster = upd_socket;    
-  }
-
   return found;
 }
 
@@ -83,13 +83,12 @@ EosAuthOfsFile::open(const char* fileName,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_open = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_open)
     {
@@ -103,8 +102,7 @@ EosAuthOfsFile::open(const char* fileName,
     }
   }
 
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -133,13 +131,12 @@ EosAuthOfsFile::read(XrdSfsFileOffset offset,
     return retc;
   }
  
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fread = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fread = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_fread)
     {
@@ -156,8 +153,7 @@ EosAuthOfsFile::read(XrdSfsFileOffset offset,
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -186,13 +182,12 @@ EosAuthOfsFile::write(XrdSfsFileOffset offset,
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fwrite = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fwrite = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_fwrite)
     {
@@ -202,8 +197,7 @@ EosAuthOfsFile::write(XrdSfsFileOffset offset,
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -230,13 +224,12 @@ EosAuthOfsFile::FName()
     return static_cast<const char*>(0);
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fname = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_fname)
     {
@@ -257,8 +250,7 @@ EosAuthOfsFile::FName()
     }
   }
  
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return (retc ? static_cast<const char*>(0) : mName.c_str());
 }
@@ -285,13 +277,12 @@ EosAuthOfsFile::stat(struct stat* buf)
     return retc;
   }
 
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_fstat = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_fstat = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_fstat)
     {
@@ -309,8 +300,7 @@ EosAuthOfsFile::stat(struct stat* buf)
     memset(buf, 0, sizeof(struct stat));
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
@@ -337,13 +327,12 @@ EosAuthOfsFile::close()
     return retc;
   }
   
-  // Get a socket object from the pool
-  zmq::socket_t* socket;
-  gOFS->mPoolSocket.wait_pop(socket);
+  // Request slot waiting for the reply
+  MgmChannel::Request request;
 
-  if (gOFS->SendProtoBufRequest(socket, req_proto))
+  if (gOFS->SendProtoBufRequest(&request, req_proto))
   {
-    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(socket));
+    ResponseProto* resp_close = static_cast<ResponseProto*>(gOFS->GetResponse(&request));
 
     if (resp_close)
     {
@@ -353,8 +342,7 @@ EosAuthOfsFile::close()
     }
   }
   
-  // Release socket and free memory
-  gOFS->mPoolSocket.push(socket);
+  // Free memory
   delete req_proto;
   return retc;
 }
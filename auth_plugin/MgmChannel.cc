@@ -0,0 +1,501 @@
+//------------------------------------------------------------------------------
+// File: MgmChannel.cc
+// Author: agent <agent@local>
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+/*----------------------------------------------------------------------------*/
+#include "MgmChannel.hh"
+/*----------------------------------------------------------------------------*/
+#include "google/protobuf/message.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+/*----------------------------------------------------------------------------*/
+
+EOSAUTHNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+MgmChannel::MgmChannel(zmq::context_t* context, int timeout_ms):
+  eos::common::LogId(),
+  mZmqContext(context),
+  mTimeout(timeout_ms),
+  mIoTid(0),
+  mMaster(0),
+  mShutdown(false),
+  mLastId(0),
+  mWakeupPending(false)
+{
+  mWakeupPipe[0] = mWakeupPipe[1] = -1;
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+MgmChannel::~MgmChannel()
+{
+  Stop();
+
+  for (size_t i = 0; i < mSockets.size(); i++)
+    delete mSockets[i];
+
+  if (mWakeupPipe[0] != -1)
+  {
+    close(mWakeupPipe[0]);
+    close(mWakeupPipe[1]);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Connect to the MGM nodes and start the IO thread
+//------------------------------------------------------------------------------
+bool
+MgmChannel::Start(const std::vector<std::string>& endpoints)
+{
+  if (endpoints.empty())
+  {
+    eos_err("no MGM endpoint given");
+    return false;
+  }
+
+  if (pipe(mWakeupPipe))
+  {
+    eos_err("unable to create the wakeup pipe, errno=%i", errno);
+    return false;
+  }
+
+  // The IO thread drains the pipe until EAGAIN and the submitters can skip
+  // the wakeup if the pipe is full, the IO thread is awake anyway
+  fcntl(mWakeupPipe[0], F_SETFL, fcntl(mWakeupPipe[0], F_GETFL) | O_NONBLOCK);
+  fcntl(mWakeupPipe[1], F_SETFL, fcntl(mWakeupPipe[1], F_GETFL) | O_NONBLOCK);
+  mEndpoints = endpoints;
+
+  // The sockets are created here but from now on they are only used by the
+  // IO thread, thread creation acts as a full memory barrier
+  for (size_t i = 0; i < mEndpoints.size(); i++)
+  {
+    std::string endpoint = "tcp://" + mEndpoints[i];
+    zmq::socket_t* socket = new zmq::socket_t(*mZmqContext, ZMQ_DEALER);
+    mSockets.push_back(socket);
+
+    try
+    {
+      socket->connect(endpoint.c_str());
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("unable to connect to MGM endpoint=%s", endpoint.c_str());
+      return false;
+    }
+  }
+
+  if (XrdSysThread::Run(&mIoTid, MgmChannel::StartIoThread,
+                        static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                        "Auth MGM Channel Thread"))
+  {
+    eos_err("cannot start the MGM channel IO thread");
+    mIoTid = 0;
+    return false;
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Stop the IO thread
+//------------------------------------------------------------------------------
+void
+MgmChannel::Stop()
+{
+  if (!mIoTid)
+    return;
+
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    mShutdown = true;
+  }
+
+  char c = 0;
+
+  if (write(mWakeupPipe[1], &c, 1) != 1)
+    eos_debug("wakeup pipe full during shutdown");
+
+  XrdSysThread::Join(mIoTid, 0);
+  mIoTid = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Serialize and submit a request to the current master MGM
+//------------------------------------------------------------------------------
+bool
+MgmChannel::Submit(Request* req, google::protobuf::Message* message)
+{
+  // Serialize directly into the ZMQ message which is handed over to the IO
+  // thread, the payload is never copied again
+  int msg_size = message->ByteSize();
+  zmq::message_t* payload = new zmq::message_t(msg_size);
+  google::protobuf::io::ArrayOutputStream aos(payload->data(), msg_size);
+
+  if (!message->SerializeToZeroCopyStream(&aos))
+  {
+    eos_err("unable to serialize request");
+    delete payload;
+    return false;
+  }
+
+  bool wakeup = false;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+
+    if (mShutdown || !mIoTid)
+    {
+      eos_err("MGM channel is not running");
+      delete payload;
+      return false;
+    }
+
+    req->mId = ++mLastId;
+    mPending[req->mId] = req;
+    mOutQueue.push_back(std::make_pair(req->mId, payload));
+
+    // Only the first request queued since the IO thread last drained the
+    // queue pays for the wakeup
+    if (!mWakeupPending)
+      mWakeupPending = wakeup = true;
+  }
+
+  if (wakeup)
+  {
+    char c = 0;
+
+    if ((write(mWakeupPipe[1], &c, 1) != 1) && (errno != EAGAIN))
+      eos_err("unable to wake up the IO thread, errno=%i", errno);
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Wait for the reply of a submitted request
+//------------------------------------------------------------------------------
+bool
+MgmChannel::Wait(Request* req)
+{
+  struct timeval now;
+  gettimeofday(&now, 0);
+  long long deadline = now.tv_sec * 1000LL + now.tv_usec / 1000 + mTimeout;
+
+  req->mCond.Lock();
+
+  while (!req->mDone)
+  {
+    gettimeofday(&now, 0);
+    long long left = deadline - (now.tv_sec * 1000LL + now.tv_usec / 1000);
+
+    if (left <= 0)
+      break;
+
+    req->mCond.WaitMS((int) left);
+  }
+
+  req->mCond.UnLock();
+
+  // Unregister the request, once this is done the IO thread can no longer
+  // touch it - it might have completed it just before though
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    mPending.erase(req->mId);
+  }
+
+  if (!req->mDone)
+  {
+    eos_err("timeout while waiting for the reply of request id=%llu",
+            (unsigned long long) req->mId);
+    return false;
+  }
+
+  return !req->mFailed;
+}
+
+
+//------------------------------------------------------------------------------
+// Send all subsequent requests to another MGM node
+//------------------------------------------------------------------------------
+void
+MgmChannel::SetMaster(size_t index)
+{
+  XrdSysMutexHelper scope_lock(mMutex);
+
+  if (index < mEndpoints.size())
+    mMaster = index;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of requests currently in flight
+//------------------------------------------------------------------------------
+size_t
+MgmChannel::GetInFlight()
+{
+  XrdSysMutexHelper scope_lock(mMutex);
+  return mPending.size();
+}
+
+
+//------------------------------------------------------------------------------
+// IO thread startup function
+//------------------------------------------------------------------------------
+void*
+MgmChannel::StartIoThread(void* pp)
+{
+  MgmChannel* channel = static_cast<MgmChannel*>(pp);
+  channel->IoThread();
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// IO thread which sends the queued requests and dispatches the replies
+//------------------------------------------------------------------------------
+void
+MgmChannel::IoThread()
+{
+  std::vector<zmq_pollitem_t> items(mSockets.size() + 1);
+  items[0].socket = 0;
+  items[0].fd = mWakeupPipe[0];
+  items[0].events = ZMQ_POLLIN;
+
+  for (size_t i = 0; i < mSockets.size(); i++)
+  {
+    items[i + 1].socket = static_cast<void*>(*mSockets[i]);
+    items[i + 1].fd = 0;
+    items[i + 1].events = ZMQ_POLLIN;
+  }
+
+  while (true)
+  {
+    try
+    {
+      zmq::poll(&items[0], items.size(), -1);
+    }
+    catch (zmq::error_t& err)
+    {
+      if (err.num() == EINTR)
+        continue;
+
+      eos_err("error in poll: %s", err.what());
+      break;
+    }
+
+    // Replies first as they release waiting threads
+    for (size_t i = 0; i < mSockets.size(); i++)
+    {
+      if (items[i + 1].revents & ZMQ_POLLIN)
+        RecvReplies(mSockets[i]);
+    }
+
+    if (items[0].revents & ZMQ_POLLIN)
+    {
+      char buff[256];
+      ssize_t nread;
+
+      do
+      {
+        nread = read(mWakeupPipe[0], buff, sizeof(buff));
+      }
+      while (nread > 0);
+
+      {
+        XrdSysMutexHelper scope_lock(mMutex);
+
+        if (mShutdown)
+          break;
+      }
+
+      SendQueued();
+    }
+  }
+
+  // Fail whatever is left
+  std::vector<uint64_t> ids;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    mShutdown = true;
+
+    for (size_t i = 0; i < mOutQueue.size(); i++)
+      delete mOutQueue[i].second;
+
+    mOutQueue.clear();
+
+    for (auto it = mPending.begin(); it != mPending.end(); ++it)
+      ids.push_back(it->first);
+  }
+
+  for (size_t i = 0; i < ids.size(); i++)
+    Complete(ids[i], 0);
+
+  eos_info("MGM channel IO thread stopped");
+}
+
+
+//------------------------------------------------------------------------------
+// Send the queued requests to the current master MGM
+//------------------------------------------------------------------------------
+void
+MgmChannel::SendQueued()
+{
+  std::vector< std::pair<uint64_t, zmq::message_t*> > queue;
+  size_t master;
+  {
+    XrdSysMutexHelper scope_lock(mMutex);
+    queue.swap(mOutQueue);
+    mWakeupPending = false;
+    master = mMaster;
+  }
+
+  zmq::socket_t* socket = mSockets[master];
+
+  for (size_t i = 0; i < queue.size(); i++)
+  {
+    uint64_t id = queue[i].first;
+    zmq::message_t* payload = queue[i].second;
+    zmq::message_t id_frame(sizeof(id));
+    zmq::message_t delimiter;
+    bool sent = false;
+    memcpy(id_frame.data(), &id, sizeof(id));
+
+    // Once the first part is accepted all the other parts are as well
+    try
+    {
+      sent = (socket->send(id_frame, ZMQ_SNDMORE | ZMQ_NOBLOCK) &&
+              socket->send(delimiter, ZMQ_SNDMORE) &&
+              socket->send(*payload, 0));
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("exception while sending request id=%llu: %s",
+              (unsigned long long) id, err.what());
+    }
+
+    delete payload;
+
+    if (!sent)
+    {
+      eos_err("unable to send request id=%llu to %s",
+              (unsigned long long) id, mEndpoints[master].c_str());
+      Complete(id, 0);
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Receive all the replies available on a socket
+//------------------------------------------------------------------------------
+void
+MgmChannel::RecvReplies(zmq::socket_t* socket)
+{
+  while (true)
+  {
+    zmq::message_t frames[3];
+    size_t nframes = 0;
+    int more = 0;
+    size_t moresz = sizeof(more);
+
+    try
+    {
+      zmq::message_t frame;
+
+      if (!socket->recv(&frame, ZMQ_NOBLOCK))
+        return;
+
+      // All the parts of a message arrive together
+      do
+      {
+        if (nframes < 3)
+          frames[nframes].move(&frame);
+
+        nframes++;
+        socket->getsockopt(ZMQ_RCVMORE, &more, &moresz);
+      }
+      while (more && socket->recv(&frame));
+    }
+    catch (zmq::error_t& err)
+    {
+      eos_err("exception while receiving reply: %s", err.what());
+      return;
+    }
+
+    if ((nframes != 3) || (frames[0].size() != sizeof(uint64_t)) ||
+        frames[1].size())
+    {
+      eos_err("dropping malformed reply with %lu frames",
+              (unsigned long) nframes);
+      continue;
+    }
+
+    uint64_t id;
+    memcpy(&id, frames[0].data(), sizeof(id));
+    Complete(id, &frames[2]);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Hand the reply over to the waiting request and wake it up
+//------------------------------------------------------------------------------
+void
+MgmChannel::Complete(uint64_t id, zmq::message_t* reply)
+{
+  XrdSysMutexHelper scope_lock(mMutex);
+  std::map<uint64_t, Request*>::iterator iter = mPending.find(id);
+
+  if (iter == mPending.end())
+  {
+    eos_debug("dropping reply of expired request id=%llu",
+              (unsigned long long) id);
+    return;
+  }
+
+  Request* req = iter->second;
+  mPending.erase(iter);
+  req->mCond.Lock();
+
+  if (reply)
+    req->mReply.move(reply);
+  else
+    req->mFailed = true;
+
+  req->mDone = true;
+  req->mCond.Signal();
+  req->mCond.UnLock();
+}
+
+EOSAUTHNAMESPACE_END
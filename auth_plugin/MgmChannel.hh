@@ -0,0 +1,211 @@
+//------------------------------------------------------------------------------
+// File: MgmChannel.hh
+// Author: agent <agent@local>
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSAUTH_MGMCHANNEL_HH__
+#define __EOSAUTH_MGMCHANNEL_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+#include "common/ZMQ.hh"
+#include "common/Logging.hh"
+#include "Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+
+namespace google
+{
+  namespace protobuf
+  {
+    class Message;
+  }
+}
+
+EOSAUTHNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class MgmChannel
+/*! Decription: multiplexed asynchronous channel between the authentication
+    plugin and the MGM nodes. There is only one ZMQ DEALER socket per MGM node
+    and it is driven exclusively by a dedicated IO thread. Every request gets
+    a unique id which is sent in front of the payload as a separate envelope
+    frame:
+
+      [request id (8 bytes)][empty delimiter][serialized RequestProto]
+
+    The ROUTER socket of the MGM keeps the envelope untouched and the REP
+    worker which served the request sends it back in front of the reply,
+    therefore the IO thread can match the replies with the waiting requests
+    no matter the order in which they arrive. Any number of requests can be
+    in flight at the same time - the client threads block only on their own
+    request and no longer on a socket from a fixed size pool.
+*/
+//------------------------------------------------------------------------------
+class MgmChannel: public eos::common::LogId
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Request in flight - lives on the stack of the thread issuing it
+    //--------------------------------------------------------------------------
+    struct Request
+    {
+      uint64_t mId; ///< request id, 0 if not (yet) submitted
+      bool mDone; ///< true once the reply was received or the request failed
+      bool mFailed; ///< true if the request could not be sent
+      zmq::message_t mReply; ///< reply payload
+      XrdSysCondVar mCond; ///< used to wake up the waiting thread
+
+      Request(): mId(0), mDone(false), mFailed(false), mCond(0) { }
+    };
+
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param context ZMQ context used to create the sockets
+    //! @param timeout_ms maximum time a request waits for its reply
+    //--------------------------------------------------------------------------
+    MgmChannel(zmq::context_t* context, int timeout_ms = 5000);
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    virtual ~MgmChannel();
+
+
+    //--------------------------------------------------------------------------
+    //! Connect to the MGM nodes and start the IO thread
+    //!
+    //! @param endpoints MGM endpoints in the format "host:port", requests are
+    //!                  sent to the first one until SetMaster is called
+    //!
+    //! @return true if successful, otherwise false
+    //--------------------------------------------------------------------------
+    bool Start(const std::vector<std::string>& endpoints);
+
+
+    //--------------------------------------------------------------------------
+    //! Stop the IO thread - all requests still in flight fail
+    //--------------------------------------------------------------------------
+    void Stop();
+
+
+    //--------------------------------------------------------------------------
+    //! Serialize and submit a request to the current master MGM
+    //!
+    //! @param req request object which has to stay valid until Wait returns
+    //! @param message object to be sent over the wire
+    //!
+    //! @return true if request submitted, in which case Wait must be called,
+    //!         otherwise false
+    //--------------------------------------------------------------------------
+    bool Submit(Request* req, google::protobuf::Message* message);
+
+
+    //--------------------------------------------------------------------------
+    //! Wait for the reply of a submitted request
+    //!
+    //! @param req submitted request
+    //!
+    //! @return true if the reply is available in req->mReply, false if the
+    //!         request failed or timed out
+    //--------------------------------------------------------------------------
+    bool Wait(Request* req);
+
+
+    //--------------------------------------------------------------------------
+    //! Send all subsequent requests to another MGM node
+    //!
+    //! @param index index of the MGM node in the list of endpoints
+    //--------------------------------------------------------------------------
+    void SetMaster(size_t index);
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of requests currently in flight
+    //--------------------------------------------------------------------------
+    size_t GetInFlight();
+
+  private:
+
+    zmq::context_t* mZmqContext; ///< ZMQ context
+    int mTimeout; ///< reply timeout in milliseconds
+    pthread_t mIoTid; ///< id of the IO thread
+    int mWakeupPipe[2]; ///< pipe used to wake up the IO thread
+    std::vector<std::string> mEndpoints; ///< MGM endpoints "host:port"
+    std::vector<zmq::socket_t*> mSockets; ///< DEALER sockets, IO thread only
+
+    XrdSysMutex mMutex; ///< protects all the members below
+    size_t mMaster; ///< index of the socket pointing to the master MGM
+    bool mShutdown; ///< flag to stop the IO thread
+    uint64_t mLastId; ///< last request id handed out
+    std::map<uint64_t, Request*> mPending; ///< requests waiting for a reply
+    ///! requests (id, payload) waiting to be sent by the IO thread
+    std::vector< std::pair<uint64_t, zmq::message_t*> > mOutQueue;
+    bool mWakeupPending; ///< true if the IO thread has already been woken up
+
+
+    //--------------------------------------------------------------------------
+    //! IO thread startup function
+    //--------------------------------------------------------------------------
+    static void* StartIoThread(void* pp);
+
+
+    //--------------------------------------------------------------------------
+    //! IO thread which sends the queued requests and dispatches the replies
+    //--------------------------------------------------------------------------
+    void IoThread();
+
+
+    //--------------------------------------------------------------------------
+    //! Send the queued requests to the current master MGM - IO thread only
+    //--------------------------------------------------------------------------
+    void SendQueued();
+
+
+    //--------------------------------------------------------------------------
+    //! Receive all the replies available on a socket - IO thread only
+    //!
+    //! @param socket DEALER socket which has incoming messages
+    //--------------------------------------------------------------------------
+    void RecvReplies(zmq::socket_t* socket);
+
+
+    //--------------------------------------------------------------------------
+    //! Hand the reply over to the waiting request and wake it up
+    //!
+    //! @param id request id
+    //! @param reply reply payload or 0 if the request failed
+    //--------------------------------------------------------------------------
+    void Complete(uint64_t id, zmq::message_t* reply);
+};
+
+EOSAUTHNAMESPACE_END
+
+#endif //__EOSAUTH_MGMCHANNEL_HH__
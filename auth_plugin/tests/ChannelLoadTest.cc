@@ -0,0 +1,318 @@
+//------------------------------------------------------------------------------
+// File: ChannelLoadTest.cc
+// Author: agent <agent@local>
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Load test of the authentication plugin request path against a local
+// stand-in MGM which has the same layout as XrdMgmOfs::AuthMasterThread
+// (ROUTER -> DEALER -> REP workers) and answers every stat request with the
+// requested path after a fixed service time.
+// Client threads issue stat requests either through a pool of REQ sockets,
+// as the plugin used to do, or through the multiplexed MgmChannel. Every
+// reply is checked against its request to make sure that nothing gets mixed
+// up when many requests are in flight on the same connection.
+//
+// usage: eosauthloadtest [max client threads] [pool size] [service time us]
+//------------------------------------------------------------------------------
+
+#undef NDEBUG
+#include "auth_plugin/MgmChannel.hh"
+#include "auth_plugin/ProtoUtils.hh"
+#include "common/ConcurrentQueue.hh"
+#include "proto/Request.pb.h"
+#include "proto/Response.pb.h"
+#include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdSec/XrdSecEntity.hh"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace eos::auth;
+
+static const char* sEndpoint = "127.0.0.1:15666";
+static const int sMgmWorkers = 64;
+static const double sRunSeconds = 2.0;
+
+static zmq::context_t* sContext = 0;
+static int sServiceTime = 200;
+static volatile bool sStop = false;
+static bool sUsePool = true;
+static eos::common::ConcurrentQueue<zmq::socket_t*> sPool;
+static MgmChannel* sChannel = 0;
+
+struct Counters
+{
+  size_t ok;
+  size_t failed;
+  char pad[64 - 2 * sizeof(size_t)];
+};
+
+static double
+Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+//------------------------------------------------------------------------------
+// Stand-in MGM - frontend proxy
+//------------------------------------------------------------------------------
+static void*
+MgmProxy(void*)
+{
+  zmq::socket_t frontend(*sContext, ZMQ_ROUTER);
+  zmq::socket_t backend(*sContext, ZMQ_DEALER);
+  std::string endpoint = "tcp://";
+  endpoint += sEndpoint;
+  frontend.bind(endpoint.c_str());
+  backend.bind("inproc://authbackend");
+#if ZMQ_VERSION_MAJOR == 2
+  zmq_device(ZMQ_QUEUE, &frontend, &backend);
+#else
+  zmq::proxy(static_cast<void*>(frontend), static_cast<void*>(backend),
+             static_cast<void*>(0));
+#endif
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Stand-in MGM - worker replying with the requested path
+//------------------------------------------------------------------------------
+static void*
+MgmWorker(void*)
+{
+  zmq::socket_t responder(*sContext, ZMQ_REP);
+
+  while (true)
+  {
+    try
+    {
+      responder.connect("inproc://authbackend");
+    }
+    catch (zmq::error_t& err)
+    {
+      usleep(1000);
+      continue;
+    }
+
+    break;
+  }
+
+  while (true)
+  {
+    zmq::message_t request;
+    responder.recv(&request);
+    RequestProto req_proto;
+    assert(req_proto.ParseFromArray(request.data(), request.size()));
+
+    if (sServiceTime)
+      usleep(sServiceTime);
+
+    ResponseProto resp;
+    resp.set_response(SFS_OK);
+    resp.set_message(req_proto.stat().path());
+    int reply_size = resp.ByteSize();
+    zmq::message_t reply(reply_size);
+    google::protobuf::io::ArrayOutputStream aos(reply.data(), reply_size);
+    resp.SerializeToZeroCopyStream(&aos);
+    responder.send(reply, ZMQ_NOBLOCK);
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Issue one request over a socket from the pool - former implementation
+//------------------------------------------------------------------------------
+static ResponseProto*
+PoolRequest(RequestProto* req_proto)
+{
+  ResponseProto* resp = 0;
+  zmq::socket_t* socket;
+  sPool.wait_pop(socket);
+  int msg_size = req_proto->ByteSize();
+  zmq::message_t request(msg_size);
+  google::protobuf::io::ArrayOutputStream aos(request.data(), msg_size);
+  req_proto->SerializeToZeroCopyStream(&aos);
+
+  if (socket->send(request, ZMQ_NOBLOCK))
+  {
+    zmq::message_t reply;
+
+    if (socket->recv(&reply))
+    {
+      std::string resp_str(static_cast<char*>(reply.data()), reply.size());
+      resp = new ResponseProto();
+      resp->ParseFromString(resp_str);
+    }
+  }
+
+  sPool.push(socket);
+  return resp;
+}
+
+//------------------------------------------------------------------------------
+// Issue one request over the multiplexed channel
+//------------------------------------------------------------------------------
+static ResponseProto*
+ChannelRequest(RequestProto* req_proto)
+{
+  ResponseProto* resp = 0;
+  MgmChannel::Request request;
+
+  if (sChannel->Submit(&request, req_proto) && sChannel->Wait(&request))
+  {
+    resp = new ResponseProto();
+    resp->ParseFromArray(request.mReply.data(), request.mReply.size());
+  }
+
+  return resp;
+}
+
+//------------------------------------------------------------------------------
+// Client thread
+//------------------------------------------------------------------------------
+static void*
+Client(void* arg)
+{
+  Counters* counters = static_cast<Counters*>(arg);
+  XrdOucErrInfo error;
+  XrdSecEntity client("unix");
+  client.name = (char*) "loadtest";
+  client.host = (char*) "localhost";
+  client.tident = (char*) "loadtest.1:1@localhost";
+  size_t seq = 0;
+
+  while (!sStop)
+  {
+    std::ostringstream sstr;
+    sstr << "/eos/loadtest/" << (void*) counters << "/" << seq++;
+    std::string path = sstr.str();
+    RequestProto* req_proto = utils::GetStatRequest(
+                                RequestProto_OperationType_STAT,
+                                path.c_str(), error, &client, "");
+    ResponseProto* resp = sUsePool ? PoolRequest(req_proto) :
+                          ChannelRequest(req_proto);
+
+    if (resp && (resp->response() == SFS_OK) && (resp->message() == path))
+      counters->ok++;
+    else
+      counters->failed++;
+
+    delete resp;
+    delete req_proto;
+  }
+
+  client.name = client.host = client.tident = 0;
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t max_threads = (argc > 1) ? atoi(argv[1]) : 256;
+  int pool_size = (argc > 2) ? atoi(argv[2]) : 10;
+  sServiceTime = (argc > 3) ? atoi(argv[3]) : 200;
+  eos::common::Logging::Init();
+  eos::common::Logging::SetUnit("AuthLoadTest");
+  eos::common::Logging::SetLogPriority(LOG_NOTICE);
+  sContext = new zmq::context_t(1);
+  pthread_t tid;
+  pthread_create(&tid, 0, MgmProxy, 0);
+
+  for (int i = 0; i < sMgmWorkers; i++)
+    pthread_create(&tid, 0, MgmWorker, 0);
+
+  std::string endpoint = "tcp://";
+  endpoint += sEndpoint;
+
+  for (int i = 0; i < pool_size; i++)
+  {
+    zmq::socket_t* socket = new zmq::socket_t(*sContext, ZMQ_REQ);
+    int timeout_mili = 5000;
+    socket->setsockopt(ZMQ_RCVTIMEO, &timeout_mili, sizeof timeout_mili);
+    socket->connect(endpoint.c_str());
+    sPool.push(socket);
+  }
+
+  sChannel = new MgmChannel(sContext);
+  std::vector<std::string> endpoints;
+  endpoints.push_back(sEndpoint);
+  assert(sChannel->Start(endpoints));
+  fprintf(stdout, "stand-in MGM: %i workers, %i us per request\n",
+          sMgmWorkers, sServiceTime);
+  fprintf(stdout, "%8s %24s %24s\n", "threads", "socket pool [req/s]",
+          "channel [req/s]");
+
+  for (size_t nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+  {
+    fprintf(stdout, "%8lu", (unsigned long) nthreads);
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+      sUsePool = (mode == 0);
+      sStop = false;
+      std::vector<pthread_t> tids(nthreads);
+      std::vector<Counters> counters(nthreads);
+      memset(&counters[0], 0, nthreads * sizeof(Counters));
+      double start = Now();
+
+      for (size_t i = 0; i < nthreads; i++)
+        pthread_create(&tids[i], 0, Client, &counters[i]);
+
+      usleep((useconds_t)(sRunSeconds * 1e6));
+      sStop = true;
+
+      for (size_t i = 0; i < nthreads; i++)
+        pthread_join(tids[i], 0);
+
+      double elapsed = Now() - start;
+      size_t ok = 0;
+      size_t failed = 0;
+
+      for (size_t i = 0; i < nthreads; i++)
+      {
+        ok += counters[i].ok;
+        failed += counters[i].failed;
+      }
+
+      assert(failed == 0);
+      fprintf(stdout, " %24.0f", ok / elapsed);
+    }
+
+    fprintf(stdout, "\n");
+    assert(sChannel->GetInFlight() == 0);
+  }
+
+  sChannel->Stop();
+  return 0;
+}
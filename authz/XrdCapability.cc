@@ -33,9 +33,12 @@
 #include "XrdOuc/XrdOucString.hh"
 #include "XrdSys/XrdSysError.hh"
 /*----------------------------------------------------------------------------*/
+#include <openssl/rand.h>
+#include <openssl/sha.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <stdint.h>
 
 #ifdef __APPLE__
 #define ENOKEY 126
@@ -48,6 +51,220 @@ XrdOucTrace TkTrace(&TkEroute);
 /*----------------------------------------------------------------------------*/
 XrdCapability gCapabilityEngine;
 
+XrdCapability::eFormat XrdCapability::sFormat = XrdCapability::kBinaryFormat;
+XrdSysMutex XrdCapability::sCacheMutex;
+size_t XrdCapability::sCacheSize = 0;
+XrdCapability::cache_t XrdCapability::sCache;
+XrdCapability::cache_t XrdCapability::sCacheOld;
+unsigned long long XrdCapability::sCacheHits = 0;
+unsigned long long XrdCapability::sCacheMisses = 0;
+
+/*----------------------------------------------------------------------------*/
+/* Binary capability format                                                   */
+/*                                                                            */
+/* cap.msg=2.<base64url without padding of>                                   */
+/*   header : 'E' 'C' <version> 0   - authenticated but not encrypted         */
+/*   nonce  : 12 random bytes                                                 */
+/*   body   : AES-256-GCM encrypted                                           */
+/*            u64 validity, u16 mask of the fixed fields present,             */
+/*            fixed fields in table order (u32/u64),                          */
+/*            extras as TLV: u8 type, u16 length, value                       */
+/*   tag    : 16 bytes GCM tag                                                */
+/*                                                                            */
+/* All integers are little endian. Numeric values are only stored as fixed    */
+/* fields if they decode to exactly the same text, everything else goes into */
+/* the extras so that Extract always returns the env given to Create. The     */
+/* '.' of the prefix can not appear in the base64 text of the legacy format.  */
+/*----------------------------------------------------------------------------*/
+namespace
+{
+  const unsigned char kCapVersion = XrdCapability::kBinaryFormat;
+  const size_t kCapHeaderLen = 4;
+  const size_t kCapNonceLen = 12;
+  const size_t kCapTagLen = 16;
+
+  //! Numeric fields of the MGM capabilities stored in fixed size
+  struct FixedField {
+    const char* key;
+    bool wide; //< 64 bit value, otherwise 32 bit
+    bool hex; //< value in %08llx format like FileId::Fid2Hex
+  };
+
+  const FixedField kFixedFields[] = {
+    {"mgm.ruid", false, false},
+    {"mgm.rgid", false, false},
+    {"mgm.uid", false, false},
+    {"mgm.gid", false, false},
+    {"mgm.fid", true, true},
+    {"mgm.cid", true, false},
+    {"mgm.fsid", false, false},
+    {"mgm.lid", false, false},
+    {"mgm.bookingsize", true, false}
+  };
+
+  const size_t kNFixedFields = sizeof(kFixedFields) / sizeof(kFixedFields[0]);
+
+  //! Text fields with their own TLV type, type 0 carries "key=value"
+  const char* kTlvKeys[] = {
+    0,
+    "mgm.access",
+    "mgm.path",
+    "mgm.manager",
+    "mgm.sec"
+  };
+
+  const size_t kNTlvKeys = sizeof(kTlvKeys) / sizeof(kTlvKeys[0]);
+
+  const char kB64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+  //----------------------------------------------------------------------------
+  // Base64url encoding without padding - the result is safe in an opaque env
+  //----------------------------------------------------------------------------
+  void
+  B64UrlEncode (const unsigned char* in, size_t len, std::string &out)
+  {
+    out.reserve(out.size() + ((len + 2) / 3) * 4);
+    size_t i = 0;
+
+    for (; i + 2 < len; i += 3) {
+      uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+      out += kB64Chars[(v >> 18) & 0x3f];
+      out += kB64Chars[(v >> 12) & 0x3f];
+      out += kB64Chars[(v >> 6) & 0x3f];
+      out += kB64Chars[v & 0x3f];
+    }
+
+    if (i < len) {
+      uint32_t v = in[i] << 16;
+
+      if (i + 1 < len)
+        v |= in[i + 1] << 8;
+
+      out += kB64Chars[(v >> 18) & 0x3f];
+      out += kB64Chars[(v >> 12) & 0x3f];
+
+      if (i + 1 < len)
+        out += kB64Chars[(v >> 6) & 0x3f];
+    }
+  }
+
+  int
+  B64UrlValue (char c)
+  {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-') return 62;
+    if (c == '_') return 63;
+    return -1;
+  }
+
+  bool
+  B64UrlDecode (const char* in, std::string &out)
+  {
+    uint32_t v = 0;
+    int bits = 0;
+
+    for (; *in; in++) {
+      int c = B64UrlValue(*in);
+
+      if (c < 0)
+        return false;
+
+      v = (v << 6) | c;
+      bits += 6;
+
+      if (bits >= 8) {
+        bits -= 8;
+        out += (char) ((v >> bits) & 0xff);
+      }
+    }
+
+    // a single dangling character can not encode a byte
+    return (bits < 6);
+  }
+
+  void
+  PutInt (std::string &out, uint64_t v, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+      out += (char) ((v >> (8 * i)) & 0xff);
+  }
+
+  bool
+  GetInt (const std::string &in, size_t &pos, size_t len, uint64_t &v)
+  {
+    if (pos + len > in.size())
+      return false;
+
+    v = 0;
+
+    for (size_t i = 0; i < len; i++)
+      v |= ((uint64_t) (unsigned char) in[pos + i]) << (8 * i);
+
+    pos += len;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Parse a numeric value if printing it back gives the very same text
+  //----------------------------------------------------------------------------
+  bool
+  ParseCanonical (const char* val, size_t len, const FixedField &field,
+                  uint64_t &out)
+  {
+    if (!len || len > 20)
+      return false;
+
+    if (field.hex) {
+      // %08llx: lower case, zero padded to 8 digits, no further padding
+      if (len < 8 || (len > 8 && val[0] == '0') || len > 16)
+        return false;
+    } else if (len > 1 && val[0] == '0') {
+      return false;
+    }
+
+    uint64_t v = 0;
+    uint64_t max = field.wide ? 0xffffffffffffffffULL : 0xffffffffULL;
+
+    for (size_t i = 0; i < len; i++) {
+      unsigned int d;
+
+      if (val[i] >= '0' && val[i] <= '9')
+        d = val[i] - '0';
+      else if (field.hex && val[i] >= 'a' && val[i] <= 'f')
+        d = val[i] - 'a' + 10;
+      else
+        return false;
+
+      unsigned int base = field.hex ? 16 : 10;
+
+      if (v > (max - d) / base)
+        return false;
+
+      v = v * base + d;
+    }
+
+    out = v;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Derive the AES-256 key from the 20 byte shared symmetric key
+  //----------------------------------------------------------------------------
+  void
+  DeriveKey (eos::common::SymKey* key, unsigned char* aeskey)
+  {
+    static const char kLabel[] = "eos-capability-v2";
+    SHA256_CTX sha;
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, key->GetKey(), SHA_DIGEST_LENGTH);
+    SHA256_Update(&sha, kLabel, sizeof(kLabel) - 1);
+    SHA256_Final(aeskey, &sha);
+  }
+}
+
 /*----------------------------------------------------------------------------*/
 XrdAccPrivs
 XrdCapability::Access(const XrdSecEntity    *Entity,
@@ -112,6 +329,21 @@ XrdCapability::Create(XrdOucEnv *inenv,
     return EINVAL;
 
   int envlen;
+  XrdOucString encenv = "";
+
+  if (sFormat == kBinaryFormat) {
+    std::string sealed;
+
+    // fall back to the legacy format if the env can not be encoded
+    if (EncodeBinary(inenv->Env(envlen), time(NULL) + cap_validity, key,
+                     sealed)) {
+      encenv += "cap.sym="; encenv += key->GetDigest64();
+      encenv += "&cap.msg=2."; encenv += sealed.c_str();
+      outenv = new XrdOucEnv(encenv.c_str());
+      return 0;
+    }
+  }
+
   XrdOucString toencrypt = inenv->Env(envlen);
   
   // Add the validity time - default 1 hour
@@ -127,7 +359,6 @@ XrdCapability::Create(XrdOucEnv *inenv,
     return EKEYREJECTED;
   } 
   
-  XrdOucString encenv = "";
   encenv += "cap.sym="; encenv+= key->GetDigest64();
   encenv += "&cap.msg="; encenv += encrypted;
   while (encenv.replace('\n','#')) {};
@@ -143,50 +374,374 @@ XrdCapability::Extract(XrdOucEnv *inenv, XrdOucEnv* &outenv)
   if (!inenv)
     return EINVAL;
 
-  int envlen;
-  XrdOucString instring = inenv->Env(envlen);
-  while (instring.replace('#','\n')) {};
-  XrdOucEnv fixedenv(instring.c_str());
-
-  //  fprintf(stderr,"Extracting: %s\n", fixedenv.Env(envlen));
-  const char* symkey = fixedenv.Get("cap.sym");
-  const char* symmsg = fixedenv.Get("cap.msg");
+  const char* symkey = inenv->Get("cap.sym");
+  const char* symmsg = inenv->Get("cap.msg");
 
-  //  fprintf(stderr,"%s\n%s\n", symkey, symmsg);
   if ( (!symkey) || (!symmsg) ) 
     return EINVAL;
-  
+
+  // ---------------------------------------------------------------------------
+  // the key has to be in the key store even for a cached capability, so that
+  // a key removed from the store or expired stops its capabilities
+  // ---------------------------------------------------------------------------
   eos::common::SymKey* key = 0;
   if (!(key = eos::common::gSymKeyStore.GetKey(symkey))) {
     return ENOKEY;
   }
-  
-  XrdOucString todecrypt = symmsg;
-  XrdOucString decrypted ="";
-  if (!XrdMqMessage::SymmetricStringDecrypt(todecrypt, 
-                                            decrypted, 
-                                            (char*)key->GetKey())) {
-    return EKEYREJECTED;
-  } 
-  
-  outenv = new XrdOucEnv(decrypted.c_str());
+
+  // ---------------------------------------------------------------------------
+  // a capability verified before with the same key does not need to be
+  // decrypted again - the cache is keyed on the digest of the key found
+  // ---------------------------------------------------------------------------
+  CacheEntry entry;
+  std::string tag;
+
+  if (sCacheSize) {
+    tag = key->GetDigest64();
+    tag += '&';
+    tag += symmsg;
+  }
+
+  if (!tag.empty() && CacheGet(tag, entry)) {
+    outenv = new XrdOucEnv(entry.env.c_str());
+  } else {
+    if ((symmsg[0] == '2') && (symmsg[1] == '.')) {
+      int rc = DecodeBinary(symmsg + 2, key, entry.env, entry.valid);
+
+      if (rc)
+        return rc;
+
+      outenv = new XrdOucEnv(entry.env.c_str());
+    } else {
+      XrdOucString todecrypt = symmsg;
+      while (todecrypt.replace('#','\n')) {};
+      XrdOucString decrypted ="";
+      if (!XrdMqMessage::SymmetricStringDecrypt(todecrypt, 
+                                                decrypted, 
+                                                (char*)key->GetKey())) {
+        return EKEYREJECTED;
+      } 
+
+      outenv = new XrdOucEnv(decrypted.c_str());
+
+      if (!outenv->Get("cap.valid")) {
+        // validity missing
+        return EINVAL;
+      }
+
+      entry.env = decrypted.c_str();
+      entry.valid = atoi(outenv->Get("cap.valid"));
+    }
+
+    if (!tag.empty() && (entry.valid >= time(NULL)))
+      CachePut(tag, entry);
+  }
   
   // ---------------------------------------------------------------------------
   // check the validity time
   // ---------------------------------------------------------------------------
-  if (!outenv->Get("cap.valid")) {
-    // validity missing
+  // capability expired!
+  if (entry.valid < time(NULL))
+    return ETIME;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+XrdCapability::EncodeBinary(const char* env, time_t valid,
+                            eos::common::SymKey* key, std::string &out)
+{
+  // ---------------------------------------------------------------------------
+  // encode the body
+  // ---------------------------------------------------------------------------
+  uint64_t fixed[kNFixedFields];
+  uint16_t mask = 0;
+  std::string extras;
+
+  while (env && *env) {
+    if (*env == '&') {
+      env++;
+      continue;
+    }
+
+    const char* end = strchr(env, '&');
+    size_t len = end ? (size_t) (end - env) : strlen(env);
+    const char* eq = (const char*) memchr(env, '=', len);
+    size_t keylen = eq ? (size_t) (eq - env) : len;
+    const char* val = eq ? eq + 1 : env + len;
+    size_t vallen = len - keylen - (eq ? 1 : 0);
+    bool done = false;
+
+    for (size_t i = 0; eq && (i < kNFixedFields); i++) {
+      if ((strlen(kFixedFields[i].key) == keylen) &&
+          !strncmp(kFixedFields[i].key, env, keylen) &&
+          !(mask & (1 << i)) &&
+          ParseCanonical(val, vallen, kFixedFields[i], fixed[i])) {
+        mask |= (1 << i);
+        done = true;
+        break;
+      }
+    }
+
+    for (size_t i = 1; eq && !done && (i < kNTlvKeys); i++) {
+      if ((strlen(kTlvKeys[i]) == keylen) && !strncmp(kTlvKeys[i], env, keylen)) {
+        if (vallen > 0xffff)
+          return false;
+
+        extras += (char) i;
+        PutInt(extras, vallen, 2);
+        extras.append(val, vallen);
+        done = true;
+      }
+    }
+
+    if (!done) {
+      if (len > 0xffff)
+        return false;
+
+      extras += (char) 0;
+      PutInt(extras, len, 2);
+      extras.append(env, len);
+    }
+
+    env += len;
+  }
+
+  std::string body;
+  body.reserve(10 + 8 * kNFixedFields + extras.size());
+  PutInt(body, (uint64_t) valid, 8);
+  PutInt(body, mask, 2);
+
+  for (size_t i = 0; i < kNFixedFields; i++) {
+    if (mask & (1 << i))
+      PutInt(body, fixed[i], kFixedFields[i].wide ? 8 : 4);
+  }
+
+  body += extras;
+
+  // ---------------------------------------------------------------------------
+  // seal it
+  // ---------------------------------------------------------------------------
+  unsigned char aeskey[SHA256_DIGEST_LENGTH];
+  DeriveKey(key, aeskey);
+  std::string sealed(kCapHeaderLen + kCapNonceLen + body.size() + kCapTagLen, 0);
+  unsigned char* ptr = (unsigned char*) &sealed[0];
+  ptr[0] = 'E';
+  ptr[1] = 'C';
+  ptr[2] = kCapVersion;
+  ptr[3] = 0;
+  unsigned char* nonce = ptr + kCapHeaderLen;
+  unsigned char* cipher = nonce + kCapNonceLen;
+  unsigned char* tag = cipher + body.size();
+
+  if (RAND_bytes(nonce, kCapNonceLen) != 1)
+    return false;
+
+  EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+
+  if (!ctx)
+    return false;
+
+  int len = 0;
+  int finallen = 0;
+  bool ok =
+    EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), 0, 0, 0) &&
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, kCapNonceLen, 0) &&
+    EVP_EncryptInit_ex(ctx, 0, 0, aeskey, nonce) &&
+    EVP_EncryptUpdate(ctx, 0, &len, ptr, kCapHeaderLen) &&
+    EVP_EncryptUpdate(ctx, cipher, &len, (const unsigned char*) body.data(),
+                      body.size()) &&
+    EVP_EncryptFinal_ex(ctx, cipher + len, &finallen) &&
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, kCapTagLen, tag);
+  EVP_CIPHER_CTX_free(ctx);
+
+  if (!ok || ((size_t) (len + finallen) != body.size()))
+    return false;
+
+  out.clear();
+  B64UrlEncode(ptr, sealed.size(), out);
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+XrdCapability::DecodeBinary(const char* msg, eos::common::SymKey* key,
+                            std::string &env, time_t &valid)
+{
+  std::string sealed;
+
+  if (!B64UrlDecode(msg, sealed) ||
+      (sealed.size() < kCapHeaderLen + kCapNonceLen + kCapTagLen + 10))
     return EINVAL;
-  } else {
-    time_t now = time(NULL);
-    time_t capnow = atoi(outenv->Get("cap.valid"));
-    // capability expired!
-    if (capnow < now)
-      return ETIME;
+
+  const unsigned char* ptr = (const unsigned char*) sealed.data();
+
+  if ((ptr[0] != 'E') || (ptr[1] != 'C') || (ptr[2] != kCapVersion))
+    return EINVAL;
+
+  // ---------------------------------------------------------------------------
+  // open it
+  // ---------------------------------------------------------------------------
+  unsigned char aeskey[SHA256_DIGEST_LENGTH];
+  DeriveKey(key, aeskey);
+  const unsigned char* nonce = ptr + kCapHeaderLen;
+  const unsigned char* cipher = nonce + kCapNonceLen;
+  size_t bodylen = sealed.size() - kCapHeaderLen - kCapNonceLen - kCapTagLen;
+  unsigned char* tag = (unsigned char*) cipher + bodylen;
+  std::string body(bodylen, 0);
+  EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+
+  if (!ctx)
+    return ENOMEM;
+
+  int len = 0;
+  int finallen = 0;
+  bool ok =
+    EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), 0, 0, 0) &&
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, kCapNonceLen, 0) &&
+    EVP_DecryptInit_ex(ctx, 0, 0, aeskey, nonce) &&
+    EVP_DecryptUpdate(ctx, 0, &len, ptr, kCapHeaderLen) &&
+    EVP_DecryptUpdate(ctx, (unsigned char*) &body[0], &len, cipher, bodylen) &&
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, kCapTagLen, tag) &&
+    (EVP_DecryptFinal_ex(ctx, (unsigned char*) &body[0] + len, &finallen) > 0);
+  EVP_CIPHER_CTX_free(ctx);
+
+  if (!ok)
+    return EKEYREJECTED;
+
+  // ---------------------------------------------------------------------------
+  // decode the body
+  // ---------------------------------------------------------------------------
+  size_t pos = 0;
+  uint64_t v;
+
+  if (!GetInt(body, pos, 8, v))
+    return EINVAL;
+
+  valid = (time_t) v;
+
+  if (!GetInt(body, pos, 2, v))
+    return EINVAL;
+
+  uint16_t mask = v;
+  char number[32];
+  env.clear();
+  env.reserve(2 * body.size());
+
+  for (size_t i = 0; i < kNFixedFields; i++) {
+    if (!(mask & (1 << i)))
+      continue;
+
+    if (!GetInt(body, pos, kFixedFields[i].wide ? 8 : 4, v))
+      return EINVAL;
+
+    snprintf(number, sizeof(number), kFixedFields[i].hex ? "%08llx" : "%llu",
+             (unsigned long long) v);
+    env += '&';
+    env += kFixedFields[i].key;
+    env += '=';
+    env += number;
+  }
+
+  while (pos < body.size()) {
+    uint64_t type;
+    uint64_t vallen;
+
+    if (!GetInt(body, pos, 1, type) || !GetInt(body, pos, 2, vallen) ||
+        (pos + vallen > body.size()) || (type >= kNTlvKeys))
+      return EINVAL;
+
+    env += '&';
+
+    if (type) {
+      env += kTlvKeys[type];
+      env += '=';
+    }
+
+    env.append(body, pos, vallen);
+    pos += vallen;
   }
+
+  snprintf(number, sizeof(number), "%llu", (unsigned long long) valid);
+  env += "&cap.valid=";
+  env += number;
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+XrdCapability::SetCacheSize(size_t size)
+{
+  XrdSysMutexHelper lock(sCacheMutex);
+  sCacheSize = size;
+  sCache.clear();
+  sCacheOld.clear();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+XrdCapability::GetCacheStatistics(unsigned long long &hits,
+                                  unsigned long long &misses)
+{
+  XrdSysMutexHelper lock(sCacheMutex);
+  hits = sCacheHits;
+  misses = sCacheMisses;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+XrdCapability::CacheGet(const std::string &tag, CacheEntry &entry)
+{
+  XrdSysMutexHelper lock(sCacheMutex);
+  cache_t::iterator it = sCache.find(tag);
+
+  if (it != sCache.end()) {
+    sCacheHits++;
+    entry = it->second;
+    return true;
+  }
+
+  it = sCacheOld.find(tag);
+
+  if (it == sCacheOld.end()) {
+    sCacheMisses++;
+    return false;
+  }
+
+  // still in use - move it to the current generation
+  sCacheHits++;
+  entry = it->second;
+  sCacheOld.erase(it);
+
+  if (sCache.size() >= sCacheSize) {
+    sCacheOld.swap(sCache);
+    sCache.clear();
+  }
+
+  sCache[tag] = entry;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+XrdCapability::CachePut(const std::string &tag, const CacheEntry &entry)
+{
+  XrdSysMutexHelper lock(sCacheMutex);
+
+  if (!sCacheSize)
+    return;
+
+  // the cache keeps two generations, the older one is dropped as a whole
+  // once the current one is full
+  if (sCache.size() >= sCacheSize) {
+    sCacheOld.swap(sCache);
+    sCache.clear();
+  }
+
+  sCache[tag] = entry;
+}
+
 //------------------------------------------------------------------------------
 // Destructor
 //------------------------------------------------------------------------------
@@ -42,6 +42,9 @@
 #include <openssl/err.h>
 #include <openssl/pem.h>
 /*----------------------------------------------------------------------------*/
+#include <map>
+#include <string>
+/*----------------------------------------------------------------------------*/
 class XrdOucEnv;
 class XrdSecEntity;
 /*----------------------------------------------------------------------------*/
@@ -95,14 +98,58 @@ public:
 
   XrdCapability(){}
 
+  //! Capability formats understood by Extract
+  enum eFormat {
+    kLegacyFormat = 1, //< encrypted and base64 encoded opaque env text
+    kBinaryFormat = 2  //< fixed fields and TLV extras sealed with AES-256-GCM
+  };
+
   static int Create(XrdOucEnv *inenv, XrdOucEnv* &outenv,
                     eos::common::SymKey* symkey, uint64_t cap_validity);
 
   static int Extract(XrdOucEnv *inenv, XrdOucEnv* &outenv);
 
+  // Select the format produced by Create - default kBinaryFormat
+  static void SetFormat(eFormat format) { sFormat = format; }
+
+  // Enable the cache of verified capabilities used by Extract, keeping at
+  // least 'size' entries - 0 disables the cache (default)
+  static void SetCacheSize(size_t size);
+
+  // Get the number of Extract calls served from/missing in the cache
+  static void GetCacheStatistics(unsigned long long &hits,
+                                 unsigned long long &misses);
+
   virtual                  ~XrdCapability();
 
 private:
+  //! Verified capability kept in the cache
+  struct CacheEntry {
+    std::string env; //< decrypted opaque env
+    time_t valid; //< expiration time of the capability
+  };
+
+  typedef std::map<std::string, CacheEntry> cache_t;
+
+  static eFormat sFormat; //< format produced by Create
+  static XrdSysMutex sCacheMutex; //< protects the cache members below
+  static size_t sCacheSize; //< number of entries per cache generation
+  static cache_t sCache; //< entries verified recently
+  static cache_t sCacheOld; //< entries of the previous generation
+  static unsigned long long sCacheHits; //< Extract calls served from the cache
+  static unsigned long long sCacheMisses; //< Extract calls missing in the cache
+
+  // Encode and seal an opaque env in the binary format
+  static bool EncodeBinary(const char* env, time_t valid,
+                           eos::common::SymKey* key, std::string &out);
+
+  // Open and decode a capability in the binary format
+  static int DecodeBinary(const char* msg, eos::common::SymKey* key,
+                          std::string &env, time_t &valid);
+
+  // Look up/add a verified capability in the cache
+  static bool CacheGet(const std::string &tag, CacheEntry &entry);
+  static void CachePut(const std::string &tag, const CacheEntry &entry);
 };
 
 /*----------------------------------------------------------------------------*/
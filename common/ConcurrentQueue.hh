@@ -27,9 +27,10 @@
 
 /*----------------------------------------------------------------------------*/
 #include "common/Namespace.hh"
+#include "common/RingQueue.hh"
 /*----------------------------------------------------------------------------*/
 #include <cstdio>
-#include <queue>
+#include <deque>
 #include <pthread.h>
 #include <common/Logging.hh>
 /*----------------------------------------------------------------------------*/
@@ -37,41 +38,66 @@
 EOSCOMMONNAMESPACE_BEGIN
 
 //------------------------------------------------------------------------------
-//! Thread-safe queue implementation using mutexes
+//! Thread-safe unbounded queue. The elements go through a lock-free ring
+//! (RingQueue) and only once the ring is full they spill over into a mutex
+//! protected deque. While there are spilled elements all new elements are
+//! spilled as well so that the order of the elements pushed by one thread is
+//! kept, the consumers move them back into the ring as soon as there is room.
+//! Blocked consumers are woken up one per pushed element. The number of
+//! elements is counted separately, so that push_size reserves its element
+//! atomically.
 //------------------------------------------------------------------------------
 template <typename Data>
 class ConcurrentQueue: public LogId
 {
 public:
-  ConcurrentQueue();
+  ConcurrentQueue(size_t ring_size = 256);
   ~ConcurrentQueue();
 
   size_t size();
   void push(Data& data);
   bool push_size(Data &data, size_t max_size);
+  void push_batch(const Data* data, size_t count);
 
   bool empty();
 
+  bool front(Data& value);
   bool try_pop(Data& popped_value);
   void wait_pop(Data& popped_value);
+  size_t try_pop_batch(Data* popped_values, size_t max_count);
   void clear();
 
 private:
-  std::queue<Data> queue;
-  pthread_mutex_t mutex;
-  pthread_cond_t cond;
+  RingQueue<Data> mRing; ///< lock-free fast path
+  volatile size_t mSize; ///< elements pushed or reserved and not popped
+  volatile size_t mSpilled; ///< number of elements in mSpill
+  pthread_mutex_t mMutex; ///< protects mSpill
+  std::deque<Data> mSpill; ///< elements which did not fit into the ring
+  EventCount mNotEmpty; ///< consumers waiting for elements
+
+  void Enqueue(const Data* data, size_t count);
+  void Spill(const Data* data, size_t count);
+  bool Unspill(Data& popped_value);
+
+  //! Not copyable - share a reference instead
+  ConcurrentQueue(const ConcurrentQueue&);
+  ConcurrentQueue& operator = (const ConcurrentQueue&);
 };
 
 
 //------------------------------------------------------------------------------
 //! Constructor
+//!
+//! @param ring_size capacity of the lock-free ring
 //------------------------------------------------------------------------------
 template <typename Data>
-ConcurrentQueue<Data>::ConcurrentQueue():
-    eos::common::LogId()
+ConcurrentQueue<Data>::ConcurrentQueue(size_t ring_size):
+    eos::common::LogId(),
+    mRing(ring_size),
+    mSize(0),
+    mSpilled(0)
 {
-  pthread_mutex_init(&mutex, NULL);
-  pthread_cond_init(&cond, NULL);
+  pthread_mutex_init(&mMutex, NULL);
 }
 
 //------------------------------------------------------------------------------
@@ -80,23 +106,18 @@ ConcurrentQueue<Data>::ConcurrentQueue():
 template <typename Data>
 ConcurrentQueue<Data>::~ConcurrentQueue()
 {
-  pthread_mutex_destroy(&mutex);
-  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mMutex);
 }
 
 
 //------------------------------------------------------------------------------
-//! Get size of the queue
+//! Get size of the queue - exact only if there are no concurrent operations
 //------------------------------------------------------------------------------
 template <typename Data>
 size_t
 ConcurrentQueue<Data>::size()
 {
-  size_t size = 0;
-  pthread_mutex_lock(&mutex);
-  size = queue.size();
-  pthread_mutex_unlock(&mutex);
-  return size;
+  return mSize;
 }
 
 
@@ -107,10 +128,7 @@ template <typename Data>
 void
 ConcurrentQueue<Data>::push(Data &data)
 {
-  pthread_mutex_lock(&mutex);
-  queue.push(data);
-  pthread_cond_broadcast(&cond);
-  pthread_mutex_unlock(&mutex);
+  push_batch(&data, 1);
 }
 
 
@@ -125,18 +143,56 @@ template <typename Data>
 bool
 ConcurrentQueue<Data>::push_size(Data &data, size_t max_size)
 {
-  bool ret_val = false;
-  pthread_mutex_lock(&mutex);
-  
-  if (queue.size() <= max_size)
+  // Reserve the element first so that concurrent producers cannot exceed
+  // max_size together
+  size_t cur = mSize;
+
+  while (true)
   {
-    queue.push(data);
-    ret_val = true;
-    pthread_cond_broadcast(&cond);
+    if (cur > max_size)
+      return false;
+
+    size_t old = __sync_val_compare_and_swap(&mSize, cur, cur + 1);
+
+    if (old == cur)
+      break;
+
+    cur = old;
   }
-  
-  pthread_mutex_unlock(&mutex);
-  return ret_val;  
+
+  Enqueue(&data, 1);
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+//! Push several elements to the queue, in order
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+ConcurrentQueue<Data>::push_batch(const Data* data, size_t count)
+{
+  __sync_fetch_and_add(&mSize, count);
+  Enqueue(data, count);
+}
+
+
+//------------------------------------------------------------------------------
+//! Put elements already counted in mSize into the ring or the spill deque
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+ConcurrentQueue<Data>::Enqueue(const Data* data, size_t count)
+{
+  size_t n = 0;
+
+  if (!mSpilled)
+    n = mRing.try_push_batch(data, count);
+
+  if (n < count)
+    Spill(data + n, count - n);
+
+  mNotEmpty.Notify(count);
 }
 
 
@@ -147,10 +203,7 @@ template <typename Data>
 bool
 ConcurrentQueue<Data>::empty()
 {
-  pthread_mutex_lock(&mutex);
-  bool emptyState = queue.empty();
-  pthread_mutex_unlock(&mutex);
-  return emptyState;
+  return (size() == 0);
 }
 
 
@@ -161,17 +214,66 @@ template <typename Data>
 bool
 ConcurrentQueue<Data>::try_pop(Data& popped_value)
 {
-  pthread_mutex_lock(&mutex);
+  if (mRing.try_pop(popped_value) || (mSpilled && Unspill(popped_value)))
+  {
+    __sync_fetch_and_sub(&mSize, 1);
+    return true;
+  }
+
+  return false;
+}
 
-  if(queue.empty()) {
-    pthread_mutex_unlock(&mutex);
-    return false;
+
+//------------------------------------------------------------------------------
+//! Get a copy of the oldest element without removing it - the queue must not
+//! be popped concurrently, e.g. a queue of sticky errors which is only read
+//!
+//! @return false if the queue is empty
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+ConcurrentQueue<Data>::front(Data& value)
+{
+  if (mRing.front(value))
+    return true;
+
+  bool found = false;
+  pthread_mutex_lock(&mMutex);
+
+  // The ring might have been filled in the meantime, its elements are older
+  if (mRing.front(value))
+  {
+    found = true;
+  }
+  else if (!mSpill.empty())
+  {
+    value = mSpill.front();
+    found = true;
   }
 
-  popped_value = queue.front();
-  queue.pop();
-  pthread_mutex_unlock(&mutex);
-  return true;
+  pthread_mutex_unlock(&mMutex);
+  return found;
+}
+
+
+//------------------------------------------------------------------------------
+//! Get up to max_count elements from the queue, in order
+//!
+//! @return number of elements popped
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+ConcurrentQueue<Data>::try_pop_batch(Data* popped_values, size_t max_count)
+{
+  size_t n = mRing.try_pop_batch(popped_values, max_count);
+
+  while ((n < max_count) && mSpilled && Unspill(popped_values[n]))
+    n++;
+
+  if (n)
+    __sync_fetch_and_sub(&mSize, n);
+
+  return n;
 }
 
 
@@ -183,15 +285,19 @@ template <typename Data>
 void
 ConcurrentQueue<Data>::wait_pop(Data& popped_value)
 {
-  pthread_mutex_lock(&mutex);
-  while(queue.empty()) {
-    pthread_cond_wait(&cond, &mutex);
+  while (!try_pop(popped_value))
+  {
+    int key = mNotEmpty.Prepare();
+
+    if (try_pop(popped_value))
+    {
+      mNotEmpty.Cancel();
+      return;
+    }
+
+    mNotEmpty.Wait(key);
     eos_static_debug("wait on concurrent queue signalled");
   }
-
-  popped_value = queue.front();
-  queue.pop();
-  pthread_mutex_unlock(&mutex);
 }
 
 
@@ -202,13 +308,66 @@ template <typename Data>
 void
 ConcurrentQueue<Data>::clear()
 {
-  pthread_mutex_lock(&mutex);
+  Data data;
+
+  while (try_pop(data)) ;
+}
+
+
+//------------------------------------------------------------------------------
+//! Append elements which do not fit into the ring to the spill deque
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+ConcurrentQueue<Data>::Spill(const Data* data, size_t count)
+{
+  pthread_mutex_lock(&mMutex);
+
+  // The ring might have been drained in the meantime
+  if (mSpill.empty())
+  {
+    size_t n = mRing.try_push_batch(data, count);
+    data += n;
+    count -= n;
+  }
+
+  mSpill.insert(mSpill.end(), data, data + count);
+  __sync_synchronize();
+  mSpilled = mSpill.size();
+  pthread_mutex_unlock(&mMutex);
+}
+
+
+//------------------------------------------------------------------------------
+//! Pop the oldest spilled element and move as many of the following ones as
+//! possible back into the ring
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+ConcurrentQueue<Data>::Unspill(Data& popped_value)
+{
+  bool found = false;
+  pthread_mutex_lock(&mMutex);
+
+  // The ring holds older elements if it was refilled in the meantime
+  if (mRing.try_pop(popped_value))
+  {
+    found = true;
+  }
+  else if (!mSpill.empty())
+  {
+    popped_value = mSpill.front();
+    mSpill.pop_front();
+    found = true;
 
-  while (!queue.empty()) {
-    queue.pop();
+    while (!mSpill.empty() && mRing.try_push(mSpill.front()))
+      mSpill.pop_front();
   }
 
-  pthread_mutex_unlock(&mutex);
+  __sync_synchronize();
+  mSpilled = mSpill.size();
+  pthread_mutex_unlock(&mMutex);
+  return found;
 }
 
 EOSCOMMONNAMESPACE_END
@@ -0,0 +1,336 @@
+// ----------------------------------------------------------------------
+// File: DbMapCommitter.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "common/DbMapCommitter.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/time.h>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+DbMapCommitter::DbMapCommitter (DbMap* map, unsigned int latency_ms,
+                                size_t max_batch) :
+  mMap(map),
+  mLatency(latency_ms),
+  mMaxBatch(max_batch ? max_batch : 1),
+  mRunning(false),
+  mCond(0),
+  mShutdown(false),
+  mFirstPending(0),
+  mBatches(0),
+  mCommitted(0)
+{
+  SetLogId("DbMapCommitter");
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+DbMapCommitter::~DbMapCommitter ()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+// Start the commit thread
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::Start ()
+{
+  if (mRunning || !mLatency)
+    return true;
+
+  mShutdown = false;
+
+  if (XrdSysThread::Run(&mThread, DbMapCommitter::StartCommitThread,
+                        static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                        "DbMap Committer"))
+  {
+    eos_err("failed to start the commit thread, writes are not buffered");
+    mLatency = 0;
+    return false;
+  }
+
+  mRunning = true;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Stop the commit thread
+//------------------------------------------------------------------------------
+void
+DbMapCommitter::Stop ()
+{
+  if (mRunning)
+  {
+    mCond.Lock();
+    mShutdown = true;
+    mCond.Broadcast();
+    mCond.UnLock();
+    XrdSysThread::Join(mThread, NULL);
+    mRunning = false;
+  }
+
+  Flush();
+}
+
+//------------------------------------------------------------------------------
+// Buffer a write
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::Put (const Slice& key, const Slice& value)
+{
+  if (!mRunning)
+  {
+    // a direct write must not join the set sequence of a batch
+    XrdSysMutexHelper commitLock(mCommitMutex);
+    return (mMap->set(key, value, "") == 0);
+  }
+
+  XrdSysCondVarHelper lock(mCond);
+
+  // throttle the writers if the DbMap can not keep up
+  while (mPending.size() >= 2 * mMaxBatch)
+    mCond.Wait();
+
+  if (mPending.empty())
+  {
+    mFirstPending = NowMs();
+    mCond.Broadcast();
+  }
+
+  mPending[key.ToString()] = value.ToString();
+
+  if (mPending.size() == mMaxBatch)
+    mCond.Broadcast();
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Get the latest value of a key
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::Get (const Slice& key, std::string* value)
+{
+  {
+    XrdSysCondVarHelper lock(mCond);
+
+    if (!mPending.empty() || !mCommitting.empty())
+    {
+      std::string skey = key.ToString();
+      std::map<std::string, std::string>::const_iterator it = mPending.find(skey);
+
+      if (it != mPending.end())
+      {
+        *value = it->second;
+        return true;
+      }
+
+      it = mCommitting.find(skey);
+
+      if (it != mCommitting.end())
+      {
+        *value = it->second;
+        return true;
+      }
+    }
+  }
+
+  DbMap::Tval val;
+
+  if (!mMap->get(key, &val))
+    return false;
+
+  value->swap(val.value);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Remove a key
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::Remove (const Slice& key)
+{
+  {
+    XrdSysCondVarHelper lock(mCond);
+    mPending.erase(key.ToString());
+
+    // the key might be in the batch in flight
+    while (!mCommitting.empty())
+      mCond.Wait();
+  }
+
+  XrdSysMutexHelper commitLock(mCommitMutex);
+  return (mMap->remove(key) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Commit everything buffered so far
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::Flush ()
+{
+  bool retc = true;
+  XrdSysCondVarHelper lock(mCond);
+
+  while (!mPending.empty() || !mCommitting.empty())
+  {
+    if (!CommitBatch())
+      retc = false;
+  }
+
+  return retc;
+}
+
+//------------------------------------------------------------------------------
+// Get the number of keys buffered or being committed
+//------------------------------------------------------------------------------
+size_t
+DbMapCommitter::GetPending ()
+{
+  XrdSysCondVarHelper lock(mCond);
+  return mPending.size() + mCommitting.size();
+}
+
+//------------------------------------------------------------------------------
+// Get the number of batches committed
+//------------------------------------------------------------------------------
+unsigned long long
+DbMapCommitter::GetBatches ()
+{
+  XrdSysCondVarHelper lock(mCond);
+  return mBatches;
+}
+
+//------------------------------------------------------------------------------
+// Get the number of keys committed
+//------------------------------------------------------------------------------
+unsigned long long
+DbMapCommitter::GetCommitted ()
+{
+  XrdSysCondVarHelper lock(mCond);
+  return mCommitted;
+}
+
+//------------------------------------------------------------------------------
+// Commit thread startup function
+//------------------------------------------------------------------------------
+void*
+DbMapCommitter::StartCommitThread (void* pp)
+{
+  static_cast<DbMapCommitter*>(pp)->CommitThread();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Commit thread
+//------------------------------------------------------------------------------
+void
+DbMapCommitter::CommitThread ()
+{
+  mCond.Lock();
+
+  while (!mShutdown)
+  {
+    if (mPending.empty())
+    {
+      mCond.Wait();
+      continue;
+    }
+
+    unsigned long long age = NowMs() - mFirstPending;
+
+    if ((mPending.size() < mMaxBatch) && (age < mLatency))
+    {
+      mCond.WaitMS(mLatency - age);
+      continue;
+    }
+
+    CommitBatch();
+  }
+
+  mCond.UnLock();
+}
+
+//------------------------------------------------------------------------------
+// Commit the pending writes as a new batch
+//------------------------------------------------------------------------------
+bool
+DbMapCommitter::CommitBatch ()
+{
+  // only one batch at a time to keep the order of the writes
+  while (!mCommitting.empty())
+    mCond.Wait();
+
+  if (mPending.empty())
+    return true;
+
+  mCommitting.swap(mPending);
+  size_t nkeys = mCommitting.size();
+  unsigned long ncommitted;
+  mCond.UnLock();
+  {
+    XrdSysMutexHelper commitLock(mCommitMutex);
+    mMap->beginSetSequence();
+
+    for (std::map<std::string, std::string>::const_iterator it = mCommitting.begin();
+         it != mCommitting.end(); ++it)
+    {
+      mMap->set(it->first, it->second, "");
+    }
+
+    ncommitted = mMap->endSetSequence();
+  }
+  mCond.Lock();
+  mBatches++;
+  mCommitted += nkeys;
+  mCommitting.clear();
+  mCond.Broadcast();
+
+  if (ncommitted != nkeys)
+  {
+    // the set sequence makes it impossible to know which key is faulty
+    eos_err("failed to commit batch of %lu keys", (unsigned long) nkeys);
+    return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Get the current time in milliseconds
+//------------------------------------------------------------------------------
+unsigned long long
+DbMapCommitter::NowMs ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (unsigned long long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+EOSCOMMONNAMESPACE_END
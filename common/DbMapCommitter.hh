@@ -0,0 +1,193 @@
+// ----------------------------------------------------------------------
+// File: DbMapCommitter.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   DbMapCommitter.hh
+ *
+ * @brief  Group commit of the writes issued to a DbMap.
+ *         The writes are buffered and a background thread commits them in
+ *         a single set sequence (i.e. one leveldb WriteBatch or one SQLITE
+ *         transaction) once the oldest buffered write reaches the latency
+ *         budget or when the buffer is full. Successive writes to the same
+ *         key are coalesced. Readers going through the committer always see
+ *         the latest written value.
+ *
+ */
+
+#ifndef __EOSCOMMON_DBMAPCOMMITTER_HH__
+#define __EOSCOMMON_DBMAPCOMMITTER_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "common/Namespace.hh"
+#include "common/Logging.hh"
+#include "common/DbMap.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <map>
+#include <string>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class DbMapCommitter
+//------------------------------------------------------------------------------
+class DbMapCommitter : public LogId
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param map DbMap receiving the writes, it has to outlive the committer
+  //! @param latency_ms maximum time a write stays buffered, 0 disables the
+  //!                   buffering and every write goes straight to the DbMap
+  //! @param max_batch number of buffered keys triggering an early commit
+  //----------------------------------------------------------------------------
+  DbMapCommitter (DbMap* map, unsigned int latency_ms = 20,
+                  size_t max_batch = 4096);
+
+  //----------------------------------------------------------------------------
+  //! Destructor - commits everything still buffered
+  //----------------------------------------------------------------------------
+  virtual ~DbMapCommitter ();
+
+  //----------------------------------------------------------------------------
+  //! Start the commit thread
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Start ();
+
+  //----------------------------------------------------------------------------
+  //! Stop the commit thread and commit everything still buffered
+  //----------------------------------------------------------------------------
+  void Stop ();
+
+  //----------------------------------------------------------------------------
+  //! Buffer a write. A successful Put is visible to Get immediately but it is
+  //! only durable once its batch is written, i.e. up to latency_ms later (20ms
+  //! by default) - a crash in between loses it. Call Flush to wait for it.
+  //!
+  //! @param key key to write
+  //! @param value value to write
+  //!
+  //! @return true if buffered, false if the direct write failed
+  //----------------------------------------------------------------------------
+  bool Put (const Slice& key, const Slice& value);
+
+  //----------------------------------------------------------------------------
+  //! Get the latest value of a key - buffered or already committed
+  //!
+  //! @param key key to look up
+  //! @param value the value found
+  //!
+  //! @return true if found, otherwise false
+  //----------------------------------------------------------------------------
+  bool Get (const Slice& key, std::string* value);
+
+  //----------------------------------------------------------------------------
+  //! Remove a key - the removal is not buffered
+  //!
+  //! @param key key to remove
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Remove (const Slice& key);
+
+  //----------------------------------------------------------------------------
+  //! Commit everything buffered so far and wait for it to be in the DbMap.
+  //! The caller has to make sure that there are no concurrent writes if he
+  //! wants to see an empty buffer afterwards (e.g. before iterating the map).
+  //!
+  //! @return true if all the commits were successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool Flush ();
+
+  //----------------------------------------------------------------------------
+  //! Get the number of keys buffered or being committed
+  //----------------------------------------------------------------------------
+  size_t GetPending ();
+
+  //----------------------------------------------------------------------------
+  //! Get the number of batches committed
+  //----------------------------------------------------------------------------
+  unsigned long long GetBatches ();
+
+  //----------------------------------------------------------------------------
+  //! Get the number of keys committed
+  //----------------------------------------------------------------------------
+  unsigned long long GetCommitted ();
+
+private:
+
+  DbMap* mMap; ///< map receiving the writes
+  unsigned int mLatency; ///< latency budget in milliseconds
+  size_t mMaxBatch; ///< maximum number of keys in a batch
+  pthread_t mThread; ///< commit thread
+  bool mRunning; ///< true if the commit thread is running
+  XrdSysMutex mCommitMutex; ///< serializes the batches and the direct writes
+
+  XrdSysCondVar mCond; ///< protects all the members below
+  bool mShutdown; ///< flag to stop the commit thread
+  std::map<std::string, std::string> mPending; ///< writes not yet in a batch
+  std::map<std::string, std::string> mCommitting; ///< batch being committed
+  unsigned long long mFirstPending; ///< time of the oldest pending write (ms)
+  unsigned long long mBatches; ///< number of batches committed
+  unsigned long long mCommitted; ///< number of keys committed
+
+  //----------------------------------------------------------------------------
+  //! Commit thread startup function
+  //----------------------------------------------------------------------------
+  static void* StartCommitThread (void* pp);
+
+  //----------------------------------------------------------------------------
+  //! Commit thread - commits the pending writes on the latency budget
+  //----------------------------------------------------------------------------
+  void CommitThread ();
+
+  //----------------------------------------------------------------------------
+  //! Wait for the batch in flight and commit the pending writes as a new
+  //! batch. Has to be called with mCond locked, it is unlocked while the batch
+  //! is written to the DbMap.
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool CommitBatch ();
+
+  //----------------------------------------------------------------------------
+  //! Get the current time in milliseconds
+  //----------------------------------------------------------------------------
+  static unsigned long long NowMs ();
+
+  //----------------------------------------------------------------------------
+  //! Disable copy constructor and assignment operator
+  //----------------------------------------------------------------------------
+  DbMapCommitter (const DbMapCommitter&);
+  DbMapCommitter& operator= (const DbMapCommitter&);
+};
+
+EOSCOMMONNAMESPACE_END
+
+#endif
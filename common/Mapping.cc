@@ -29,6 +29,7 @@
 #include "common/SecEntity.hh"
 #include "common/SymKeys.hh"
 /*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysAtomics.hh"
 #include "XrdSys/XrdSysDNS.hh"
 /*----------------------------------------------------------------------------*/
 
@@ -68,6 +69,9 @@ std::map<std::string, uid_t> Mapping::gPhysicalUserIdCache;
 std::map<std::string, gid_t> Mapping::gPhysicalGroupIdCache;
 
 Mapping::ip_cache Mapping::gIpCache (300);
+
+Mapping::IdCacheShard Mapping::gIdCache[Mapping::gIdCacheShards];
+unsigned long long Mapping::gMapGeneration = 0;
 /*----------------------------------------------------------------------------*/
 /**
  * Initialize Google maps
@@ -81,6 +85,12 @@ Mapping::Init ()
 {
   ActiveTidents.set_empty_key("#__EMPTY__#");
   ActiveTidents.set_deleted_key("#__DELETED__#");
+
+  for (size_t i = 0; i < gIdCacheShards; i++)
+  {
+    gIdCache[i].entries.set_empty_key("#__EMPTY__#");
+    gIdCache[i].entries.set_deleted_key("#__DELETED__#");
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -89,6 +99,7 @@ Mapping::Init ()
 void
 Mapping::Reset()
 {
+  InvalidateIdCache();
   {
     XrdSysMutexHelper mLock(gPhysicalIdMutex);
     gPhysicalUidCache.Purge();
@@ -145,10 +156,26 @@ Mapping::ActiveExpire (int interval, bool force)
   }
 }
 
+/*----------------------------------------------------------------------------*/
+/**
+ * Invalidate all memoized identities by moving to a new mapping generation
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::InvalidateIdCache ()
+{
+  AtomicInc(gMapGeneration);
+}
+
 /*----------------------------------------------------------------------------*/
 /**
  * Map a client to its virtual identity
  *
+ * The result is memoized per client signature (tident, authentication entity
+ * and the role selection in env). A cached identity is used until the mapping
+ * generation changes or it is older than gIdCacheLifeTime.
+ *
  * @param client xrootd client authenticatino object
  * @param env opaque information containing role selection like 'eos.ruid' and 'eos.rgid'
  * @param tident trace identifier of the client
@@ -162,11 +189,128 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
   if (!client)
     return;
 
+  XrdOucEnv Env(env);
+  std::string activetident;
+
+  if (vid.geolocation.length() || !tident)
+  {
+    // an externally set geo location is not part of the cache key
+    ComputeIdMap(client, Env, tident, vid, activetident);
+  }
+  else
+  {
+    // -------------------------------------------------------------------------
+    // build the client signature
+    // -------------------------------------------------------------------------
+    const char* ruid = Env.Get("eos.ruid");
+    const char* rgid = Env.Get("eos.rgid");
+    const char* rapp = Env.Get("eos.app");
+    std::string key = tident;
+    key += '\n';
+    key += client->prot;
+    key += '\n';
+    key += client->name ? client->name : "";
+    key += '\n';
+    key += client->host ? client->host : "";
+    key += '\n';
+    key += client->grps ? client->grps : "";
+    key += '\n';
+    key += client->role ? client->role : "";
+    key += '\n';
+    key += ruid ? ruid : "";
+    key += '\n';
+    key += rgid ? rgid : "";
+    key += '\n';
+    key += rapp ? rapp : "";
+
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < key.length(); i++)
+    {
+      hash ^= (unsigned char) key[i];
+      hash *= 1099511628211ULL;
+    }
+
+    IdCacheShard& shard = gIdCache[hash % gIdCacheShards];
+    unsigned long long generation = AtomicGet(gMapGeneration);
+    time_t now = time(NULL);
+    bool hit = false;
+    bool refresh = false;
+
+    {
+      XrdSysMutexHelper cLock(shard.mutex);
+      google::dense_hash_map<std::string, IdCacheEntry>::iterator it = shard.entries.find(key);
+
+      if ((it != shard.entries.end()) && (it->second.generation == generation) &&
+          (it->second.expires > now))
+      {
+        vid = it->second.vid;
+        hit = true;
+
+        if (it->second.active != now)
+        {
+          // refresh the active client map at most once per second per client
+          it->second.active = now;
+          activetident = it->second.activetident;
+          refresh = true;
+        }
+      }
+    }
+
+    if (hit)
+    {
+      if (refresh)
+      {
+        XrdSysMutexHelper aLock(ActiveLock);
+
+        if (ActiveTidents.count(activetident) || (ActiveTidents.size() < 60000))
+          ActiveTidents[activetident] = now;
+      }
+    }
+    else
+    {
+      ComputeIdMap(client, Env, tident, vid, activetident);
+      XrdSysMutexHelper cLock(shard.mutex);
+
+      if (shard.entries.size() >= gIdCacheShardSize)
+      {
+        shard.entries.clear();
+        shard.entries.resize(0);
+      }
+
+      IdCacheEntry& entry = shard.entries[key];
+      entry.vid = vid;
+      entry.generation = generation;
+      entry.expires = now + gIdCacheLifeTime;
+      entry.active = now;
+      entry.activetident = activetident;
+    }
+  }
+
+  if (log)
+  {
+    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client, Env.Get("eos.app")).c_str(), tident);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Map a client to its virtual identity without the identity cache
+ *
+ * @param client xrootd client authenticatino object
+ * @param Env opaque information containing role selection like 'eos.ruid' and 'eos.rgid'
+ * @param tident trace identifier of the client
+ * @param vid returned virtual identity
+ * @param activetident returned key of the client in the active tident map
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::ComputeIdMap (const XrdSecEntity* client, XrdOucEnv &Env, const char* tident, Mapping::VirtualIdentity &vid, std::string &activetident)
+{
   eos_static_debug("name:%s role:%s group:%s tident:%s", client->name, client->role, client->grps, client->tident);
 
   // you first are 'nobody'
   Nobody(vid);
-  XrdOucEnv Env(env);
 
   vid.name = client->name;
   vid.tident = tident;
@@ -847,6 +991,10 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
   // ---------------------------------------------------------------------------
   // Maintain the active client map and expire old entries
   // ---------------------------------------------------------------------------
+  char actident[1024];
+  snprintf(actident, sizeof (actident) - 1, "%d^%s^%s^%s^%s", vid.uid, mytident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
+  activetident = actident;
+
   ActiveLock.Lock();
 
   // ---------------------------------------------------------------------------
@@ -858,18 +1006,11 @@ Mapping::IdMap (const XrdSecEntity* client, const char* env, const char* tident,
   }
   if (ActiveTidents.size() < 60000)
   {
-    char actident[1024];
-    snprintf(actident, sizeof (actident) - 1, "%d^%s^%s^%s^%s", vid.uid, mytident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
-    std::string intident = actident;
-    ActiveTidents[intident] = now;
+    ActiveTidents[activetident] = now;
   }
   ActiveLock.UnLock();
 
   eos_static_debug("selected %d %d [%s %s]", vid.uid, vid.gid, ruid.c_str(), rgid.c_str());
-  if (log)
-  {
-    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client, Env.Get("eos.app")).c_str(), tident);
-  }
 }
 
 /*----------------------------------------------------------------------------*/
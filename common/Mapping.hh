@@ -250,9 +250,41 @@ public:
 
   // ---------------------------------------------------------------------------
   //! Main mapping function to create a virtual identity from authentication information
+  //! - results are memoized per client signature until the mapping generation changes
   // ---------------------------------------------------------------------------
   static void IdMap (const XrdSecEntity* client, const char* env, const char* tident, Mapping::VirtualIdentity &vid, bool log = true);
 
+  // ---------------------------------------------------------------------------
+  //! Invalidate all memoized identities - to be called with gMapMutex write-locked
+  //! whenever the mapping configuration changes
+  // ---------------------------------------------------------------------------
+  static void InvalidateIdCache ();
+
+  // ---------------------------------------------------------------------------
+  //! Memoized IdMap result of a client signature (tident, auth entity, roles)
+  // ---------------------------------------------------------------------------
+  struct IdCacheEntry {
+    VirtualIdentity vid; //< mapped identity
+    unsigned long long generation; //< mapping generation used to compute vid
+    time_t expires; //< entry lifetime (physical ids/geo location may change)
+    time_t active; //< last refresh of the active tident entry
+    std::string activetident; //< key in ActiveTidents
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Shard of the identity cache
+  // ---------------------------------------------------------------------------
+  struct IdCacheShard {
+    XrdSysMutex mutex;
+    google::dense_hash_map<std::string, IdCacheEntry> entries;
+  };
+
+  static const size_t gIdCacheShards = 64; //< number of independently locked shards
+  static const size_t gIdCacheShardSize = 4096; //< max. entries per shard
+  static const time_t gIdCacheLifeTime = 300; //< lifetime of cached identities
+  static IdCacheShard gIdCache[gIdCacheShards]; //< the identity cache
+  static unsigned long long gMapGeneration; //< bumped on every mapping change
+
   // ---------------------------------------------------------------------------
   //! Map describing which virtual user roles a user with a given uid has
   // ---------------------------------------------------------------------------
@@ -564,6 +596,12 @@ public:
     return gidstring;
   }
 
+
+private:
+  // ---------------------------------------------------------------------------
+  //! Map a client without consulting the identity cache
+  // ---------------------------------------------------------------------------
+  static void ComputeIdMap (const XrdSecEntity* client, XrdOucEnv &Env, const char* tident, Mapping::VirtualIdentity &vid, std::string &activetident);
 };
 
 /*----------------------------------------------------------------------------*/
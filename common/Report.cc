@@ -29,6 +29,22 @@
 
 EOSCOMMONNAMESPACE_BEGIN
 
+//------------------------------------------------------------------------------
+//! 
+//! Create an empty Report object
+//! 
+//------------------------------------------------------------------------------
+Report::Report () :
+  ots(0), cts(0), otms(0), ctms(0), uid(0), gid(0), lid(0), fid(0), fsid(0),
+  rb(0), rb_min(0), rb_max(0), rb_sigma(0), rv_op(0), rvb_min(0), rvb_max(0),
+  rvb_sum(0), rvb_sigma(0), rs_op(0), rsb_min(0), rsb_max(0), rsb_sum(0),
+  rsb_sigma(0), rc_min(0), rc_max(0), rc_sum(0), rc_sigma(0), wb(0), wb_min(0),
+  wb_max(0), wb_sigma(0), sfwdb(0), sbwdb(0), sxlfwdb(0), sxlbwdb(0), nrc(0),
+  nwc(0), nfwds(0), nbwds(0), nxlfwds(0), nxlbwds(0), rt(0), rvt(0), wt(0),
+  osize(0), csize(0)
+{
+}
+
 //------------------------------------------------------------------------------
 //! 
 //! Create a Report object based on a report env representation
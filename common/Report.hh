@@ -117,6 +117,11 @@ public:
   std::string sec_info;    //< auth info (=dn if moninfo configuredin GSI plugin)
   std::string sec_app;     //< auth application
 
+  // ---------------------------------------------------------------------------
+  //! Constructor of an empty report (filled by ReportStore::Decode)
+  // ---------------------------------------------------------------------------
+  Report();
+
   // ---------------------------------------------------------------------------
   //! Constructor by report env 
   // ---------------------------------------------------------------------------
@@ -0,0 +1,1147 @@
+// ----------------------------------------------------------------------
+// File: ReportStore.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "common/Namespace.hh"
+#include "common/ReportStore.hh"
+#include "common/Path.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+const size_t ReportStore::sBlockRecords = 256;
+const size_t ReportStore::sRunEntries = 64 * 1024;
+const size_t ReportStore::sFlushSize = 256 * 1024;
+const size_t ReportStore::sMaxPrefixDepth = 16;
+
+namespace {
+  const char sSegmentMagic[8] = {'E', 'O', 'S', 'R', 'P', 'T', '0', '1'};
+  const size_t sSegmentHeaderSize = 16;
+  const uint32_t sRecordMagic = 0x54505245; // 'ERPT'
+  const uint32_t sRunMagic = 0x4e555250; // 'PRUN'
+  const char* sSegmentSuffix = ".eosreport.bin";
+
+  //----------------------------------------------------------------------------
+  // Record framing
+  //----------------------------------------------------------------------------
+  struct RecordHeader {
+    uint32_t magic;
+    uint32_t length; // total length including this header, 8 byte aligned
+  };
+
+  //----------------------------------------------------------------------------
+  // Fixed numeric part of a record - followed by the string table
+  //----------------------------------------------------------------------------
+  struct RecordFixed {
+    uint64_t ots, otms, cts, ctms;
+    uint64_t uid, gid, lid, fid, fsid;
+    uint64_t rb, rb_min, rb_max;
+    double rb_sigma;
+    uint64_t rv_op, rvb_min, rvb_max, rvb_sum;
+    double rvb_sigma;
+    uint64_t rs_op, rsb_min, rsb_max, rsb_sum;
+    double rsb_sigma;
+    uint64_t rc_min, rc_max, rc_sum;
+    double rc_sigma;
+    uint64_t wb, wb_min, wb_max;
+    double wb_sigma;
+    uint64_t sfwdb, sbwdb, sxlfwdb, sxlbwdb;
+    uint64_t nrc, nwc, nfwds, nbwds, nxlfwds, nxlbwds;
+    double rt, rvt, wt;
+    uint64_t osize, csize;
+  };
+
+  //----------------------------------------------------------------------------
+  // Time index entry describing one block of records
+  //----------------------------------------------------------------------------
+  struct TimeEntry {
+    uint64_t min_cts;
+    uint64_t max_cts;
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  //----------------------------------------------------------------------------
+  // Path index run header followed by 'count' sorted PathEntry's
+  //----------------------------------------------------------------------------
+  struct RunHeader {
+    uint32_t magic;
+    uint32_t count;
+  };
+
+  struct PathEntry {
+    uint64_t hash;
+    uint64_t offset;
+  };
+
+  //----------------------------------------------------------------------------
+  // Write a complete buffer
+  //----------------------------------------------------------------------------
+  bool
+  WriteAll(int fd, const char* ptr, size_t len)
+  {
+    while (len)
+    {
+      ssize_t nwrite = write(fd, ptr, len);
+
+      if (nwrite < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        return false;
+      }
+
+      ptr += nwrite;
+      len -= nwrite;
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Append a length prefixed string
+  //----------------------------------------------------------------------------
+  void
+  PutString(std::string& out, const std::string& s)
+  {
+    uint16_t len = (s.length() > 0xffff) ? 0xffff : s.length();
+    out.append((const char*) &len, sizeof(len));
+    out.append(s.c_str(), len);
+  }
+
+  //----------------------------------------------------------------------------
+  // Read a length prefixed string
+  //----------------------------------------------------------------------------
+  bool
+  GetString(const char*& ptr, const char* end, std::string& s)
+  {
+    uint16_t len;
+
+    if ((size_t)(end - ptr) < sizeof(len))
+      return false;
+
+    memcpy(&len, ptr, sizeof(len));
+    ptr += sizeof(len);
+
+    if ((size_t)(end - ptr) < len)
+      return false;
+
+    s.assign(ptr, len);
+    ptr += len;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Check if a report path matches an exact or prefix ('/' terminated) query
+  //----------------------------------------------------------------------------
+  bool
+  PathMatch(const std::string& report_path, const std::string& query)
+  {
+    if (query.empty())
+      return true;
+
+    if (query[query.length() - 1] == '/')
+      return (report_path.compare(0, query.length(), query) == 0);
+
+    return (report_path == query);
+  }
+
+  //----------------------------------------------------------------------------
+  // Check if Append puts a query path into the path index - the root and the
+  // prefixes deeper than sMaxPrefixDepth are not indexed
+  //----------------------------------------------------------------------------
+  bool
+  PathIndexed(const std::string& query)
+  {
+    if (query[query.length() - 1] != '/')
+      return true;
+
+    return (query.length() > 1) &&
+           ((size_t) std::count(query.begin() + 1, query.end(), '/') <=
+            ReportStore::sMaxPrefixDepth);
+  }
+
+  bool
+  PathEntryLess(const PathEntry& entry, uint64_t hash)
+  {
+    return entry.hash < hash;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+ReportStore::Hash(const char* ptr, size_t len)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (unsigned char) ptr[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::Encode(const Report& report, std::string& out)
+{
+  RecordFixed fixed;
+  fixed.ots = report.ots;
+  fixed.otms = report.otms;
+  fixed.cts = report.cts;
+  fixed.ctms = report.ctms;
+  fixed.uid = report.uid;
+  fixed.gid = report.gid;
+  fixed.lid = report.lid;
+  fixed.fid = report.fid;
+  fixed.fsid = report.fsid;
+  fixed.rb = report.rb;
+  fixed.rb_min = report.rb_min;
+  fixed.rb_max = report.rb_max;
+  fixed.rb_sigma = report.rb_sigma;
+  fixed.rv_op = report.rv_op;
+  fixed.rvb_min = report.rvb_min;
+  fixed.rvb_max = report.rvb_max;
+  fixed.rvb_sum = report.rvb_sum;
+  fixed.rvb_sigma = report.rvb_sigma;
+  fixed.rs_op = report.rs_op;
+  fixed.rsb_min = report.rsb_min;
+  fixed.rsb_max = report.rsb_max;
+  fixed.rsb_sum = report.rsb_sum;
+  fixed.rsb_sigma = report.rsb_sigma;
+  fixed.rc_min = report.rc_min;
+  fixed.rc_max = report.rc_max;
+  fixed.rc_sum = report.rc_sum;
+  fixed.rc_sigma = report.rc_sigma;
+  fixed.wb = report.wb;
+  fixed.wb_min = report.wb_min;
+  fixed.wb_max = report.wb_max;
+  fixed.wb_sigma = report.wb_sigma;
+  fixed.sfwdb = report.sfwdb;
+  fixed.sbwdb = report.sbwdb;
+  fixed.sxlfwdb = report.sxlfwdb;
+  fixed.sxlbwdb = report.sxlbwdb;
+  fixed.nrc = report.nrc;
+  fixed.nwc = report.nwc;
+  fixed.nfwds = report.nfwds;
+  fixed.nbwds = report.nbwds;
+  fixed.nxlfwds = report.nxlfwds;
+  fixed.nxlbwds = report.nxlbwds;
+  fixed.rt = report.rt;
+  fixed.rvt = report.rvt;
+  fixed.wt = report.wt;
+  fixed.osize = report.osize;
+  fixed.csize = report.csize;
+
+  size_t start = out.size();
+  RecordHeader header;
+  header.magic = sRecordMagic;
+  header.length = 0;
+  out.append((const char*) &header, sizeof(header));
+  out.append((const char*) &fixed, sizeof(fixed));
+  uint16_t nstrings = 13;
+  out.append((const char*) &nstrings, sizeof(nstrings));
+  PutString(out, report.logid);
+  PutString(out, report.path);
+  PutString(out, report.td);
+  PutString(out, report.host);
+  PutString(out, report.sec_prot);
+  PutString(out, report.sec_name);
+  PutString(out, report.sec_host);
+  PutString(out, report.sec_domain);
+  PutString(out, report.sec_vorg);
+  PutString(out, report.sec_grps);
+  PutString(out, report.sec_role);
+  PutString(out, report.sec_info);
+  PutString(out, report.sec_app);
+
+  // keep records 8 byte aligned
+  while ((out.size() - start) % 8)
+    out += '\0';
+
+  header.length = out.size() - start;
+  memcpy(&out[start], &header, sizeof(header));
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Decode(const char* ptr, size_t len, Report& report)
+{
+  const char* end = ptr + len;
+  RecordFixed fixed;
+  uint16_t nstrings;
+
+  if (len < sizeof(fixed) + sizeof(nstrings))
+    return false;
+
+  memcpy(&fixed, ptr, sizeof(fixed));
+  ptr += sizeof(fixed);
+  memcpy(&nstrings, ptr, sizeof(nstrings));
+  ptr += sizeof(nstrings);
+  report.ots = fixed.ots;
+  report.otms = fixed.otms;
+  report.cts = fixed.cts;
+  report.ctms = fixed.ctms;
+  report.uid = fixed.uid;
+  report.gid = fixed.gid;
+  report.lid = fixed.lid;
+  report.fid = fixed.fid;
+  report.fsid = fixed.fsid;
+  report.rb = fixed.rb;
+  report.rb_min = fixed.rb_min;
+  report.rb_max = fixed.rb_max;
+  report.rb_sigma = fixed.rb_sigma;
+  report.rv_op = fixed.rv_op;
+  report.rvb_min = fixed.rvb_min;
+  report.rvb_max = fixed.rvb_max;
+  report.rvb_sum = fixed.rvb_sum;
+  report.rvb_sigma = fixed.rvb_sigma;
+  report.rs_op = fixed.rs_op;
+  report.rsb_min = fixed.rsb_min;
+  report.rsb_max = fixed.rsb_max;
+  report.rsb_sum = fixed.rsb_sum;
+  report.rsb_sigma = fixed.rsb_sigma;
+  report.rc_min = fixed.rc_min;
+  report.rc_max = fixed.rc_max;
+  report.rc_sum = fixed.rc_sum;
+  report.rc_sigma = fixed.rc_sigma;
+  report.wb = fixed.wb;
+  report.wb_min = fixed.wb_min;
+  report.wb_max = fixed.wb_max;
+  report.wb_sigma = fixed.wb_sigma;
+  report.sfwdb = fixed.sfwdb;
+  report.sbwdb = fixed.sbwdb;
+  report.sxlfwdb = fixed.sxlfwdb;
+  report.sxlbwdb = fixed.sxlbwdb;
+  report.nrc = fixed.nrc;
+  report.nwc = fixed.nwc;
+  report.nfwds = fixed.nfwds;
+  report.nbwds = fixed.nbwds;
+  report.nxlfwds = fixed.nxlfwds;
+  report.nxlbwds = fixed.nxlbwds;
+  report.rt = fixed.rt;
+  report.rvt = fixed.rvt;
+  report.wt = fixed.wt;
+  report.osize = fixed.osize;
+  report.csize = fixed.csize;
+
+  std::string* strings[13] = {
+    &report.logid, &report.path, &report.td, &report.host, &report.sec_prot,
+    &report.sec_name, &report.sec_host, &report.sec_domain, &report.sec_vorg,
+    &report.sec_grps, &report.sec_role, &report.sec_info, &report.sec_app
+  };
+
+  std::string skip;
+
+  for (uint16_t i = 0; i < nstrings; ++i)
+  {
+    if (!GetString(ptr, end, (i < 13) ? *strings[i] : skip))
+      return false;
+  }
+
+  report.server_name = report.host;
+  report.server_domain = report.host;
+  size_t dpos = report.host.find(".");
+
+  if (dpos != std::string::npos)
+  {
+    report.server_name.erase(dpos);
+    report.server_domain.erase(0, dpos + 1);
+  }
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+ReportStore::ReportStore() :
+  mDay(0), mDataFd(-1), mTimeFd(-1), mPathFd(-1), mOffset(0),
+  mBlockOffset(0), mBlockMin(0), mBlockMax(0), mBlockCount(0)
+{
+}
+
+/*----------------------------------------------------------------------------*/
+ReportStore::~ReportStore()
+{
+  Close();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::SetPath(const std::string& root)
+{
+  XrdSysMutexHelper lock(mMutex);
+  mRoot = root;
+}
+
+/*----------------------------------------------------------------------------*/
+std::string
+ReportStore::SegmentName(const std::string& root, time_t when)
+{
+  struct tm nowtm;
+  char name[4096];
+  localtime_r(&when, &nowtm);
+  snprintf(name, sizeof(name) - 1, "%s/%04u/%02u/%04u%02u%02u%s", root.c_str(),
+           1900 + nowtm.tm_year, nowtm.tm_mon + 1, 1900 + nowtm.tm_year,
+           nowtm.tm_mon + 1, nowtm.tm_mday, sSegmentSuffix);
+  return std::string(name);
+}
+
+/*----------------------------------------------------------------------------*/
+//! Open the segment of the day of 'when' for appending. A segment left behind
+//! by a crash is truncated to its last complete record/index entry.
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Open(time_t when)
+{
+  struct tm nowtm;
+  localtime_r(&when, &nowtm);
+  int day = (1900 + nowtm.tm_year) * 10000 + (nowtm.tm_mon + 1) * 100 +
+            nowtm.tm_mday;
+
+  if ((mDataFd >= 0) && (day == mDay))
+    return true;
+
+  if (mDataFd >= 0)
+    CloseSegment();
+
+  if (mRoot.empty())
+    return false;
+
+  mSegment = SegmentName(mRoot, when);
+  eos::common::Path cPath(mSegment.c_str());
+
+  if (!cPath.MakeParentPath(S_IRWXU))
+    return false;
+
+  std::string tidx = mSegment + ".tidx";
+  std::string pidx = mSegment + ".pidx";
+  mDataFd = open(mSegment.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+  mTimeFd = open(tidx.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+  mPathFd = open(pidx.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+
+  if ((mDataFd < 0) || (mTimeFd < 0) || (mPathFd < 0))
+  {
+    if (mDataFd >= 0) close(mDataFd);
+    if (mTimeFd >= 0) close(mTimeFd);
+    if (mPathFd >= 0) close(mPathFd);
+    mDataFd = mTimeFd = mPathFd = -1;
+    return false;
+  }
+
+  struct stat buf;
+  uint64_t size = (!fstat(mDataFd, &buf)) ? buf.st_size : 0;
+
+  if (size < sSegmentHeaderSize)
+  {
+    char header[sSegmentHeaderSize];
+    memset(header, 0, sizeof(header));
+    memcpy(header, sSegmentMagic, sizeof(sSegmentMagic));
+
+    if (ftruncate(mDataFd, 0) ||
+        !WriteAll(mDataFd, header, sizeof(header)))
+      return false;
+
+    size = sSegmentHeaderSize;
+
+    if (ftruncate(mTimeFd, 0) || ftruncate(mPathFd, 0))
+      return false;
+  }
+
+  // Drop partially written time index entries
+  uint64_t tsize = (!fstat(mTimeFd, &buf)) ? buf.st_size : 0;
+  uint64_t valid = sSegmentHeaderSize;
+
+  if (tsize % sizeof(TimeEntry))
+  {
+    tsize -= tsize % sizeof(TimeEntry);
+
+    if (ftruncate(mTimeFd, tsize)) { }
+  }
+
+  if (tsize)
+  {
+    TimeEntry last;
+
+    if ((pread(mTimeFd, &last, sizeof(last), tsize - sizeof(last)) ==
+         (ssize_t) sizeof(last)) && (last.offset + last.length <= size))
+      valid = last.offset + last.length;
+  }
+
+  // Validate the records after the last indexed block
+  while (valid + sizeof(RecordHeader) <= size)
+  {
+    RecordHeader header;
+
+    if ((pread(mDataFd, &header, sizeof(header), valid) != sizeof(header)) ||
+        (header.magic != sRecordMagic) || (header.length < sizeof(header)) ||
+        (valid + header.length > size))
+      break;
+
+    valid += header.length;
+  }
+
+  if (valid < size)
+  {
+    if (ftruncate(mDataFd, valid)) { }
+
+    size = valid;
+  }
+
+  // Drop a partially written path index run
+  uint64_t psize = (!fstat(mPathFd, &buf)) ? buf.st_size : 0;
+  uint64_t ppos = 0;
+
+  while (ppos + sizeof(RunHeader) <= psize)
+  {
+    RunHeader run;
+
+    if ((pread(mPathFd, &run, sizeof(run), ppos) != sizeof(run)) ||
+        (run.magic != sRunMagic) ||
+        (ppos + sizeof(run) + run.count * sizeof(PathEntry) > psize))
+      break;
+
+    ppos += sizeof(run) + run.count * sizeof(PathEntry);
+  }
+
+  if (ppos < psize)
+  {
+    if (ftruncate(mPathFd, ppos)) { }
+  }
+
+  mDay = day;
+  mOffset = size;
+  mData.clear();
+  mRun.clear();
+  mBlockCount = 0;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Append(const Report& report, bool index_path, time_t when)
+{
+  XrdSysMutexHelper lock(mMutex);
+
+  if (!when)
+    when = time(NULL);
+
+  if (!Open(when))
+    return false;
+
+  uint64_t offset = mOffset;
+  size_t before = mData.size();
+  Encode(report, mData);
+  mOffset += mData.size() - before;
+
+  if (!mBlockCount)
+  {
+    mBlockOffset = offset;
+    mBlockMin = mBlockMax = report.cts;
+  }
+  else
+  {
+    if (report.cts < mBlockMin) mBlockMin = report.cts;
+    if (report.cts > mBlockMax) mBlockMax = report.cts;
+  }
+
+  mBlockCount++;
+
+  if (index_path && report.path.length())
+  {
+    const std::string& path = report.path;
+    mRun.push_back(std::make_pair(Hash(path.c_str(), path.length()), offset));
+    size_t depth = 0;
+
+    // Index all parent directories (with trailing '/') except the root
+    for (size_t pos = path.find('/', 1);
+         (pos != std::string::npos) && (pos + 1 < path.length()) &&
+         (depth < sMaxPrefixDepth);
+         pos = path.find('/', pos + 1), ++depth)
+      mRun.push_back(std::make_pair(Hash(path.c_str(), pos + 1), offset));
+  }
+
+  bool ok = true;
+
+  if (mBlockCount >= sBlockRecords)
+    ok &= FlushBlock();
+
+  if (mRun.size() >= sRunEntries)
+    ok &= FlushRun();
+
+  if (mData.size() >= sFlushSize)
+  {
+    ok &= WriteAll(mDataFd, mData.c_str(), mData.size());
+    mData.clear();
+  }
+
+  return ok;
+}
+
+/*----------------------------------------------------------------------------*/
+//! Write the time index entry of the current block (after its records)
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::FlushBlock()
+{
+  if (mData.size())
+  {
+    if (!WriteAll(mDataFd, mData.c_str(), mData.size()))
+      return false;
+
+    mData.clear();
+  }
+
+  if (!mBlockCount)
+    return true;
+
+  TimeEntry entry;
+  entry.min_cts = mBlockMin;
+  entry.max_cts = mBlockMax;
+  entry.offset = mBlockOffset;
+  entry.length = mOffset - mBlockOffset;
+  mBlockCount = 0;
+  return WriteAll(mTimeFd, (const char*) &entry, sizeof(entry));
+}
+
+/*----------------------------------------------------------------------------*/
+//! Sort and write the current path index run (after the referenced records)
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::FlushRun()
+{
+  if (mData.size())
+  {
+    if (!WriteAll(mDataFd, mData.c_str(), mData.size()))
+      return false;
+
+    mData.clear();
+  }
+
+  if (mRun.empty())
+    return true;
+
+  std::sort(mRun.begin(), mRun.end());
+  std::string buffer;
+  RunHeader run;
+  run.magic = sRunMagic;
+  run.count = mRun.size();
+  buffer.reserve(sizeof(run) + mRun.size() * sizeof(PathEntry));
+  buffer.append((const char*) &run, sizeof(run));
+
+  for (size_t i = 0; i < mRun.size(); ++i)
+  {
+    PathEntry entry;
+    entry.hash = mRun[i].first;
+    entry.offset = mRun[i].second;
+    buffer.append((const char*) &entry, sizeof(entry));
+  }
+
+  mRun.clear();
+  return WriteAll(mPathFd, buffer.c_str(), buffer.size());
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Flush(bool indexes)
+{
+  XrdSysMutexHelper lock(mMutex);
+
+  if (mDataFd < 0)
+    return true;
+
+  if (indexes)
+    return FlushBlock() && FlushRun();
+
+  if (mData.size())
+  {
+    if (!WriteAll(mDataFd, mData.c_str(), mData.size()))
+      return false;
+
+    mData.clear();
+  }
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::Close()
+{
+  XrdSysMutexHelper lock(mMutex);
+  CloseSegment();
+}
+
+/*----------------------------------------------------------------------------*/
+//! Flush everything and close the open segment - called with mMutex locked
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::CloseSegment()
+{
+  if (mDataFd >= 0)
+  {
+    FlushBlock();
+    FlushRun();
+  }
+
+  if (mDataFd >= 0) close(mDataFd);
+  if (mTimeFd >= 0) close(mTimeFd);
+  if (mPathFd >= 0) close(mPathFd);
+
+  mDataFd = mTimeFd = mPathFd = -1;
+  mDay = 0;
+  mOffset = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::ListSegments(const std::string& root, time_t from, time_t to,
+                          std::vector<std::string>& segments)
+{
+  DIR* ydir = opendir(root.c_str());
+  struct dirent* yent;
+
+  if (!ydir)
+    return;
+
+  while ((yent = readdir(ydir)))
+  {
+    if ((strlen(yent->d_name) != 4) || !isdigit(yent->d_name[0]))
+      continue;
+
+    std::string ypath = root + "/" + yent->d_name;
+    DIR* mdir = opendir(ypath.c_str());
+    struct dirent* ment;
+
+    if (!mdir)
+      continue;
+
+    while ((ment = readdir(mdir)))
+    {
+      if ((strlen(ment->d_name) != 2) || !isdigit(ment->d_name[0]))
+        continue;
+
+      std::string mpath = ypath + "/" + ment->d_name;
+      DIR* ddir = opendir(mpath.c_str());
+      struct dirent* dent;
+
+      if (!ddir)
+        continue;
+
+      while ((dent = readdir(ddir)))
+      {
+        std::string name = dent->d_name;
+
+        if ((name.length() != 8 + strlen(sSegmentSuffix)) ||
+            (name.compare(8, std::string::npos, sSegmentSuffix)))
+          continue;
+
+        int ymd = atoi(name.substr(0, 8).c_str());
+        struct tm daytm;
+        memset(&daytm, 0, sizeof(daytm));
+        daytm.tm_year = ymd / 10000 - 1900;
+        daytm.tm_mon = (ymd / 100) % 100 - 1;
+        daytm.tm_mday = ymd % 100;
+        daytm.tm_isdst = -1;
+        time_t start = mktime(&daytm);
+
+        // records of long transfers can be stored one day after their cts
+        if ((to && (start > to + 86400)) || (from && (start + 2 * 86400 < from)))
+          continue;
+
+        segments.push_back(mpath + "/" + name);
+      }
+
+      closedir(ddir);
+    }
+
+    closedir(mdir);
+  }
+
+  closedir(ydir);
+  std::sort(segments.begin(), segments.end());
+}
+
+/*----------------------------------------------------------------------------*/
+long long
+ReportStore::Query(const std::string& root, const std::string& path,
+                   time_t from, time_t to, Visitor& visitor)
+{
+  std::vector<std::string> segments;
+  ListSegments(root, from, to, segments);
+  long long total = 0;
+
+  for (size_t i = 0; i < segments.size(); ++i)
+  {
+    Reader reader;
+
+    if (!reader.Open(segments[i]))
+      continue;
+
+    long long n = reader.Scan(path, from, to, visitor);
+
+    if (n < 0)
+      break;
+
+    total += n;
+  }
+
+  return total;
+}
+
+/*----------------------------------------------------------------------------*/
+long long
+ReportStore::QueryLive(const std::string& path, time_t from, time_t to,
+                       Visitor& visitor)
+{
+  std::string root;
+  std::string segment;
+  std::vector<uint64_t> pending;
+  {
+    XrdSysMutexHelper lock(mMutex);
+    root = mRoot;
+
+    if (mDataFd >= 0)
+    {
+      // make the buffered records readable - the partial time block is
+      // covered by the tail scan of the reader
+      if (mData.size())
+      {
+        if (!WriteAll(mDataFd, mData.c_str(), mData.size()))
+          return -1;
+
+        mData.clear();
+      }
+
+      segment = mSegment;
+
+      if (path.length())
+      {
+        uint64_t hash = Hash(path.c_str(), path.length());
+
+        for (size_t i = 0; i < mRun.size(); ++i)
+        {
+          if (mRun[i].first == hash)
+            pending.push_back(mRun[i].second);
+        }
+      }
+    }
+  }
+
+  // a run flushed in the meantime only duplicates offsets, which Scan drops
+  std::vector<std::string> segments;
+  ListSegments(root, from, to, segments);
+  long long total = 0;
+
+  for (size_t i = 0; i < segments.size(); ++i)
+  {
+    Reader reader;
+
+    if (!reader.Open(segments[i]))
+      continue;
+
+    long long n = reader.Scan(path, from, to, visitor,
+                              (segments[i] == segment) ? &pending : 0);
+
+    if (n < 0)
+      break;
+
+    total += n;
+  }
+
+  return total;
+}
+
+/*----------------------------------------------------------------------------*/
+ReportStore::Reader::Reader() { }
+
+/*----------------------------------------------------------------------------*/
+ReportStore::Reader::~Reader()
+{
+  Close();
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Reader::Map(const std::string& path, Mapping& mapping)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat buf;
+
+  if (fstat(fd, &buf) || !buf.st_size)
+  {
+    close(fd);
+    return false;
+  }
+
+  void* ptr = mmap(0, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (ptr == MAP_FAILED)
+    return false;
+
+  madvise(ptr, buf.st_size, MADV_SEQUENTIAL);
+  mapping.ptr = (const char*) ptr;
+  mapping.size = buf.st_size;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::Reader::Unmap(Mapping& mapping)
+{
+  if (mapping.ptr)
+    munmap((void*) mapping.ptr, mapping.size);
+
+  mapping.ptr = 0;
+  mapping.size = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Reader::Open(const std::string& segment)
+{
+  Close();
+
+  if (!Map(segment, mData) || (mData.size < sSegmentHeaderSize) ||
+      memcmp(mData.ptr, sSegmentMagic, sizeof(sSegmentMagic)))
+  {
+    Close();
+    return false;
+  }
+
+  Map(segment + ".tidx", mTime);
+  Map(segment + ".pidx", mPath);
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+ReportStore::Reader::Close()
+{
+  Unmap(mData);
+  Unmap(mTime);
+  Unmap(mPath);
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+ReportStore::Reader::VisitAt(uint64_t offset, const std::string& path,
+                             time_t from, time_t to, Visitor& visitor,
+                             bool& stop, uint64_t& next, long long& count)
+{
+  RecordHeader header;
+
+  if (offset + sizeof(header) > mData.size)
+    return false;
+
+  memcpy(&header, mData.ptr + offset, sizeof(header));
+
+  if ((header.magic != sRecordMagic) ||
+      (header.length < sizeof(header) + sizeof(RecordFixed)) ||
+      (offset + header.length > mData.size))
+    return false;
+
+  next = offset + header.length;
+  const char* rec = mData.ptr + offset + sizeof(header);
+  uint64_t cts;
+  memcpy(&cts, rec + offsetof(RecordFixed, cts), sizeof(cts));
+
+  // cheap time filter before decoding the strings
+  if ((from && (cts < (uint64_t) from)) || (to && (cts > (uint64_t) to)))
+    return true;
+
+  Report report;
+
+  if (!Decode(rec, header.length - sizeof(header), report))
+    return false;
+
+  if (!PathMatch(report.path, path))
+    return true;
+
+  count++;
+
+  if (!visitor.Visit(report))
+    stop = true;
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+long long
+ReportStore::Reader::Scan(const std::string& path, time_t from, time_t to,
+                          Visitor& visitor,
+                          const std::vector<uint64_t>* pending)
+{
+  long long count = 0;
+  bool stop = false;
+  uint64_t next = 0;
+
+  if (!mData.ptr)
+    return 0;
+
+  if (path.length() && PathIndexed(path) && mPath.ptr)
+  {
+    // Collect the candidates from all sorted runs of the path index
+    uint64_t hash = ReportStore::Hash(path.c_str(), path.length());
+    std::vector<uint64_t> offsets;
+    const PathEntry* last_begin = 0;
+    const PathEntry* last_end = 0;
+    size_t pos = 0;
+
+    while (pos + sizeof(RunHeader) <= mPath.size)
+    {
+      RunHeader run;
+      memcpy(&run, mPath.ptr + pos, sizeof(run));
+
+      if ((run.magic != sRunMagic) ||
+          (pos + sizeof(run) + run.count * sizeof(PathEntry) > mPath.size))
+        break;
+
+      const PathEntry* begin = (const PathEntry*)(mPath.ptr + pos + sizeof(run));
+      const PathEntry* end = begin + run.count;
+
+      for (const PathEntry* it = std::lower_bound(begin, end, hash, PathEntryLess);
+           (it != end) && (it->hash == hash); ++it)
+        offsets.push_back(it->offset);
+
+      last_begin = begin;
+      last_end = end;
+      pos += sizeof(run) + run.count * sizeof(PathEntry);
+    }
+
+    if (pending)
+      offsets.insert(offsets.end(), pending->begin(), pending->end());
+
+    std::sort(offsets.begin(), offsets.end());
+    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+    for (size_t i = 0; (i < offsets.size()) && !stop; ++i)
+      VisitAt(offsets[i], path, from, to, visitor, stop, next, count);
+
+    if (pending)
+      return stop ? -1 : count;
+
+    // The run of the writer not flushed yet is not known here - scan the
+    // records after the last record of the last flushed run
+    uint64_t offset = sSegmentHeaderSize;
+    uint64_t last = 0;
+
+    for (const PathEntry* it = last_begin; it != last_end; ++it)
+    {
+      if (it->offset > last)
+        last = it->offset;
+    }
+
+    if (last)
+    {
+      RecordHeader header;
+
+      if (last + sizeof(header) > mData.size)
+        return stop ? -1 : count;
+
+      memcpy(&header, mData.ptr + last, sizeof(header));
+
+      if ((header.magic != sRecordMagic) ||
+          (header.length < sizeof(header) + sizeof(RecordFixed)))
+        return stop ? -1 : count;
+
+      offset = last + header.length;
+    }
+
+    while ((offset < mData.size) && !stop)
+    {
+      if (!VisitAt(offset, path, from, to, visitor, stop, next, count))
+        break;
+
+      offset = next;
+    }
+
+    return stop ? -1 : count;
+  }
+
+  // Skip whole blocks outside of the time window using the time index
+  uint64_t offset = sSegmentHeaderSize;
+
+  if (mTime.ptr)
+  {
+    size_t nentries = mTime.size / sizeof(TimeEntry);
+
+    for (size_t i = 0; (i < nentries) && !stop; ++i)
+    {
+      TimeEntry entry;
+      memcpy(&entry, mTime.ptr + i * sizeof(TimeEntry), sizeof(entry));
+
+      if ((entry.offset != offset) ||
+          (entry.offset + entry.length > mData.size))
+        break;
+
+      offset = entry.offset + entry.length;
+
+      if ((from && (entry.max_cts < (uint64_t) from)) ||
+          (to && (entry.min_cts > (uint64_t) to)))
+        continue;
+
+      for (uint64_t roff = entry.offset; (roff < offset) && !stop; roff = next)
+      {
+        if (!VisitAt(roff, path, from, to, visitor, stop, next, count))
+          break;
+      }
+    }
+  }
+
+  // Records after the last indexed block
+  while ((offset < mData.size) && !stop)
+  {
+    if (!VisitAt(offset, path, from, to, visitor, stop, next, count))
+      break;
+
+    offset = next;
+  }
+
+  return stop ? -1 : count;
+}
+
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_END
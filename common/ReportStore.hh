@@ -0,0 +1,234 @@
+// ----------------------------------------------------------------------
+// File: ReportStore.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   ReportStore.hh
+ *
+ * @brief  Binary, indexed store for file transaction reports.
+ *
+ * The store keeps one segment per day under <root>/YYYY/MM/YYYYMMDD.eosreport.bin
+ * holding binary encoded Report records. Each segment has two side-car indexes:
+ *
+ *  - <segment>.tidx : one entry (min cts, max cts, offset, length) per block of
+ *                     sBlockRecords records - used to skip blocks by time
+ *  - <segment>.pidx : sorted runs of (hash(path prefix), offset) entries for the
+ *                     full path and all parent directories of each record - used
+ *                     for exact path and directory prefix queries
+ *
+ * Readers memory-map the segment and its indexes. Records appended after the
+ * last indexed block are scanned linearly.
+ */
+
+#ifndef __EOSCOMMON_REPORTSTORE__
+#define __EOSCOMMON_REPORTSTORE__
+
+/*----------------------------------------------------------------------------*/
+#include "common/Namespace.hh"
+#include "common/Report.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+/*----------------------------------------------------------------------------*/
+//! Class appending reports to and querying reports from the binary store
+/*----------------------------------------------------------------------------*/
+class ReportStore {
+public:
+  // ---------------------------------------------------------------------------
+  //! Interface of a class receiving the reports matching a query
+  // ---------------------------------------------------------------------------
+  class Visitor {
+  public:
+    virtual ~Visitor() {};
+
+    // -------------------------------------------------------------------------
+    //! Called for every matching report - return false to stop the query
+    // -------------------------------------------------------------------------
+    virtual bool Visit(Report& report) = 0;
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Read-only, memory-mapped view of one segment and its indexes
+  // ---------------------------------------------------------------------------
+  class Reader {
+  public:
+    Reader();
+    ~Reader();
+
+    // -------------------------------------------------------------------------
+    //! Map a segment and its indexes
+    // -------------------------------------------------------------------------
+    bool Open(const std::string& segment);
+
+    // -------------------------------------------------------------------------
+    //! Unmap everything
+    // -------------------------------------------------------------------------
+    void Close();
+
+    // -------------------------------------------------------------------------
+    //! Visit all records matching path and [from, to] (cts). The root and
+    //! prefixes deeper than sMaxPrefixDepth are not in the path index and are
+    //! answered by a scan of the segment, as are the records after the last
+    //! flushed path index run unless pending is given.
+    //!
+    //! @param path exact path, directory prefix if it ends with '/', or empty
+    //! @param from lower cts bound (0 = unbounded)
+    //! @param to upper cts bound (0 = unbounded)
+    //! @param visitor receives the matching reports
+    //! @param pending offsets of records matching path which are not yet in
+    //!        the path index of the segment (optional)
+    //!
+    //! @return number of visited records, -1 if the visitor stopped the query
+    // -------------------------------------------------------------------------
+    long long Scan(const std::string& path, time_t from, time_t to,
+                   Visitor& visitor,
+                   const std::vector<uint64_t>* pending = 0);
+
+  private:
+    struct Mapping {
+      const char* ptr;
+      size_t size;
+      Mapping() : ptr(0), size(0) {}
+    };
+
+    Mapping mData; //< segment
+    Mapping mTime; //< time index
+    Mapping mPath; //< path index
+
+    static bool Map(const std::string& path, Mapping& mapping);
+    static void Unmap(Mapping& mapping);
+
+    // -------------------------------------------------------------------------
+    //! Decode and filter the record at offset - returns false on corruption
+    // -------------------------------------------------------------------------
+    bool VisitAt(uint64_t offset, const std::string& path, time_t from,
+                 time_t to, Visitor& visitor, bool& stop, uint64_t& next,
+                 long long& count);
+  };
+
+  static const size_t sBlockRecords; //< records per time index block
+  static const size_t sRunEntries; //< path index entries per sorted run
+  static const size_t sFlushSize; //< buffered bytes triggering a data write
+  static const size_t sMaxPrefixDepth; //< max. directory depth of prefix index
+
+  ReportStore();
+  ~ReportStore();
+
+  // ---------------------------------------------------------------------------
+  //! Set the root directory of the store
+  // ---------------------------------------------------------------------------
+  void SetPath(const std::string& root);
+
+  // ---------------------------------------------------------------------------
+  //! Append a report to the segment of the day of 'when'
+  //!
+  //! @param report report to store
+  //! @param index_path add the record to the path prefix index
+  //! @param when time selecting the daily segment (0 = now)
+  // ---------------------------------------------------------------------------
+  bool Append(const Report& report, bool index_path, time_t when = 0);
+
+  // ---------------------------------------------------------------------------
+  //! Write buffered records - if 'indexes' is set also the partial time block
+  //! and the partial path index run, so that readers see everything
+  // ---------------------------------------------------------------------------
+  bool Flush(bool indexes = false);
+
+  // ---------------------------------------------------------------------------
+  //! Flush everything and close the current segment
+  // ---------------------------------------------------------------------------
+  void Close();
+
+  // ---------------------------------------------------------------------------
+  //! Name of the segment for the day of 'when'
+  // ---------------------------------------------------------------------------
+  static std::string SegmentName(const std::string& root, time_t when);
+
+  // ---------------------------------------------------------------------------
+  //! List the segments of a store overlapping [from, to] (0 = unbounded)
+  // ---------------------------------------------------------------------------
+  static void ListSegments(const std::string& root, time_t from, time_t to,
+                           std::vector<std::string>& segments);
+
+  // ---------------------------------------------------------------------------
+  //! Query all segments of a store - see Reader::Scan
+  // ---------------------------------------------------------------------------
+  static long long Query(const std::string& root, const std::string& path,
+                         time_t from, time_t to, Visitor& visitor);
+
+  // ---------------------------------------------------------------------------
+  //! Query the store written by this object including the records appended
+  //! since the last index flush. Only the buffered data is written, the
+  //! partial path index run is looked up in memory.
+  // ---------------------------------------------------------------------------
+  long long QueryLive(const std::string& path, time_t from, time_t to,
+                      Visitor& visitor);
+
+  // ---------------------------------------------------------------------------
+  //! Binary encoding of a report appended to out
+  // ---------------------------------------------------------------------------
+  static void Encode(const Report& report, std::string& out);
+
+  // ---------------------------------------------------------------------------
+  //! Decode a binary record - returns false if the record is corrupted
+  // ---------------------------------------------------------------------------
+  static bool Decode(const char* ptr, size_t len, Report& report);
+
+  // ---------------------------------------------------------------------------
+  //! 64-bit FNV-1a hash used for the path index
+  // ---------------------------------------------------------------------------
+  static uint64_t Hash(const char* ptr, size_t len);
+
+private:
+  XrdSysMutex mMutex; //< serializes writers and flushes
+  std::string mRoot; //< root directory of the store
+  std::string mSegment; //< currently open segment
+  int mDay; //< YYYYMMDD of the open segment
+  int mDataFd; //< segment file descriptor
+  int mTimeFd; //< time index file descriptor
+  int mPathFd; //< path index file descriptor
+  uint64_t mOffset; //< logical end of the segment (incl. buffered data)
+  std::string mData; //< buffered records
+  std::vector<std::pair<uint64_t, uint64_t> > mRun; //< current path index run
+  uint64_t mBlockOffset; //< offset of the first record of the current block
+  uint64_t mBlockMin; //< min cts of the current block
+  uint64_t mBlockMax; //< max cts of the current block
+  size_t mBlockCount; //< records in the current block
+
+  bool Open(time_t when);
+  void CloseSegment();
+  bool FlushBlock();
+  bool FlushRun();
+};
+
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_END
+
+#endif
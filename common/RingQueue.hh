@@ -0,0 +1,577 @@
+// ----------------------------------------------------------------------
+// File: RingQueue.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_RINGQUEUE_HH__
+#define __EOS_RINGQUEUE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "common/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+/*----------------------------------------------------------------------------*/
+
+EOSCOMMONNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Event count used to block threads on a lock-free condition. A waiter
+//! registers with Prepare, re-checks its condition and then either calls
+//! Cancel or Wait with the key returned by Prepare. Notify wakes up only as
+//! many waiters as requested and is a no-op if nobody waits. On Linux the
+//! waiters sleep on a futex, elsewhere on a condition variable.
+//------------------------------------------------------------------------------
+class EventCount
+{
+public:
+
+  EventCount (): mSeq(0), mWaiters(0)
+  {
+#ifndef __linux__
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+#endif
+  }
+
+  ~EventCount ()
+  {
+#ifndef __linux__
+    pthread_mutex_destroy(&mMutex);
+    pthread_cond_destroy(&mCond);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  //! Register as waiter
+  //!
+  //! @return key to be passed to Wait
+  //----------------------------------------------------------------------------
+  int
+  Prepare ()
+  {
+    __sync_fetch_and_add(&mWaiters, 1);
+    return __sync_fetch_and_add(&mSeq, 0);
+  }
+
+  //----------------------------------------------------------------------------
+  //! Unregister a waiter which does not need to wait anymore
+  //----------------------------------------------------------------------------
+  void
+  Cancel ()
+  {
+    __sync_fetch_and_sub(&mWaiters, 1);
+  }
+
+  //----------------------------------------------------------------------------
+  //! Wait until Notify is called - returns immediately if Notify was called
+  //! since Prepare returned key. Spurious wake-ups are possible.
+  //----------------------------------------------------------------------------
+  void
+  Wait (int key)
+  {
+#ifdef __linux__
+    // A waiter woken up by the futex has already been unregistered by the
+    // notifier, so that waiters which are awake but not yet running do not
+    // cause further wake-up system calls
+    if (syscall(SYS_futex, &mSeq, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0))
+      __sync_fetch_and_sub(&mWaiters, 1);
+#else
+    pthread_mutex_lock(&mMutex);
+
+    while (mSeq == key)
+      pthread_cond_wait(&mCond, &mMutex);
+
+    pthread_mutex_unlock(&mMutex);
+    __sync_fetch_and_sub(&mWaiters, 1);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  //! Wake up waiters - the condition must have been published before
+  //!
+  //! @param count maximum number of waiters to wake up
+  //----------------------------------------------------------------------------
+  void
+  Notify (int count = 1)
+  {
+    // Order the publication of the condition before reading the waiters
+    __sync_synchronize();
+
+    if (!mWaiters)
+      return;
+
+    __sync_fetch_and_add(&mSeq, 1);
+#ifdef __linux__
+    long woken = syscall(SYS_futex, &mSeq, FUTEX_WAKE_PRIVATE, count, NULL,
+                         NULL, 0);
+
+    if (woken > 0)
+      __sync_fetch_and_sub(&mWaiters, (int) woken);
+#else
+    pthread_mutex_lock(&mMutex);
+
+    if (count == 1)
+      pthread_cond_signal(&mCond);
+    else
+      pthread_cond_broadcast(&mCond);
+
+    pthread_mutex_unlock(&mMutex);
+#endif
+  }
+
+private:
+  volatile int mSeq; ///< futex word, changed by every Notify with waiters
+  volatile int mWaiters; ///< number of registered waiters
+#ifndef __linux__
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+#endif
+
+  EventCount (const EventCount&);
+  EventCount& operator = (const EventCount&);
+};
+
+
+//------------------------------------------------------------------------------
+//! Bounded lock-free multi-producer multi-consumer queue. The elements live in
+//! a ring of cells, each with a sequence number telling whether the cell can
+//! be written (seq == pos) or read (seq == pos + 1) by the producer or the
+//! consumer which claimed position pos, therefore producers and consumers only
+//! contend on the CAS of their respective position. A batch operation claims
+//! several consecutive cells with a single CAS.
+//! Blocking operations sleep on event counts which wake up a single waiter
+//! per element pushed or popped.
+//! Data has to be default constructible and assignable.
+//------------------------------------------------------------------------------
+template <typename Data>
+class RingQueue
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param capacity maximum number of elements, rounded up to a power of 2
+  //----------------------------------------------------------------------------
+  RingQueue (size_t capacity = 1024);
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~RingQueue ();
+
+  size_t capacity () const { return mMask + 1; }
+  size_t size ();
+  bool empty () { return (size() == 0); }
+
+  bool try_push (const Data& data);
+  void push (Data& data);
+  bool push_size (Data& data, size_t max_size);
+  size_t try_push_batch (const Data* data, size_t count);
+  void push_batch (const Data* data, size_t count);
+
+  bool front (Data& value);
+  bool try_pop (Data& popped_value);
+  void wait_pop (Data& popped_value);
+  size_t try_pop_batch (Data* popped_values, size_t max_count);
+  size_t wait_pop_batch (Data* popped_values, size_t max_count);
+  void clear ();
+
+private:
+
+  struct Cell
+  {
+    volatile size_t mSeq;
+    Data mData;
+  };
+
+  enum { CacheLine = 64 };
+
+  char mPad0[CacheLine];
+  Cell* mBuffer; ///< ring of cells
+  size_t mMask; ///< capacity - 1
+  char mPad1[CacheLine];
+  volatile size_t mEnqueuePos; ///< next position to be written
+  char mPad2[CacheLine];
+  volatile size_t mDequeuePos; ///< next position to be read
+  char mPad3[CacheLine];
+  EventCount mNotEmpty; ///< consumers waiting for elements
+  EventCount mNotFull; ///< producers waiting for free cells
+
+  size_t PushBatch (const Data* data, size_t count, size_t max_size);
+
+  RingQueue (const RingQueue&);
+  RingQueue& operator = (const RingQueue&);
+};
+
+
+//------------------------------------------------------------------------------
+//! Constructor
+//------------------------------------------------------------------------------
+template <typename Data>
+RingQueue<Data>::RingQueue (size_t capacity):
+  mEnqueuePos(0),
+  mDequeuePos(0)
+{
+  size_t size = 2;
+
+  while (size < capacity)
+    size <<= 1;
+
+  mBuffer = new Cell[size];
+  mMask = size - 1;
+
+  for (size_t i = 0; i < size; i++)
+    mBuffer[i].mSeq = i;
+}
+
+//------------------------------------------------------------------------------
+//! Destructor
+//------------------------------------------------------------------------------
+template <typename Data>
+RingQueue<Data>::~RingQueue ()
+{
+  delete[] mBuffer;
+}
+
+//------------------------------------------------------------------------------
+//! Get size of the queue - exact only if there are no concurrent operations
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+RingQueue<Data>::size ()
+{
+  size_t deq = mDequeuePos;
+  __sync_synchronize();
+  size_t enq = mEnqueuePos;
+  return (enq > deq) ? (enq - deq) : 0;
+}
+
+//------------------------------------------------------------------------------
+//! Push data to the queue if there is a free cell
+//!
+//! @return true if pushed, false if the queue is full
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+RingQueue<Data>::try_push (const Data& data)
+{
+  return (try_push_batch(&data, 1) == 1);
+}
+
+//------------------------------------------------------------------------------
+//! Push data to the queue, block while the queue is full
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+RingQueue<Data>::push (Data& data)
+{
+  push_batch(&data, 1);
+}
+
+//------------------------------------------------------------------------------
+//! Push data to the queue if queue size is less or equal to max_size - the
+//! size is checked when the cell is claimed, so that concurrent producers
+//! cannot exceed the limit together
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+RingQueue<Data>::push_size (Data& data, size_t max_size)
+{
+  return (PushBatch(&data, 1, max_size) == 1);
+}
+
+//------------------------------------------------------------------------------
+//! Push as many elements as there are free cells, in order
+//!
+//! @return number of elements pushed
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+RingQueue<Data>::try_push_batch (const Data* data, size_t count)
+{
+  return PushBatch(data, count, (size_t) - 1);
+}
+
+//------------------------------------------------------------------------------
+//! Push as many elements as there are free cells, in order, as long as the
+//! queue holds at most max_size elements at the time the cells are claimed
+//!
+//! @return number of elements pushed
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+RingQueue<Data>::PushBatch (const Data* data, size_t count, size_t max_size)
+{
+  size_t pos = mEnqueuePos;
+  size_t n = 0;
+
+  while (count)
+  {
+    // Count the free cells following pos
+    n = 0;
+
+    while ((n < count) && (n <= mMask))
+    {
+      Cell* cell = &mBuffer[(pos + n) & mMask];
+      size_t seq = cell->mSeq;
+      __sync_synchronize();
+
+      if (seq != pos + n)
+        break;
+
+      n++;
+    }
+
+    if (n)
+    {
+      // The size is taken at the position which is claimed: if pos is
+      // outdated the dequeue position can be ahead and the CAS fails anyway
+      size_t deq = mDequeuePos;
+
+      if ((deq <= pos) && (pos - deq > max_size))
+        return 0;
+
+      size_t old = __sync_val_compare_and_swap(&mEnqueuePos, pos, pos + n);
+
+      if (old == pos)
+        break;
+
+      pos = old;
+      continue;
+    }
+
+    // The first cell is still in use: either the queue is full or another
+    // producer claimed it and pos is outdated
+    Cell* cell = &mBuffer[pos & mMask];
+    intptr_t dif = (intptr_t) cell->mSeq - (intptr_t) pos;
+
+    if (dif < 0)
+      return 0;
+
+    pos = mEnqueuePos;
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    Cell* cell = &mBuffer[(pos + i) & mMask];
+    cell->mData = data[i];
+    __sync_synchronize();
+    cell->mSeq = pos + i + 1;
+  }
+
+  if (n)
+    mNotEmpty.Notify(n);
+
+  return n;
+}
+
+//------------------------------------------------------------------------------
+//! Push all elements in order, block while the queue is full
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+RingQueue<Data>::push_batch (const Data* data, size_t count)
+{
+  while (count)
+  {
+    size_t n = try_push_batch(data, count);
+
+    if (n)
+    {
+      data += n;
+      count -= n;
+      continue;
+    }
+
+    int key = mNotFull.Prepare();
+
+    if ((n = try_push_batch(data, count)))
+    {
+      mNotFull.Cancel();
+      data += n;
+      count -= n;
+      continue;
+    }
+
+    mNotFull.Wait(key);
+  }
+}
+
+//------------------------------------------------------------------------------
+//! Get a copy of the oldest element without removing it - the queue must not
+//! be popped concurrently
+//!
+//! @return false if the queue is empty
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+RingQueue<Data>::front (Data& value)
+{
+  size_t pos = mDequeuePos;
+  Cell* cell = &mBuffer[pos & mMask];
+  size_t seq = cell->mSeq;
+  __sync_synchronize();
+
+  if (seq != pos + 1)
+    return false;
+
+  value = cell->mData;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+//! Try to get data from queue
+//------------------------------------------------------------------------------
+template <typename Data>
+bool
+RingQueue<Data>::try_pop (Data& popped_value)
+{
+  return (try_pop_batch(&popped_value, 1) == 1);
+}
+
+//------------------------------------------------------------------------------
+//! Get data from queue, if empty queue then block until at least one element
+//! is added
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+RingQueue<Data>::wait_pop (Data& popped_value)
+{
+  wait_pop_batch(&popped_value, 1);
+}
+
+//------------------------------------------------------------------------------
+//! Get up to max_count elements from the queue, in order
+//!
+//! @return number of elements popped
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+RingQueue<Data>::try_pop_batch (Data* popped_values, size_t max_count)
+{
+  size_t pos = mDequeuePos;
+  size_t n = 0;
+
+  while (max_count)
+  {
+    // Count the filled cells following pos
+    n = 0;
+
+    while ((n < max_count) && (n <= mMask))
+    {
+      Cell* cell = &mBuffer[(pos + n) & mMask];
+      size_t seq = cell->mSeq;
+      __sync_synchronize();
+
+      if (seq != pos + n + 1)
+        break;
+
+      n++;
+    }
+
+    if (n)
+    {
+      size_t old = __sync_val_compare_and_swap(&mDequeuePos, pos, pos + n);
+
+      if (old == pos)
+        break;
+
+      pos = old;
+      continue;
+    }
+
+    // The first cell is not filled: either the queue is empty or another
+    // consumer emptied it and pos is outdated
+    Cell* cell = &mBuffer[pos & mMask];
+    intptr_t dif = (intptr_t) cell->mSeq - (intptr_t) (pos + 1);
+
+    if (dif < 0)
+      return 0;
+
+    pos = mDequeuePos;
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    Cell* cell = &mBuffer[(pos + i) & mMask];
+    popped_values[i] = cell->mData;
+    cell->mData = Data();
+    __sync_synchronize();
+    cell->mSeq = pos + i + mMask + 1;
+  }
+
+  if (n)
+    mNotFull.Notify(n);
+
+  return n;
+}
+
+//------------------------------------------------------------------------------
+//! Get up to max_count elements from the queue, block until there is at least
+//! one element
+//!
+//! @return number of elements popped, at least 1
+//------------------------------------------------------------------------------
+template <typename Data>
+size_t
+RingQueue<Data>::wait_pop_batch (Data* popped_values, size_t max_count)
+{
+  while (true)
+  {
+    size_t n = try_pop_batch(popped_values, max_count);
+
+    if (n)
+      return n;
+
+    int key = mNotEmpty.Prepare();
+
+    if ((n = try_pop_batch(popped_values, max_count)))
+    {
+      mNotEmpty.Cancel();
+      return n;
+    }
+
+    mNotEmpty.Wait(key);
+  }
+}
+
+//------------------------------------------------------------------------------
+//! Remove all elements from the queue
+//------------------------------------------------------------------------------
+template <typename Data>
+void
+RingQueue<Data>::clear ()
+{
+  Data data;
+
+  while (try_pop(data)) ;
+}
+
+EOSCOMMONNAMESPACE_END
+
+#endif
@@ -0,0 +1,196 @@
+// ----------------------------------------------------------------------
+// File: DbMapTestCommit.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   DbMapTestCommit.cc
+ *
+ * @brief  Write throughput of an out-of-core DbMap updated like the FST file
+ *         meta data DB: several threads write records keyed by file id, either
+ *         one by one under a global write lock (as FmdDbMapHandler::Commit
+ *         used to do) or through a DbMapCommitter with different latency
+ *         budgets. Every record is read back at the end to check that no
+ *         update got lost.
+ *         Note that by defining EOS_SQLITE_DBMAP while building the common
+ *         lib, the test will meter the performances of the SQLITE
+ *         implementation.
+ *
+ *         usage: dbmaptestcommit [threads] [writes per thread] [files per thread]
+ */
+
+#undef NDEBUG
+#include "common/DbMap.hh"
+#include "common/DbMapCommitter.hh"
+#include "common/RWMutex.hh"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <vector>
+using namespace eos::common;
+
+const char* dbfile = "/tmp/testcommit.db";
+const int nlatencies = 4;
+const unsigned int latencies[nlatencies] = {0, 1, 10, 50};
+
+unsigned long nwrites = 0;
+unsigned long nfiles = 0;
+DbMap* globmap = 0;
+DbMapCommitter* committer = 0;
+RWMutex globmutex;
+
+double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// a record has about the size of a serialized Fmd and ends with the write sequence
+void
+MakeRecord (unsigned long long fid, unsigned long seq, std::string& record)
+{
+  char buffer[256];
+  memset(buffer, 'x', sizeof(buffer));
+  snprintf(buffer, sizeof(buffer), "fid=%016llx", fid);
+  record.assign(buffer, 200);
+  snprintf(buffer, sizeof(buffer), "seq=%010lu", seq);
+  record += buffer;
+}
+
+void*
+TestWrite (void* threadid)
+{
+  unsigned long long nthr = (unsigned long long) threadid;
+  std::string record;
+
+  for (unsigned long k = 0; k < nwrites; k++)
+  {
+    unsigned long long fid = (nthr << 32) | (k % nfiles);
+    Slice key((const char*) &fid, sizeof(fid));
+    MakeRecord(fid, k, record);
+
+    if (committer)
+    {
+      committer->Put(key, record);
+    }
+    else
+    {
+      RWMutexWriteLock lock(globmutex);
+      globmap->set(key, record, "");
+    }
+  }
+
+  return 0;
+}
+
+int
+main (int argc, char* argv[])
+{
+  unsigned long nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+  nwrites = (argc > 2) ? atoi(argv[2]) : 20000;
+  nfiles = (argc > 3) ? atoi(argv[3]) : 5000;
+  std::string rm_cmd = "rm -rf ";
+  rm_cmd += dbfile;
+
+  if (!nfiles || nfiles > nwrites)
+    nfiles = nwrites;
+
+#ifdef EOS_SQLITE_DBMAP
+  printf("Using SQLITE3 DbMap implementation\n");
+#else
+  printf("Using LEVELDB DbMap implementation\n");
+#endif
+  printf("%lu threads writing %lu records each over %lu files\n\n",
+         nthreads, nwrites, nfiles);
+  printf("%24s %16s %12s %12s\n", "scheme", "writes/sec", "batches",
+         "keys written");
+
+  for (int k = -1; k < nlatencies; k++)
+  {
+    system(rm_cmd.c_str());
+    globmap = new DbMap();
+    assert(globmap->attachDb(dbfile));
+    globmap->outOfCore(true);
+    char scheme[64];
+
+    if (k < 0)
+    {
+      committer = 0;
+      snprintf(scheme, sizeof(scheme), "one by one");
+    }
+    else
+    {
+      committer = new DbMapCommitter(globmap, latencies[k]);
+      committer->Start();
+      snprintf(scheme, sizeof(scheme), "group commit %ums", latencies[k]);
+    }
+
+    std::vector<pthread_t> threads(nthreads);
+    double start = Now();
+
+    for (unsigned long t = 0; t < nthreads; t++)
+      pthread_create(&threads[t], NULL, TestWrite, (void*) t);
+
+    for (unsigned long t = 0; t < nthreads; t++)
+      pthread_join(threads[t], NULL);
+
+    unsigned long long batches = 0;
+
+    if (committer)
+    {
+      assert(committer->Flush());
+      batches = committer->GetBatches();
+    }
+
+    double elapsed = Now() - start;
+    printf("%24s %16.0f %12llu %12lu\n", scheme,
+           (nthreads * nwrites) / elapsed, batches,
+           (unsigned long) globmap->getWriteCount());
+
+    // every file holds its last written record
+    std::string record;
+
+    for (unsigned long long t = 0; t < nthreads; t++)
+    {
+      for (unsigned long f = 0; f < nfiles; f++)
+      {
+        unsigned long long fid = (t << 32) | f;
+        unsigned long last = f + ((nwrites - 1 - f) / nfiles) * nfiles;
+        DbMap::Tval val;
+        MakeRecord(fid, last, record);
+        assert(globmap->get(Slice((const char*) &fid, sizeof(fid)), &val));
+        assert(val.value == record);
+      }
+    }
+
+    delete committer;
+    committer = 0;
+    delete globmap;
+  }
+
+  system(rm_cmd.c_str());
+  return 0;
+}
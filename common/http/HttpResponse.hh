@@ -36,6 +36,7 @@
 #include "common/Namespace.hh"
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
+#include <sys/types.h>
 #include <map>
 #include <string>
 /*----------------------------------------------------------------------------*/
@@ -96,6 +97,7 @@ protected:
 public:
   off_t        mResponseLength;        //!< length of the response
   bool         mUseFileReaderCallback; //!< read the file using callbacks
+  bool         mStreamBody;            //!< body is produced by StreamBody
 
 public:
 
@@ -103,7 +105,8 @@ public:
    * Constructor
    */
   HttpResponse () :
-    mResponseCode(OK), mResponseLength(0), mUseFileReaderCallback(false) {};
+    mResponseCode(OK), mResponseLength(0), mUseFileReaderCallback(false),
+    mStreamBody(false) {};
 
   /**
    * Destructor
@@ -164,6 +167,18 @@ public:
   inline size_t
   GetBodySize () { return mResponseBody.length(); }
 
+  /**
+   * Produce the next part of a body of unknown length which is sent while it
+   * is being built (if mStreamBody is set)
+   *
+   * @param buf  buffer to fill
+   * @param max  size of the buffer
+   *
+   * @return number of bytes placed in buf or -1 at the end of the body
+   */
+  virtual ssize_t
+  StreamBody (char *buf, size_t max) { return -1; }
+
   /**
    * @return the server response code
    */
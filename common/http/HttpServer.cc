@@ -57,6 +57,8 @@ HttpServer::HttpServer (int port)
   mPort = port;
   mThreadId = 0;
   mRunning = false;
+  mThreadModel = "threads";
+  mThreadPoolSize = 16;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -92,13 +94,14 @@ void*
 HttpServer::Run ()
 {
 #ifdef EOS_MICRO_HTTPD
-  std::string thread_model="threads";
+  std::string thread_model = mThreadModel;
 
   {
     // Delay to make sure xrootd is configured before serving
     XrdSysTimer::Snooze(1);
 
-    int nthreads = 16;
+    int nthreads = mThreadPoolSize;
+
     if (getenv("EOS_HTTP_THREADPOOL"))
       thread_model = getenv("EOS_HTTP_THREADPOOL");
 
@@ -58,6 +58,8 @@ protected:
   int                mPort;     //!< The port this server listens on
   pthread_t          mThreadId; //!< This thread's ID
   bool               mRunning;  //!< Is this server running?
+  std::string        mThreadModel; //!< default thread model if EOS_HTTP_THREADPOOL is not set
+  int                mThreadPoolSize; //!< default epoll pool size if EOS_HTTP_THREADPOOL_SIZE is not set
   static HttpServer *gHttp;     //!< This is the instance of the HTTP server
                                 //!< allowing the Handler function to call
                                 //!< class member functions
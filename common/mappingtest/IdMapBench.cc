@@ -0,0 +1,140 @@
+// ----------------------------------------------------------------------
+// File: IdMapBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+/**
+ * @file   IdMapBench.cc
+ *
+ * @brief  Measures Mapping::IdMap operations per second with many threads,
+ *         with the identity cache and with the cache invalidated on every call.
+ *
+ */
+
+#include "common/Mapping.hh"
+#include "common/Logging.hh"
+#include "common/Timing.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace eos::common;
+
+const int NCLIENTS = 1000; // distinct client connections
+const int NOPS = 200000; // IdMap calls per thread
+
+std::vector<XrdSecEntity*> clients;
+std::vector<std::string> tidents;
+bool invalidate = false;
+
+void*
+BenchThread (void* arg)
+{
+  unsigned long tid = (unsigned long) arg;
+  Mapping::VirtualIdentity vid;
+
+  for (int k = 0; k < NOPS; k++)
+  {
+    size_t c = (tid * 7919 + k) % NCLIENTS;
+
+    if (invalidate)
+    {
+      Mapping::InvalidateIdCache();
+    }
+
+    vid.geolocation = "";
+    Mapping::IdMap(clients[c], "eos.app=bench", tidents[c].c_str(), vid, false);
+
+    if (vid.uid != 1000)
+    {
+      fprintf(stderr, "error: unexpected mapping uid=%u\n", vid.uid);
+      exit(-1);
+    }
+  }
+
+  return 0;
+}
+
+double
+Run (unsigned long nthreads)
+{
+  std::vector<pthread_t> threads(nthreads);
+  struct timeval start, stop;
+  gettimeofday(&start, 0);
+
+  for (unsigned long t = 0; t < nthreads; t++)
+  {
+    if (pthread_create(&threads[t], NULL, BenchThread, (void*) t))
+    {
+      fprintf(stderr, "error: cannot create thread\n");
+      exit(-1);
+    }
+  }
+
+  for (unsigned long t = 0; t < nthreads; t++)
+  {
+    pthread_join(threads[t], NULL);
+  }
+
+  gettimeofday(&stop, 0);
+  double elapsed = (stop.tv_sec - start.tv_sec) +
+                   (stop.tv_usec - start.tv_usec) / 1000000.0;
+  return (nthreads * NOPS) / elapsed;
+}
+
+int
+main (int argc, char* argv[])
+{
+  Logging::Init();
+  Logging::SetLogPriority(LOG_NOTICE);
+  Mapping::Init();
+
+  // forced unix mapping - avoids password database lookups in the benchmark
+  Mapping::gVirtualUidMap["unix:\"<pwd>\":uid"] = 1000;
+  Mapping::gVirtualGidMap["unix:\"<pwd>\":gid"] = 1000;
+
+  for (int i = 0; i < NCLIENTS; i++)
+  {
+    char tident[256];
+    char name[64];
+    snprintf(tident, sizeof (tident), "user%d.%d:%d@client%d.cern.ch", i, 1000 + i, 10 + i, i % 50);
+    snprintf(name, sizeof (name), "user%d", i);
+    XrdSecEntity* client = new XrdSecEntity("unix");
+    client->name = strdup(name);
+    client->host = strdup(strchr(tident, '@') + 1);
+    client->tident = strdup(tident);
+    clients.push_back(client);
+    tidents.push_back(tident);
+  }
+
+  fprintf(stdout, "# %8s %16s %16s %8s\n", "threads", "cached[ops/s]", "uncached[ops/s]", "speedup");
+
+  for (unsigned long nthreads = 1; nthreads <= 64; nthreads *= 2)
+  {
+    invalidate = false;
+    double cached = Run(nthreads);
+    invalidate = true;
+    double uncached = Run(nthreads);
+    fprintf(stdout, "  %8lu %16.0f %16.0f %8.2f\n", nthreads, cached, uncached, cached / uncached);
+  }
+
+  return 0;
+}
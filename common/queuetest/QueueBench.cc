@@ -0,0 +1,237 @@
+// ----------------------------------------------------------------------
+// File: QueueBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   QueueBench.cc
+ *
+ * @brief  Producer/consumer throughput under contention of the former mutex
+ *         queue (broadcast on every push), the ConcurrentQueue (lock-free
+ *         ring + spill deque) and the bounded RingQueue. The consumers block
+ *         in wait_pop, every element is checked to be consumed exactly once
+ *         and in order for each producer.
+ *
+ *         usage: queuebench [max threads] [elements per producer]
+ */
+
+#undef NDEBUG
+#include "common/ConcurrentQueue.hh"
+#include "common/RingQueue.hh"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <queue>
+#include <vector>
+
+using namespace eos::common;
+
+//------------------------------------------------------------------------------
+// Former ConcurrentQueue implementation
+//------------------------------------------------------------------------------
+template <typename Data>
+class MutexQueue
+{
+public:
+  MutexQueue ()
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  void push (Data& data)
+  {
+    pthread_mutex_lock(&mutex);
+    queue.push(data);
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  void wait_pop (Data& popped_value)
+  {
+    pthread_mutex_lock(&mutex);
+
+    while (queue.empty())
+      pthread_cond_wait(&cond, &mutex);
+
+    popped_value = queue.front();
+    queue.pop();
+    pthread_mutex_unlock(&mutex);
+  }
+
+private:
+  std::queue<Data> queue;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+// Elements are (producer << 32 | sequence + 1), 0 stops a consumer
+typedef unsigned long long Element;
+
+const size_t MAXTHREADS = 64;
+
+int mode = 0;
+size_t nproducers = 0;
+size_t nelements = 0;
+MutexQueue<Element>* mutexQueue = 0;
+ConcurrentQueue<Element>* concurrentQueue = 0;
+RingQueue<Element>* ringQueue = 0;
+// last sequence seen by each consumer for each producer
+size_t lastSeen[MAXTHREADS][MAXTHREADS];
+size_t consumed[MAXTHREADS * 8];
+
+double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+void
+Push (Element& element)
+{
+  if (mode == 0)
+    mutexQueue->push(element);
+  else if (mode == 1)
+    concurrentQueue->push(element);
+  else
+    ringQueue->push(element);
+}
+
+void
+Pop (Element& element)
+{
+  if (mode == 0)
+    mutexQueue->wait_pop(element);
+  else if (mode == 1)
+    concurrentQueue->wait_pop(element);
+  else
+    ringQueue->wait_pop(element);
+}
+
+void*
+Producer (void* arg)
+{
+  unsigned long id = (unsigned long) arg;
+
+  for (size_t i = 0; i < nelements; i++)
+  {
+    Element element = ((Element) id << 32) | (i + 1);
+    Push(element);
+  }
+
+  return 0;
+}
+
+void*
+Consumer (void* arg)
+{
+  unsigned long id = (unsigned long) arg;
+  Element element;
+
+  while (true)
+  {
+    Pop(element);
+
+    if (!element)
+      break;
+
+    size_t producer = element >> 32;
+    size_t seq = element & 0xffffffff;
+    // a consumer sees the elements of one producer in push order
+    assert(seq > lastSeen[id][producer]);
+    lastSeen[id][producer] = seq;
+    consumed[id * 8]++;
+  }
+
+  return 0;
+}
+
+int
+main (int argc, char* argv[])
+{
+  size_t maxthreads = (argc > 1) ? atoi(argv[1]) : 16;
+  nelements = (argc > 2) ? atoi(argv[2]) : 200000;
+  const char* names[3] = {"mutex+broadcast", "ConcurrentQueue", "RingQueue"};
+
+  if (maxthreads > MAXTHREADS)
+    maxthreads = MAXTHREADS;
+
+  fprintf(stdout, "%8s %8s %20s %20s %20s\n", "prod", "cons",
+          names[0], names[1], names[2]);
+
+  for (size_t nthreads = 1; nthreads <= maxthreads; nthreads *= 2)
+  {
+    nproducers = nthreads;
+    size_t nconsumers = nthreads;
+    fprintf(stdout, "%8lu %8lu", nproducers, nconsumers);
+
+    for (mode = 0; mode < 3; mode++)
+    {
+      mutexQueue = new MutexQueue<Element>();
+      concurrentQueue = new ConcurrentQueue<Element>();
+      ringQueue = new RingQueue<Element>(1024);
+      memset(lastSeen, 0, sizeof(lastSeen));
+      memset(consumed, 0, sizeof(consumed));
+      std::vector<pthread_t> producers(nproducers);
+      std::vector<pthread_t> consumers(nconsumers);
+      double start = Now();
+
+      for (size_t i = 0; i < nconsumers; i++)
+        pthread_create(&consumers[i], 0, Consumer, (void*) i);
+
+      for (size_t i = 0; i < nproducers; i++)
+        pthread_create(&producers[i], 0, Producer, (void*) i);
+
+      for (size_t i = 0; i < nproducers; i++)
+        pthread_join(producers[i], 0);
+
+      for (size_t i = 0; i < nconsumers; i++)
+      {
+        Element stop = 0;
+        Push(stop);
+      }
+
+      for (size_t i = 0; i < nconsumers; i++)
+        pthread_join(consumers[i], 0);
+
+      double elapsed = Now() - start;
+      size_t total = 0;
+
+      for (size_t i = 0; i < nconsumers; i++)
+        total += consumed[i * 8];
+
+      assert(total == nproducers * nelements);
+      fprintf(stdout, " %14.0f el/s", total / elapsed);
+      delete mutexQueue;
+      delete concurrentQueue;
+      delete ringQueue;
+    }
+
+    fprintf(stdout, "\n");
+  }
+
+  return 0;
+}
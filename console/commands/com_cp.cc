@@ -25,17 +25,618 @@
 #include "console/ConsoleMain.hh"
 #include "common/Path.hh"
 /*----------------------------------------------------------------------------*/
+#include "XrdCl/XrdClCopyProcess.hh"
+#include "XrdCl/XrdClFileSystem.hh"
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
 #include <vector>
+#include <map>
+#include <errno.h>
+#include <signal.h>
 /*----------------------------------------------------------------------------*/
 
 extern XrdOucString serveruri;
 //extern char* com_fileinfo (char* arg1);
 extern int com_transfer (char* argin);
 
+//------------------------------------------------------------------------------
+// One file to copy - prepared sequentially by com_cp and run by a copy worker
+//------------------------------------------------------------------------------
+struct CpJob
+{
+  size_t nfile; ///< index in the source list
+  XrdOucString arg1; ///< source URL/path
+  XrdOucString arg2; ///< target URL/path
+  XrdOucString targetfile; ///< target name used to verify the copy
+  XrdOucString upload_target; ///< external target uploaded from a temporary file
+  XrdOucString cmdprefix; ///< download command piped into eoscp
+  XrdOucString cmdargs; ///< eoscp arguments
+  bool mkdir; ///< the target directory has still to be created
+  bool inprocess; ///< copy with XrdCl in this process instead of eoscp
+  bool copied; ///< copy was successful
+  bool interrupted; ///< copy was interrupted by CONTROL-C
+};
+
+//------------------------------------------------------------------------------
+// State shared by the copy workers
+//------------------------------------------------------------------------------
+struct CpContext
+{
+  std::vector<CpJob> jobs;
+  std::vector<unsigned long long>* source_size;
+  std::vector < std::pair<timespec, timespec >>* source_utime;
+  std::vector<XrdOucString>* source_list;
+  XrdOucString target;
+  bool preserve;
+  bool checksums;
+  bool noprogress;
+  bool silent;
+  bool debug;
+  XrdSysMutex mutex; ///< protects the members below
+  size_t next; ///< next job to run
+  bool stop; ///< don't start any new job
+  int retc;
+  int copiedok;
+  unsigned long long copiedsize;
+};
+
+//------------------------------------------------------------------------------
+// Result of a source stat done by cp_stat_sources
+//------------------------------------------------------------------------------
+struct CpStat
+{
+  bool ok;
+  struct stat buf;
+};
+
+//------------------------------------------------------------------------------
+// Handler of one asynchronous stat of cp_stat_sources
+//------------------------------------------------------------------------------
+class CpStatHandler : public XrdCl::ResponseHandler
+{
+public:
+
+  CpStatHandler (CpStat* stat, XrdSysCondVar* cond, size_t* inflight) :
+    mStat (stat), mCond (cond), mInFlight (inflight) { }
+
+  virtual void
+  HandleResponse (XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
+  {
+    XrdCl::StatInfo* info = 0;
+
+    if (status->IsOK() && response)
+    {
+      response->Get(info);
+    }
+
+    mCond->Lock();
+
+    if (info)
+    {
+      memset(&mStat->buf, 0, sizeof (mStat->buf));
+      mStat->buf.st_size = info->GetSize();
+      mStat->buf.st_mtime = info->GetModTime();
+      mStat->buf.st_mode = info->TestFlags(XrdCl::StatInfo::IsDir) ? S_IFDIR : S_IFREG;
+      mStat->ok = true;
+    }
+
+    (*mInFlight)--;
+    mCond->Signal();
+    mCond->UnLock();
+    delete status;
+    delete response;
+    delete this;
+  }
+
+private:
+  CpStat* mStat;
+  XrdSysCondVar* mCond;
+  size_t* mInFlight;
+};
+
+//------------------------------------------------------------------------------
+// Stat all the given XRootD URLs with a window of requests in flight, using
+// one file system object (and connection) per server instead of a
+// synchronous stat per file. Empty URLs are skipped.
+//------------------------------------------------------------------------------
+static void
+cp_stat_sources (std::vector<XrdOucString>& urls, std::vector<CpStat>& stats,
+                 size_t window)
+{
+  std::map<std::string, XrdCl::FileSystem*> servers;
+  XrdSysCondVar cond(0);
+  size_t inflight = 0;
+  stats.resize(urls.size());
+
+  for (size_t i = 0; i < urls.size(); i++)
+  {
+    stats[i].ok = false;
+
+    if (!urls[i].length())
+      continue;
+
+    XrdCl::URL url(urls[i].c_str());
+
+    if (!url.IsValid())
+      continue;
+
+    std::string server = url.GetProtocol() + "://" + url.GetHostId() + "/";
+
+    if (!servers.count(server))
+    {
+      servers[server] = new XrdCl::FileSystem(XrdCl::URL(server));
+    }
+
+    cond.Lock();
+
+    while (inflight >= window)
+    {
+      cond.Wait();
+    }
+
+    inflight++;
+    cond.UnLock();
+    XrdCl::XRootDStatus status =
+      servers[server]->Stat(url.GetPathWithParams(),
+                            new CpStatHandler(&stats[i], &cond, &inflight));
+
+    if (!status.IsOK())
+    {
+      // the handler is not called
+      cond.Lock();
+      inflight--;
+      cond.UnLock();
+    }
+  }
+
+  cond.Lock();
+
+  while (inflight)
+  {
+    cond.Wait();
+  }
+
+  cond.UnLock();
+
+  for (std::map<std::string, XrdCl::FileSystem*>::iterator it = servers.begin();
+       it != servers.end(); it++)
+  {
+    delete it->second;
+  }
+}
+
+//------------------------------------------------------------------------------
+// CONTROL-C during in-process copies - eoscp children get the signal directly
+//------------------------------------------------------------------------------
+static volatile sig_atomic_t cp_interrupted = 0;
+
+static void
+cp_interrupt_handler (int sig)
+{
+  cp_interrupted = 1;
+}
+
+//------------------------------------------------------------------------------
+// Cancels an in-process copy once CONTROL-C was hit
+//------------------------------------------------------------------------------
+class CpProgressHandler : public XrdCl::CopyProgressHandler
+{
+public:
+
+  virtual bool
+  ShouldCancel (uint16_t jobNum)
+  {
+    return cp_interrupted;
+  }
+};
+
+//------------------------------------------------------------------------------
+// Copy a file with XrdCl in this process, connections to the MGM and the FSTs
+// are shared by all the jobs
+//------------------------------------------------------------------------------
+static int
+cp_xrdcl (CpJob& job)
+{
+  XrdCl::PropertyList properties;
+  XrdCl::PropertyList result;
+  std::string source = job.arg1.c_str();
+  std::string target = job.arg2.c_str();
+
+  if (source[0] == '/')
+    source.insert(0, "file://");
+
+  if (target[0] == '/')
+    target.insert(0, "file://");
+
+  properties.Set("source", source);
+  properties.Set("target", target);
+  properties.Set("force", true);
+  properties.Set("makeDir", job.mkdir);
+  XrdCl::CopyProcess copy_proc;
+  CpProgressHandler progress;
+  copy_proc.AddJob(properties, &result);
+  XrdCl::XRootDStatus status = copy_proc.Prepare();
+
+  if (status.IsOK())
+  {
+    status = copy_proc.Run(&progress);
+  }
+
+  if (cp_interrupted)
+  {
+    // reported as CONTROL-C by cp_run, no further job is started
+    return EINTR;
+  }
+
+  if (!status.IsOK())
+  {
+    fprintf(stderr, "error: copy of %s failed: %s\n", job.arg1.c_str(),
+            status.ToStr().c_str());
+    return 0xffff00;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Run one copy job and verify the target - called by the copy workers
+//------------------------------------------------------------------------------
+static int
+cp_run (CpContext& ctx, CpJob& job)
+{
+  size_t nfile = job.nfile;
+  std::vector<unsigned long long>& source_size = *ctx.source_size;
+  std::vector < std::pair<timespec, timespec >>& source_utime = *ctx.source_utime;
+  std::vector<XrdOucString>& source_list = *ctx.source_list;
+  XrdOucString& target = ctx.target;
+  XrdOucString& arg2 = job.arg2;
+  XrdOucString& targetfile = job.targetfile;
+  XrdOucString& upload_target = job.upload_target;
+  bool preserve = ctx.preserve;
+  bool checksums = ctx.checksums;
+  bool noprogress = ctx.noprogress;
+  bool silent = ctx.silent;
+  bool debug = ctx.debug;
+  XrdOucString cmdline;
+  int lrc = 0;
+
+  if (job.inprocess)
+  {
+    if (debug) fprintf(stderr, "[eos-cp] copying: %s => %s\n", job.arg1.c_str(), arg2.c_str());
+    lrc = cp_xrdcl(job);
+  }
+  else
+  {
+    cmdline = job.cmdprefix;
+    cmdline += job.mkdir ? "eoscp -p " : "eoscp ";
+    cmdline += job.cmdargs;
+    if (debug)fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
+    lrc = system(cmdline.c_str());
+  }
+
+  int erc = lrc ; // the original return code
+  // check the target size
+  struct stat buf;
+
+  if ((targetfile.beginswith("/eos/") || (targetfile.beginswith("root://"))))
+  {
+    buf.st_size = 0;
+    XrdOucString url = serveruri.c_str();
+    url += "/";
+    if (targetfile.beginswith("root://"))
+    {
+      url = targetfile;
+    }
+    else
+    {
+      url += targetfile;
+    }
+
+    if ((url.find("?") == STR_NPOS))
+    {
+	url += "?";
+    }
+    else
+    {
+	url += "&";
+    }
+
+    url += "eos.app=eoscp";
+    // add the 'role' switches to the URL
+    if (user_role.length() && group_role.length())
+    {
+      url += "&eos.ruid=";
+      url += user_role;
+      url += "&eos.rgid=";
+      url += group_role;
+    }
+
+    if (!XrdPosixXrootd::Stat(url.c_str(), &buf))
+    {
+      if ((source_size[nfile]) && (buf.st_size != (off_t) source_size[nfile]))
+      {
+        fprintf(stderr, "error: filesize differ between source and target file!\n");
+        lrc = 0xffff00;
+      }
+      else
+      {
+        if (preserve && (source_size.size() == source_utime.size()))
+        {
+          char value[4096];
+          value[0] = 0;
+          ;
+          XrdOucString request;
+          request = url.c_str();
+          if ((url.find("?") == STR_NPOS))
+          {
+            request += "?";
+          }
+          else
+          {
+            request += "&";
+          }
+          request += "mgm.pcmd=utimes&tv1_sec=";
+          char lltime[1024];
+          sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].first.tv_sec);
+          request += lltime;
+          request += "&tv1_nsec=";
+          sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].first.tv_nsec);
+          request += lltime;
+          request += "&tv2_sec=";
+          sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].second.tv_sec);
+          request += lltime;
+          request += "&tv2_nsec=";
+          sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].second.tv_nsec);
+          request += lltime;
+
+          long long doutimes = XrdPosixXrootd::QueryOpaque(request.c_str(), value, 4096);
+          if (doutimes >= 0)
+          {
+            char tag[1024];
+            int retc;
+            // parse the stat output
+            int items = sscanf(value, "%s retc=%d", tag, &retc);
+            if ((items != 2) || (strcmp(tag, "utimes:")))
+            {
+              fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
+            }
+          }
+          else
+          {
+            fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
+          }
+        }
+      }
+    }
+    else
+    {
+      fprintf(stderr, "error: target file was not created!\n");
+      lrc = 0xffff00;
+    }
+  }
+
+  if (((arg2.find(":/") == STR_NPOS) && (!arg2.beginswith("as3:"))))
+  {
+    // exclude STDOUT
+    if (arg2 != "-")
+    {
+      // this is a local file
+      buf.st_size = 0;
+      if (!stat(targetfile.c_str(), &buf))
+      {
+        if ((source_size[nfile]) && (buf.st_size != (off_t) source_size[nfile]))
+        {
+          fprintf(stderr, "error: filesize differ between source and target file!\n");
+          lrc = 0xffff00;
+        }
+        else
+        {
+          if (preserve && (source_size.size() == source_utime.size()))
+          {
+            struct timeval times[2];
+            times[0].tv_sec = source_utime[nfile].first.tv_sec;
+            times[0].tv_usec = source_utime[nfile].first.tv_nsec / 1000;
+            times[1].tv_sec = source_utime[nfile].second.tv_sec;
+            times[1].tv_usec = source_utime[nfile].second.tv_nsec / 1000;
+
+            if (utimes(targetfile.c_str(), times))
+            {
+              fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
+            }
+          }
+        }
+      }
+      else
+      {
+        fprintf(stderr, "error: target file was not created!\n");
+        lrc = 0xffff00;
+      }
+    }
+  }
+  if (!WEXITSTATUS(lrc))
+  {
+    if (target.beginswith("/eos"))
+    {
+      if (checksums)
+      {
+        XrdOucString address = serveruri.c_str();
+        address += "//dummy";
+        XrdCl::URL url(address.c_str());
+
+        if (!url.IsValid())
+        {
+          fprintf(stderr, "error: the file system URL is not valid.\n");
+          return lrc;
+        }
+
+        XrdCl::FileSystem* fs = new XrdCl::FileSystem(url);
+
+        if (!fs)
+        {
+          fprintf(stderr, "erroe: failed to get new FS object. \n");
+          return lrc;
+        }
+
+        XrdCl::Buffer arg;
+        XrdCl::Buffer* response = 0;
+        XrdCl::XRootDStatus status;
+        arg.FromString(targetfile.c_str());
+        status = fs->Query(XrdCl::QueryCode::Checksum, arg, response);
+
+        if (status.IsOK())
+        {
+          XrdOucString sanswer = response->GetBuffer();
+          sanswer.replace("eos ", "");
+          fprintf(stdout, "path=%s size=%llu checksum=%s\n",
+                  source_list[nfile].c_str(), source_size[nfile], sanswer.c_str());
+        }
+        else
+        {
+          fprintf(stdout, "error: getting checksum for path=%s size=%llu\n",
+                  source_list[nfile].c_str(), source_size[nfile]);
+        }
+
+        delete response;
+        delete fs;
+      }
+    }
+
+    if (upload_target.length())
+    {
+      bool uploadok = false;
+      if (upload_target.beginswith("as3:"))
+      {
+        XrdOucString s3arg = upload_target;
+        s3arg.replace("as3:", "");
+        cmdline = "s3 put ";
+        cmdline += s3arg;
+        cmdline += " filename=";
+        cmdline += arg2;
+        if (noprogress || silent)
+        {
+          cmdline += " >& /dev/null";
+        }
+        if (debug)
+        {
+          fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
+        }
+        int rc = system(cmdline.c_str());
+        if (WEXITSTATUS(rc))
+        {
+          fprintf(stderr, "error: failed to upload to <s3>\n");
+          uploadok = false;
+        }
+        else
+        {
+          uploadok = true;
+        }
+      }
+      if (upload_target.beginswith("http:"))
+      {
+        fprintf(stderr, "error: we don't support file uploads with http/https protocol\n");
+        uploadok = false;
+      }
+      if (upload_target.beginswith("https:"))
+      {
+        fprintf(stderr, "error: we don't support file uploads with http/https protocol\n");
+        uploadok = false;
+      }
+      if (upload_target.beginswith("gsiftp:"))
+      {
+        cmdline = "globus-url-copy file://";
+        cmdline += arg2;
+        cmdline += " ";
+        cmdline += upload_target;
+        if (silent)
+        {
+          cmdline += " >&/dev/null";
+        }
+        if (debug)
+        {
+          fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
+        }
+        int rc = system(cmdline.c_str());
+        if (WEXITSTATUS(rc))
+        {
+          fprintf(stderr, "error: failed to upload to <gsiftp>\n");
+          uploadok = false;
+        }
+        else
+        {
+          uploadok = true;
+        }
+        uploadok = true;
+      }
+      // clean-up the tmp file in any case
+      unlink(arg2.c_str());
+
+      if (!uploadok)
+      {
+        lrc |= 0xffff00;
+      }
+      else
+      {
+        job.copied = true;
+      }
+    }
+    else
+    {
+      job.copied = true;
+    }
+  } 
+  // check if we got a CONTROL-C
+  if ( erc == EINTR) 
+  {
+    fprintf(stderr,"<Control-C>\n");
+    job.interrupted = true;
+  }
+
+  return lrc;
+
+}
+
+//------------------------------------------------------------------------------
+// Copy worker - runs jobs until all are done or CONTROL-C was hit
+//------------------------------------------------------------------------------
+static void*
+cp_worker (void* arg)
+{
+  CpContext* ctx = static_cast<CpContext*> (arg);
+
+  while (1)
+  {
+    size_t n = 0;
+    {
+      XrdSysMutexHelper lock(ctx->mutex);
+
+      if (ctx->stop || cp_interrupted || (ctx->next >= ctx->jobs.size()))
+        break;
+
+      n = ctx->next++;
+    }
+
+    CpJob& job = ctx->jobs[n];
+    int lrc = cp_run(*ctx, job);
+    XrdSysMutexHelper lock(ctx->mutex);
+    ctx->retc |= lrc;
+
+    if (job.copied)
+    {
+      ctx->copiedok++;
+      ctx->copiedsize += (*ctx->source_size)[job.nfile];
+    }
+
+    if (job.interrupted)
+      ctx->stop = true;
+  }
+
+  return 0;
+}
+
 int
 com_cp_usage ()
 {
-  fprintf(stdout, "Usage: cp [--async] [--atomic] [--rate=<rate>] [--streams=<n>] [--recursive|-R|-r] [-a] [-n] [-S] [-s|--silent] [-d] [--checksum] <src> <dst>");
+  fprintf(stdout, "Usage: cp [--async] [--atomic] [--rate=<rate>] [--streams=<n>] [--parallel=<n>] [--recursive|-R|-r] [-a] [-n] [-S] [-s|--silent] [-d] [--checksum] <src> <dst>");
   fprintf(stdout, "'[eos] cp ..' provides copy functionality to EOS.\n");
   fprintf(stdout, "Options:\n");
   fprintf(stdout, "                                                             <src>|<dst> can be root://<host>/<path>, a local path /tmp/../ or an eos path /eos/ in the connected instanace...\n");
@@ -43,6 +644,7 @@ com_cp_usage ()
   fprintf(stdout, "       --atomic        : run an atomic upload where files are only visible with the target name when their are completly uploaded [ adds ?eos.atomic=1 to the target URL ]\n");
   fprintf(stdout, "       --rate          : limit the cp rate to <rate>\n");
   fprintf(stdout, "       --streams       : use <#> parallel streams\n");
+  fprintf(stdout, "       --parallel      : copy up to <#> files at the same time (default 1 for a single file, otherwise 8) - the progress bar is disabled for more than one\n");
   fprintf(stdout, "       --checksum      : output the checksums\n");
   fprintf(stdout, " -p |--preserve : preserves file creation and modification time from the source\n");
   fprintf(stdout, "       -a              : append to the target, don't truncate\n");
@@ -115,6 +717,8 @@ com_cp (char* argin)
   bool silent = false;
   bool nooverwrite = false;
   bool preserve = false;
+  size_t parallel = 0;
+  CpContext ctx;
   XrdOucString atomic = "";
   unsigned long long copysize = 0;
   int retc = 0;
@@ -147,6 +751,15 @@ com_cp (char* argin)
         streams = option;
         streams.replace("--streams=", "");
       }
+      else if (option.beginswith("--parallel="))
+      {
+        XrdOucString sparallel = option;
+        sparallel.replace("--parallel=", "");
+        parallel = atoi(sparallel.c_str());
+
+        if (!parallel)
+          return com_cp_usage();
+      }
       else
       {
         if ((option == "--recursive") ||
@@ -490,6 +1103,15 @@ com_cp (char* argin)
     exit(0);
   }
 
+  if (!parallel)
+    parallel = (source_list.size() > 1) ? 8 : 1;
+
+  if (parallel > 1)
+  {
+    // progress bars of concurrent copies would overwrite each other
+    noprogress = true;
+  }
+
   // create the target directory if it is a local one
   if ((!target.beginswith("/eos")))
   {
@@ -548,6 +1170,25 @@ com_cp (char* argin)
   }
 
 
+  // stat all the XRootD sources up front with many requests in flight
+  std::vector<XrdOucString> stat_urls(source_list.size());
+  std::vector<CpStat> source_stat;
+
+  for (size_t nfile = 0; nfile < source_list.size(); nfile++)
+  {
+    if (source_list[nfile].beginswith("/eos/"))
+    {
+      stat_urls[nfile] = serveruri.c_str();
+      stat_urls[nfile] += "/";
+      stat_urls[nfile] += source_list[nfile];
+    }
+
+    if (source_list[nfile].beginswith("root:"))
+      stat_urls[nfile] = source_list[nfile];
+  }
+
+  cp_stat_sources(stat_urls, source_stat, 256);
+
   // compute the size to copy
   std::vector<std::string> file_info;
   for (size_t nfile = 0; nfile < source_list.size(); nfile++)
@@ -559,11 +1200,8 @@ com_cp (char* argin)
 
     if (source_list[nfile].beginswith("/eos/"))
     {
-      struct stat buf;
-      XrdOucString url = serveruri.c_str();
-      url += "/";
-      url += source_list[nfile];
-      if (!XrdPosixXrootd::Stat(url.c_str(), &buf))
+      struct stat& buf = source_stat[nfile].buf;
+      if (source_stat[nfile].ok)
       {
         if (S_ISDIR(buf.st_mode))
         {
@@ -702,8 +1340,8 @@ com_cp (char* argin)
       // ------------------------------------------
       // XRootD file
       // ------------------------------------------
-      struct stat buf;
-      if (!XrdPosixXrootd::Stat(source_list[nfile].c_str(), &buf))
+      struct stat& buf = source_stat[nfile].buf;
+      if (source_stat[nfile].ok)
       {
         if (S_ISDIR(buf.st_mode))
         {
@@ -1100,8 +1738,11 @@ com_cp (char* argin)
       }
     }
 
-    // everything goes either via a stage file or direct
-    cmdline += "eoscp -p ";
+    // everything goes either via a stage file or direct, the 'eoscp [-p]'
+    // command is put between the prefix and the arguments when the job runs
+    CpJob job;
+    job.cmdprefix = cmdline;
+    cmdline = "";
     if (append) cmdline += "-a ";
     if (!summary) cmdline += "-s ";
     if (noprogress) cmdline += "-n ";
@@ -1147,291 +1788,159 @@ com_cp (char* argin)
       cmdline += " > /dev/null";
     }
 
-    if (debug)fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
-    int lrc = system(cmdline.c_str());
-    int erc = lrc ; // the original return code
-    // check the target size
-    struct stat buf;
 
-    if ((targetfile.beginswith("/eos/") || (targetfile.beginswith("root://"))))
+    job.nfile = nfile;
+    job.arg1 = arg1;
+    job.arg2 = arg2;
+    job.targetfile = targetfile;
+    job.upload_target = upload_target;
+    job.cmdargs = cmdline;
+    job.mkdir = true;
+    job.copied = false;
+    job.interrupted = false;
+    // plain XRootD/local copies without progress bar or summary run in-process
+    job.inprocess = (noprogress && !summary && !append && !rstdin && !rstdout &&
+                     !upload_target.length() && !transfersize.length() &&
+                     (arg1.find("#AND#") == STR_NPOS) &&
+                     (arg2.find("#AND#") == STR_NPOS) &&
+                     (arg1.beginswith("root:") || arg1.beginswith("/")) &&
+                     (arg2.beginswith("root:") || arg2.beginswith("/")));
+    ctx.jobs.push_back(job);
+    upload_target = "";
+  }
+
+  // --------------------------------------------------------------------------
+  // create the EOS target directories once instead of letting every eoscp
+  // check and create the path of its file
+  // --------------------------------------------------------------------------
+  if (target.beginswith("/eos") && (ctx.jobs.size() > 1))
+  {
+    std::map<std::string, bool> targetdirs;
+
+    for (size_t i = 0; i < ctx.jobs.size(); i++)
     {
-      buf.st_size = 0;
-      XrdOucString url = serveruri.c_str();
-      url += "/";
-      if (targetfile.beginswith("root://"))
-      {
-        url = targetfile;
-      }
-      else
-      {
-        url += targetfile;
-      }
+      XrdOucString tpath = ctx.jobs[i].targetfile;
 
-      if ((url.find("?") == STR_NPOS))
-      {
-	url += "?";
-      }
-      else
-      {
-	url += "&";
-      }
+      if (tpath.find("?") != STR_NPOS)
+        tpath.erase(tpath.find("?"));
+
+      eos::common::Path cTarget(tpath.c_str());
+      targetdirs[cTarget.GetParentPath()] = false;
+    }
+
+    XrdCl::FileSystem fs(XrdCl::URL(serveruri.c_str()));
+    XrdCl::Access::Mode mode = XrdCl::Access::UR | XrdCl::Access::UW |
+      XrdCl::Access::UX | XrdCl::Access::GR | XrdCl::Access::GX |
+      XrdCl::Access::OR | XrdCl::Access::OX;
+
+    for (std::map<std::string, bool>::iterator it = targetdirs.begin();
+         it != targetdirs.end(); it++)
+    {
+      std::string dpath = it->first;
+      dpath += "?eos.app=eoscp";
 
-      url += "eos.app=eoscp";
-      // add the 'role' switches to the URL
       if (user_role.length() && group_role.length())
       {
-        url += "&eos.ruid=";
-        url += user_role;
-        url += "&eos.rgid=";
-        url += group_role;
+        dpath += "&eos.ruid=";
+        dpath += user_role.c_str();
+        dpath += "&eos.rgid=";
+        dpath += group_role.c_str();
       }
 
-      if (!XrdPosixXrootd::Stat(url.c_str(), &buf))
-      {
-        if ((source_size[nfile]) && (buf.st_size != (off_t) source_size[nfile]))
-        {
-          fprintf(stderr, "error: filesize differ between source and target file!\n");
-          lrc = 0xffff00;
-        }
-        else
-        {
-          if (preserve && (source_size.size() == source_utime.size()))
-          {
-            char value[4096];
-            value[0] = 0;
-            ;
-            XrdOucString request;
-            request = url.c_str();
-            if ((url.find("?") == STR_NPOS))
-            {
-              request += "?";
-            }
-            else
-            {
-              request += "&";
-            }
-            request += "mgm.pcmd=utimes&tv1_sec=";
-            char lltime[1024];
-            sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].first.tv_sec);
-            request += lltime;
-            request += "&tv1_nsec=";
-            sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].first.tv_nsec);
-            request += lltime;
-            request += "&tv2_sec=";
-            sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].second.tv_sec);
-            request += lltime;
-            request += "&tv2_nsec=";
-            sprintf(lltime, "%llu", (unsigned long long) source_utime[nfile].second.tv_nsec);
-            request += lltime;
-
-            long long doutimes = XrdPosixXrootd::QueryOpaque(request.c_str(), value, 4096);
-            if (doutimes >= 0)
-            {
-              char tag[1024];
-              int retc;
-              // parse the stat output
-              int items = sscanf(value, "%s retc=%d", tag, &retc);
-              if ((items != 2) || (strcmp(tag, "utimes:")))
-              {
-                fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
-              }
-            }
-            else
-            {
-              fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
-            }
-          }
-        }
-      }
-      else
-      {
-        fprintf(stderr, "error: target file was not created!\n");
-        lrc = 0xffff00;
-      }
-    }
+      XrdCl::XRootDStatus status = fs.MkDir(dpath, XrdCl::MkDirFlags::MakePath, mode);
+      it->second = status.IsOK();
 
-    if (((arg2.find(":/") == STR_NPOS) && (!arg2.beginswith("as3:"))))
-    {
-      // exclude STDOUT
-      if (arg2 != "-")
+      if (debug)
       {
-        // this is a local file
-        buf.st_size = 0;
-        if (!stat(targetfile.c_str(), &buf))
-        {
-          if ((source_size[nfile]) && (buf.st_size != (off_t) source_size[nfile]))
-          {
-            fprintf(stderr, "error: filesize differ between source and target file!\n");
-            lrc = 0xffff00;
-          }
-          else
-          {
-            if (preserve && (source_size.size() == source_utime.size()))
-            {
-              struct timeval times[2];
-              times[0].tv_sec = source_utime[nfile].first.tv_sec;
-              times[0].tv_usec = source_utime[nfile].first.tv_nsec / 1000;
-              times[1].tv_sec = source_utime[nfile].second.tv_sec;
-              times[1].tv_usec = source_utime[nfile].second.tv_nsec / 1000;
-
-              if (utimes(targetfile.c_str(), times))
-              {
-                fprintf(stderr, "warning: creation/modification time could not be preserved for %s\n", targetfile.c_str());
-              }
-            }
-          }
-        }
-        else
-        {
-          fprintf(stderr, "error: target file was not created!\n");
-          lrc = 0xffff00;
-        }
+        fprintf(stderr, "[eos-cp] mkdir %s : %s\n", it->first.c_str(),
+                status.ToStr().c_str());
       }
     }
-    if (!WEXITSTATUS(lrc))
-    {
-      if (target.beginswith("/eos"))
-      {
-        if (checksums)
-        {
-          XrdOucString address = serveruri.c_str();
-          address += "//dummy";
-          XrdCl::URL url(address.c_str());
 
-          if (!url.IsValid())
-          {
-            fprintf(stderr, "error: the file system URL is not valid.\n");
-            return (0);
-          }
+    for (size_t i = 0; i < ctx.jobs.size(); i++)
+    {
+      XrdOucString tpath = ctx.jobs[i].targetfile;
 
-          XrdCl::FileSystem* fs = new XrdCl::FileSystem(url);
+      if (tpath.find("?") != STR_NPOS)
+        tpath.erase(tpath.find("?"));
 
-          if (!fs)
-          {
-            fprintf(stderr, "erroe: failed to get new FS object. \n");
-            return (0);
-          }
+      eos::common::Path cTarget(tpath.c_str());
+      ctx.jobs[i].mkdir = !targetdirs[cTarget.GetParentPath()];
+    }
+  }
 
-          XrdCl::Buffer arg;
-          XrdCl::Buffer* response = 0;
-          XrdCl::XRootDStatus status;
-          arg.FromString(targetfile.c_str());
-          status = fs->Query(XrdCl::QueryCode::Checksum, arg, response);
+  // --------------------------------------------------------------------------
+  // run the jobs with a pool of copy workers
+  // --------------------------------------------------------------------------
+  ctx.source_size = &source_size;
+  ctx.source_utime = &source_utime;
+  ctx.source_list = &source_list;
+  ctx.target = target;
+  ctx.preserve = preserve;
+  ctx.checksums = checksums;
+  ctx.noprogress = noprogress;
+  ctx.silent = silent;
+  ctx.debug = debug;
+  ctx.next = 0;
+  ctx.stop = false;
+  ctx.retc = retc;
+  ctx.copiedok = 0;
+  ctx.copiedsize = 0;
+
+  if (parallel > ctx.jobs.size())
+    parallel = ctx.jobs.size();
+
+  // CONTROL-C cancels the in-process copies instead of exiting the console
+  bool inprocess = false;
+
+  for (size_t i = 0; i < ctx.jobs.size(); i++)
+  {
+    if (ctx.jobs[i].inprocess)
+      inprocess = true;
+  }
 
-          if (status.IsOK())
-          {
-            XrdOucString sanswer = response->GetBuffer();
-            sanswer.replace("eos ", "");
-            fprintf(stdout, "path=%s size=%llu checksum=%s\n",
-                    source_list[nfile].c_str(), source_size[nfile], sanswer.c_str());
-          }
-          else
-          {
-            fprintf(stdout, "error: getting checksum for path=%s size=%llu\n",
-                    source_list[nfile].c_str(), source_size[nfile]);
-          }
+  struct sigaction sa, oldsa;
 
-          delete response;
-          delete fs;
-        }
-      }
+  if (inprocess)
+  {
+    cp_interrupted = 0;
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = cp_interrupt_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &oldsa);
+  }
 
-      if (upload_target.length())
-      {
-        bool uploadok = false;
-        if (upload_target.beginswith("as3:"))
-        {
-          XrdOucString s3arg = upload_target;
-          s3arg.replace("as3:", "");
-          cmdline = "s3 put ";
-          cmdline += s3arg;
-          cmdline += " filename=";
-          cmdline += arg2;
-          if (noprogress || silent)
-          {
-            cmdline += " >& /dev/null";
-          }
-          if (debug)
-          {
-            fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
-          }
-          int rc = system(cmdline.c_str());
-          if (WEXITSTATUS(rc))
-          {
-            fprintf(stderr, "error: failed to upload to <s3>\n");
-            uploadok = false;
-          }
-          else
-          {
-            uploadok = true;
-          }
-        }
-        if (upload_target.beginswith("http:"))
-        {
-          fprintf(stderr, "error: we don't support file uploads with http/https protocol\n");
-          uploadok = false;
-        }
-        if (upload_target.beginswith("https:"))
-        {
-          fprintf(stderr, "error: we don't support file uploads with http/https protocol\n");
-          uploadok = false;
-        }
-        if (upload_target.beginswith("gsiftp:"))
-        {
-          cmdline = "globus-url-copy file://";
-          cmdline += arg2;
-          cmdline += " ";
-          cmdline += upload_target;
-          if (silent)
-          {
-            cmdline += " >&/dev/null";
-          }
-          if (debug)
-          {
-            fprintf(stderr, "[eos-cp] running: %s\n", cmdline.c_str());
-          }
-          int rc = system(cmdline.c_str());
-          if (WEXITSTATUS(rc))
-          {
-            fprintf(stderr, "error: failed to upload to <gsiftp>\n");
-            uploadok = false;
-          }
-          else
-          {
-            uploadok = true;
-          }
-          uploadok = true;
-        }
-        // clean-up the tmp file in any case
-        unlink(arg2.c_str());
+  if (parallel <= 1)
+  {
+    cp_worker(&ctx);
+  }
+  else
+  {
+    std::vector<pthread_t> workers;
 
-        if (!uploadok)
-        {
-          lrc |= 0xffff00;
-        }
-        else
-        {
-          copiedok++;
-          copiedsize += source_size[nfile];
-        }
-      }
-      else
-      {
-        copiedok++;
-        copiedsize += source_size[nfile];
-      }
-    } 
-    // check if we got a CONTROL-C
-    if ( erc == EINTR) 
+    for (size_t i = 0; i < parallel; i++)
     {
-      fprintf(stderr,"<Control-C>\n");
-      retc |= lrc;
-      break;
+      pthread_t tid;
+
+      if (!XrdSysThread::Run(&tid, cp_worker, static_cast<void*> (&ctx),
+                             XRDSYSTHREAD_HOLD, "Copy Worker"))
+        workers.push_back(tid);
     }
 
-    retc |= lrc;
+    if (workers.empty())
+      cp_worker(&ctx);
+
+    for (size_t i = 0; i < workers.size(); i++)
+      XrdSysThread::Join(workers[i], NULL);
   }
 
+  if (inprocess)
+    sigaction(SIGINT, &oldsa, 0);
+
+  retc = ctx.retc;
+  copiedok = ctx.copiedok;
+  copiedsize = ctx.copiedsize;
+
   gettimeofday(&tv2, &tz);
 
   float passed = (float) (((tv2.tv_sec - tv1.tv_sec) *1000000 + (tv2.tv_usec - tv1.tv_usec)) / 1000000.0);
@@ -919,6 +919,14 @@ com_fs_usage:
   fprintf(stdout, "                                                  grace period before a filesystem with an operation error get's automatically drained\n");
   fprintf(stdout, "fs config <fsid> drainperiod=<seconds> : \n");
   fprintf(stdout, "                                                  drain period a drain job is waiting to finish the drain procedure\n");
+  fprintf(stdout, "fs config <fsid> iodepth=<n> :\n");
+  fprintf(stdout, "                                                  queue the vector reads and writes of files without block checksums on an io_uring with <n> entries. 0 uses synchronous IO (default).\n");
+  fprintf(stdout, "fs config <fsid> iosched=<n> :\n");
+  fprintf(stdout, "                                                  let at most <n> reads/writes run in parallel on the filesystem when its disk is loaded and share them between user access, transfers (drain, balance, third party copies) and verification (scanner, scrubber) by weight. 0 disables the IO scheduling (default).\n");
+  fprintf(stdout, "fs config <fsid> iosched.load=<percent> :\n");
+  fprintf(stdout, "                                                  disk load (busy time) above which the IO scheduler limits the parallel IO (default 50).\n");
+  fprintf(stdout, "fs config <fsid> iosched.user|iosched.transfer|iosched.verify=<weight> :\n");
+  fprintf(stdout, "                                                  share of the IOPS and the bandwidth of a loaded disk given to user access, transfers and verification (default 8, 2 and 1).\n");
   fprintf(stdout, "\n");
   fprintf(stdout, "fs rm    <fs-id>|<node-queue>|<mount-point>|<hostname> <mountpoint> :\n");
   fprintf(stdout, "                                                  remove filesystem configuration by various identifiers\n");
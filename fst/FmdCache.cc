@@ -0,0 +1,144 @@
+// ----------------------------------------------------------------------
+// File: FmdCache.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/FmdCache.hh"
+/*----------------------------------------------------------------------------*/
+#include <limits>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+/*----------------------------------------------------------------------------*/
+FmdCache::FmdCache (size_t capacity) :
+  mCapacity(capacity),
+  mHits(0),
+  mMisses(0)
+{
+  mIndex.set_empty_key(std::numeric_limits<eos::common::FileId::fileid_t>::max() - 1);
+  mIndex.set_deleted_key(std::numeric_limits<eos::common::FileId::fileid_t>::max());
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+FmdCache::Get (eos::common::FileId::fileid_t fid, Fmd& fmd)
+{
+  if (!mCapacity)
+    return false;
+
+  XrdSysMutexHelper lock(mMutex);
+  google::dense_hash_map<eos::common::FileId::fileid_t, lru_t::iterator>::iterator it =
+    mIndex.find(fid);
+
+  if (it == mIndex.end())
+  {
+    mMisses++;
+    return false;
+  }
+
+  mHits++;
+  // move to the front of the list, the iterators stay valid
+  mLru.splice(mLru.begin(), mLru, it->second);
+  fmd = it->second->second;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+FmdCache::Put (eos::common::FileId::fileid_t fid, const Fmd& fmd)
+{
+  if (!mCapacity)
+    return;
+
+  XrdSysMutexHelper lock(mMutex);
+  google::dense_hash_map<eos::common::FileId::fileid_t, lru_t::iterator>::iterator it =
+    mIndex.find(fid);
+
+  if (it != mIndex.end())
+  {
+    mLru.splice(mLru.begin(), mLru, it->second);
+    it->second->second = fmd;
+    return;
+  }
+
+  if (mLru.size() >= mCapacity)
+  {
+    // evict the least recently used record and reuse its list node
+    mIndex.erase(mLru.back().first);
+    mLru.splice(mLru.begin(), mLru, --mLru.end());
+    mLru.front().first = fid;
+    mLru.front().second = fmd;
+  }
+  else
+  {
+    mLru.push_front(std::make_pair(fid, fmd));
+  }
+
+  mIndex[fid] = mLru.begin();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+FmdCache::Erase (eos::common::FileId::fileid_t fid)
+{
+  if (!mCapacity)
+    return;
+
+  XrdSysMutexHelper lock(mMutex);
+  google::dense_hash_map<eos::common::FileId::fileid_t, lru_t::iterator>::iterator it =
+    mIndex.find(fid);
+
+  if (it != mIndex.end())
+  {
+    mLru.erase(it->second);
+    mIndex.erase(it);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+FmdCache::Clear ()
+{
+  XrdSysMutexHelper lock(mMutex);
+  mLru.clear();
+  mIndex.clear();
+}
+
+/*----------------------------------------------------------------------------*/
+size_t
+FmdCache::Size ()
+{
+  XrdSysMutexHelper lock(mMutex);
+  return mLru.size();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+FmdCache::GetStatistics (unsigned long long& hits, unsigned long long& misses)
+{
+  XrdSysMutexHelper lock(mMutex);
+  hits = mHits;
+  misses = mMisses;
+}
+
+EOSFSTNAMESPACE_END
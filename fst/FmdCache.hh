@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------
+// File: FmdCache.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file   FmdCache.hh
+ *
+ * @brief  Bounded LRU cache of the recently used Fmd records of a filesystem.
+ *
+ */
+
+#ifndef __EOSFST_FMDCACHE_HH__
+#define __EOSFST_FMDCACHE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+#include "fst/Fmd.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <google/dense_hash_map>
+#include <list>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+// ---------------------------------------------------------------------------
+//! Class FmdCache
+//! Holds the parsed Fmd records of the files currently in use (opened,
+//! committed, verified ...) so that they are not fetched from the DB and
+//! parsed again each time. Records which are not in the cache are loaded
+//! lazily by the caller, the least recently used one is evicted when the
+//! cache is full. The cache has its own mutex as it is filled by readers.
+// ---------------------------------------------------------------------------
+class FmdCache
+{
+public:
+
+  // ---------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param capacity maximum number of records, 0 disables the cache
+  // ---------------------------------------------------------------------------
+  FmdCache (size_t capacity);
+
+  // ---------------------------------------------------------------------------
+  //! Destructor
+  // ---------------------------------------------------------------------------
+  ~FmdCache () { }
+
+  // ---------------------------------------------------------------------------
+  //! Get a record and mark it as most recently used
+  //!
+  //! @param fid file id
+  //! @param fmd record found
+  //!
+  //! @return true if found, otherwise false
+  // ---------------------------------------------------------------------------
+  bool Get (eos::common::FileId::fileid_t fid, Fmd& fmd);
+
+  // ---------------------------------------------------------------------------
+  //! Insert or update a record
+  //!
+  //! @param fid file id
+  //! @param fmd record
+  // ---------------------------------------------------------------------------
+  void Put (eos::common::FileId::fileid_t fid, const Fmd& fmd);
+
+  // ---------------------------------------------------------------------------
+  //! Drop a record
+  // ---------------------------------------------------------------------------
+  void Erase (eos::common::FileId::fileid_t fid);
+
+  // ---------------------------------------------------------------------------
+  //! Drop all the records
+  // ---------------------------------------------------------------------------
+  void Clear ();
+
+  // ---------------------------------------------------------------------------
+  //! Get the number of records in the cache
+  // ---------------------------------------------------------------------------
+  size_t Size ();
+
+  // ---------------------------------------------------------------------------
+  //! Get the number of lookups served from/missing in the cache
+  // ---------------------------------------------------------------------------
+  void GetStatistics (unsigned long long& hits, unsigned long long& misses);
+
+private:
+  typedef std::list< std::pair<eos::common::FileId::fileid_t, Fmd> > lru_t;
+
+  XrdSysMutex mMutex; ///< protects all the members below
+  size_t mCapacity; ///< maximum number of records
+  lru_t mLru; ///< records, most recently used first
+  ///! position of each record in the LRU list
+  google::dense_hash_map<eos::common::FileId::fileid_t, lru_t::iterator> mIndex;
+  unsigned long long mHits; ///< lookups served from the cache
+  unsigned long long mMisses; ///< lookups missing in the cache
+};
+
+EOSFSTNAMESPACE_END
+
+#endif
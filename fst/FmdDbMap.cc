@@ -66,7 +66,7 @@ FmdDbMapHandler::SetDBFile (const char* dbfileprefix, int fsid, XrdOucString opt
   {
     // we first check if we have already this DB open - in this case we first do a shutdown
     eos::common::RWMutexReadLock lock(Mutex);
-    if (dbmap.count(fsid))
+    if (shards.count(fsid))
     {
       isattached = true;
     }
@@ -74,17 +74,17 @@ FmdDbMapHandler::SetDBFile (const char* dbfileprefix, int fsid, XrdOucString opt
 
   if (isattached)
   {
-    if(ShutdownDB(fsid))
-      isattached = false;
+    if (!ShutdownDB(fsid))
+    {
+      // the DB is still attached to the current shard, don't open it twice
+      eos_err("cannot replace the DB of fsid=%d - the current one is still attached", fsid);
+      return false;
+    }
   }
 
   eos::common::RWMutexWriteLock lock(Mutex);
-
-  if(!isattached)
-  { 
-    dbmap[fsid]=new eos::common::DbMap();
-  }
-
+  FmdDbShard* shard = new FmdDbShard(commitLatencyMs, commitBatchSize, cacheSize);
+  shards[fsid] = shard;
 
   //! -when we successfully attach to a DB we set the mode to S_IRWXU & ~S_IRGRP
   //! -when we shutdown the daemon clean we set the mode back to S_IRWXU | S_IRGRP
@@ -126,12 +126,13 @@ FmdDbMapHandler::SetDBFile (const char* dbfileprefix, int fsid, XrdOucString opt
     if(lvdboption.BloomFilterNbits==0 && lvdboption.BloomFilterNbits==0) dbopt=NULL;
 #endif
 
-  if(!dbmap[fsid]->attachDb(fsDBFileName,true,0,dbopt)) {
+  if(!shard->db->attachDb(fsDBFileName,true,0,dbopt)) {
     eos_err("failed to attach %s database file %s", eos::common::DbMap::getDbType().c_str(), fsDBFileName);
     return false;
   }
   else {
-    dbmap[fsid]->outOfCore(true);
+    shard->db->outOfCore(true);
+    shard->committer->Start();
   }
 
   // set the mode to S_IRWXU & ~S_IRGRP
@@ -159,8 +160,14 @@ FmdDbMapHandler::ShutdownDB (eos::common::FileSystem::fsid_t fsid)
 {
   eos::common::RWMutexWriteLock lock(Mutex);
   eos_info("%s DB shutdown for fsid=%lu\n", eos::common::DbMap::getDbType().c_str(), (unsigned long) fsid);
-  if (dbmap.count(fsid))
+  FmdDbShard* shard = GetShard(fsid);
+  if (shard)
   {
+    unsigned long long hits, misses;
+    shard->cache.GetStatistics(hits, misses);
+    eos_info("fsid=%lu fmd cache hits=%llu misses=%llu", (unsigned long) fsid, hits, misses);
+    // write the records still buffered before the DB is flagged clean
+    shard->committer->Stop();
     if (!stayDirty[fsid])
     {
       // if there was a complete boot procedure done, we remove the dirty flag
@@ -170,11 +177,16 @@ FmdDbMapHandler::ShutdownDB (eos::common::FileSystem::fsid_t fsid)
         eos_crit("failed to switch the %s database file to S_IRWXU | S_IRGRP errno=%d", eos::common::DbMap::getDbType().c_str(), errno);
       }
     }
-    if (dbmap[fsid]->detachDb())
+    if (!shard->db->detachDb())
     {
-      delete dbmap[fsid];
-      return true;
+      // keep the shard - its records are still reachable and written
+      // directly to the DB now that the committer is stopped
+      eos_err("failed to detach %s database file %s for fsid=%lu", eos::common::DbMap::getDbType().c_str(), DBfilename[fsid].c_str(), (unsigned long) fsid);
+      return false;
     }
+    shards.erase(fsid);
+    delete shard;
+    return true;
   }
   return false;
 }
@@ -230,20 +242,22 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
     return 0;
   }
 
-  Mutex.LockRead();
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
-  if (dbmap.count(fsid))
+  if (shard)
   {
-    bool entryexist=ExistFmd(fid,fsid);
-    Fmd valfmd=RetrieveFmd(fid,fsid);
+    shard->mutex.LockRead();
+    Fmd valfmd;
+    bool entryexist=RetrieveFmd(shard,fid,valfmd);
 
-    if (dbmap.count(fsid) && entryexist)
+    if (entryexist)
     {
       // this is to read an existing entry
       FmdHelper* fmd = new FmdHelper();
       if (!fmd)
       {
-        Mutex.UnLockRead();
+        shard->mutex.UnLockRead();
         return 0;
       }
 
@@ -255,7 +269,7 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
         // fatal this is somehow a wrong record!
         eos_crit("unable to get fmd for fid %llu on fs %lu - file id mismatch in meta data block (%llu)", fid, (unsigned long) fsid, fmd->fMd.fid());
         delete fmd;
-        Mutex.UnLockRead();
+        shard->mutex.UnLockRead();
         return 0;
       }
 
@@ -264,7 +278,7 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
         // fatal this is somehow a wrong record!
         eos_crit("unable to get fmd for fid %llu on fs %lu - filesystem id mismatch in meta data block (%llu)", fid, (unsigned long) fsid, fmd->fMd.fsid());
         delete fmd;
-        Mutex.UnLockRead();
+        shard->mutex.UnLockRead();
         return 0;
       }
 
@@ -284,7 +298,7 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
             eos_crit("msg=\"size mismatch disk/mgm vs memory\" fid=%08llx fsid=%lu size=%llu disksize=%llu mgmsize=%llu",
 		     fid, (unsigned long) fsid, fmd->fMd.size(), fmd->fMd.disksize(), fmd->fMd.mgmsize());
             delete fmd;
-            Mutex.UnLockRead();
+            shard->mutex.UnLockRead();
             return 0;
           }
 
@@ -300,14 +314,14 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
 		     fmd->fMd.diskchecksum().c_str(), fmd->fMd.mgmchecksum().c_str());
 
 	    delete fmd;
-	    Mutex.UnLockRead();
+	    shard->mutex.UnLockRead();
 	    return 0;
 	  }
 	}
       }
 
       // return the new entry
-      Mutex.UnLockRead();
+      shard->mutex.UnLockRead();
       return fmd;
     }
 
@@ -320,9 +334,9 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
 
       gettimeofday(&tv, &tz);
 
-      Mutex.UnLockRead(); // <--
+      shard->mutex.UnLockRead(); // <--
 
-      eos::common::RWMutexWriteLock lock(Mutex); // --> (return)
+      eos::common::RWMutexWriteLock fslock(shard->mutex); // --> (return)
 
       valfmd.set_uid(uid);
       valfmd.set_gid(gid);
@@ -364,14 +378,13 @@ FmdDbMapHandler::GetFmd (eos::common::FileId::fileid_t fid, eos::common::FileSys
     else
     {
       eos_warning("unable to get fmd for fid %llu on fs %lu - record not found", fid, (unsigned long) fsid);
-      Mutex.UnLockRead();
+      shard->mutex.UnLockRead();
       return 0;
     }
   }
   else
   {
     eos_crit("unable to get fmd for fid %llu on fs %lu - there is no changelog file open for that file system id", fid, (unsigned long) fsid);
-    Mutex.UnLockRead();
     return 0;
   }
 }
@@ -393,15 +406,22 @@ FmdDbMapHandler::DeleteFmd (eos::common::FileId::fileid_t fid, eos::common::File
 {
   bool rc = true;
   eos_static_info("");
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
-  bool entryexist=ExistFmd(fid,fsid);
+  if (!shard)
+    return false;
+
+  eos::common::RWMutexWriteLock fslock(shard->mutex);
+  Fmd valfmd;
+  bool entryexist=RetrieveFmd(shard,fid,valfmd);
 
   // erase the hash entry
-  if (dbmap.count(fsid) && entryexist)
+  if (entryexist)
   {
     // delete in the in-memory hash
-    if( dbmap[fsid]->remove(eos::common::Slice((const char*)&fid,sizeof(fid))) )
+    shard->cache.Erase(fid);
+    if( !shard->committer->Remove(eos::common::Slice((const char*)&fid,sizeof(fid))) )
     {
       eos_err("unable to delete fid=%08llx from fst table\n", fid);
       rc = false;
@@ -444,28 +464,24 @@ FmdDbMapHandler::Commit (FmdHelper* fmd, bool lockit)
   fmd->fMd.set_atime_ns(tv.tv_usec * 1000);
 
 
-  if (lockit)
+  if (!lockit)
   {
-    // ---->
-    Mutex.LockWrite();
+    // the caller holds Mutex and the shard mutex
+    return PutFmd(GetShard(fsid),fid,fmd->fMd);
   }
 
-  if (dbmap.count(fsid))
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
+
+  if (shard)
   {
     // update in-memory
-    if (lockit)
-    {
-      Mutex.UnLockWrite(); // <----
-    }
-    return PutFmd(fid,fsid,fmd->fMd);
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    return PutFmd(shard,fid,fmd->fMd);
   }
   else
   {
     eos_crit("no %s DB open for fsid=%llu", eos::common::DbMap::getDbType().c_str(), (unsigned long) fsid);
-    if (lockit)
-    {
-      Mutex.UnLockWrite(); // <----
-    }
   }
 
   return false;
@@ -490,7 +506,8 @@ FmdDbMapHandler::Commit (FmdHelper* fmd, bool lockit)
 bool
 FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::common::FileId::fileid_t fid, unsigned long long disksize, std::string diskchecksum, unsigned long checktime, bool filecxerror, bool blockcxerror, bool flaglayouterror)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
   eos_debug("fsid=%lu fid=%08llx disksize=%llu diskchecksum=%s checktime=%llu fcxerror=%d bcxerror=%d flaglayouterror=%d", (unsigned long) fsid, fid, disksize, diskchecksum.c_str(), checktime, filecxerror, blockcxerror, flaglayouterror);
 
@@ -500,10 +517,11 @@ FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::comm
     return false;
   }
 
-  Fmd valfmd=RetrieveFmd(fid,fsid);
-
-  if (dbmap.count(fsid))
+  if (shard)
   {
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    Fmd valfmd;
+    RetrieveFmd(shard,fid,valfmd);
     // update in-memory
     valfmd.set_disksize(disksize);
     // fix the reference value from disk
@@ -521,7 +539,7 @@ FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::comm
       // orphan, until it is synced from the mgm
       valfmd.set_layouterror(eos::common::LayoutId::kOrphan);
     }
-    return PutFmd(fid,fsid,valfmd);
+    return PutFmd(shard,fid,valfmd);
   }
   else
   {
@@ -549,7 +567,8 @@ FmdDbMapHandler::UpdateFromDisk (eos::common::FileSystem::fsid_t fsid, eos::comm
 bool
 FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::common::FileId::fileid_t fid, eos::common::FileId::fileid_t cid, eos::common::LayoutId::layoutid_t lid, unsigned long long mgmsize, std::string mgmchecksum, uid_t uid, gid_t gid, unsigned long long ctime, unsigned long long ctime_ns, unsigned long long mtime, unsigned long long mtime_ns, int layouterror, std::string locations)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
   eos_debug("fsid=%lu fid=%08llx cid=%llu lid=%lx mgmsize=%llu mgmchecksum=%s",
       (unsigned long) fsid, fid, cid, lid, mgmsize, mgmchecksum.c_str());
@@ -560,11 +579,12 @@ FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::commo
     return false;
   }
 
-  bool entryexist=ExistFmd(fid,fsid);
-  Fmd valfmd=RetrieveFmd(fid,fsid);
-
-  if (dbmap.count(fsid))
+  if (shard)
   {
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    Fmd valfmd;
+    bool entryexist=RetrieveFmd(shard,fid,valfmd);
+
     if (!entryexist)
     {
       valfmd.set_disksize(0xfffffffffff1ULL);
@@ -591,7 +611,7 @@ FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::commo
         std::string(valfmd.mgmchecksum()).erase( std::min( valfmd.mgmchecksum().length(), cslen )) );
     valfmd.set_checksum(
         std::string(valfmd.checksum()).erase( std::min( valfmd.checksum().length(), cslen )) );
-    return PutFmd(fid,fsid,valfmd);
+    return PutFmd(shard,fid,valfmd);
   }
   else
   {
@@ -613,16 +633,20 @@ FmdDbMapHandler::UpdateFromMgm (eos::common::FileSystem::fsid_t fsid, eos::commo
 bool
 FmdDbMapHandler::ResetDiskInformation (eos::common::FileSystem::fsid_t fsid)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
-  if (dbmap.count(fsid))
+  if (shard)
   {
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    // the iteration only sees the records already in the DB
+    shard->committer->Flush();
     const eos::common::DbMapTypes::Tkey *k;
     const eos::common::DbMapTypes::Tval *v;
     eos::common::DbMapTypes::Tval val;
-    dbmap[fsid]->beginSetSequence();
+    shard->db->beginSetSequence();
     unsigned long cpt=0;
-    for ( dbmap[fsid]->beginIter(); dbmap[fsid]->iterate(&k, &v);) {
+    for ( shard->db->beginIter(); shard->db->iterate(&k, &v);) {
       Fmd f;
       f.ParseFromString(v->value);
       f.set_disksize(0xfffffffffff1ULL);
@@ -632,10 +656,12 @@ FmdDbMapHandler::ResetDiskInformation (eos::common::FileSystem::fsid_t fsid)
       f.set_blockcxerror(-1);
       val=*v;
       f.SerializeToString(&val.value);
-      dbmap[fsid]->set(*k,val);
+      shard->db->set(*k,val);
       cpt++;
     }
-    if( dbmap[fsid]->endSetSequence() != cpt )
+    // all the records have been rewritten
+    shard->cache.Clear();
+    if( shard->db->endSetSequence() != cpt )
       // the setsequence makes that it's impossible to know which key is faulty
     {
       eos_err("unable to update fsid=%lu\n", fsid);
@@ -663,17 +689,21 @@ FmdDbMapHandler::ResetDiskInformation (eos::common::FileSystem::fsid_t fsid)
 bool
 FmdDbMapHandler::ResetMgmInformation (eos::common::FileSystem::fsid_t fsid)
 {
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
-  if (dbmap.count(fsid))
+  if (shard)
   {
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    // the iteration only sees the records already in the DB
+    shard->committer->Flush();
     const eos::common::DbMapTypes::Tkey *k;
     const eos::common::DbMapTypes::Tval *v;
     eos::common::DbMapTypes::Tval val;
-    dbmap[fsid]->beginSetSequence();
+    shard->db->beginSetSequence();
     unsigned long cpt=0;
 
-    for ( dbmap[fsid]->beginIter(); dbmap[fsid]->iterate(&k, &v);) {
+    for ( shard->db->beginIter(); shard->db->iterate(&k, &v);) {
       Fmd f;
       f.ParseFromString(v->value);
       f.set_mgmsize(0xfffffffffff1ULL);
@@ -681,10 +711,12 @@ FmdDbMapHandler::ResetMgmInformation (eos::common::FileSystem::fsid_t fsid)
       f.set_locations("");
       val=*v;
       f.SerializeToString(&val.value);
-      dbmap[fsid]->set(*k,val);
+      shard->db->set(*k,val);
       cpt++;
     }
-    if( dbmap[fsid]->endSetSequence() != cpt )
+    // all the records have been rewritten
+    shard->cache.Clear();
+    if( shard->db->endSetSequence() != cpt )
       // the setsequence makes that it's impossible to know which key is faulty
     {
       eos_err("unable to update fsid=%lu\n", fsid);
@@ -1131,10 +1163,13 @@ FmdDbMapHandler::GetInconsistencyStatistics (eos::common::FileSystem::fsid_t fsi
     std::map<std::string, std::set < eos::common::FileId::fileid_t> > &fidset)
 {
   eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
 
-  if (!dbmap.count(fsid))
+  if (!shard)
     return false;
 
+  eos::common::RWMutexReadLock fslock(shard->mutex);
+
   // query in-memory
   statistics["mem_n"] = 0; // number of files in DB
 
@@ -1173,7 +1208,9 @@ FmdDbMapHandler::GetInconsistencyStatistics (eos::common::FileSystem::fsid_t fsi
     eos::common::DbMapTypes::Tval val;
 
     // we report values only when we are not in the sync phase from disk/mgm
-    for ( dbmap[fsid]->beginIter(); dbmap[fsid]->iterate(&k, &v);) {
+    shard->committer->Flush();
+
+    for ( shard->db->beginIter(); shard->db->iterate(&k, &v);) {
       Fmd f;
       f.ParseFromString(v->value);
 
@@ -1265,12 +1302,16 @@ FmdDbMapHandler::ResetDB (eos::common::FileSystem::fsid_t fsid)
 {
   bool rc = true;
   eos_static_info("");
-  eos::common::RWMutexWriteLock lock(Mutex);
+  eos::common::RWMutexReadLock lock(Mutex);
+  FmdDbShard* shard = GetShard(fsid);
   // erase the hash entry
-  if (dbmap.count(fsid))
+  if (shard)
   {
+    eos::common::RWMutexWriteLock fslock(shard->mutex);
+    shard->committer->Flush();
+    shard->cache.Clear();
     // delete in the in-memory hash
-    if(!dbmap[fsid]->clear())
+    if(!shard->db->clear())
     {
       eos_err("unable to delete all from fst table\n");
       rc = false;
@@ -1291,20 +1332,22 @@ FmdDbMapHandler::ResetDB (eos::common::FileSystem::fsid_t fsid)
 bool
 FmdDbMapHandler::TrimDB()
 {
-  std::map<eos::common::FileSystem::fsid_t, eos::common::DbMap*>::iterator it;
+  eos::common::RWMutexReadLock lock(Mutex);
+  std::map<eos::common::FileSystem::fsid_t, FmdDbShard*>::iterator it;
 
-  for (it = dbmap.begin(); it != dbmap.end(); ++it)
+  for (it = shards.begin(); it != shards.end(); ++it)
   {
     eos_static_info("Trimming fsid=%llu ", it->first);
+    it->second->committer->Flush();
 
-    if (!it->second->trimDb())
+    if (!it->second->db->trimDb())
     {
       eos_static_err("Cannot trim the DB file for fsid=%llu ", it->first);
       return false;
     }
     else
     {
-      eos_static_info("Trimmed %s DB file for fsid=%llu ", it->second->getDbType().c_str(), it->first);
+      eos_static_info("Trimmed %s DB file for fsid=%llu ", it->second->db->getDbType().c_str(), it->first);
     }
   }
   return true;
@@ -40,7 +40,9 @@
 #include "common/FileSystem.hh"
 #include "common/LayoutId.hh"
 #include "common/DbMap.hh"
+#include "common/DbMapCommitter.hh"
 #include "fst/FmdHandler.hh"
+#include "fst/FmdCache.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
 #include "XrdSys/XrdSysPthread.hh"
@@ -51,6 +53,7 @@
 #include <google/sparse_hash_map>
 #include <google/sparsehash/densehashtable.h>
 #include <sys/time.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -65,6 +68,31 @@
 
 EOSFSTNAMESPACE_BEGIN
 
+// ---------------------------------------------------------------------------
+//! Per filesystem part of the Fmd handler: every filesystem has its own DB,
+//! group committer, lock and cache of recently used records, so that the
+//! operations on different disks don't wait for each other
+// ---------------------------------------------------------------------------
+struct FmdDbShard
+{
+  eos::common::DbMap* db; //< DB of the filesystem
+  eos::common::DbMapCommitter* committer; //< group committer writing into db
+  eos::common::RWMutex mutex; //< protects the records of the filesystem
+  FmdCache cache; //< recently used records, loaded lazily from db
+
+  FmdDbShard (unsigned int latencyms, size_t batchsize, size_t cachesize) :
+    db(new eos::common::DbMap()),
+    committer(new eos::common::DbMapCommitter(db, latencyms, batchsize)),
+    cache(cachesize) { }
+
+  ~FmdDbShard ()
+  {
+    // the committer writes the records still buffered
+    delete committer;
+    delete db;
+  }
+};
+
 // ---------------------------------------------------------------------------
 //! Class handling many Fmd changelog files at a time
 // ---------------------------------------------------------------------------
@@ -75,7 +103,10 @@ public:
   typedef std::vector<std::map< std::string, XrdOucString > > qr_result_t;
 
   XrdOucString DBDir; //< path to the directory with the SQLITE DBs
-  eos::common::RWMutex Mutex;//< Mutex protecting the Fmd handler
+  //! Mutex protecting the map of shards, it is taken for writing only to
+  //! attach or detach a DB. The records of a filesystem are protected by the
+  //! mutex of its shard.
+  eos::common::RWMutex Mutex;
 
   // ---------------------------------------------------------------------------
   //! Define a DB file for a filesystem id
@@ -83,7 +114,8 @@ public:
   virtual bool SetDBFile (const char* dbfile, int fsid, XrdOucString option = "");
 
   // ---------------------------------------------------------------------------
-  //! Shutdown a DB for a filesystem
+  //! Shutdown a DB for a filesystem - if the DB cannot be detached the error is
+  //! logged, the shard stays in place and false is returned
   // ---------------------------------------------------------------------------
   virtual bool ShutdownDB (eos::common::FileSystem::fsid_t fsid);
 
@@ -109,35 +141,51 @@ public:
   // ---------------------------------------------------------------------------
   virtual bool DeleteFmd (eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid);
 
-  inline bool ExistFmd(eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid)
+  // ---------------------------------------------------------------------------
+  //! Get the shard of a filesystem - the caller holds Mutex, returns 0 if
+  //! there is no DB attached for that filesystem
+  // ---------------------------------------------------------------------------
+  inline FmdDbShard* GetShard(eos::common::FileSystem::fsid_t fsid)
   {
-    eos::common::DbMap::Tval val;
-    if(!dbmap.count(fsid))
-    return false;
-    bool retval=dbmap[fsid]->get(eos::common::Slice((const char*)&fid,sizeof(fid)),&val);
-    //eos_warning("ExistFmd fid=%lu fsid=%u result=%d",fid,fsid,retval);
-    return retval;
+    std::map<eos::common::FileSystem::fsid_t, FmdDbShard*>::const_iterator it = shards.find(fsid);
+    return (it != shards.end()) ? it->second : 0;
   }
-  inline Fmd RetrieveFmd(eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid)
+
+  // ---------------------------------------------------------------------------
+  //! Record accessors - the caller holds Mutex and the shard mutex.
+  //! The records are read from the shard cache and loaded from the DB on a
+  //! miss. They are written through the group committer of the filesystem,
+  //! which buffers them for at most the commit latency and writes them to the
+  //! DB as one batch. The writes of the last batch are lost on a crash; an
+  //! unclean shutdown leaves the DB marked dirty and the full resync at the
+  //! next boot rebuilds them from the disk and the MGM.
+  // ---------------------------------------------------------------------------
+  inline bool RetrieveFmd(FmdDbShard* shard, eos::common::FileId::fileid_t fid, Fmd &fmd)
   {
-    eos::common::DbMap::Tval val;
-    dbmap[fsid]->get(eos::common::Slice((const char*)&fid,sizeof(fid)),&val);
-    Fmd retval;
-    retval.ParseFromString(val.value);
-    std::stringstream ss;
-    //eos_warning("RetrieveFmd fid=%lu fsid=%u getfid=%lu getfsid=%u",fid,fsid,retval.fid(),retval.fsid());
-    return retval;
+    if (shard->cache.Get(fid, fmd))
+      return true;
+    std::string sval;
+    if (!shard->committer->Get(eos::common::Slice((const char*)&fid,sizeof(fid)),&sval))
+      return false;
+    fmd.ParseFromString(sval);
+    //eos_warning("RetrieveFmd fid=%lu getfid=%lu getfsid=%u",fid,fmd.fid(),fmd.fsid());
+    shard->cache.Put(fid, fmd);
+    return true;
   }
-  inline bool PutFmd(eos::common::FileId::fileid_t fid, eos::common::FileSystem::fsid_t fsid, const Fmd &fmd)
+  inline bool PutFmd(FmdDbShard* shard, eos::common::FileId::fileid_t fid, const Fmd &fmd)
   {
     std::string sval;
     fmd.SerializePartialToString(&sval);
-    //eos_warning("RetrieveFmd fid=%lu fsid=%u setfid=%lu setfsid=%u",fid,fsid,fmd.fid(),fmd.fsid());
-    return dbmap[fsid]->set(eos::common::Slice((const char*)&fid,sizeof(fid)),sval,"") == 0;
+    //eos_warning("PutFmd fid=%lu setfid=%lu setfsid=%u",fid,fmd.fid(),fmd.fsid());
+    shard->cache.Put(fid, fmd);
+    return shard->committer->Put(eos::common::Slice((const char*)&fid,sizeof(fid)),sval);
   }
 
   // ---------------------------------------------------------------------------
-  //! Commit a modified fmd record
+  //! Commit a modified fmd record - the record is group committed, a successful
+  //! commit is not durable in the local DB for up to
+  //! EOS_FST_FMD_COMMIT_LATENCY_MS (default 20ms) and lost if the FST dies
+  //! in between
   // ---------------------------------------------------------------------------
   virtual bool Commit (FmdHelper* fmd, bool lockit = true);
 
@@ -197,14 +245,16 @@ public:
   virtual bool GetInconsistencyStatistics (eos::common::FileSystem::fsid_t fsid, std::map<std::string, size_t> &statistics, std::map<std::string, std::set < eos::common::FileId::fileid_t> > &fidset);
 
   // ---------------------------------------------------------------------------
-  //! Initialize the changelog hash
+  //! Drop the cached records of a filesystem
   // ---------------------------------------------------------------------------
 
   virtual void
   Reset (eos::common::FileSystem::fsid_t fsid)
   {
     // you need to lock the RWMutex Mutex before calling this
-    FmdHelperMap[fsid].clear();
+    FmdDbShard* shard = GetShard(fsid);
+    if (shard)
+      shard->cache.Clear();
   }
 
   // ---------------------------------------------------------------------------
@@ -220,11 +270,6 @@ public:
 
   // that is all we need for meta data handling
 
-  // ---------------------------------------------------------------------------
-  //! Hash map pointing from fid to offset in changelog file
-  // ---------------------------------------------------------------------------
-  google::sparse_hash_map<eos::common::FileSystem::fsid_t, google::dense_hash_map<unsigned long long, struct Fmd > > FmdHelperMap;
-
   // ---------------------------------------------------------------------------
   //! Constructor
   // ---------------------------------------------------------------------------
@@ -232,6 +277,12 @@ public:
   FmdDbMapHandler ()
   {
     SetLogId("CommonFmdDbMapHandler");
+    commitLatencyMs = getenv("EOS_FST_FMD_COMMIT_LATENCY_MS") ?
+      strtoul(getenv("EOS_FST_FMD_COMMIT_LATENCY_MS"), 0, 10) : 20;
+    commitBatchSize = getenv("EOS_FST_FMD_COMMIT_BATCH") ?
+      strtoul(getenv("EOS_FST_FMD_COMMIT_BATCH"), 0, 10) : 4096;
+    cacheSize = getenv("EOS_FST_FMD_CACHE_SIZE") ?
+      strtoul(getenv("EOS_FST_FMD_CACHE_SIZE"), 0, 10) : 4096;
 #ifndef EOS_SQLITE_DBMAP
     lvdboption.CacheSizeMb=0;
     lvdboption.BloomFilterNbits=0;
@@ -255,16 +306,19 @@ public:
   Shutdown ()
   {
     // detach all opened db's
-    std::map<eos::common::FileSystem::fsid_t, eos::common::DbMap*>::const_iterator it;
-    for (it = dbmap.begin(); it != dbmap.end(); it++)
+    std::vector<eos::common::FileSystem::fsid_t> fsids;
     {
-      ShutdownDB(it->first);
+      eos::common::RWMutexReadLock lock(Mutex);
+      std::map<eos::common::FileSystem::fsid_t, FmdDbShard*>::const_iterator it;
+      for (it = shards.begin(); it != shards.end(); it++)
+      {
+        fsids.push_back(it->first);
+      }
     }
 
+    for (size_t i = 0; i < fsids.size(); i++)
     {
-      // remove all
-      eos::common::RWMutexWriteLock lock(Mutex);
-      dbmap.clear();
+      ShutdownDB(fsids[i]);
     }
   }
 
@@ -294,7 +348,10 @@ public:
   google::sparse_hash_map<eos::common::FileSystem::fsid_t, eos::common::DbMap* > FmdMap;
 
 private:
-  std::map<eos::common::FileSystem::fsid_t, eos::common::DbMap*> dbmap;
+  std::map<eos::common::FileSystem::fsid_t, FmdDbShard*> shards;
+  unsigned int commitLatencyMs; //< latency budget of the group commit
+  size_t commitBatchSize; //< number of records triggering an early commit
+  size_t cacheSize; //< number of records cached per filesystem
 #ifndef EOS_SQLITE_DBMAP
   eos::common::LvDbDbMapInterface::Option lvdboption;
 #endif
@@ -0,0 +1,303 @@
+//------------------------------------------------------------------------------
+//! @file IoScheduler.cc
+//! @author agent <agent@local>
+//! @brief Weighted fair sharing of the disk IO of a filesystem between
+//!        user access, transfers and verification
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/IoScheduler.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysAtomics.hh"
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+#include <sys/time.h>
+#include <deque>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+static double
+NowMs ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+//------------------------------------------------------------------------------
+//! State of a filesystem - mSlots and the mOps/mBytes counters are accessed
+//! atomically by the IOs of filesystems without slots, the rest needs mMutex
+//------------------------------------------------------------------------------
+struct IoScheduler::Queue
+{
+  Queue ();
+
+  XrdSysMutex mMutex;
+  unsigned mSlots; ///< configured slots, 0 = unlimited
+  bool mEnforce; ///< disk loaded, limit to mSlots
+  unsigned mWeight[kNClasses]; ///< weight per class
+  unsigned mInFlight; ///< granted and not released IOs
+  double mVirtualTime; ///< start time of the last granted IO
+  double mFinish[kNClasses]; ///< virtual finish time of the last IO per class
+  std::deque<Waiter*> mWaiting[kNClasses]; ///< queued IOs per class
+  Stats mStats[kNClasses]; ///< counters since the last sample
+};
+
+//------------------------------------------------------------------------------
+// Constructor of the filesystem state
+//------------------------------------------------------------------------------
+IoScheduler::Queue::Queue () :
+  mSlots(0),
+  mEnforce(false),
+  mInFlight(0),
+  mVirtualTime(0)
+{
+  for (int i = 0; i < kNClasses; i++)
+  {
+    mWeight[i] = 1;
+    mFinish[i] = 0;
+  }
+
+  memset(mStats, 0, sizeof(mStats));
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+IoScheduler::IoScheduler () { }
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+IoScheduler::~IoScheduler ()
+{
+  for (auto it = mQueues.begin(); it != mQueues.end(); ++it)
+    delete it->second;
+}
+
+//------------------------------------------------------------------------------
+// Get the name of a class
+//------------------------------------------------------------------------------
+const char*
+IoScheduler::GetClassName (int ioclass)
+{
+  switch (ioclass)
+  {
+  case kInteractive:
+    return "user";
+  case kTransfer:
+    return "transfer";
+  case kVerify:
+    return "verify";
+  }
+
+  return "unknown";
+}
+
+//------------------------------------------------------------------------------
+// Get the state of a filesystem
+//------------------------------------------------------------------------------
+IoScheduler::Queue*
+IoScheduler::GetQueue (unsigned long fsid)
+{
+  XrdSysMutexHelper lock(mMutex);
+  Queue*& queue = mQueues[fsid];
+
+  if (!queue)
+    queue = new Queue();
+
+  return queue;
+}
+
+//------------------------------------------------------------------------------
+// Update the configuration and the disk load of a filesystem
+//------------------------------------------------------------------------------
+void
+IoScheduler::Configure (unsigned long fsid, unsigned slots,
+                        const unsigned* weights, double load, double maxload)
+{
+  Queue* queue = GetQueue(fsid);
+  XrdSysMutexHelper lock(queue->mMutex);
+  queue->mSlots = slots;
+  queue->mEnforce = slots && (load >= maxload);
+
+  for (int i = 0; i < kNClasses; i++)
+    queue->mWeight[i] = weights[i] ? weights[i] : 1;
+
+  // the limit may have been lifted
+  Dispatch(queue);
+}
+
+//------------------------------------------------------------------------------
+// Wait for a slot on a filesystem
+//------------------------------------------------------------------------------
+bool
+IoScheduler::Acquire (Queue* queue, int ioclass, size_t bytes)
+{
+  if ((ioclass < 0) || (ioclass >= kNClasses))
+    ioclass = kInteractive;
+
+  AtomicInc(queue->mStats[ioclass].mOps);
+  AtomicAdd(queue->mStats[ioclass].mBytes, bytes);
+
+  // without slots there is nothing to schedule, the IOs which are still
+  // queued from before are granted by Configure
+  if (!AtomicGet(queue->mSlots))
+    return false;
+
+  Waiter waiter;
+  queue->mMutex.Lock();
+  double start = queue->mVirtualTime;
+
+  // a class which was idle starts at the current virtual time and does not
+  // get credit for the time it didn't use the disk
+  if (queue->mFinish[ioclass] > start)
+    start = queue->mFinish[ioclass];
+
+  queue->mFinish[ioclass] = start + (1.0 * bytes + kSeekCost) /
+    queue->mWeight[ioclass];
+  bool waiting = false;
+
+  for (int i = 0; i < kNClasses; i++)
+    waiting |= !queue->mWaiting[i].empty();
+
+  if (!waiting && (!queue->mEnforce || (queue->mInFlight < queue->mSlots)))
+  {
+    queue->mInFlight++;
+
+    if (start > queue->mVirtualTime)
+      queue->mVirtualTime = start;
+
+    queue->mMutex.UnLock();
+    return true;
+  }
+
+  waiter.mStart = start;
+  waiter.mArrival = NowMs();
+  queue->mWaiting[ioclass].push_back(&waiter);
+  queue->mMutex.UnLock();
+  waiter.mCond.Lock();
+
+  while (!waiter.mGranted)
+    waiter.mCond.Wait();
+
+  waiter.mCond.UnLock();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Give back a slot of a filesystem
+//------------------------------------------------------------------------------
+void
+IoScheduler::Release (Queue* queue)
+{
+  XrdSysMutexHelper lock(queue->mMutex);
+
+  if (queue->mInFlight)
+    queue->mInFlight--;
+
+  Dispatch(queue);
+}
+
+//------------------------------------------------------------------------------
+// Grant the free slots to the waiting IOs in the order of their start time
+//------------------------------------------------------------------------------
+void
+IoScheduler::Dispatch (Queue* queue)
+{
+  double now = 0;
+
+  while (!queue->mEnforce || (queue->mInFlight < queue->mSlots))
+  {
+    int next = -1;
+
+    for (int i = 0; i < kNClasses; i++)
+    {
+      if (!queue->mWaiting[i].empty() && ((next < 0) ||
+          (queue->mWaiting[i].front()->mStart <
+           queue->mWaiting[next].front()->mStart)))
+        next = i;
+    }
+
+    if (next < 0)
+      break;
+
+    Waiter* waiter = queue->mWaiting[next].front();
+    queue->mWaiting[next].pop_front();
+    queue->mInFlight++;
+
+    if (waiter->mStart > queue->mVirtualTime)
+      queue->mVirtualTime = waiter->mStart;
+
+    if (!now)
+      now = NowMs();
+
+    Stats& stats = queue->mStats[next];
+    double wait = now - waiter->mArrival;
+    stats.mWaited++;
+    stats.mWaitMs += wait;
+
+    if (wait > stats.mMaxWaitMs)
+      stats.mMaxWaitMs = wait;
+
+    // the waiter must not be touched once its condition is unlocked
+    waiter->mCond.Lock();
+    waiter->mGranted = true;
+    waiter->mCond.Signal();
+    waiter->mCond.UnLock();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get the counters of every class since the previous call and reset them
+//------------------------------------------------------------------------------
+bool
+IoScheduler::Sample (unsigned long fsid, Stats* stats)
+{
+  Queue* queue = 0;
+  {
+    XrdSysMutexHelper lock(mMutex);
+    std::map<unsigned long, Queue*>::iterator it = mQueues.find(fsid);
+
+    if (it == mQueues.end())
+      return false;
+
+    queue = it->second;
+  }
+  XrdSysMutexHelper lock(queue->mMutex);
+
+  for (int i = 0; i < kNClasses; i++)
+  {
+    Stats& current = queue->mStats[i];
+    stats[i] = current;
+    stats[i].mOps = AtomicFAZ(current.mOps);
+    stats[i].mBytes = AtomicFAZ(current.mBytes);
+    stats[i].mQueued = queue->mWaiting[i].size();
+    current.mWaited = 0;
+    current.mWaitMs = 0;
+    current.mMaxWaitMs = 0;
+  }
+
+  return true;
+}
+
+EOSFSTNAMESPACE_END
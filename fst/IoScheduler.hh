@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+//! @file IoScheduler.hh
+//! @author agent <agent@local>
+//! @brief Weighted fair sharing of the disk IO of a filesystem between
+//!        user access, transfers and verification
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_IOSCHEDULER_HH__
+#define __EOSFST_IOSCHEDULER_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <map>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class IoScheduler
+//! Admission of the disk IO of every filesystem. Each read or write takes a
+//! slot of its filesystem for the time of the system call. Without configured
+//! slots an IO is only counted, without taking any lock. As long as the disk
+//! load measured by fst::Load stays below the configured threshold, every IO
+//! gets a slot immediately. On a loaded disk at most 'slots' IOs run in
+//! parallel and the waiting ones are granted in start-time fair queuing
+//! order: every IO costs its size plus a fixed seek cost divided by the weight
+//! of its class, so that the classes share both the IOPS and the bandwidth of
+//! the disk in the ratio of their weights while an idle class leaves its share
+//! to the others.
+//------------------------------------------------------------------------------
+class IoScheduler
+{
+public:
+
+  //----------------------------------------------------------------------------
+  //! IO classes
+  //----------------------------------------------------------------------------
+  enum eClass
+  {
+    kInteractive = 0, ///< user reads and writes
+    kTransfer = 1, ///< drain, balance and third party copies
+    kVerify = 2, ///< scanner and scrubber
+    kNClasses = 3
+  };
+
+  //----------------------------------------------------------------------------
+  //! Counters of one class since the previous sample
+  //----------------------------------------------------------------------------
+  struct Stats
+  {
+    unsigned long long mOps; ///< IOs granted
+    unsigned long long mBytes; ///< bytes of the granted IOs
+    unsigned long long mWaited; ///< IOs which had to queue for a slot
+    double mWaitMs; ///< sum of the queueing time in ms
+    double mMaxWaitMs; ///< longest queueing time in ms
+    unsigned long long mQueued; ///< IOs queued at the time of the sample
+  };
+
+  //----------------------------------------------------------------------------
+  //! State of a filesystem, it lives as long as the scheduler so that files
+  //! and scanners can keep the pointer returned by GetQueue
+  //----------------------------------------------------------------------------
+  struct Queue;
+
+  //----------------------------------------------------------------------------
+  //! Scoped slot, a null queue does not take any slot
+  //----------------------------------------------------------------------------
+  class Slot
+  {
+  public:
+
+    Slot (IoScheduler& scheduler, Queue* queue, int ioclass, size_t bytes) :
+      mScheduler(scheduler),
+      mQueue(queue)
+    {
+      mScheduled = mQueue && mScheduler.Acquire(mQueue, ioclass, bytes);
+    }
+
+    ~Slot ()
+    {
+      if (mScheduled)
+        mScheduler.Release(mQueue);
+    }
+
+  private:
+    IoScheduler& mScheduler;
+    Queue* mQueue;
+    bool mScheduled; ///< a slot was taken and has to be given back
+  };
+
+  static const unsigned kSeekCost = 128 * 1024; ///< cost of an IO in bytes besides its size
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  IoScheduler ();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~IoScheduler ();
+
+  //----------------------------------------------------------------------------
+  //! Get the name of a class as used in the config and the stat keys
+  //----------------------------------------------------------------------------
+  static const char* GetClassName (int ioclass);
+
+  //----------------------------------------------------------------------------
+  //! Update the configuration and the disk load of a filesystem
+  //!
+  //! @param fsid filesystem id
+  //! @param slots parallel IOs on a loaded disk, 0 disables the scheduling
+  //! @param weights weight of every class, 0 is taken as 1
+  //! @param load disk load between 0 and 1 (fraction of the time busy)
+  //! @param maxload load above which the slots are enforced
+  //----------------------------------------------------------------------------
+  void Configure (unsigned long fsid, unsigned slots, const unsigned* weights,
+                  double load, double maxload);
+
+  //----------------------------------------------------------------------------
+  //! Get the state of a filesystem, created on first use
+  //----------------------------------------------------------------------------
+  Queue* GetQueue (unsigned long fsid);
+
+  //----------------------------------------------------------------------------
+  //! Wait for a slot on a filesystem
+  //!
+  //! @param queue state of the filesystem
+  //! @param ioclass class of the IO
+  //! @param bytes size of the IO
+  //!
+  //! @return true if a slot was taken and has to be given back with Release,
+  //!         false if the filesystem has no slots configured
+  //----------------------------------------------------------------------------
+  bool Acquire (Queue* queue, int ioclass, size_t bytes);
+
+  //----------------------------------------------------------------------------
+  //! Give back a slot of a filesystem
+  //----------------------------------------------------------------------------
+  void Release (Queue* queue);
+
+  //----------------------------------------------------------------------------
+  //! Get the counters of every class since the previous call and reset them
+  //!
+  //! @param fsid filesystem id
+  //! @param stats array of kNClasses entries
+  //!
+  //! @return false if the filesystem is not known to the scheduler
+  //----------------------------------------------------------------------------
+  bool Sample (unsigned long fsid, Stats* stats);
+
+private:
+
+  //----------------------------------------------------------------------------
+  //! IO waiting for a slot
+  //----------------------------------------------------------------------------
+  struct Waiter
+  {
+    Waiter () : mCond(0), mGranted(false), mStart(0), mArrival(0) { }
+
+    XrdSysCondVar mCond; ///< signalled when the slot is granted
+    bool mGranted; ///< slot granted
+    double mStart; ///< virtual start time
+    double mArrival; ///< time of the Acquire call in ms
+  };
+
+  XrdSysMutex mMutex; ///< protects mQueues
+  std::map<unsigned long, Queue*> mQueues; ///< state per filesystem
+
+  //----------------------------------------------------------------------------
+  //! Grant the free slots to the waiting IOs - needs the queue mutex
+  //----------------------------------------------------------------------------
+  void Dispatch (Queue* queue);
+
+  //----------------------------------------------------------------------------
+  //! Disable copy constructor and assign operator
+  //----------------------------------------------------------------------------
+  IoScheduler (const IoScheduler&) = delete;
+  IoScheduler& operator = (const IoScheduler&) = delete;
+};
+
+EOSFSTNAMESPACE_END
+
+#endif // __EOSFST_IOSCHEDULER_HH__
@@ -161,10 +161,8 @@ Messaging::Process (XrdMqMessage* newmessage)
       if (capOpaque) delete capOpaque;
       if (newdeletion)
       {
-        gOFS.Storage->deletionsMutex.Lock();
-        gOFS.Storage->deletions.push_back(*newdeletion);
+        gOFS.Storage->AddDeletion(*newdeletion);
         delete newdeletion;
-        gOFS.Storage->deletionsMutex.UnLock();
       }
       else
       {
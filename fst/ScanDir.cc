@@ -657,11 +657,24 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
 
   int nread = 0;
   off_t offset = 0;
+#ifndef _NOOFS
+  // the scanner competes with user access as verification IO
+  IoScheduler::Queue* ioqueue = bgThread ?
+    gOFS.Storage->ioScheduler.GetQueue(fsId) : 0;
+#endif
 
   do
   {
     errno = 0;
+#ifndef _NOOFS
+    {
+      IoScheduler::Slot slot(gOFS.Storage->ioScheduler, ioqueue,
+                             IoScheduler::kVerify, bufferSize);
+      nread = read(fd, buffer, bufferSize);
+    }
+#else
     nread = read(fd, buffer, bufferSize);
+#endif
     if (nread < 0)
     {
       close(fd);
@@ -696,7 +709,7 @@ ScanDir::ScanFileLoadAware (const char* path, unsigned long long &scansize, floa
           sleeper.Wait(expecttime - scantime);
         }
         //adjust the rate according to the load information
-        load = fstLoad->GetDiskRate("sda", "millisIO") / 1000.0;
+        load = fstLoad->GetDiskRate(dirPath.c_str(), "millisIO") / 1000.0;
         if (load > 0.7)
         {
           //adjust currentRate
@@ -318,6 +318,18 @@ XrdFstOfs::Configure (XrdSysError& Eroute, XrdOucEnv* envP)
     // return NoGo;
   }
 
+  // Keep the recently verified capabilities to skip their decryption when
+  // the same capability is presented again (default 1024 entries)
+  {
+    size_t capcachesize = getenv("EOS_FST_CAPABILITY_CACHE_SIZE") ?
+      strtoul(getenv("EOS_FST_CAPABILITY_CACHE_SIZE"), 0, 10) : 1024;
+    char scapcachesize[32];
+    snprintf(scapcachesize, sizeof(scapcachesize), "%lu",
+             (unsigned long) capcachesize);
+    XrdCapability::SetCacheSize(capcachesize);
+    Eroute.Say("=====> fstofs.capability-cache-size: ", scapcachesize);
+  }
+
   TransferScheduler = new XrdScheduler(&Eroute, &OfsTrace, 8, 128, 60);
   TransferScheduler->Start();
   eos::fst::Config::gConfig.autoBoot = false;
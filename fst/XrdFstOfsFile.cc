@@ -32,10 +32,14 @@
 #include "fst/checksum/ChecksumPlugins.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOss/XrdOssApi.hh"
+#include "XrdOfs/XrdOfsHandle.hh"
 #include "XrdOuc/XrdOucIOVec.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
 /*----------------------------------------------------------------------------*/
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 /*----------------------------------------------------------------------------*/
 
 extern XrdOssSys* XrdOfsOss;
@@ -74,6 +78,7 @@ mTpcThreadStatus(EINVAL)
   wTime.tv_usec = lwTime.tv_usec = cTime.tv_usec = 0;
   fileid = 0;
   fsid = 0;
+  ioQueue = 0;
   lid = 0;
   cid = 0;
   rCalls = wCalls = nFwdSeeks = nBwdSeeks = nXlFwdSeeks = nXlBwdSeeks = 0;
@@ -576,6 +581,7 @@ XrdFstOfsFile::open (const char* path,
   targetsize = 0;
   fileid = 0;
   fsid = 0;
+  ioQueue = 0;
   lid = 0;
   cid = 0;
   const char* secinfo = 0;
@@ -661,9 +667,12 @@ XrdFstOfsFile::open (const char* path,
   eos::common::RWMutexReadLock lock(gOFS.Storage->fsMutex);
   fsid = atoi(sfsid ? sfsid : "0");
 
+  long long iodepth = 0;
+
   if (fsid && gOFS.Storage->fileSystemsMap.count(fsid))
   {
     localPrefix = gOFS.Storage->fileSystemsMap[fsid]->GetPath().c_str();
+    iodepth = gOFS.Storage->fileSystemsMap[fsid]->GetLongLong("iodepth");
   }
 
   //............................................................................
@@ -716,6 +725,7 @@ XrdFstOfsFile::open (const char* path,
   eos::common::FileId::FidPrefix2FullPath(hexfid, localPrefix.c_str(), fstPath);
   fileid = eos::common::FileId::Hex2Fid(hexfid);
   fsid = atoi(sfsid);
+  ioQueue = gOFS.Storage->ioScheduler.GetQueue(fsid);
   lid = (unsigned long)atoi(slid);
   cid = strtoull(scid, 0, 10);
 
@@ -1026,6 +1036,15 @@ XrdFstOfsFile::open (const char* path,
   oss_opaque += slid;
   oss_opaque += "&mgm.bookingsize=";
   oss_opaque += static_cast<int> (bookingsize);
+  // the oss keeps per filesystem read-ahead counters and io_uring queues
+  oss_opaque += "&mgm.fsid=";
+  oss_opaque += static_cast<int> (fsid);
+
+  if (iodepth > 0)
+  {
+    oss_opaque += "&fst.iodepth=";
+    oss_opaque += static_cast<int> (iodepth);
+  }
   
   //............................................................................
   // Open layout implementation
@@ -2391,8 +2410,14 @@ XrdFstOfsFile::readofs (XrdSfsFileOffset fileOffset,
 {
   gettimeofday(&cTime, &tz);
   rCalls++;
+  int rc = 0;
+
+  {
+    IoScheduler::Slot slot(gOFS.Storage->ioScheduler, ioQueue, GetIoClass(),
+                           buffer_size);
+    rc = XrdOfsFile::read(fileOffset, buffer, buffer_size);
+  }
 
-  int rc = XrdOfsFile::read(fileOffset, buffer, buffer_size);
   eos_debug("read %llu %llu %i rc=%d", this, fileOffset, buffer_size, rc);
 
   if (gOFS.Simulate_IO_read_error)
@@ -2455,6 +2480,74 @@ XrdFstOfsFile::read (XrdSfsFileOffset fileOffset,
 }
 
 
+//------------------------------------------------------------------------------
+// Open a descriptor on the local replica for zero-copy reads
+//------------------------------------------------------------------------------
+int
+XrdFstOfsFile::ZeroCopyFd (off_t offset, size_t length)
+{
+  unsigned long ltype = eos::common::LayoutId::GetLayoutType(lid);
+
+  // only plain files and local replicas without block checksums are stored
+  // 1:1 on the local disk
+  if (!opened || closed || isRW || hasBlockXs || (tpcFlag != kTpcNone) ||
+      gOFS.Simulate_IO_read_error ||
+      ((ltype != eos::common::LayoutId::kPlain) &&
+       (ltype != eos::common::LayoutId::kReplica)))
+  {
+    return -1;
+  }
+
+  if ((offset + (off_t) length) > openSize)
+    return -1;
+
+  // a complete read verifies the file checksum at the end, this needs the
+  // data to pass through the checksum object
+  if (checkSum && (offset == 0) && ((off_t) length == openSize))
+    return -1;
+
+  // use the descriptor of the file opened by the storage system
+  int ossfd = oh ? oh->Select().getFD() : -1;
+
+  if (ossfd < 0)
+    return -1;
+
+  gettimeofday(&cTime, &tz);
+  int fd = dup(ossfd);
+
+  if (fd < 0)
+  {
+    eos_warning("msg=\"cannot duplicate the descriptor of the local replica "
+                "for zero-copy read\" fstpath=%s errno=%d", fstPath.c_str(),
+                errno);
+    return -1;
+  }
+
+  struct stat buf;
+
+  if (fstat(fd, &buf) || (buf.st_size < (off_t) (offset + length)))
+  {
+    ::close(fd);
+    return -1;
+  }
+
+  posix_fadvise(fd, offset, length, POSIX_FADV_SEQUENTIAL);
+  rCalls++;
+
+  {
+    XrdSysMutexHelper vecLock(vecMutex);
+    rvec.push_back(length);
+    rOffset = offset + length;
+  }
+
+  gettimeofday(&lrTime, &tz);
+  AddReadTime();
+  eos_debug("fd=%d offset=%llu length=%llu", fd, (unsigned long long) offset,
+            (unsigned long long) length);
+  return fd;
+}
+
+
 //------------------------------------------------------------------------------
 // OFS layer read entry point
 //------------------------------------------------------------------------------
@@ -2543,7 +2636,18 @@ XrdFstOfsFile::readvofs(XrdOucIOVec* readV,
 {
   eos_debug("read count=%i", readCount);
   gettimeofday(&cTime, &tz);
-  XrdSfsXferSize sz = XrdOfsFile::readv(readV, readCount);
+  size_t total = 0;
+
+  for (uint32_t i = 0; i < readCount; ++i)
+    total += readV[i].size;
+
+  XrdSfsXferSize sz = 0;
+
+  {
+    IoScheduler::Slot slot(gOFS.Storage->ioScheduler, ioQueue, GetIoClass(), total);
+    sz = XrdOfsFile::readv(readV, readCount);
+  }
+
   gettimeofday(&lrvTime, &tz);
   AddReadVTime();
 
@@ -2650,8 +2754,13 @@ XrdFstOfsFile::writeofs (XrdSfsFileOffset fileOffset,
 
   gettimeofday(&cTime, &tz);
   wCalls++;
-  
-  int rc = XrdOfsFile::write(fileOffset, buffer, buffer_size);
+  int rc = 0;
+
+  {
+    IoScheduler::Slot slot(gOFS.Storage->ioScheduler, ioQueue, GetIoClass(),
+                           buffer_size);
+    rc = XrdOfsFile::write(fileOffset, buffer, buffer_size);
+  }
 
   if (rc != buffer_size)
   {
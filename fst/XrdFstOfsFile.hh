@@ -41,6 +41,7 @@
 #include "fst/Namespace.hh"
 #include "fst/checksum/CheckSum.hh"
 #include "fst/FmdDbMap.hh"
+#include "fst/IoScheduler.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOfs/XrdOfs.hh"
 #include "XrdOfs/XrdOfsTrace.hh"
@@ -344,6 +345,20 @@ public:
     return fMd->fMd.checksum();
   }
 
+  //--------------------------------------------------------------------------
+  //! Get a descriptor of the local replica to serve a byte range without
+  //! going through the layout (e.g. with sendfile). The range is accounted
+  //! as one read. A complete read of a file with a checksum is refused since
+  //! it has to go through the read-time checksum verification.
+  //!
+  //! @param offset start of the range
+  //! @param length length of the range
+  //!
+  //! @return file descriptor to be closed by the caller or -1 if the file
+  //!         has to be read through the layout
+  //--------------------------------------------------------------------------
+  int ZeroCopyFd (off_t offset, size_t length);
+
   //--------------------------------------------------------------------------
   //! Check for chunked upload flag
   //--------------------------------------------------------------------------
@@ -376,6 +391,7 @@ protected:
   bool hasBlockXs; //! mark if file has blockxs assigned
   unsigned long long fileid; //! file id
   unsigned long fsid; //! file system id
+  IoScheduler::Queue* ioQueue; //! IO scheduler state of the file system
   unsigned long lid; //! layout id
   unsigned long long cid; //! container id
   unsigned long long mForcedMtime;
@@ -437,6 +453,18 @@ protected:
   off_t openSize; //! file size when the file was opened
   off_t closeSize; //! file size when the file was closed
 
+  //--------------------------------------------------------------------------
+  //! Class of the file IO for the filesystem IO scheduler - replications
+  //! (drain, balance) and third party copies are transfers, everything else
+  //! is user access
+  //--------------------------------------------------------------------------
+  int
+  GetIoClass () const
+  {
+    return (isReplication || (tpcFlag != kTpcNone)) ?
+      IoScheduler::kTransfer : IoScheduler::kInteractive;
+  }
+
  private:
   //----------------------------------------------------------------------------
   // File statistics for monitoring purposes
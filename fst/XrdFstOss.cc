@@ -23,6 +23,7 @@
 
 /*----------------------------------------------------------------------------*/
 #include <fcntl.h>
+#include <string.h>
 #include <strings.h>
 #include <utime.h>
 #include <sys/time.h>
@@ -33,6 +34,7 @@
 #include "XrdVersion.hh"
 #include "XrdOuc/XrdOucUtils.hh"
 #include "XrdOuc/XrdOuca2x.hh"
+#include "XrdSys/XrdSysAtomics.hh"
 #include "XrdSys/XrdSysPlatform.hh"
 /*----------------------------------------------------------------------------*/
 #include "fst/XrdFstOss.hh"
@@ -74,6 +76,9 @@ XrdFstOss::XrdFstOss () :
 eos::common::LogId (),
 mFdFence (-1),
 mFdLimit (-1),
+mReadVGap (16384),
+mReadVGapBuffer (0),
+mReadAheadMax (8 * 1024 * 1024),
 mPrBytes(0),
 mPrActive(0),
 mPrDepth(0),
@@ -84,6 +89,24 @@ mPrQSize(0)
   mPrPSize = static_cast<int>(mPrPBits);
   mPrPBits--;
   mPrPMask = ~mPrPBits;
+
+  if (getenv("EOS_FST_READV_GAP"))
+    mReadVGap = strtoll(getenv("EOS_FST_READV_GAP"), 0, 10);
+
+  if (mReadVGap < 0)
+    mReadVGap = 0;
+
+  if (mReadVGap > 1048576)
+    mReadVGap = 1048576;
+
+  // the gap data is thrown away, concurrent reads can share the buffer
+  mReadVGapBuffer = new char[mReadVGap ? mReadVGap : 1];
+
+  if (getenv("EOS_FST_READAHEAD_MAX"))
+    mReadAheadMax = strtoll(getenv("EOS_FST_READAHEAD_MAX"), 0, 10);
+
+  if (mReadAheadMax < 0)
+    mReadAheadMax = 0;
 }
 
 
@@ -92,7 +115,16 @@ mPrQSize(0)
 //------------------------------------------------------------------------------
 XrdFstOss::~XrdFstOss()
 {
-  // empty 
+  delete[] mReadVGapBuffer;
+
+  for (auto it = mIoRings.begin(); it != mIoRings.end(); ++it)
+    delete it->second.second;
+
+  for (auto it = mRetiredIoRings.begin(); it != mRetiredIoRings.end(); ++it)
+    delete *it;
+
+  for (auto it = mReadAheadStats.begin(); it != mReadAheadStats.end(); ++it)
+    delete it->second;
 }
 
 
@@ -179,6 +211,7 @@ XrdFstOss::Configure(const char* configfn, XrdSysError& Eroute)
 
   eos_info("preread depth=%i, queue_size=%i and bytes=%i",
            mPrDepth, mPrQSize, mPrBytes);
+  eos_info("readv gap=%lli readahead max=%lli", mReadVGap, mReadAheadMax);
   
   Config.Close();
   return NoGo;
@@ -731,5 +764,80 @@ XrdFstOss::DropXs (const std::string& fileName, bool force)
   eos_debug("Oss map size after drop: %i.", mMapFileXs.size());
 }
 
+
+//------------------------------------------------------------------------------
+// Get the io_uring queue of a filesystem
+//------------------------------------------------------------------------------
+IoRing*
+XrdFstOss::GetIoRing (unsigned long fsid, unsigned depth)
+{
+  XrdSysMutexHelper lock(mIoRingMutex);
+  std::map< unsigned long, std::pair<unsigned, IoRing*> >::iterator it =
+    mIoRings.find(fsid);
+
+  if (it != mIoRings.end())
+  {
+    // a failed setup is remembered as well, it is not retried for each open
+    if (it->second.first == depth)
+      return it->second.second;
+
+    // the depth changed, files opened before keep using the old queue
+    if (it->second.second)
+      mRetiredIoRings.push_back(it->second.second);
+  }
+
+  IoRing* ring = IoRing::Create(depth);
+
+  if (ring)
+    eos_info("msg=\"using io_uring\" fsid=%lu depth=%u", fsid, depth);
+  else
+    eos_warning("msg=\"io_uring not available, using synchronous IO\" "
+                "fsid=%lu depth=%u", fsid, depth);
+
+  mIoRings[fsid] = std::make_pair(depth, ring);
+  return ring;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the read-ahead counters of a filesystem
+//------------------------------------------------------------------------------
+ReadAheadStats*
+XrdFstOss::GetReadAheadCounters (unsigned long fsid)
+{
+  XrdSysMutexHelper lock(mReadAheadMutex);
+  ReadAheadStats*& stats = mReadAheadStats[fsid];
+
+  if (!stats)
+  {
+    stats = new ReadAheadStats();
+    memset(stats, 0, sizeof(ReadAheadStats));
+  }
+
+  return stats;
+}
+
+
+//------------------------------------------------------------------------------
+// Get a snapshot of the read-ahead counters of a filesystem
+//------------------------------------------------------------------------------
+bool
+XrdFstOss::GetReadAheadStats (unsigned long fsid, ReadAheadStats& stats)
+{
+  XrdSysMutexHelper lock(mReadAheadMutex);
+  std::map<unsigned long, ReadAheadStats*>::iterator it =
+    mReadAheadStats.find(fsid);
+
+  if (it == mReadAheadStats.end())
+    return false;
+
+  stats.mReads = AtomicGet(it->second->mReads);
+  stats.mHits = AtomicGet(it->second->mHits);
+  stats.mBytes = AtomicGet(it->second->mBytes);
+  stats.mSequential = AtomicGet(it->second->mSequential);
+  stats.mRandom = AtomicGet(it->second->mRandom);
+  return true;
+}
+
 EOSFSTNAMESPACE_END
 
@@ -28,10 +28,12 @@
 /*----------------------------------------------------------------------------*/
 #include <map>
 #include <string>
+#include <vector>
 /*----------------------------------------------------------------------------*/
 #include "fst/Namespace.hh"
 #include "fst/checksum/CheckSum.hh"
 #include "fst/XrdFstOssFile.hh"
+#include "fst/io/IoRing.hh"
 #include "common/Logging.hh"
 #include "common/Namespace.hh"
 /*----------------------------------------------------------------------------*/
@@ -45,6 +47,18 @@ EOSFSTNAMESPACE_BEGIN
 //! Forward declaration
 class XrdFstOssFile;
 
+//------------------------------------------------------------------------------
+//! Read-ahead counters of a filesystem, updated atomically by the files
+//------------------------------------------------------------------------------
+struct ReadAheadStats
+{
+  unsigned long long mReads; ///< reads of read-only files
+  unsigned long long mHits; ///< reads inside a window hinted before
+  unsigned long long mBytes; ///< bytes hinted with FADV_WILLNEED
+  unsigned long long mSequential; ///< files switched to sequential mode
+  unsigned long long mRandom; ///< files switched to random mode
+};
+
 //------------------------------------------------------------------------------
 //! Class XrdFstOss
 //------------------------------------------------------------------------------
@@ -56,6 +70,9 @@ public:
 
   int mFdFence; ///< smalest file FD number allowed
   int mFdLimit; ///< largest file FD number allowed
+  long long mReadVGap; ///< largest gap between two readv chunks read at once
+  char* mReadVGapBuffer; ///< sink for the data of the gaps between chunks
+  long long mReadAheadMax; ///< largest FADV_WILLNEED window, 0 disables it
 
   //--------------------------------------------------------------------------
   //! Constuctor
@@ -279,12 +296,61 @@ public:
   void DropXs (const std::string& fileName, bool force = false);
 
 
+  //--------------------------------------------------------------------------
+  //! Get the io_uring queue of a filesystem, the queue is created with the
+  //! first file opened with a given depth and shared by all the files of
+  //! the filesystem
+  //!
+  //! @param fsid filesystem id
+  //! @param depth queue depth
+  //!
+  //! @return queue or 0 if the filesystem has to use synchronous IO
+  //!
+  //--------------------------------------------------------------------------
+  IoRing* GetIoRing (unsigned long fsid, unsigned depth);
+
+
+  //--------------------------------------------------------------------------
+  //! Get the read-ahead counters of a filesystem, created on first use
+  //!
+  //! @param fsid filesystem id
+  //!
+  //! @return counters, valid until the oss is destroyed
+  //!
+  //--------------------------------------------------------------------------
+  ReadAheadStats* GetReadAheadCounters (unsigned long fsid);
+
+
+  //--------------------------------------------------------------------------
+  //! Get a snapshot of the read-ahead counters of a filesystem. This is
+  //! virtual so that the FST, which only knows the oss through XrdOfsOss,
+  //! can call it without linking the oss library.
+  //!
+  //! @param fsid filesystem id
+  //! @param stats counters
+  //!
+  //! @return true if the filesystem had read-only files opened
+  //!
+  //--------------------------------------------------------------------------
+  virtual bool GetReadAheadStats (unsigned long fsid, ReadAheadStats& stats);
+
+
 private:
 
   XrdSysRWLock mRWMap; ///< rw lock for the file <-> xs map
   //! map between file names and block xs objects
   std::map< std::string, std::pair<XrdSysRWLock*, CheckSum*> > mMapFileXs;
 
+  XrdSysMutex mIoRingMutex; ///< mutex for the io_uring queues
+  //! map between filesystem ids and their queue depth and io_uring queue
+  std::map< unsigned long, std::pair<unsigned, IoRing*> > mIoRings;
+  //! queues replaced after a depth change, files may still be using them
+  std::vector<IoRing*> mRetiredIoRings;
+
+  XrdSysMutex mReadAheadMutex; ///< mutex for the read-ahead counters map
+  //! map between filesystem ids and their read-ahead counters
+  std::map<unsigned long, ReadAheadStats*> mReadAheadStats;
+
   // Parameters for pre-reading (i.e. for fadvise)
   long long mPrPBits; ///< page lo order bit mask
   long long mPrPMask; ///< page hi order bit mask
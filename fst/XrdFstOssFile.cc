@@ -23,12 +23,17 @@
 
 /*----------------------------------------------------------------------------*/
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <algorithm>
 /*----------------------------------------------------------------------------*/
 #include "fst/XrdFstOss.hh"
 #include "fst/XrdFstOssFile.hh"
 #include "fst/checksum/ChecksumPlugins.hh"
 /*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysAtomics.hh"
+/*----------------------------------------------------------------------------*/
 
 EOSFSTNAMESPACE_BEGIN
 
@@ -47,7 +52,17 @@ XrdOssDF(),
 eos::common::LogId (),
 mIsRW (false),
 mRWLockXs (0),
-mBlockXs (0)
+mBlockXs (0),
+mIoRing (0),
+mReadAheadStats (0),
+mFileSize (0),
+mReadEnd (0),
+mSeqReads (0),
+mRandomReads (0),
+mAdvice (POSIX_FADV_NORMAL),
+mPrefetchStart (0),
+mPrefetchEnd (0),
+mPrefetchWindow (0)
 {
   mPieceStart = new char[eos::common::LayoutId::OssXsBlockSize];
   mPieceEnd = new char[eos::common::LayoutId::OssXsBlockSize];
@@ -98,6 +113,15 @@ XrdFstOssFile::Open (const char* path, int flags, mode_t mode, XrdOucEnv& env)
     }
   }
 
+  // Filesystems configured with an io depth queue the vector requests on
+  // their io_uring
+  if ((val = env.Get("fst.iodepth")) && (atoi(val) > 0) &&
+      env.Get("mgm.fsid"))
+  {
+    mIoRing = XrdFstSS->GetIoRing(strtoul(env.Get("mgm.fsid"), 0, 10),
+                                  atoi(val));
+  }
+
   // Decide if file opened for rw operations
   if ((flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC)) != 0)
     mIsRW = true;
@@ -163,6 +187,17 @@ XrdFstOssFile::Open (const char* path, int flags, mode_t mode, XrdOucEnv& env)
     }
 
     fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // Read-only files get their access pattern tracked
+    struct stat buf;
+
+    if (!mIsRW && XrdFstSS->mReadAheadMax && env.Get("mgm.fsid") &&
+        !fstat(fd, &buf))
+    {
+      mFileSize = buf.st_size;
+      mReadAheadStats = XrdFstSS->GetReadAheadCounters(
+                          strtoul(env.Get("mgm.fsid"), 0, 10));
+    }
   }
 
   eos_info("fd=%d flags=%x", fd, flags);
@@ -180,13 +215,14 @@ XrdFstOssFile::Read (void* buffer, off_t offset, size_t length)
   ssize_t nread;
   off_t off_copy;
   size_t len_copy;
-  char* ptr_piece;
-  char* ptr_buff;
   std::vector<XrdOucIOVec> pieces;
   eos_debug("off=%ji len=%ji", offset, length);
 
   if (fd < 0)
     return static_cast<ssize_t> (-EBADF);
+
+  if (mReadAheadStats)
+    TrackAccess(offset, length);
   
   if (!mBlockXs)
   {
@@ -200,58 +236,81 @@ XrdFstOssFile::Read (void* buffer, off_t offset, size_t length)
     // pieces in the beginning and/or at the end of the requested piece
     pieces = AlignBuffer(buffer, offset, length);
   }
-  
-  // Loop through all the pieces and read them in
-  for (auto piece = pieces.begin(); piece != pieces.end(); ++piece)
+
+  if (pieces.empty())
+    return 0;
+
+  // The pieces are contiguous in the file, read them with a single call
+  struct iovec iov[3];
+
+  for (size_t i = 0; i < pieces.size(); i++)
   {
-    do
-    {
-      nread = pread(fd, piece->data, piece->size, piece->offset);
-    }
-    while ((nread < 0) && (errno == EINTR));
-    
-    if (mBlockXs)
+    iov[i].iov_base = pieces[i].data;
+    iov[i].iov_len = pieces[i].size;
+  }
+
+  do
+  {
+    if (pieces.size() == 1)
+      nread = pread(fd, pieces[0].data, pieces[0].size, pieces[0].offset);
+    else
+      nread = preadv(fd, iov, pieces.size(), pieces[0].offset);
+  }
+  while ((nread < 0) && (errno == EINTR));
+
+  if (nread < 0)
+  {
+    eos_err("error=failed read offset=%zu, length=%zu", pieces[0].offset,
+            length);
+    return -EIO;
+  }
+
+  if (mBlockXs)
+  {
+    XrdSysRWLockHelper wr_lock(mRWLockXs, 0);
+    ssize_t left = nread;
+
+    for (auto piece = pieces.begin(); piece != pieces.end(); ++piece)
     {
-      XrdSysRWLockHelper wr_lock(mRWLockXs, 0);
-      
-      if ((nread > 0) &&
-          (!mBlockXs->CheckBlockSum(piece->offset, piece->data, nread)))
+      ssize_t piece_read = std::min(left, (ssize_t)piece->size);
+      left -= piece_read;
+
+      if ((piece_read > 0) &&
+          (!mBlockXs->CheckBlockSum(piece->offset, piece->data, piece_read)))
       {
         eos_err("error=read block-xs error offset=%zu, length=%zu",
                 piece->offset, piece->size);
         return -EIO;
       }
     }
+  }
 
-    if (nread >= 0)
+  // Copy back the requested part of the edge pieces
+  ssize_t left = nread;
+
+  for (auto piece = pieces.begin(); piece != pieces.end(); ++piece)
+  {
+    ssize_t piece_read = std::min(left, (ssize_t)piece->size);
+    left -= piece_read;
+
+    if (piece->data == mPieceStart)
     {
-      if (piece->offset < offset)
-      {
-        // Copy back begin edge 
-        ptr_buff = (char*)buffer;
-        off_copy = offset - piece->offset;
-        len_copy = std::min((size_t)(nread - off_copy), length);
-        ptr_piece = piece->data + off_copy;
-        ptr_buff = (char*)memcpy((void*)ptr_buff, ptr_piece, len_copy);
-        retval += len_copy;
-      }
-      else if ((piece->offset >= offset) &&
-	       (piece->offset + nread >= (ssize_t)(offset + length)))
-      {
-        // Copy back end edge
-        len_copy = std::min((ssize_t)(offset + length - piece->offset), nread);
-        ptr_buff = (char*)buffer + (piece->offset - offset);
-        ptr_buff = (char*)memcpy((void*)ptr_buff, piece->data, len_copy);
-        retval += len_copy;
-      }
-      else
-        retval += nread;
+      // Copy back begin edge
+      off_copy = offset - piece->offset;
+      len_copy = (piece_read > off_copy) ?
+                 std::min((size_t)(piece_read - off_copy), length) : 0;
+      memcpy(buffer, mPieceStart + off_copy, len_copy);
+      retval += len_copy;
     }
-    else
+    else if (piece->data == mPieceEnd)
     {
-      eos_err("error=failed read offset=%zu, length=%zu", piece->offset, piece->size);
-      return -EIO;
+      // Copy back end edge
+      len_copy = std::min((ssize_t)(offset + length - piece->offset), piece_read);
+      memcpy((char*)buffer + (piece->offset - offset), mPieceEnd, len_copy);
+      retval += len_copy;
     }
+    else
+      retval += piece_read;
   }
 
   if (retval > (ssize_t)length)
@@ -260,7 +319,7 @@ XrdFstOssFile::Read (void* buffer, off_t offset, size_t length)
     return -EIO;
   }
 
-  return ( retval >= 0 ? retval : static_cast<ssize_t> (-errno));
+  return retval;
 }
 
 
@@ -336,6 +395,10 @@ XrdFstOssFile::ReadV(XrdOucIOVec *readV, int n)
   ssize_t rdsz;
   ssize_t totBytes = 0;
 
+  // The block checksums are verified piece by piece in Read
+  if (!mBlockXs && (n > 1))
+    return ReadVCoalesced(readV, n);
+
 // For platforms that support fadvise, pre-advise what we will be reading
 #if defined(__linux__) && defined(HAVE_ATOMICS)
   long long begOff, endOff, begLst = -1, endLst = -1;
@@ -409,6 +472,228 @@ XrdFstOssFile::ReadV(XrdOucIOVec *readV, int n)
 }
 
 
+//------------------------------------------------------------------------------
+// Track the access pattern of a read-only file
+//------------------------------------------------------------------------------
+void
+XrdFstOssFile::TrackAccess (off_t offset, size_t length)
+{
+  static const int sSequentialReads = 3; ///< reads to detect a stream
+  static const int sRandomReads = 4; ///< reads to detect random access
+  static const size_t sMinWindow = 1024 * 1024; ///< first prefetch window
+  int advice = -1;
+  off_t willneed_offset = 0;
+  off_t willneed_length = 0;
+  off_t end = offset + length;
+
+  {
+    XrdSysMutexHelper lock(mAccessMutex);
+    AtomicInc(mReadAheadStats->mReads);
+
+    if ((offset >= mPrefetchStart) && (end <= mPrefetchEnd))
+      AtomicInc(mReadAheadStats->mHits);
+
+    if (offset == mReadEnd)
+    {
+      mSeqReads++;
+      mRandomReads = 0;
+    }
+    else
+    {
+      mRandomReads++;
+      mSeqReads = 0;
+    }
+
+    mReadEnd = end;
+
+    if (mSeqReads >= sSequentialReads)
+    {
+      if (mAdvice != POSIX_FADV_SEQUENTIAL)
+      {
+        advice = mAdvice = POSIX_FADV_SEQUENTIAL;
+        AtomicInc(mReadAheadStats->mSequential);
+        mPrefetchWindow = std::min(std::max(sMinWindow, 4 * length),
+                                   (size_t) XrdFstSS->mReadAheadMax);
+        mPrefetchStart = mPrefetchEnd = end;
+      }
+
+      // the reader overtook the window, restart it at the current position
+      if (mPrefetchEnd < end)
+        mPrefetchStart = mPrefetchEnd = end;
+
+      // keep at least half a window hinted ahead of the reader
+      if ((mPrefetchEnd < mFileSize) &&
+          (mPrefetchEnd - end < (off_t) mPrefetchWindow / 2))
+      {
+        willneed_offset = mPrefetchEnd;
+        willneed_length = std::min((off_t) mPrefetchWindow,
+                                   mFileSize - mPrefetchEnd);
+        mPrefetchEnd += willneed_length;
+        AtomicAdd(mReadAheadStats->mBytes, willneed_length);
+        mPrefetchWindow = std::min(2 * mPrefetchWindow,
+                                   (size_t) XrdFstSS->mReadAheadMax);
+      }
+    }
+    else if ((mRandomReads >= sRandomReads) && (mAdvice != POSIX_FADV_RANDOM))
+    {
+      advice = mAdvice = POSIX_FADV_RANDOM;
+      AtomicInc(mReadAheadStats->mRandom);
+      mPrefetchStart = mPrefetchEnd = 0;
+    }
+  }
+
+  // the hints are given outside the lock, WILLNEED may block in the submission
+  if (advice >= 0)
+  {
+    posix_fadvise(fd, 0, 0, advice);
+    eos_debug("fd=%d advice=%s", fd,
+              (advice == POSIX_FADV_RANDOM) ? "random" : "sequential");
+  }
+
+  if (willneed_length)
+  {
+    posix_fadvise(fd, willneed_offset, willneed_length, POSIX_FADV_WILLNEED);
+    eos_debug("fadvise fd=%d off=%lli len=%lli", fd, (long long) willneed_offset,
+              (long long) willneed_length);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Order the chunks of a vector read by offset
+//------------------------------------------------------------------------------
+struct ReadVOffsetLess
+{
+  const XrdOucIOVec* mReadV;
+
+  ReadVOffsetLess (const XrdOucIOVec* readV) : mReadV(readV) { }
+
+  bool
+  operator() (int a, int b) const
+  {
+    return mReadV[a].offset < mReadV[b].offset;
+  }
+};
+
+
+//------------------------------------------------------------------------------
+// Vector read coalescing the nearby chunks
+//------------------------------------------------------------------------------
+ssize_t
+XrdFstOssFile::ReadVCoalesced (XrdOucIOVec* readV, int n)
+{
+  //! group of chunks read with one request
+  struct Group
+  {
+    off_t offset;
+    size_t first; ///< first entry in the iovec
+    int count; ///< number of entries in the iovec
+    ssize_t length;
+  };
+
+  ssize_t totBytes = 0;
+  long long end = -1;
+  std::vector<int> order(n);
+  std::vector<struct iovec> iov;
+  std::vector<Group> groups;
+
+  if (fd < 0)
+    return static_cast<ssize_t> (-EBADF);
+
+  for (int i = 0; i < n; i++)
+    order[i] = i;
+
+  std::stable_sort(order.begin(), order.end(), ReadVOffsetLess(readV));
+  iov.reserve(2 * n);
+
+  for (int i = 0; i < n; i++)
+  {
+    XrdOucIOVec& chunk = readV[order[i]];
+
+    if (chunk.size <= 0)
+      continue;
+
+    long long gap = chunk.offset - end;
+
+    // overlapping chunks start a new group, the iovec can't go backwards
+    if (groups.size() && (gap >= 0) && (gap <= XrdFstSS->mReadVGap) &&
+        (groups.back().count + 2 <= IOV_MAX))
+    {
+      if (gap)
+      {
+        struct iovec sink = {XrdFstSS->mReadVGapBuffer, (size_t) gap};
+        iov.push_back(sink);
+        groups.back().count++;
+        groups.back().length += gap;
+      }
+    }
+    else
+    {
+      Group group = {chunk.offset, iov.size(), 0, 0};
+      groups.push_back(group);
+    }
+
+    struct iovec data = {chunk.data, (size_t) chunk.size};
+    iov.push_back(data);
+    groups.back().count++;
+    groups.back().length += chunk.size;
+    end = chunk.offset + chunk.size;
+    totBytes += chunk.size;
+  }
+
+  eos_debug("fd=%d chunks=%d groups=%zu", fd, n, groups.size());
+
+  // every group counts as a read of the access pattern, a vector read spread
+  // over the file turns the readahead off like scattered single reads do
+  if (mReadAheadStats)
+  {
+    for (size_t i = 0; i < groups.size(); i++)
+      TrackAccess(groups[i].offset, groups[i].length);
+  }
+
+  if (mIoRing)
+  {
+    std::vector<IoRing::Request> requests(groups.size());
+
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+      requests[i].fd = fd;
+      requests[i].vector = &iov[groups[i].first];
+      requests[i].count = groups[i].count;
+      requests[i].offset = groups[i].offset;
+    }
+
+    if (requests.size())
+      mIoRing->Run(&requests[0], requests.size());
+
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+      if (requests[i].result != groups[i].length)
+        return (requests[i].result < 0 ? requests[i].result : -ESPIPE);
+    }
+
+    return totBytes;
+  }
+
+  for (size_t i = 0; i < groups.size(); i++)
+  {
+    ssize_t nread;
+
+    do
+    {
+      nread = preadv(fd, &iov[groups[i].first], groups[i].count,
+                     groups[i].offset);
+    }
+    while ((nread < 0) && (errno == EINTR));
+
+    if (nread != groups[i].length)
+      return (nread < 0 ? -errno : -ESPIPE);
+  }
+
+  return totBytes;
+}
+
+
 //------------------------------------------------------------------------------
 // Vector write
 //------------------------------------------------------------------------------
@@ -418,6 +703,9 @@ XrdFstOssFile::WriteV(XrdOucIOVec *writeV, int n)
   ssize_t nbytes = 0;
   ssize_t curCount = 0;
 
+  if (mIoRing && !mBlockXs && (n > 1))
+    return RingV(writeV, n, true);
+
   for (int i = 0; i < n; i++) {
     curCount = Write((void *)writeV[i].data,
                      (off_t)writeV[i].offset,
@@ -435,6 +723,42 @@ XrdFstOssFile::WriteV(XrdOucIOVec *writeV, int n)
 }
 
 
+//------------------------------------------------------------------------------
+// Hand all the pieces of a vector request to the io_uring queue at once
+//------------------------------------------------------------------------------
+ssize_t
+XrdFstOssFile::RingV (XrdOucIOVec* iov, int n, bool write)
+{
+  ssize_t nbytes = 0;
+  std::vector<IoRing::Request> requests(n);
+
+  if (fd < 0)
+    return static_cast<ssize_t> (-EBADF);
+
+  for (int i = 0; i < n; i++)
+  {
+    requests[i].fd = fd;
+    requests[i].write = write;
+    requests[i].buffer = iov[i].data;
+    requests[i].length = iov[i].size;
+    requests[i].offset = iov[i].offset;
+  }
+
+  mIoRing->Run(&requests[0], n);
+
+  for (int i = 0; i < n; i++)
+  {
+    if (requests[i].result != iov[i].size)
+      return (requests[i].result < 0 ? requests[i].result : -ESPIPE);
+
+    nbytes += requests[i].result;
+  }
+
+  eos_debug("fd=%d write=%d n=%d bytes=%zi", fd, write, n, nbytes);
+  return nbytes;
+}
+
+
 //------------------------------------------------------------------------------
 // Write
 //------------------------------------------------------------------------------
@@ -504,6 +828,13 @@ XrdFstOssFile::Ftruncate (unsigned long long flen)
 
   if ((sizeof ( newlen) < sizeof ( flen)) && (flen >> 31)) return -EOVERFLOW;
 
+  if (mBlockXs)
+  {
+    // The data kept of a partially written block is not valid anymore
+    XrdSysRWLockHelper wr_lock(mRWLockXs, 0);
+    mBlockXs->DropBlockTail();
+  }
+
   // Note that space adjustment will occur when the file is closed, not here
   return ( ftruncate(fd, newlen) ? -errno : XrdOssOK);
 }
@@ -31,6 +31,7 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/Namespace.hh"
 #include "fst/checksum/CheckSum.hh"
+#include "fst/io/IoRing.hh"
 #include "common/Logging.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOss/XrdOss.hh"
@@ -39,6 +40,8 @@
 
 EOSFSTNAMESPACE_BEGIN
 
+struct ReadAheadStats;
+
 //------------------------------------------------------------------------------
 //! Class XrdFstOssFile using blockxs information
 //------------------------------------------------------------------------------
@@ -201,6 +204,19 @@ private:
   CheckSum* mBlockXs; ///< block xs object
   char* mPieceStart; ///< start piece aligned to the blockxs offset
   char* mPieceEnd; ///< end piece aligned to the blockxs offset
+  IoRing* mIoRing; ///< io_uring queue of the filesystem or 0 for sync IO
+
+  //! Read-ahead management of read-only files
+  ReadAheadStats* mReadAheadStats; ///< counters of the filesystem or 0 if off
+  XrdSysMutex mAccessMutex; ///< protects the access pattern members below
+  off_t mFileSize; ///< size of the file at open
+  off_t mReadEnd; ///< end offset of the last read
+  int mSeqReads; ///< consecutive reads continuing the previous one
+  int mRandomReads; ///< consecutive reads not continuing the previous one
+  int mAdvice; ///< last posix_fadvise advice given for the whole file
+  off_t mPrefetchStart; ///< start of the window hinted with FADV_WILLNEED
+  off_t mPrefetchEnd; ///< end of the window hinted with FADV_WILLNEED
+  size_t mPrefetchWindow; ///< size of the next window to hint
 
   //--------------------------------------------------------------------------
   //! Align request to the blockchecksum offset so that the whole request is
@@ -216,6 +232,50 @@ private:
   //--------------------------------------------------------------------------
   std::vector<XrdOucIOVec> AlignBuffer(void* buffer, off_t offset, size_t length);
 
+
+  //--------------------------------------------------------------------------
+  //! Hand all the pieces of a vector request to the io_uring queue at once
+  //!
+  //! @param iov pieces of the request
+  //! @param n number of pieces
+  //! @param write write instead of read
+  //!
+  //! @return total number of bytes transferred, -errno or -ESPIPE if a piece
+  //!         was transferred partially
+  //!
+  //--------------------------------------------------------------------------
+  ssize_t RingV (XrdOucIOVec* iov, int n, bool write);
+
+
+  //--------------------------------------------------------------------------
+  //! Vector read of a file without block checksums: the chunks are sorted by
+  //! offset and the ones closer than the readv gap are read with a single
+  //! preadv (or io_uring request) scattering the data directly to the
+  //! chunks, the data in between goes to a sink buffer. Each group goes
+  //! through the access pattern tracking like a single read.
+  //!
+  //! @param readV chunks of the request
+  //! @param n number of chunks
+  //!
+  //! @return total number of bytes read, -errno or -ESPIPE if a chunk was
+  //!         read partially
+  //!
+  //--------------------------------------------------------------------------
+  ssize_t ReadVCoalesced (XrdOucIOVec* readV, int n);
+
+
+  //--------------------------------------------------------------------------
+  //! Track the access pattern of a read-only file. After a few reads which
+  //! continue each other the file is advised as sequential and a growing
+  //! window ahead of the reader is hinted with FADV_WILLNEED, after a few
+  //! unrelated reads it is advised as random to stop the kernel readahead.
+  //!
+  //! @param offset read offset
+  //! @param length read length
+  //!
+  //--------------------------------------------------------------------------
+  void TrackAccess (off_t offset, size_t length);
+
 };
 
 EOSFSTNAMESPACE_END
@@ -119,6 +119,12 @@ public:
     }
   }
 
+  void
+  ComputeBlockSums (const char* buffer, size_t nblocks, char* sums)
+  {
+    checksum::crc32cBlocks(buffer, BlockSize, nblocks, (uint32_t*) sums);
+  }
+
   virtual
   ~CRC32C () { };
 
@@ -38,6 +38,7 @@
 #include <fcntl.h>
 #include <sys/time.h>
 #include <sys/mman.h>
+#include <algorithm>
 #ifndef __APPLE__
 #include <xfs/xfs.h>
 #endif //__APPLE__
@@ -299,6 +300,7 @@ CheckSum::OpenMap (const char* mapfilepath, size_t maxfilesize, size_t blocksize
 
   ChecksumMapSize = ((maxfilesize / blocksize) + 1) * (GetCheckSumLen());
   ChecksumMapOpenSize = ChecksumMapSize; // we need this, in case we have to deallocate !
+  mLastSync = time(0);
 
   if (isRW)
   {
@@ -378,6 +380,7 @@ CheckSum::SyncMap ()
     {
       if (!msync(ChecksumMap, ChecksumMapSize, MS_ASYNC))
       {
+        mLastSync = time(0);
         return true;
       }
       fprintf(stderr, "Fatal: [CheckSum::SyncMap] fd=%d errno=%d %llu %llu\n", (int) ChecksumMapFd, (int) errno, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
@@ -417,7 +420,9 @@ CheckSum::ChangeMap (size_t newsize, bool shrink)
   if ((!shrink) && ((newsize - ChecksumMapSize) < (64 * 1024)))
     newsize = ChecksumMapSize + (64 * 1024); // to avoid to many truncs/msync's here we increase the desired value by 64k
 
-  if (!SyncMap())
+  // the dirty pages stay in memory when the map grows, they are synced
+  // periodically by SetXSMapBlocks and when the map is closed
+  if ((newsize < ChecksumMapSize) && (!SyncMap()))
   {
     fprintf(stderr, "Fatal: [CheckSum:ChangeMap] sync failed [ fd=%d map=%llu mapsize=%llu\n", (int) ChecksumMapFd, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
     return false;
@@ -457,6 +462,8 @@ bool
 CheckSum::CloseMap ()
 {
   //  fprintf(stderr,"[Checksum::CloseMap] %d %llu %llu\n", ChecksumMapFd, ChecksumMap, ChecksumMapSize);
+  mBlockTailLength = 0;
+
   if (ChecksumMapFd)
   {
     if (ChecksumMap)
@@ -525,64 +532,135 @@ CheckSum::AlignBlockShrink (off_t offset, size_t len, off_t &aligned_offset, siz
   return;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+CheckSum::ComputeBlockSums (const char* buffer, size_t nblocks, char* sums)
+{
+  int len = 0;
+  int xslen = GetCheckSumLen();
+
+  for (size_t i = 0; i < nblocks; i++)
+  {
+    Reset();
+    Add(buffer + (i * BlockSize), BlockSize, 0);
+    Finalize();
+    memcpy(sums + (i * xslen), GetBinChecksum(len), xslen);
+  }
+}
+
 /*----------------------------------------------------------------------------*/
 bool
 CheckSum::AddBlockSum (off_t offset, const char* buffer, size_t len)
 {
   // --------------------------------------------------------------------------------------
   // !this only calculates the checksum on full blocks, not matching edge is not calculated
+  // !unless the write continues the previous one which ended inside a block
   // --------------------------------------------------------------------------------------
 
   off_t aligned_offset;
   size_t aligned_len;
+  off_t expand_offset;
+  size_t expand_len;
+  uint64_t sums[(XSBlockBatch * 32) / sizeof (uint64_t)];
+
+  if (!len)
+    return true;
+
+  // -----------------------------------------------------------------------------
+  // first wipe out the concerned edge pages (set to the empty checksum)
+  // -----------------------------------------------------------------------------
+
+  AlignBlockExpand(offset, len, expand_offset, expand_len);
+  AlignBlockShrink(offset, len, aligned_offset, aligned_len);
+  off_t expand_end = expand_offset + expand_len;
+  off_t inner_start = aligned_len ? aligned_offset : expand_end;
+  off_t inner_end = aligned_len ? (off_t) (aligned_offset + aligned_len) : expand_end;
+
+  for (off_t position = expand_offset; position < expand_end; position += BlockSize)
+  {
+    if ((position >= inner_start) && (position < inner_end))
+      continue;
+
+    Reset();
+    Finalize();
+    if (!SetXSMap(position))
+      return false;
+  }
 
   // -----------------------------------------------------------------------------
-  // first wipe out the concerned pages (set to 0)
+  // write the inner matching pages in batches
   // -----------------------------------------------------------------------------
 
-  AlignBlockExpand(offset, len, aligned_offset, aligned_len);
   if (aligned_len)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
     const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    size_t nblocks = aligned_len / BlockSize;
+
+    for (size_t done = 0; done < nblocks;)
     {
-      Reset();
-      Finalize();
-      if (!SetXSMap(position))
+      size_t batch = std::min(nblocks - done, XSBlockBatch);
+      ComputeBlockSums(bufferptr, batch, (char*) sums);
+      if (!SetXSMapBlocks(aligned_offset + (done * BlockSize), (char*) sums, batch))
         return false;
-      bufferptr += BlockSize;
+      nXSBlocksWritten += batch;
+      bufferptr += batch * BlockSize;
+      done += batch;
     }
   }
 
-
   // -----------------------------------------------------------------------------
-  // write the inner matching page
+  // complete the block left partial by the previous write if this one continues
+  // it, so that sequential unaligned writes don't leave holes to be read back
   // -----------------------------------------------------------------------------
 
-  AlignBlockShrink(offset, len, aligned_offset, aligned_len);
+  off_t endoffset = offset + len;
+  bool continued = false;
 
-  if (aligned_len)
+  if (mBlockTailLength)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
-    const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    off_t tail_end = mBlockTailOffset + mBlockTailLength;
+    off_t block_end = mBlockTailOffset + BlockSize;
+
+    if (offset == tail_end)
     {
-      // checksum this block
-      Reset();
-      Add(bufferptr, BlockSize, 0);
-      Finalize();
-      // write the checksum page
-      if (!SetXSMap(position))
-        return false;
-      nXSBlocksWritten++;
-      bufferptr += BlockSize;
+      size_t fill = std::min(len, (size_t) (block_end - tail_end));
+      memcpy(mBlockTail + mBlockTailLength, buffer, fill);
+      mBlockTailLength += fill;
+      continued = true;
+
+      if (mBlockTailLength == BlockSize)
+      {
+        mBlockTailLength = 0;
+        ComputeBlockSums(mBlockTail, 1, (char*) sums);
+        if (!SetXSMapBlocks(mBlockTailOffset, (char*) sums, 1))
+          return false;
+        nXSBlocksWritten++;
+      }
+    }
+    else if ((offset < block_end) && (endoffset > mBlockTailOffset))
+    {
+      // the data of the block changed in an unknown way
+      mBlockTailLength = 0;
     }
   }
+
+  // -----------------------------------------------------------------------------
+  // keep the data of the new partial end block
+  // -----------------------------------------------------------------------------
+
+  off_t end_block = endoffset - (endoffset % BlockSize);
+
+  if ((endoffset % BlockSize) && (end_block >= offset) &&
+      !(continued && (mBlockTailOffset == end_block)))
+  {
+    if (!mBlockTail)
+      mBlockTail = new char[BlockSize];
+
+    mBlockTailOffset = end_block;
+    mBlockTailLength = endoffset - end_block;
+    memcpy(mBlockTail, buffer + (end_block - offset), mBlockTailLength);
+  }
+
   return true;
 }
 
@@ -596,30 +674,100 @@ CheckSum::CheckBlockSum (off_t offset, const char* buffer, size_t len)
 
   off_t aligned_offset;
   size_t aligned_len;
+  uint64_t sums[(XSBlockBatch * 32) / sizeof (uint64_t)];
 
   AlignBlockShrink(offset, len, aligned_offset, aligned_len);
 
   if (aligned_len)
   {
-    off_t endoffset = aligned_offset + aligned_len;
-    off_t position = offset;
     const char* bufferptr = buffer + (aligned_offset - offset);
-    // loop over all blocks
-    for (position = aligned_offset; position < endoffset; position += BlockSize)
+    size_t nblocks = aligned_len / BlockSize;
+
+    for (size_t done = 0; done < nblocks;)
     {
-      // checksum this block
-      Reset();
-      Add(bufferptr, BlockSize, 0);
-      Finalize();
-      // compare the checksum page
-      if (!VerifyXSMap(position))
+      size_t batch = std::min(nblocks - done, XSBlockBatch);
+      ComputeBlockSums(bufferptr, batch, (char*) sums);
+      // compare the checksum pages
+      if (!VerifyXSMapBlocks(aligned_offset + (done * BlockSize), (char*) sums, batch))
       {
         return false;
       }
-      nXSBlocksChecked++;
-      bufferptr += BlockSize;
+      nXSBlocksChecked += batch;
+      bufferptr += batch * BlockSize;
+      done += batch;
+    }
+  }
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+CheckSum::SetXSMapBlocks (off_t offset, const char* sums, size_t nblocks)
+{
+  if (!ChangeMap((offset + (nblocks * BlockSize)), false))
+  {
+    return false;
+  }
+
+  off_t mapoffset = (offset / BlockSize) * GetCheckSumLen();
+  size_t maplen = nblocks * GetCheckSumLen();
+
+  if (!sigsetjmp(sj_env, 1))
+  {
+    memcpy(ChecksumMap + mapoffset, sums, maplen);
+  }
+  else
+  {
+    // return point from signal handler
+    fprintf(stderr, "Fatal: [CheckSum::SetXSMapBlocks] recovered SIGBUS by illegal write access to mmaped XS map file [ nblocks=%llu mapoffset=%llu offset=%llu map=%llu mapsize=%llu ]\n", (unsigned long long) nblocks, (unsigned long long) mapoffset, (unsigned long long) offset, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
+    return false;
+  }
+
+  // the dirty pages of the map are written back at most every few seconds
+  if ((time(0) - mLastSync) >= XSMapSyncInterval)
+  {
+    SyncMap();
+  }
+
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+CheckSum::VerifyXSMapBlocks (off_t offset, const char* sums, size_t nblocks)
+{
+  if (!ChangeMap((offset + (nblocks * BlockSize)), false))
+  {
+    fprintf(stderr, "Fatal: [CheckSum::VerifyXSMapBlocks] ChangeMap failed\n");
+    return false;
+  }
+
+  off_t mapoffset = (offset / BlockSize) * GetCheckSumLen();
+  size_t maplen = nblocks * GetCheckSumLen();
+
+  if (!sigsetjmp(sj_env, 1))
+  {
+    const char* map = ChecksumMap + mapoffset;
+
+    if (memcmp(map, sums, maplen))
+    {
+      // zero bytes in the map are not computed yet (holes)
+      for (size_t i = 0; i < maplen; i++)
+      {
+        if ((map[i]) && (map[i] != sums[i]))
+        {
+          return false;
+        }
+      }
     }
   }
+  else
+  {
+    // return point from signal handler
+    fprintf(stderr, "Fatal: [CheckSum::VerifyXSMapBlocks] recovered SIGBUS by illegal read access to mmaped XS map file [ offset=%llu mapoffset=%llu fd=%d map=%llu mapsize=%llu ]\n", (unsigned long long) offset, (unsigned long long) mapoffset, (int) ChecksumMapFd, (unsigned long long) ChecksumMap, (unsigned long long) ChecksumMapSize);
+    return false;
+  }
 
   return true;
 }
@@ -738,7 +886,21 @@ CheckSum::AddBlockSumHoles (int fd)
           }
           if (iszero)
           {
-            int nrbytes = pread(fd, buffer, BlockSize, i * BlockSize);
+            int nrbytes;
+
+            if (mBlockTailLength && ((off_t) (i * BlockSize) == mBlockTailOffset) &&
+                ((off_t) (mBlockTailOffset + mBlockTailLength) == buf.st_size))
+            {
+              // the last block of the file was written sequentially, it is
+              // still in memory
+              memcpy(buffer, mBlockTail, mBlockTailLength);
+              nrbytes = mBlockTailLength;
+            }
+            else
+            {
+              nrbytes = pread(fd, buffer, BlockSize, i * BlockSize);
+            }
+
             if (nrbytes < 0)
             {
               continue;
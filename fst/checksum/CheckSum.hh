@@ -35,6 +35,7 @@
 #include <google/sparse_hash_map>
 #include <setjmp.h>
 #include <signal.h>
+#include <time.h>
 
 /*----------------------------------------------------------------------------*/
 
@@ -60,6 +61,39 @@ protected:
   unsigned long long nXSBlocksWritten;
   unsigned long long nXSBlocksWrittenHoles;
 
+  char* mBlockTail; ///< data of the last partially written block
+  off_t mBlockTailOffset; ///< offset of the last partially written block
+  size_t mBlockTailLength; ///< bytes known from the start of that block
+  time_t mLastSync; ///< time of the last msync of the map
+
+  //! number of blocks checksummed and stored in the map in one go
+  static const size_t XSBlockBatch = 256;
+  //! maximum interval in seconds between two msync of a map being written
+  static const time_t XSMapSyncInterval = 5;
+
+  //----------------------------------------------------------------------------
+  //! Store the checksums of consecutive blocks in the map
+  //!
+  //! @param offset offset of the first block
+  //! @param sums checksums of the blocks, one after the other
+  //! @param nblocks number of blocks
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  bool SetXSMapBlocks (off_t offset, const char* sums, size_t nblocks);
+
+  //----------------------------------------------------------------------------
+  //! Verify the checksums of consecutive blocks against the map, blocks
+  //! without a checksum in the map are not verified
+  //!
+  //! @param offset offset of the first block
+  //! @param sums checksums of the blocks, one after the other
+  //! @param nblocks number of blocks
+  //!
+  //! @return true if all match, otherwise false
+  //----------------------------------------------------------------------------
+  bool VerifyXSMapBlocks (off_t offset, const char* sums, size_t nblocks);
+
 public:
 
   CheckSum ()
@@ -69,6 +103,10 @@ public:
     mNumRd = 0;
     mNumWr = 0;
     finalized = false;
+    mBlockTail = 0;
+    mBlockTailOffset = 0;
+    mBlockTailLength = 0;
+    mLastSync = 0;
   }
 
   CheckSum (const char* name)
@@ -87,6 +125,10 @@ public:
     mNumRd = 0;
     mNumWr = 0;
     finalized = false;
+    mBlockTail = 0;
+    mBlockTailOffset = 0;
+    mBlockTailLength = 0;
+    mLastSync = 0;
   }
 
   virtual bool Add (const char* buffer, size_t length, off_t offset) = 0;
@@ -158,6 +200,26 @@ public:
   virtual bool CheckBlockSum (off_t offset, const char* buffer, size_t buffersizem); // this only verifies the checksum on full blocks, not matching edge is not calculated
   virtual bool AddBlockSumHoles (int fd);
 
+  //----------------------------------------------------------------------------
+  //! Compute the checksums of consecutive blocks of BlockSize bytes
+  //!
+  //! @param buffer data of the blocks
+  //! @param nblocks number of blocks
+  //! @param sums receives the binary checksums one after the other, aligned
+  //!        to 8 bytes
+  //----------------------------------------------------------------------------
+  virtual void ComputeBlockSums (const char* buffer, size_t nblocks, char* sums);
+
+  //----------------------------------------------------------------------------
+  //! Forget the data kept of the last partially written block e.g. when the
+  //! file is truncated
+  //----------------------------------------------------------------------------
+  void
+  DropBlockTail ()
+  {
+    mBlockTailLength = 0;
+  }
+
   virtual const char*
   MakeBlockXSPath (const char *filepath)
   {
@@ -198,7 +260,10 @@ public:
   }
 
   virtual
-  ~CheckSum () { };
+  ~CheckSum ()
+  {
+    delete[] mBlockTail;
+  };
 
   virtual void
   Print ()
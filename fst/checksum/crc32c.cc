@@ -22,6 +22,21 @@ namespace checksum {
 
   CRC32CFunctionPtr crc32c = crc32c_CPUDetection;
 
+  static void crc32cBlocks_CPUDetection(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs) {
+    // the hardware block version interleaves the 64-bit CRC32 instructions,
+    // a zero length call runs the detection of crc32c only once
+    CRC32CBlocksFunctionPtr best = crc32cBlocksGeneric;
+    crc32c(crc32cInit(), data, 0);
+#ifdef __LP64__
+    if (crc32c == crc32cHardware64)
+      best = crc32cBlocksHardware64;
+#endif
+    crc32cBlocks = best;
+    best(data, blocksize, nblocks, crcs);
+  }
+
+  CRC32CBlocksFunctionPtr crc32cBlocks = crc32cBlocks_CPUDetection;
+
   static uint32_t cpuid(uint32_t functionInput) {
     uint32_t ecx;
 #if __SIZEOF_POINTER__ == 8
@@ -264,4 +279,51 @@ namespace checksum {
 #endif
   }
 
+  // CRC-32C of independent blocks, one after the other
+  void crc32cBlocksGeneric(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs) {
+    const char* p_buf = (const char*) data;
+    for (size_t i = 0; i < nblocks; i++) {
+      crcs[i] = crc32cFinish(crc32c(crc32cInit(), p_buf, blocksize));
+      p_buf += blocksize;
+    }
+  }
+
+  // Hardware-accelerated CRC-32C of independent blocks: the CRC32 instruction
+  // has a latency of 3 cycles but a throughput of 1 per cycle, so three blocks
+  // are computed at the same time with interleaved instructions
+  void crc32cBlocksHardware64(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs) {
+#ifndef __LP64__
+    crc32cBlocksGeneric(data, blocksize, nblocks, crcs);
+#else
+    const char* p_buf = (const char*) data;
+    size_t i = 0;
+
+    if (!(blocksize % sizeof(uint64_t))) {
+      size_t nwords = blocksize / sizeof(uint64_t);
+      for (; i + 3 <= nblocks; i += 3) {
+        const uint64_t* p0 = (const uint64_t*) p_buf;
+        const uint64_t* p1 = (const uint64_t*) (p_buf + blocksize);
+        const uint64_t* p2 = (const uint64_t*) (p_buf + 2 * blocksize);
+        uint64_t crc0 = crc32cInit();
+        uint64_t crc1 = crc32cInit();
+        uint64_t crc2 = crc32cInit();
+        for (size_t w = 0; w < nwords; w++) {
+          crc0 = __builtin_ia32_crc32di(crc0, p0[w]);
+          crc1 = __builtin_ia32_crc32di(crc1, p1[w]);
+          crc2 = __builtin_ia32_crc32di(crc2, p2[w]);
+        }
+        crcs[i] = crc32cFinish((uint32_t) crc0);
+        crcs[i + 1] = crc32cFinish((uint32_t) crc1);
+        crcs[i + 2] = crc32cFinish((uint32_t) crc2);
+        p_buf += 3 * blocksize;
+      }
+    }
+
+    for (; i < nblocks; i++) {
+      crcs[i] = crc32cFinish(crc32cHardware64(crc32cInit(), p_buf, blocksize));
+      p_buf += blocksize;
+    }
+#endif
+  }
+
 }  // namespace checksum
@@ -27,6 +27,18 @@ extern CRC32CFunctionPtr crc32c;
 
 CRC32CFunctionPtr detectBestCRC32C();
 
+/** Pointer to a function that computes the final CRC32-C values of several
+equally sized blocks, independent of each other.
+@arg data Pointer to the first block, the blocks are contiguous.
+@arg blocksize size of each block in bytes.
+@arg nblocks number of blocks.
+@arg crcs Array receiving the nblocks final CRC32-C values.
+*/
+typedef void (*CRC32CBlocksFunctionPtr)(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs);
+
+/** This will map automatically to the "best" block implementation. */
+extern CRC32CBlocksFunctionPtr crc32cBlocks;
+
 /** Converts a partial CRC32-C computation to the final value. */
 static inline uint32_t crc32cFinish(uint32_t crc) {
     return ~crc;
@@ -38,5 +50,8 @@ uint32_t crc32cSlicingBy8(uint32_t crc, const void* data, size_t length);
 uint32_t crc32cHardware32(uint32_t crc, const void* data, size_t length);
 uint32_t crc32cHardware64(uint32_t crc, const void* data, size_t length);
 
+void crc32cBlocksGeneric(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs);
+void crc32cBlocksHardware64(const void* data, size_t blocksize, size_t nblocks, uint32_t* crcs);
+
 }  // namespace checksum
 #endif
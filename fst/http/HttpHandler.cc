@@ -360,6 +360,17 @@ HttpHandler::Get (eos::common::HttpRequest *request)
   return response;
 }
 
+/*----------------------------------------------------------------------------*/
+int
+HttpHandler::ZeroCopyFd (off_t &offset)
+{
+  if (!mFile || (mRangeRequest && (mOffsetMap.size() != 1)))
+    return -1;
+
+  offset = mRangeRequest ? mOffsetMap.begin()->first : 0;
+  return mFile->ZeroCopyFd(offset, mRequestSize);
+}
+
 /*----------------------------------------------------------------------------*/
 eos::common::HttpResponse*
 HttpHandler::Head (eos::common::HttpRequest *request)
@@ -77,6 +77,7 @@ public:
   std::string                mLogId;              //< log id used in EOS - determined after Ofs::Open
   int                        mErrCode;            //< first seen error code
   std::string                mErrText;            //< error text
+  bool                       mZeroCopy;           //< response data sent from a descriptor, the handler is cleaned up on completion
 
   static XrdSysMutex mOpenMutexMapMutex;
   static std::map<unsigned int, XrdSysMutex*> mOpenMutexMap;
@@ -107,6 +108,7 @@ public:
     mUploadLeftSize         = 0;
     mLastChunk              = false;
     mErrCode                = 0;
+    mZeroCopy               = false;
   }
 
   /**
@@ -228,6 +230,18 @@ public:
                    off_t                  &requestsize,
                    off_t                     filesize);
 
+  /**
+   * Open a descriptor to send the response data of a GET request with
+   * zero-copy. Multipart range responses are always served via the reader
+   * callback.
+   *
+   * @param offset  returns the file offset of the response data
+   *
+   * @return file descriptor or -1 if the data has to be read via the file
+   */
+  int
+  ZeroCopyFd (off_t &offset);
+
   /**
    * Initialize this HTTP handler
    *
@@ -30,6 +30,7 @@
 #include "XrdSys/XrdSysPthread.hh"
 #include "XrdSfs/XrdSfsInterface.hh"
 /*----------------------------------------------------------------------------*/
+#include <unistd.h>
 
 /*----------------------------------------------------------------------------*/
 
@@ -155,11 +156,31 @@ HttpServer::Handler (void *cls,
   if (response->mUseFileReaderCallback)
   {
     eos_static_debug("response length=%d", response->mResponseLength);
-    mhdResponse = MHD_create_response_from_callback(response->mResponseLength,
-                                                    4 * 1024 * 1024, /* 4M page size */
-                                                    &HttpServer::FileReaderCallback,
-                                                    (void*) protocolHandler,
-                                                    &HttpServer::FileCloseCallback);
+    eos::fst::HttpHandler *httpHandle =
+      dynamic_cast<eos::fst::HttpHandler*> (protocolHandler);
+    off_t offset = 0;
+    int fd = (mZeroCopy && httpHandle) ? httpHandle->ZeroCopyFd(offset) : -1;
+
+    if (fd >= 0)
+    {
+      // the daemon sends the data with sendfile and closes fd when done - the
+      // response has no close callback, the handler is cleaned up in
+      // CompleteHandler once the request is done
+      mhdResponse = MHD_create_response_from_fd_at_offset(response->mResponseLength,
+                                                          fd, offset);
+      if (mhdResponse)
+        httpHandle->mZeroCopy = true;
+      else
+        close(fd);
+    }
+    else
+    {
+      mhdResponse = MHD_create_response_from_callback(response->mResponseLength,
+                                                      4 * 1024 * 1024, /* 4M page size */
+                                                      &HttpServer::FileReaderCallback,
+                                                      (void*) protocolHandler,
+                                                      &HttpServer::FileCloseCallback);
+    }
   }
   else
   {
@@ -374,6 +395,24 @@ HttpServer::CompleteHandler (void                              *cls,
 
   eos_static_info("msg=\"http connection disconnect\" reason=\"Request %s\" ", scode.c_str());
 
+  if (con_cls && (*con_cls))
+  {
+    eos::common::ProtocolHandler *handler = static_cast<eos::common::ProtocolHandler*> (*con_cls);
+    eos::fst::HttpHandler *httpHandle = dynamic_cast<eos::fst::HttpHandler*> (handler);
+
+    if (httpHandle && httpHandle->mZeroCopy)
+    {
+      // the data was sent from a descriptor: close the file like
+      // FileCloseCallback does after the last callback read
+      if (httpHandle->mFile)
+        httpHandle->mCloseCode = httpHandle->mFile->close();
+
+      delete httpHandle;
+      *con_cls = 0;
+      return;
+    }
+  }
+
   if ( (toe != MHD_REQUEST_TERMINATED_COMPLETED_OK) && (con_cls && (*con_cls))) {
     eos_static_info("msg=\"http connection disconnect\" action=\"Cleanup\" ");
     eos::common::ProtocolHandler *handler = static_cast<eos::common::ProtocolHandler*> (*con_cls);
@@ -37,19 +37,32 @@
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysPthread.hh"
 /*----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 /*----------------------------------------------------------------------------*/
 
 EOSFSTNAMESPACE_BEGIN
 
 class HttpServer : public eos::common::HttpServer
 {
+private:
+  bool mZeroCopy; //< serve plain files with sendfile
 
 public:
 
   /**
    * Constructor
    */
-  HttpServer (int port = 8001) : eos::common::HttpServer::HttpServer (port) {};
+  HttpServer (int port = 8001) : eos::common::HttpServer::HttpServer (port)
+  {
+    // an epoll pool has one thread per core by default on the FST
+    mThreadPoolSize = sysconf(_SC_NPROCESSORS_ONLN);
+    if (mThreadPoolSize < 1)
+      mThreadPoolSize = 16;
+    mZeroCopy = getenv("EOS_FST_HTTP_ZEROCOPY") &&
+                !strcmp(getenv("EOS_FST_HTTP_ZEROCOPY"), "1");
+  };
 
   /**
    * Destructor
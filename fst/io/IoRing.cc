@@ -0,0 +1,455 @@
+//------------------------------------------------------------------------------
+//! @file IoRing.cc
+//! @author agent <agent@local>
+//! @brief Asynchronous local disk IO with a Linux io_uring per filesystem
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "fst/io/IoRing.hh"
+#include "common/Logging.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysTimer.hh"
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+IoRing::IoRing () :
+  mFd(-1),
+  mSqEntries(0),
+  mCqEntries(0),
+  mSqRing(MAP_FAILED),
+  mSqRingSize(0),
+  mCqRing(MAP_FAILED),
+  mCqRingSize(0),
+  mSqes(MAP_FAILED),
+  mSqesSize(0),
+  mSqHead(0),
+  mSqTail(0),
+  mSqMask(0),
+  mSqArray(0),
+  mCqHead(0),
+  mCqTail(0),
+  mCqMask(0),
+  mCqes(0),
+  mSubmitCond(0),
+  mInFlight(0),
+  mReaper(0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Create a ring
+//------------------------------------------------------------------------------
+IoRing*
+IoRing::Create (unsigned depth)
+{
+#ifdef HAVE_IO_URING
+  IoRing* ring = new IoRing();
+
+  if (!ring->Setup(depth))
+  {
+    delete ring;
+    return 0;
+  }
+
+  return ring;
+#else
+  eos_static_warning("msg=\"io_uring is not supported by this build\" depth=%u",
+                     depth);
+  return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+IoRing::~IoRing ()
+{
+#ifdef HAVE_IO_URING
+  if (mReaper)
+  {
+    // wait for the requests in flight and wake up the reaper with a NOP
+    // carrying no request
+    mSubmitCond.Lock();
+
+    while (mInFlight)
+      mSubmitCond.Wait();
+
+    while (!Queue(0, IORING_OP_NOP))
+      mSubmitCond.Wait();
+
+    if (!Enter(1))
+    {
+      // the reaper can't be woken up, leave the queues mapped for it
+      eos_static_crit("msg=\"failed to stop the io_uring reaper, leaking the "
+                      "ring\" fd=%d", mFd);
+      mSubmitCond.UnLock();
+      return;
+    }
+
+    mSubmitCond.UnLock();
+    XrdSysThread::Join(mReaper, NULL);
+  }
+#endif
+
+  if (mSqes != MAP_FAILED)
+    munmap(mSqes, mSqesSize);
+
+  if (mCqRing != MAP_FAILED)
+    munmap(mCqRing, mCqRingSize);
+
+  if (mSqRing != MAP_FAILED)
+    munmap(mSqRing, mSqRingSize);
+
+  if (mFd >= 0)
+    close(mFd);
+}
+
+//------------------------------------------------------------------------------
+// Set up the ring and map the queues
+//------------------------------------------------------------------------------
+bool
+IoRing::Setup (unsigned depth)
+{
+#ifdef HAVE_IO_URING
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  mFd = syscall(__NR_io_uring_setup, depth, &params);
+
+  if (mFd < 0)
+  {
+    eos_static_warning("msg=\"io_uring setup failed\" depth=%u errno=%d",
+                       depth, errno);
+    return false;
+  }
+
+  mSqEntries = params.sq_entries;
+  mCqEntries = params.cq_entries;
+  mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  mCqRingSize = params.cq_off.cqes +
+    params.cq_entries * sizeof(struct io_uring_cqe);
+  mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  mSqRing = mmap(0, mSqRingSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+  mCqRing = mmap(0, mCqRingSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_CQ_RING);
+  mSqes = mmap(0, mSqesSize, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES);
+
+  if ((mSqRing == MAP_FAILED) || (mCqRing == MAP_FAILED) ||
+      (mSqes == MAP_FAILED))
+  {
+    eos_static_err("msg=\"failed to map the io_uring queues\" errno=%d", errno);
+    return false;
+  }
+
+  char* sq = (char*) mSqRing;
+  char* cq = (char*) mCqRing;
+  mSqHead = (unsigned*) (sq + params.sq_off.head);
+  mSqTail = (unsigned*) (sq + params.sq_off.tail);
+  mSqMask = *(unsigned*) (sq + params.sq_off.ring_mask);
+  mSqArray = (unsigned*) (sq + params.sq_off.array);
+  mCqHead = (unsigned*) (cq + params.cq_off.head);
+  mCqTail = (unsigned*) (cq + params.cq_off.tail);
+  mCqMask = *(unsigned*) (cq + params.cq_off.ring_mask);
+  mCqes = cq + params.cq_off.cqes;
+
+  if (XrdSysThread::Run(&mReaper, IoRing::StaticReaper, static_cast<void*> (this),
+                        XRDSYSTHREAD_HOLD, "IoRing Reaper"))
+  {
+    eos_static_err("msg=\"failed to start the io_uring reaper\"");
+    mReaper = 0;
+    return false;
+  }
+
+  eos_static_info("msg=\"io_uring ready\" sq-entries=%u cq-entries=%u",
+                  mSqEntries, mCqEntries);
+  return true;
+#else
+  return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Queue the requests of a batch and hand them to the kernel
+//------------------------------------------------------------------------------
+void
+IoRing::Submit (Batch& batch, Request* requests, size_t n)
+{
+#ifdef HAVE_IO_URING
+  batch.mCond.Lock();
+  batch.mPending += n;
+  batch.mCond.UnLock();
+  unsigned queued = 0;
+  mSubmitCond.Lock();
+
+  for (size_t i = 0; i < n; i++)
+  {
+    Request* request = &requests[i];
+    request->batch = &batch;
+    request->result = 0;
+    request->iov.iov_base = request->buffer;
+    request->iov.iov_len = request->length;
+    uint8_t opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+
+    // never put more requests in flight than the completion queue can hold
+    while ((mInFlight + queued >= mCqEntries) || !Queue(request, opcode))
+    {
+      if (queued)
+      {
+        Enter(queued);
+        queued = 0;
+      }
+      else
+      {
+        mSubmitCond.Wait();
+      }
+    }
+
+    queued++;
+  }
+
+  if (queued)
+    Enter(queued);
+
+  mSubmitCond.UnLock();
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Wait for all the requests of a batch
+//------------------------------------------------------------------------------
+void
+IoRing::Wait (Batch& batch)
+{
+  batch.mCond.Lock();
+
+  while (batch.mPending)
+    batch.mCond.Wait();
+
+  batch.mCond.UnLock();
+}
+
+#ifdef HAVE_IO_URING
+//------------------------------------------------------------------------------
+// Put one request in the submission queue
+//------------------------------------------------------------------------------
+bool
+IoRing::Queue (Request* request, uint8_t opcode)
+{
+  // we are the only writer of the tail, the kernel moves the head
+  unsigned tail = *mSqTail;
+
+  if (tail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mSqEntries)
+    return false;
+
+  unsigned index = tail & mSqMask;
+  struct io_uring_sqe* sqe = ((struct io_uring_sqe*) mSqes) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->user_data = (uint64_t) (uintptr_t) request;
+
+  if (request)
+  {
+    sqe->fd = request->fd;
+
+    if (request->vector)
+    {
+      sqe->addr = (uint64_t) (uintptr_t) request->vector;
+      sqe->len = request->count;
+    }
+    else
+    {
+      sqe->addr = (uint64_t) (uintptr_t) &request->iov;
+      sqe->len = 1;
+    }
+
+    sqe->off = request->offset;
+  }
+  else
+  {
+    sqe->fd = -1;
+  }
+
+  mSqArray[index] = index;
+  __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Hand the queued requests to the kernel
+//------------------------------------------------------------------------------
+bool
+IoRing::Enter (unsigned nsubmit)
+{
+  mInFlight += nsubmit;
+
+  while (nsubmit)
+  {
+    int retc = syscall(__NR_io_uring_enter, mFd, nsubmit, 0, 0, NULL, 0);
+
+    if (retc < 0)
+    {
+      int error = errno;
+
+      if ((error == EINTR) || (error == EAGAIN) || (error == EBUSY))
+        continue;
+
+      eos_static_err("msg=\"io_uring submission failed\" errno=%d pending=%u",
+                     error, nsubmit);
+      // the kernel did not take the remaining entries, take them back from
+      // the submission queue and fail their requests
+      unsigned head = __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+      unsigned tail = *mSqTail;
+
+      for (unsigned i = head; i != tail; i++)
+      {
+        struct io_uring_sqe* sqe = ((struct io_uring_sqe*) mSqes) +
+          mSqArray[i & mSqMask];
+        Request* request = (Request*) (uintptr_t) sqe->user_data;
+
+        if (request)
+          Complete(request, -error);
+      }
+
+      __atomic_store_n(mSqTail, head, __ATOMIC_RELEASE);
+      mInFlight -= nsubmit;
+      mSubmitCond.Broadcast();
+      return false;
+    }
+
+    nsubmit -= retc;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Complete a request and wake up its batch once it is done
+//------------------------------------------------------------------------------
+void
+IoRing::Complete (Request* request, ssize_t result)
+{
+  // the request must not be touched once the batch is released
+  Batch* batch = request->batch;
+  batch->mCond.Lock();
+  request->result = result;
+
+  if (!--batch->mPending)
+    batch->mCond.Signal();
+
+  batch->mCond.UnLock();
+}
+
+//------------------------------------------------------------------------------
+// Reaper thread collecting the completions
+//------------------------------------------------------------------------------
+void*
+IoRing::StaticReaper (void* arg)
+{
+  static_cast<IoRing*> (arg)->Reaper();
+  return 0;
+}
+
+void
+IoRing::Reaper ()
+{
+  bool shutdown = false;
+
+  while (!shutdown)
+  {
+    if ((syscall(__NR_io_uring_enter, mFd, 0, 1, IORING_ENTER_GETEVENTS,
+                 NULL, 0) < 0) && (errno != EINTR))
+    {
+      eos_static_err("msg=\"io_uring wait failed\" errno=%d", errno);
+      XrdSysTimer::Wait(1);
+    }
+
+    // we are the only writer of the head, the kernel moves the tail
+    unsigned head = *mCqHead;
+    unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+    size_t reaped = tail - head;
+
+    for (; head != tail; head++)
+    {
+      struct io_uring_cqe* cqe = ((struct io_uring_cqe*) mCqes) +
+        (head & mCqMask);
+      Request* request = (Request*) (uintptr_t) cqe->user_data;
+
+      if (!request)
+      {
+        shutdown = true;
+        continue;
+      }
+
+      Complete(request, cqe->res);
+    }
+
+    __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+
+    if (reaped)
+    {
+      mSubmitCond.Lock();
+      mInFlight -= reaped;
+      mSubmitCond.Broadcast();
+      mSubmitCond.UnLock();
+    }
+  }
+}
+#else
+bool
+IoRing::Queue (Request* request, uint8_t opcode)
+{
+  return false;
+}
+
+bool
+IoRing::Enter (unsigned nsubmit)
+{
+  return false;
+}
+
+void
+IoRing::Complete (Request* request, ssize_t result) { }
+
+void*
+IoRing::StaticReaper (void* arg)
+{
+  return 0;
+}
+
+void
+IoRing::Reaper () { }
+#endif
+
+EOSFSTNAMESPACE_END
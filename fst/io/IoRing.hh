@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+//! @file IoRing.hh
+//! @author agent <agent@local>
+//! @brief Asynchronous local disk IO with a Linux io_uring per filesystem
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFST_IORING_HH__
+#define __EOSFST_IORING_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "fst/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+EOSFSTNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Class IoRing
+//! Submission and completion queue shared by all the files of a filesystem.
+//! Requests are put in the submission queue and handed to the kernel with a
+//! single system call per batch, so that the disk sees the whole batch at
+//! once instead of one pread/pwrite after the other. A reaper thread collects
+//! the completions and wakes up the waiting batches. The ring is built on the
+//! raw io_uring system calls, without liburing. If the kernel or the build
+//! host don't support io_uring, Create returns 0 and the caller keeps doing
+//! synchronous IO. Only the vector reads and writes of XrdFstOssFile use the
+//! ring, single reads and writes stay synchronous.
+//------------------------------------------------------------------------------
+class IoRing
+{
+public:
+
+  class Batch;
+
+  //----------------------------------------------------------------------------
+  //! One read or write
+  //----------------------------------------------------------------------------
+  struct Request
+  {
+    int fd; ///< file descriptor
+    bool write; ///< write instead of read
+    char* buffer; ///< data
+    size_t length; ///< length of the data
+    off_t offset; ///< file offset
+    const struct iovec* vector; ///< scatter/gather vector used instead of buffer
+    int count; ///< number of entries in the vector
+    ssize_t result; ///< bytes transferred or -errno once completed
+    Batch* batch; ///< batch the request belongs to, set by Submit
+    struct iovec iov; ///< vector handed to the kernel for buffer/length
+  };
+
+  //----------------------------------------------------------------------------
+  //! Set of requests submitted together and waited for together
+  //----------------------------------------------------------------------------
+  class Batch
+  {
+  public:
+    Batch () : mCond(0), mPending(0) { }
+
+  private:
+    friend class IoRing;
+    XrdSysCondVar mCond; ///< signalled when a request completes
+    size_t mPending; ///< requests not yet completed
+  };
+
+  //----------------------------------------------------------------------------
+  //! Create a ring
+  //!
+  //! @param depth number of submission queue entries
+  //!
+  //! @return ring or 0 if io_uring is not available
+  //----------------------------------------------------------------------------
+  static IoRing* Create (unsigned depth);
+
+  //----------------------------------------------------------------------------
+  //! Destructor - waits for the requests in flight and stops the reaper
+  //----------------------------------------------------------------------------
+  ~IoRing ();
+
+  //----------------------------------------------------------------------------
+  //! Queue the requests of a batch and hand them to the kernel. Blocks only
+  //! while the ring is full.
+  //!
+  //! @param batch batch to wait for with Wait
+  //! @param requests requests, they have to stay valid until Wait returned
+  //! @param n number of requests
+  //----------------------------------------------------------------------------
+  void Submit (Batch& batch, Request* requests, size_t n);
+
+  //----------------------------------------------------------------------------
+  //! Wait for all the requests of a batch
+  //----------------------------------------------------------------------------
+  void Wait (Batch& batch);
+
+  //----------------------------------------------------------------------------
+  //! Submit the requests and wait for all of them
+  //----------------------------------------------------------------------------
+  void
+  Run (Request* requests, size_t n)
+  {
+    Batch batch;
+    Submit(batch, requests, n);
+    Wait(batch);
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the number of submission queue entries
+  //----------------------------------------------------------------------------
+  unsigned
+  GetDepth () const
+  {
+    return mSqEntries;
+  }
+
+private:
+  int mFd; ///< io_uring file descriptor
+  unsigned mSqEntries; ///< submission queue entries
+  unsigned mCqEntries; ///< completion queue entries
+  void* mSqRing; ///< mmapped submission queue ring
+  size_t mSqRingSize; ///< size of the submission queue ring
+  void* mCqRing; ///< mmapped completion queue ring
+  size_t mCqRingSize; ///< size of the completion queue ring
+  void* mSqes; ///< mmapped submission queue entries
+  size_t mSqesSize; ///< size of the submission queue entries
+  unsigned* mSqHead; ///< submission queue head, moved by the kernel
+  unsigned* mSqTail; ///< submission queue tail, moved by us
+  unsigned mSqMask; ///< submission queue index mask
+  unsigned* mSqArray; ///< submission queue index array
+  unsigned* mCqHead; ///< completion queue head, moved by us
+  unsigned* mCqTail; ///< completion queue tail, moved by the kernel
+  unsigned mCqMask; ///< completion queue index mask
+  void* mCqes; ///< completion queue entries
+
+  XrdSysCondVar mSubmitCond; ///< serializes submissions, signalled on completions
+  size_t mInFlight; ///< requests handed to the kernel and not reaped
+  pthread_t mReaper; ///< completion reaper thread
+
+  IoRing ();
+
+  //----------------------------------------------------------------------------
+  //! Set up the ring and map the queues
+  //----------------------------------------------------------------------------
+  bool Setup (unsigned depth);
+
+  //----------------------------------------------------------------------------
+  //! Reaper thread collecting the completions
+  //----------------------------------------------------------------------------
+  static void* StaticReaper (void* arg);
+  void Reaper ();
+
+  //----------------------------------------------------------------------------
+  //! Put one request in the submission queue - needs mSubmitCond
+  //!
+  //! @return false if the submission queue is full
+  //----------------------------------------------------------------------------
+  bool Queue (Request* request, uint8_t opcode);
+
+  //----------------------------------------------------------------------------
+  //! Hand the queued requests to the kernel - needs mSubmitCond. If the kernel
+  //! refuses them, the queued entries are taken back and their requests are
+  //! completed with -errno.
+  //!
+  //! @return false if the requests could not be submitted
+  //----------------------------------------------------------------------------
+  bool Enter (unsigned nsubmit);
+
+  //----------------------------------------------------------------------------
+  //! Complete a request with the result and wake up its batch
+  //----------------------------------------------------------------------------
+  void Complete (Request* request, ssize_t result);
+
+  //----------------------------------------------------------------------------
+  //! Disable copy constructor and assign operator
+  //----------------------------------------------------------------------------
+  IoRing (const IoRing&) = delete;
+  IoRing& operator = (const IoRing&) = delete;
+};
+
+EOSFSTNAMESPACE_END
+
+#endif // __EOSFST_IORING_HH__
@@ -136,7 +136,8 @@ public:
 
 
   //----------------------------------------------------------------------------
-  //! Read from file async - falls back to synchrounous mode
+  //! Read from file async - falls back to synchrounous mode, only the vector
+  //! requests of the filesystems with an iodepth go through the io_uring queue
   //!
   //! @param offset offset in file
   //! @param buffer where the data is read
@@ -154,7 +155,7 @@ public:
 
 
   //----------------------------------------------------------------------------
-  //! Write to file async - falls back to synchronous mode
+  //! Write to file async - falls back to synchronous mode, like ReadAsync
   //!
   //! @param offset offset
   //! @param buffer data to be written
@@ -45,6 +45,7 @@ Layout (file, lid, client, outError, io, timeout)
 {
   mNumReplicas = eos::common::LayoutId::GetStripeNumber(lid) + 1; // this 1=0x0 16=0xf :-)
   ioLocal = false;
+  mChain = false;
 }
 
 
@@ -120,12 +121,39 @@ ReplicaParLayout::Open (const std::string& path,
    mIsEntryServer = true;
  }
 
+ // The head selects star or chain mode, the other replicas follow the chain
+ // flag forwarded by the previous replica
+ static bool chain_default = (getenv("EOS_FST_REPLICA_CHAIN") &&
+                              atoi(getenv("EOS_FST_REPLICA_CHAIN")));
+ const char* chain = mOfsFile->openOpaque->Get("mgm.replicachain");
+ int next_index = -1;
+
+ if (chain)
+ {
+   mChain = (atoi(chain) != 0);
+ }
+ else if (is_head_server)
+ {
+   mChain = chain_default;
+ }
+
+ if (mChain && !is_gateway && mOfsFile->isRW && (mNumReplicas > 1))
+ {
+   next_index = (replica_index + 1) % mNumReplicas;
+
+   // the last replica before wrapping to the head ends the chain
+   if (next_index == replica_head)
+     next_index = -1;
+ }
+
+ eos_info("replica_chain=%d next_index=%d", mChain, next_index);
+
  int envlen;
  XrdOucString remoteOpenOpaque = mOfsFile->openOpaque->Env(envlen);
  XrdOucString remoteOpenPath = mOfsFile->openOpaque->Get("mgm.path");
 
- // Only a gateway or head server needs to contact others
- if (is_gateway || is_head_server)
+ // Only a gateway, the head server or a chain member needs to contact others
+ if (is_gateway || is_head_server || (next_index >= 0))
  {
    // Assign stripe URLs
    std::string replica_url;
@@ -168,6 +196,9 @@ ReplicaParLayout::Open (const std::string& path,
        remoteOpenOpaque += head;
      }
 
+     if (mChain && !chain)
+       remoteOpenOpaque += "&mgm.replicachain=1";
+
      replica_url += remoteOpenOpaque.c_str();
      mReplicaUrl.push_back(replica_url);
      eos_debug("added replica_url = %s, index = %i", replica_url.c_str(), i);
@@ -199,9 +230,11 @@ ReplicaParLayout::Open (const std::string& path,
    }
    else
    {
-     // Gateway contacts the head, head contacts all
+     // Gateway contacts the head, head contacts all in star mode and every
+     // replica contacts the next one in chain mode
      if ((is_gateway && (i == replica_head)) ||
-         (is_head_server && (i != replica_index)))
+         (is_head_server && !mChain && (i != replica_index)) ||
+         (i == next_index))
      {
        if (mOfsFile->isRW)
        {
@@ -348,8 +381,11 @@ ReplicaParLayout::Write (XrdSfsFileOffset offset,
 {
   int64_t rc;
 
-  for (unsigned int i = 0; i < mReplicaFile.size(); i++)
+  // Start the remote writes before the local one (index 0) so that the next
+  // replicas work in parallel with the local disk
+  for (unsigned int n = 0; n < mReplicaFile.size(); n++)
   {
+    unsigned int i = (n + 1) % mReplicaFile.size();
     rc = mReplicaFile[i]->WriteAsync(offset, buffer, length, mTimeout);
 
     if (rc != length)
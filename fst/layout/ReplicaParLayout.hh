@@ -33,6 +33,16 @@ EOSFSTNAMESPACE_BEGIN
 
 //------------------------------------------------------------------------------
 //! Class abstracting the physical layout of a file with replicas
+//!
+//! In the default (star) mode the head server writes every buffer to all the
+//! replicas, so its network link carries N times the client stream. In chain
+//! mode the head only forwards to replica head+1, which forwards to head+2 and
+//! so on, so that every link carries the stream once. The close of a replica
+//! returns once all the replicas further down the chain are closed and
+//! committed, giving an end-to-end acknowledgement to the client.
+//! The mode is selected by the head server from mgm.replicachain (set by the
+//! MGM from the client's eos.replicachain) or from EOS_FST_REPLICA_CHAIN, and
+//! passed down the chain as mgm.replicachain=1.
 //------------------------------------------------------------------------------
 class ReplicaParLayout : public Layout
 {
@@ -203,6 +213,10 @@ private:
   int mNumReplicas; ///< number of replicas for current file
   bool ioLocal; ///< mark if we are to do local IO
 
+  //! in chain mode every replica forwards the stream to the next one instead
+  //! of the head writing to all of them
+  bool mChain;
+
   //! replica file object, index 0 is the local file
   std::vector<FileIo*> mReplicaFile;
   std::vector<std::string> mReplicaUrl; ///< URLs of the replica files
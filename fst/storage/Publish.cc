@@ -24,10 +24,13 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/storage/Storage.hh"
 #include "fst/XrdFstOfs.hh"
+#include "fst/XrdFstOss.hh"
 #include "common/LinuxStat.hh"
 #include "common/ShellCmd.hh"
 /*----------------------------------------------------------------------------*/
 
+extern eos::fst::XrdFstOss *XrdOfsOss;
+
 EOSFSTNAMESPACE_BEGIN
 
 /*----------------------------------------------------------------------------*/
@@ -267,7 +270,44 @@ Storage::Publish ()
           //          eos_static_debug("Path is %s %f\n", fileSystemsVector[i]->GetPath().c_str(), fstLoad.GetDiskRate(fileSystemsVector[i]->GetPath().c_str(),"writeSectors")*512.0/1000000.0);
           success &= fileSystemsVector[i]->SetDouble("stat.disk.readratemb", fstLoad.GetDiskRate(fileSystemsVector[i]->GetPath().c_str(), "readSectors")*512.0 / 1000000.0);
           success &= fileSystemsVector[i]->SetDouble("stat.disk.writeratemb", fstLoad.GetDiskRate(fileSystemsVector[i]->GetPath().c_str(), "writeSectors")*512.0 / 1000000.0);
-          success &= fileSystemsVector[i]->SetDouble("stat.disk.load", fstLoad.GetDiskRate(fileSystemsVector[i]->GetPath().c_str(), "millisIO") / 1000.0);
+          double diskload = fstLoad.GetDiskRate(fileSystemsVector[i]->GetPath().c_str(), "millisIO") / 1000.0;
+          success &= fileSystemsVector[i]->SetDouble("stat.disk.load", diskload);
+
+          {
+            // hand the IO scheduler settings and the disk load to the scheduler
+            // and copy out what happened since the last round
+            static const unsigned defaultweights[IoScheduler::kNClasses] = {8, 2, 1};
+            unsigned weights[IoScheduler::kNClasses];
+            IoScheduler::Stats iostats[IoScheduler::kNClasses];
+            long long slots = fileSystemsVector[i]->GetLongLong("iosched");
+            long long maxload = fileSystemsVector[i]->GetLongLong("iosched.load");
+
+            for (int c = 0; c < IoScheduler::kNClasses; c++)
+            {
+              std::string key = "iosched.";
+              key += IoScheduler::GetClassName(c);
+              long long weight = fileSystemsVector[i]->GetLongLong(key.c_str());
+              weights[c] = (weight > 0) ? (unsigned) weight : defaultweights[c];
+            }
+
+            ioScheduler.Configure(fsid, (slots > 0) ? (unsigned) slots : 0, weights,
+                                  diskload, ((maxload > 0) ? maxload : 50) / 100.0);
+
+            if (ioScheduler.Sample(fsid, iostats))
+            {
+              for (int c = 0; c < IoScheduler::kNClasses; c++)
+              {
+                std::string key = "stat.iosched.";
+                key += IoScheduler::GetClassName(c);
+                success &= fileSystemsVector[i]->SetLongLong((key + ".ops").c_str(), iostats[c].mOps);
+                success &= fileSystemsVector[i]->SetLongLong((key + ".bytes").c_str(), iostats[c].mBytes);
+                success &= fileSystemsVector[i]->SetLongLong((key + ".queued").c_str(), iostats[c].mQueued);
+                success &= fileSystemsVector[i]->SetDouble((key + ".waitms").c_str(), iostats[c].mWaited ? iostats[c].mWaitMs / iostats[c].mWaited : 0);
+                success &= fileSystemsVector[i]->SetDouble((key + ".maxwaitms").c_str(), iostats[c].mMaxWaitMs);
+              }
+            }
+          }
+
           gOFS.OpenFidMutex.Lock();
           success &= fileSystemsVector[i]->SetLongLong("stat.ropen", (long long) gOFS.ROpenFid[fsid].size());
           success &= fileSystemsVector[i]->SetLongLong("stat.wopen", (long long) gOFS.WOpenFid[fsid].size());
@@ -294,6 +334,19 @@ Storage::Publish ()
           success &= fileSystemsVector[i]->SetLongLong("stat.disk.iops", fileSystemsVector[i]->getIOPS());
           success &= fileSystemsVector[i]->SetDouble("stat.disk.bw", fileSystemsVector[i]->getSeqBandwidth()); // in MB
 
+          // copy out the read-ahead counters of the oss
+          eos::fst::ReadAheadStats rastats;
+
+          if (XrdOfsOss && XrdOfsOss->GetReadAheadStats(fsid, rastats))
+          {
+            success &= fileSystemsVector[i]->SetLongLong("stat.readahead.reads", rastats.mReads);
+            success &= fileSystemsVector[i]->SetLongLong("stat.readahead.hits", rastats.mHits);
+            success &= fileSystemsVector[i]->SetDouble("stat.readahead.hitratio", rastats.mReads ? 100.0 * rastats.mHits / rastats.mReads : 0);
+            success &= fileSystemsVector[i]->SetLongLong("stat.readahead.bytes", rastats.mBytes);
+            success &= fileSystemsVector[i]->SetLongLong("stat.readahead.sequential", rastats.mSequential);
+            success &= fileSystemsVector[i]->SetLongLong("stat.readahead.random", rastats.mRandom);
+          }
+
 	  {
             // we have to set something which is not empty to update the value
             if (!r_open_hotfiles.length())
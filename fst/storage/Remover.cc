@@ -24,16 +24,52 @@
 /*----------------------------------------------------------------------------*/
 #include "fst/storage/Storage.hh"
 #include "fst/XrdFstOfs.hh"
-
 /*----------------------------------------------------------------------------*/
+#ifndef __APPLE__
+#include <sys/syscall.h>
+#endif
+/*----------------------------------------------------------------------------*/
+
+// ---------------------------------------------------------------------------
+// - we miss ioprio.h and gettid
+// ---------------------------------------------------------------------------
+
+static int
+remover_ioprio_set (int which, int who, int ioprio)
+{
+#ifdef __APPLE__
+  return 0;
+#else
+  return syscall(SYS_ioprio_set, which, who, ioprio);
+#endif
+}
+
+#define REMOVER_IOPRIO_CLASS_SHIFT (13)
+#define REMOVER_IOPRIO_PRIO_VALUE(class, data) (((class) << REMOVER_IOPRIO_CLASS_SHIFT) | data)
+#define REMOVER_IOPRIO_CLASS_BE (2)
+#define REMOVER_IOPRIO_CLASS_IDLE (3)
+#define REMOVER_IOPRIO_WHO_PROCESS (1)
 
 EOSFSTNAMESPACE_BEGIN
 
+// max. size of the fid list in a bulk drop call (the MGM accepts 16k opaque)
+static const size_t sDropListSize = 12000;
+
+/*----------------------------------------------------------------------------*/
+void
+Storage::AddDeletion (Deletion &deletion)
+{
+  deletionsCond.Lock();
+  deletions.push_back(deletion);
+  deletionsCond.Signal();
+  deletionsCond.UnLock();
+}
+
 /*----------------------------------------------------------------------------*/
 void
 Storage::Remover ()
 {
-  static time_t lastAskedForDeletions = 0;
+  time_t nextAskForDeletions = 0;
 
   std::string nodeconfigqueue = "";
   const char* val = 0;
@@ -47,107 +83,282 @@ Storage::Remover ()
 
   nodeconfigqueue = eos::fst::Config::gConfig.FstNodeConfigQueue.c_str();
 
-  // this thread unlinks stored files
-  while (1)
+  // ---------------------------------------------------------------------------
+  // start the unlink worker pool - by default one worker per filesystem can run
+  // in parallel with up to 16 filesystems served at the same time
+  // ---------------------------------------------------------------------------
+  int nworkers = getenv("EOS_FST_DELETION_THREADS") ?
+    atoi(getenv("EOS_FST_DELETION_THREADS")) : 16;
+  int perfs = getenv("EOS_FST_DELETION_THREADS_PER_FS") ?
+    atoi(getenv("EOS_FST_DELETION_THREADS_PER_FS")) : 1;
+
+  if (nworkers < 1)
+    nworkers = 1;
+
+  if (perfs < 1)
+    perfs = 1;
+
+  deletionsCond.Lock();
+  deletionsPerFs = perfs;
+  deletionsCond.UnLock();
+
+  eos_static_info("starting %d deletion workers with %d workers per filesystem",
+                  nworkers, perfs);
+
+  for (int i = 0; i < nworkers; i++)
   {
-    // since we use vector and erase from the beginning, this is not really a perfect choice, but we don't have any performance issues here
-    deletionsMutex.Lock();
-    while (deletions.size())
-    {
-      eos_static_debug("%u files to delete", deletions.size());
-      Deletion todelete = deletions[0];
-      deletionsMutex.UnLock();
+    pthread_t tid;
 
-      for (unsigned int j = 0; j < todelete.fIdVector.size(); j++)
-      {
-        eos_static_debug("Deleting File Id=%llu on Fs=%u", todelete.fIdVector[j], todelete.fsId);
-        // delete the file
-        XrdOucString hexstring = "";
-        eos::common::FileId::Fid2Hex(todelete.fIdVector[j], hexstring);
-        XrdOucErrInfo error;
-
-        XrdOucString capOpaqueString = "/?mgm.pcmd=drop";
-        XrdOucString OpaqueString = "";
-        OpaqueString += "&mgm.fsid=";
-        OpaqueString += (int) todelete.fsId;
-        OpaqueString += "&mgm.fid=";
-        OpaqueString += hexstring;
-        OpaqueString += "&mgm.localprefix=";
-        OpaqueString += todelete.localPrefix;
-        XrdOucEnv Opaque(OpaqueString.c_str());
-        capOpaqueString += OpaqueString;
-
-        if ((gOFS._rem("/DELETION", error, (const XrdSecEntity*) 0, &Opaque, 0, 0, 0, true) != SFS_OK))
-        {
-          eos_static_warning("unable to remove fid %s fsid %lu localprefix=%s", hexstring.c_str(), todelete.fsId, todelete.localPrefix.c_str());
-        }
-
-        // update the manager
-        int rc = gOFS.CallManager(&error, 0, 0 , capOpaqueString);
-        if (rc)
-        {
-          eos_static_err("unable to drop file id %s fsid %u at manager %s", hexstring.c_str(), todelete.fsId, todelete.managerId.c_str());
-        }
-      }
-      deletionsMutex.Lock();
-      deletions.erase(deletions.begin());
+    if (XrdSysThread::Run(&tid, Storage::StartFsRemoverWorker,
+                          static_cast<void *> (this), 0, "Deletion Worker"))
+    {
+      eos_static_crit("cannot start deletion worker thread");
+      continue;
     }
 
-    deletionsMutex.UnLock();
+    XrdSysMutexHelper tsLock(ThreadSetMutex);
+    ThreadSet.insert(tid);
+  }
+
+  // ---------------------------------------------------------------------------
+  // the MGM schedules all pending deletions of this node in one go, therefore
+  // we ask only when our queue is drained: 30s after a successful request to
+  // give the deletion messages the time to arrive, 5 minutes after an empty one
+  // ---------------------------------------------------------------------------
+  while (1)
+  {
     XrdSysTimer msSleep;
-    msSleep.Wait(100);
+    msSleep.Wait(1000);
+
+    off_t pending = 0;
+    deletionsCond.Lock();
+    pending = deletionsSize() + deletionsInFlightFids;
+    deletionsCond.UnLock();
+
+    if (pending)
+    {
+      eos_static_debug("%lld files to delete", (long long) pending);
+      continue;
+    }
 
     time_t now = time(NULL);
 
-    // ask to schedule deletions every 5 minutes
-    if ((now - lastAskedForDeletions) > 300)
+    if (now < nextAskForDeletions)
+      continue;
+
+    // ---------------------------------------
+    // get some global variables
+    // ---------------------------------------
+    gOFS.ObjectManager.HashMutex.LockRead();
+
+    XrdMqSharedHash* confighash = gOFS.ObjectManager.GetHash(nodeconfigqueue.c_str());
+    std::string manager = confighash ? confighash->Get("manager") : "unknown";
+    eos_static_debug("manager=%s", manager.c_str());
+    gOFS.ObjectManager.HashMutex.UnLockRead();
+    // ---------------------------------------
+
+    eos_static_debug("asking for new deletions");
+    XrdOucString managerQuery = "/?";
+    managerQuery += "mgm.pcmd=schedule2delete";
+    managerQuery += "&mgm.target.nodename=";
+    managerQuery += Config::gConfig.FstQueue;
+    // the log ID to the schedule2delete call
+    managerQuery += "&mgm.logid=";
+    managerQuery += logId;
+
+    XrdOucErrInfo error;
+    XrdOucString response = "";
+    int rc = gOFS.CallManager(&error, "/", 0, managerQuery, &response);
+    nextAskForDeletions = time(NULL) + 300;
+
+    if (rc)
+    {
+      eos_static_err("manager returned errno=%d", rc);
+    }
+    else
     {
-      // ---------------------------------------
-      // get some global variables
-      // ---------------------------------------
-      gOFS.ObjectManager.HashMutex.LockRead();
-
-      XrdMqSharedHash* confighash = gOFS.ObjectManager.GetHash(nodeconfigqueue.c_str());
-      std::string manager = confighash ? confighash->Get("manager") : "unknown";
-      eos_static_debug("manager=%s", manager.c_str());
-      gOFS.ObjectManager.HashMutex.UnLockRead();
-      // ---------------------------------------
-
-      lastAskedForDeletions = now;
-      eos_static_debug("asking for new deletions");
-      XrdOucString managerQuery = "/?";
-      managerQuery += "mgm.pcmd=schedule2delete";
-      managerQuery += "&mgm.target.nodename=";
-      managerQuery += Config::gConfig.FstQueue;
-      // the log ID to the schedule2delete call
-      managerQuery += "&mgm.logid=";
-      managerQuery += logId;
-
-      XrdOucErrInfo error;
-      XrdOucString response = "";
-      int rc = gOFS.CallManager(&error, "/", 0, managerQuery, &response);
-      if (rc)
+      if (response == "submitted")
       {
-        eos_static_err("manager returned errno=%d", rc);
+        eos_static_debug("manager scheduled deletions for us!");
+        nextAskForDeletions = time(NULL) + 30;
       }
       else
       {
-        if (response == "submitted")
-        {
-          eos_static_debug("manager scheduled deletions for us!");
-          // we wait 30 seconds to receive our deletions
-          XrdSysTimer Sleeper;
-          Sleeper.Snooze(30);
-        }
-        else
-        {
-          eos_static_debug("manager returned no deletion to schedule [ENODATA]");
-        }
+        eos_static_debug("manager returned no deletion to schedule [ENODATA]");
       }
     }
   }
 }
 
-EOSFSTNAMESPACE_END
+/*----------------------------------------------------------------------------*/
+void
+Storage::RemoverWorker ()
+{
+  // ---------------------------------------------------------------------------
+  // deletions run with low IO priority unless configured otherwise
+  // EOS_FST_DELETION_IOPRIO=idle|be:<0-7>|none
+  // ---------------------------------------------------------------------------
+  std::string ioprio = getenv("EOS_FST_DELETION_IOPRIO") ?
+    getenv("EOS_FST_DELETION_IOPRIO") : "be:7";
+
+  if (ioprio != "none")
+  {
+#ifndef __APPLE__
+    pid_t tid = (pid_t) syscall(SYS_gettid);
+#else
+    pid_t tid = 0;
+#endif
+    int prio = REMOVER_IOPRIO_PRIO_VALUE(REMOVER_IOPRIO_CLASS_BE, 7);
 
+    if (ioprio == "idle")
+      prio = REMOVER_IOPRIO_PRIO_VALUE(REMOVER_IOPRIO_CLASS_IDLE, 0);
+    else if ((ioprio.find("be:") == 0) && (ioprio.length() == 4) &&
+             (ioprio[3] >= '0') && (ioprio[3] <= '7'))
+      prio = REMOVER_IOPRIO_PRIO_VALUE(REMOVER_IOPRIO_CLASS_BE, ioprio[3] - '0');
+    else
+      eos_static_warning("illegal deletion io priority %s - using be:7",
+                         ioprio.c_str());
 
+    if (remover_ioprio_set(REMOVER_IOPRIO_WHO_PROCESS, tid, prio))
+      eos_static_warning("cannot set io priority %s for deletion worker",
+                         ioprio.c_str());
+  }
+
+  while (1)
+  {
+    std::deque<Deletion>::iterator it;
+    deletionsCond.Lock();
+
+    while (1)
+    {
+      // take the oldest deletion of a filesystem with a free worker slot
+      for (it = deletions.begin(); it != deletions.end(); ++it)
+      {
+        if (!deletionsInFlight.count(it->fsId) ||
+            (deletionsInFlight[it->fsId] < deletionsPerFs))
+          break;
+      }
+
+      if (it != deletions.end())
+        break;
+
+      deletionsCond.Wait(5);
+    }
+
+    Deletion todelete = *it;
+    deletions.erase(it);
+    deletionsInFlight[todelete.fsId]++;
+    deletionsInFlightFids += todelete.fIdVector.size();
+    deletionsCond.UnLock();
+
+    ExecuteDeletion(todelete);
+
+    deletionsCond.Lock();
+
+    if (!--deletionsInFlight[todelete.fsId])
+      deletionsInFlight.erase(todelete.fsId);
+
+    deletionsInFlightFids -= todelete.fIdVector.size();
+    // a worker might wait for a slot on this filesystem
+    deletionsCond.Broadcast();
+    deletionsCond.UnLock();
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Storage::ExecuteDeletion (Deletion &todelete)
+{
+  std::vector<unsigned long long> dropped;
+  size_t droplistsize = 0;
+
+  for (unsigned int j = 0; j < todelete.fIdVector.size(); j++)
+  {
+    eos_static_debug("Deleting File Id=%llu on Fs=%u", todelete.fIdVector[j], todelete.fsId);
+    // delete the file
+    XrdOucString hexstring = "";
+    XrdOucString fstPath = "";
+    eos::common::FileId::Fid2Hex(todelete.fIdVector[j], hexstring);
+    eos::common::FileId::FidPrefix2FullPath(hexstring.c_str(),
+                                            todelete.localPrefix.c_str(),
+                                            fstPath);
+    XrdOucErrInfo error;
+
+    if ((gOFS._rem("/DELETION", error, (const XrdSecEntity*) 0, 0,
+                   fstPath.c_str(), todelete.fIdVector[j], todelete.fsId,
+                   true) != SFS_OK))
+    {
+      eos_static_warning("unable to remove fid %s fsid %lu localprefix=%s", hexstring.c_str(), todelete.fsId, todelete.localPrefix.c_str());
+    }
+
+    dropped.push_back(todelete.fIdVector[j]);
+    droplistsize += hexstring.length() + 1;
+
+    // update the manager in bulk
+    if (droplistsize > sDropListSize)
+    {
+      DropFids(todelete, dropped);
+      dropped.clear();
+      droplistsize = 0;
+    }
+  }
+
+  if (dropped.size())
+    DropFids(todelete, dropped);
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Storage::DropFids (Deletion &todelete, std::vector<unsigned long long> &fids)
+{
+  XrdOucString capOpaqueString = "/?mgm.pcmd=drop";
+  capOpaqueString += "&mgm.fsid=";
+  capOpaqueString += (int) todelete.fsId;
+  capOpaqueString += "&mgm.fids=";
+
+  for (size_t i = 0; i < fids.size(); i++)
+  {
+    XrdOucString hexstring = "";
+    eos::common::FileId::Fid2Hex(fids[i], hexstring);
+
+    if (i)
+      capOpaqueString += ",";
+
+    capOpaqueString += hexstring;
+  }
+
+  XrdOucErrInfo error;
+  int rc = gOFS.CallManager(&error, 0, 0 , capOpaqueString);
+
+  if (!rc)
+    return true;
+
+  // ---------------------------------------------------------------------------
+  // a manager without bulk drop support needs one call per file
+  // ---------------------------------------------------------------------------
+  eos_static_warning("bulk drop of %lu files on fsid %lu failed at manager %s - "
+                     "dropping one by one", (unsigned long) fids.size(), todelete.fsId,
+                     todelete.managerId.c_str());
+  bool ok = true;
+
+  for (size_t i = 0; i < fids.size(); i++)
+  {
+    XrdOucString hexstring = "";
+    eos::common::FileId::Fid2Hex(fids[i], hexstring);
+    XrdOucString dropOpaqueString = "/?mgm.pcmd=drop";
+    dropOpaqueString += "&mgm.fsid=";
+    dropOpaqueString += (int) todelete.fsId;
+    dropOpaqueString += "&mgm.fid=";
+    dropOpaqueString += hexstring;
+
+    if (gOFS.CallManager(&error, 0, 0 , dropOpaqueString))
+    {
+      eos_static_err("unable to drop file id %s fsid %u at manager %s", hexstring.c_str(), todelete.fsId, todelete.managerId.c_str());
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+EOSFSTNAMESPACE_END
@@ -147,6 +147,7 @@ Storage::ScrubFs (const char* path, unsigned long long free, unsigned long long
   eos_static_debug("Running Scrubber on filesystem path=%s id=%u free=%llu blocks=%llu index=%d", path, id, free, blocks, index);
 
   int fserrors = 0;
+  IoScheduler::Queue* ioqueue = ioScheduler.GetQueue(id);
 
   for (int fs = 1; fs <= index; fs++)
   {
@@ -188,7 +189,11 @@ Storage::ScrubFs (const char* path, unsigned long long free, unsigned long long
         eos_static_debug("rshift is %d", rshift);
         for (int i = 0; i < MB; i++)
         {
-          int nwrite = write(ff, scrubPattern[rshift], 1024 * 1024);
+          int nwrite = 0;
+          {
+            IoScheduler::Slot slot(ioScheduler, ioqueue, IoScheduler::kVerify, 1024 * 1024);
+            nwrite = write(ff, scrubPattern[rshift], 1024 * 1024);
+          }
           if (nwrite != (1024 * 1024))
           {
             eos_static_crit("Unable to write all needed bytes for scrubfile %s", scrubfile[k].c_str());
@@ -216,7 +221,11 @@ Storage::ScrubFs (const char* path, unsigned long long free, unsigned long long
 
       for (int i = 0; i < MB; i++)
       {
-        int nread = read(ff, scrubPatternVerify, 1024 * 1024);
+        int nread = 0;
+        {
+          IoScheduler::Slot slot(ioScheduler, ioqueue, IoScheduler::kVerify, 1024 * 1024);
+          nread = read(ff, scrubPatternVerify, 1024 * 1024);
+        }
         if (nread != (1024 * 1024))
         {
           eos_static_crit("Unable to read all needed bytes from scrubfile %s", scrubfile[k].c_str());
@@ -49,6 +49,8 @@ EOSFSTNAMESPACE_BEGIN
 Storage::Storage (const char* metadirectory)
 {
   SetLogId("FstOfsStorage");
+  deletionsInFlightFids = 0;
+  deletionsPerFs = 1;
 
   // make metadir
   XrdOucString mkmetalogdir = "mkdir -p ";
@@ -792,6 +794,15 @@ Storage::StartFsRemover (void * pp)
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void*
+Storage::StartFsRemoverWorker (void * pp)
+{
+  Storage* storage = (Storage*) pp;
+  storage->RemoverWorker();
+  return 0;
+}
+
 /*----------------------------------------------------------------------------*/
 void*
 Storage::StartFsReport (void * pp)
@@ -35,6 +35,7 @@
 #include "fst/Deletion.hh"
 #include "fst/Verify.hh"
 #include "fst/Load.hh"
+#include "fst/IoScheduler.hh"
 #include "mq/XrdMqSharedObject.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysPthread.hh"
@@ -42,6 +43,7 @@
 #include <vector>
 #include <list>
 #include <queue>
+#include <deque>
 #include <map>
 
 /*----------------------------------------------------------------------------*/
@@ -80,6 +82,7 @@ public:
   static void* StartFsScrub (void * pp);
   static void* StartFsTrim (void* pp);
   static void* StartFsRemover (void* pp);
+  static void* StartFsRemoverWorker (void* pp);
   static void* StartFsReport (void* pp);
   static void* StartFsErrorReport (void* pp);
   static void* StartFsVerify (void* pp);
@@ -175,22 +178,33 @@ public:
 
   eos::fst::Verify* runningVerify;
 
-  XrdSysMutex deletionsMutex;
-  std::vector <Deletion> deletions;
+  // ---------------------------------------------------------------------------
+  // deletion related methods
+  // ---------------------------------------------------------------------------
+  XrdSysCondVar deletionsCond; // protects & signals the deletion queue
+  std::deque <Deletion> deletions; // deletions waiting for an unlink worker
+  std::map<unsigned long, int> deletionsInFlight; // busy unlink workers per fsid
+  size_t deletionsInFlightFids; // fids currently processed by unlink workers
+  int deletionsPerFs; // max. parallel unlink workers per filesystem
 
   off_t
   deletionsSize ()
   {
-    // take the lock 'deletionsMutex' outside: 
+    // take the lock 'deletionsCond' outside: 
     off_t totalsize = 0;
 
     for (size_t i = 0; i < deletions.size(); i++)
     {
-      totalsize = deletions[i].fIdVector.size();
+      totalsize += deletions[i].fIdVector.size();
     }
     return totalsize;
   }
 
+  void AddDeletion (Deletion &deletion);
+  void RemoverWorker ();
+  void ExecuteDeletion (Deletion &todelete);
+  bool DropFids (Deletion &todelete, std::vector<unsigned long long> &fids);
+
   XrdSysMutex verificationsMutex;
   std::queue <eos::fst::Verify*> verifications;
 
@@ -211,6 +225,8 @@ public:
 
   Load fstLoad;
 
+  IoScheduler ioScheduler; // shares the disk IO of every filesystem between the IO classes
+
   static Storage* Create (const char* metadirectory);
 
   void BroadcastQuota (XrdOucString &quotareport);
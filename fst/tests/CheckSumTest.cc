@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+//! @file CheckSumTest.cc
+//! @author agent <agent@local>
+//! @brief Unit tests of the block checksums of the FST
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "CheckSumTest.hh"
+#include "fst/checksum/CRC32C.hh"
+#include "fst/checksum/crc32c.h"
+/*----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CheckSumTest);
+
+//! block size of the checksum maps used in the tests
+static const size_t kBlockSize = 4096;
+
+//------------------------------------------------------------------------------
+// Get the final crc32c of a single block
+//------------------------------------------------------------------------------
+static uint32_t
+BlockCrc(const char* data, size_t len)
+{
+  return checksum::crc32cFinish(checksum::crc32c(checksum::crc32cInit(),
+                                                 data, len));
+}
+
+//------------------------------------------------------------------------------
+// Fill a buffer with pseudo random data
+//------------------------------------------------------------------------------
+static void
+FillRandom(std::vector<char>& data, unsigned int seed)
+{
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i] = (char) rand_r(&seed);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Check that every full block of the data has the checksum in the map: the
+// data verifies and a corruption of any block is detected
+//------------------------------------------------------------------------------
+static void
+AssertAllBlocksSet(eos::fst::CheckSum& xs, const std::vector<char>& data)
+{
+  CPPUNIT_ASSERT(xs.CheckBlockSum(0, &data[0], data.size()));
+
+  for (size_t off = 0; off + kBlockSize <= data.size(); off += kBlockSize)
+  {
+    std::vector<char> corrupt = data;
+    corrupt[off + kBlockSize / 2] ^= 0x1;
+    CPPUNIT_ASSERT(!xs.CheckBlockSum(0, &corrupt[0], corrupt.size()));
+  }
+}
+
+//------------------------------------------------------------------------------
+// setUp function
+//------------------------------------------------------------------------------
+void
+CheckSumTest::setUp()
+{
+  char dir[] = "/tmp/eos-checksumtest.XXXXXX";
+  CPPUNIT_ASSERT(mkdtemp(dir));
+  mDataPath = std::string(dir) + "/data";
+  mMapPath = mDataPath + ".xsmap";
+}
+
+
+//------------------------------------------------------------------------------
+// tearDown function
+//------------------------------------------------------------------------------
+void
+CheckSumTest::tearDown()
+{
+  std::string dir = mDataPath.substr(0, mDataPath.rfind('/'));
+  unlink(mMapPath.c_str());
+  unlink(mDataPath.c_str());
+  rmdir(dir.c_str());
+}
+
+
+//------------------------------------------------------------------------------
+// crc32cBlocks against crc32c of the single blocks
+//------------------------------------------------------------------------------
+void
+CheckSumTest::Crc32cBlocksTest()
+{
+  size_t blocksizes[] = {1, 7, 512, 4096, 4099, 65536};
+  size_t nblocks[] = {1, 2, 3, 17};
+  checksum::CRC32CBlocksFunctionPtr impls[] = {checksum::crc32cBlocks,
+                                               checksum::crc32cBlocksGeneric};
+
+  for (size_t b = 0; b < sizeof(blocksizes) / sizeof(blocksizes[0]); b++)
+  {
+    for (size_t n = 0; n < sizeof(nblocks) / sizeof(nblocks[0]); n++)
+    {
+      std::vector<char> data(blocksizes[b] * nblocks[n]);
+      FillRandom(data, blocksizes[b] + nblocks[n]);
+
+      for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++)
+      {
+        std::vector<uint32_t> crcs(nblocks[n], 0);
+        impls[i](&data[0], blocksizes[b], nblocks[n], &crcs[0]);
+
+        for (size_t k = 0; k < nblocks[n]; k++)
+        {
+          CPPUNIT_ASSERT_EQUAL(BlockCrc(&data[k * blocksizes[b]], blocksizes[b]),
+                               crcs[k]);
+        }
+      }
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Partial tail block continued by the following writes
+//------------------------------------------------------------------------------
+void
+CheckSumTest::BlockTailTest()
+{
+  std::vector<char> data(3 * kBlockSize);
+  FillRandom(data, 1);
+
+  {
+    // every block is completed by a later write
+    eos::fst::CRC32C xs;
+    CPPUNIT_ASSERT(xs.OpenMap(mMapPath.c_str(), data.size(), kBlockSize, true));
+    CPPUNIT_ASSERT(xs.AddBlockSum(0, &data[0], 6000));
+    CPPUNIT_ASSERT(xs.AddBlockSum(6000, &data[6000], 4000));
+    CPPUNIT_ASSERT(xs.AddBlockSum(10000, &data[10000], data.size() - 10000));
+    AssertAllBlocksSet(xs, data);
+    CPPUNIT_ASSERT(xs.CloseMap());
+    unlink(mMapPath.c_str());
+  }
+
+  {
+    // a write which does not continue the tail leaves the block a hole
+    eos::fst::CRC32C xs;
+    CPPUNIT_ASSERT(xs.OpenMap(mMapPath.c_str(), data.size(), kBlockSize, true));
+    CPPUNIT_ASSERT(xs.AddBlockSum(0, &data[0], 6000));
+    CPPUNIT_ASSERT(xs.AddBlockSum(7000, &data[7000], data.size() - 7000));
+    CPPUNIT_ASSERT(xs.CheckBlockSum(0, &data[0], data.size()));
+    std::vector<char> corrupt = data;
+    corrupt[kBlockSize + 100] ^= 0x1;
+    CPPUNIT_ASSERT(xs.CheckBlockSum(0, &corrupt[0], corrupt.size()));
+    corrupt = data;
+    corrupt[2 * kBlockSize + 100] ^= 0x1;
+    CPPUNIT_ASSERT(!xs.CheckBlockSum(0, &corrupt[0], corrupt.size()));
+    CPPUNIT_ASSERT(xs.CloseMap());
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// AddBlockSumHoles with the last partial block in memory
+//------------------------------------------------------------------------------
+void
+CheckSumTest::BlockSumHolesTest()
+{
+  size_t tail = 1000;
+  std::vector<char> data(2 * kBlockSize + tail);
+  FillRandom(data, 2);
+
+  // the file on disk differs from the data in memory in its last block, the
+  // hole in the middle has to be read from the disk
+  std::vector<char> ondisk = data;
+  memset(&ondisk[2 * kBlockSize], 0, tail);
+  int fd = open(mDataPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT_EQUAL((ssize_t) ondisk.size(),
+                       pwrite(fd, &ondisk[0], ondisk.size(), 0));
+
+  eos::fst::CRC32C xs;
+  CPPUNIT_ASSERT(xs.OpenMap(mMapPath.c_str(), data.size(), kBlockSize, true));
+  CPPUNIT_ASSERT(xs.AddBlockSum(0, &data[0], kBlockSize));
+  CPPUNIT_ASSERT(xs.AddBlockSum(2 * kBlockSize, &data[2 * kBlockSize], tail));
+  CPPUNIT_ASSERT(xs.AddBlockSumHoles(fd));
+  CPPUNIT_ASSERT(xs.GetXSBlocksWrittenHoles() >= 2);
+
+  // the last block is checksummed zero padded like on a read
+  std::vector<char> padded(3 * kBlockSize, 0);
+  memcpy(&padded[0], &data[0], data.size());
+  AssertAllBlocksSet(xs, padded);
+
+  std::vector<char> diskpadded(3 * kBlockSize, 0);
+  memcpy(&diskpadded[0], &ondisk[0], ondisk.size());
+  CPPUNIT_ASSERT(!xs.CheckBlockSum(2 * kBlockSize, &diskpadded[2 * kBlockSize],
+                                   kBlockSize));
+  CPPUNIT_ASSERT(xs.CloseMap());
+  close(fd);
+}
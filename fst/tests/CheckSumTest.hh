@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+//! @file CheckSumTest.hh
+//! @author agent <agent@local>
+//! @brief Unit tests of the block checksums of the FST
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFSTTEST_CHECKSUMTEST_HH__
+#define __EOSFSTTEST_CHECKSUMTEST_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <cppunit/extensions/HelperMacros.h>
+/*----------------------------------------------------------------------------*/
+#include <string>
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+//! Declaration of CheckSumTest class
+//------------------------------------------------------------------------------
+class CheckSumTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(CheckSumTest);
+    CPPUNIT_TEST(Crc32cBlocksTest);
+    CPPUNIT_TEST(BlockTailTest);
+    CPPUNIT_TEST(BlockSumHolesTest);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+
+  //----------------------------------------------------------------------------
+  //! setUp function - creates the data and map files
+  //----------------------------------------------------------------------------
+  void setUp(void);
+
+
+  //----------------------------------------------------------------------------
+  //! tearDown function - removes the data and map files
+  //----------------------------------------------------------------------------
+  void tearDown(void);
+
+ protected:
+
+  //----------------------------------------------------------------------------
+  //! Test that crc32cBlocks gives the crc32c of every single block for the
+  //! block implementation selected and the generic one
+  //----------------------------------------------------------------------------
+  void Crc32cBlocksTest();
+
+
+  //----------------------------------------------------------------------------
+  //! Test that a partial block at the end of a write is completed by the
+  //! following sequential writes and gets its checksum in the map
+  //----------------------------------------------------------------------------
+  void BlockTailTest();
+
+
+  //----------------------------------------------------------------------------
+  //! Test that AddBlockSumHoles reads the holes from the file and takes the
+  //! last partial block from the data kept in memory
+  //----------------------------------------------------------------------------
+  void BlockSumHolesTest();
+
+ private:
+
+  std::string mDataPath; ///< file holding the data
+  std::string mMapPath; ///< block checksum map of the data file
+};
+
+#endif // __EOSFSTTEST_CHECKSUMTEST_HH__
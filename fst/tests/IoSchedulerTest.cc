@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+//! @file IoSchedulerTest.cc
+//! @author agent <agent@local>
+//! @brief Unit tests of the disk IO scheduler of the FST
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "IoSchedulerTest.hh"
+/*----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+CPPUNIT_TEST_SUITE_REGISTRATION(IoSchedulerTest);
+
+using eos::fst::IoScheduler;
+
+//------------------------------------------------------------------------------
+//! IO run by a thread of the tests
+//------------------------------------------------------------------------------
+struct TestIo
+{
+  IoScheduler* mScheduler;
+  IoScheduler::Queue* mQueue;
+  int mClass;
+  size_t mBytes;
+  XrdSysMutex* mMutex; ///< protects mOrder
+  std::string* mOrder; ///< classes in the order they were granted
+};
+
+//------------------------------------------------------------------------------
+// Wait for a slot, note the class and give the slot back
+//------------------------------------------------------------------------------
+static void*
+RunIo (void* arg)
+{
+  TestIo* io = static_cast<TestIo*> (arg);
+  bool scheduled = io->mScheduler->Acquire(io->mQueue, io->mClass, io->mBytes);
+  {
+    XrdSysMutexHelper lock(*io->mMutex);
+    io->mOrder->push_back("utv"[io->mClass]);
+  }
+
+  if (scheduled)
+    io->mScheduler->Release(io->mQueue);
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Queue IOs behind a slot held by a transfer and get the grant order
+//------------------------------------------------------------------------------
+std::string
+IoSchedulerTest::GrantOrder (const unsigned* weights,
+                             const std::string& classes, size_t bytes)
+{
+  const unsigned long fsid = 1;
+  IoScheduler scheduler;
+  IoScheduler::Queue* queue = scheduler.GetQueue(fsid);
+  IoScheduler::Stats stats[IoScheduler::kNClasses];
+  XrdSysMutex mutex;
+  std::string order;
+  std::vector<TestIo> ios(classes.size());
+  std::vector<pthread_t> threads(classes.size());
+
+  // a single slot on a disk which is always loaded
+  scheduler.Configure(fsid, 1, weights, 1.0, 0.0);
+  CPPUNIT_ASSERT(scheduler.Acquire(queue, IoScheduler::kTransfer, bytes));
+
+  for (size_t i = 0; i < classes.size(); i++)
+  {
+    TestIo io = {&scheduler, queue, (classes[i] == 'u') ?
+                 IoScheduler::kInteractive : (classes[i] == 't') ?
+                 IoScheduler::kTransfer : IoScheduler::kVerify,
+                 bytes, &mutex, &order};
+    ios[i] = io;
+    CPPUNIT_ASSERT(!pthread_create(&threads[i], 0, RunIo, &ios[i]));
+
+    // the start times depend on the arrival order, wait until it is queued
+    for (size_t queued = 0; queued <= i;)
+    {
+      usleep(1000);
+      CPPUNIT_ASSERT(scheduler.Sample(fsid, stats));
+      queued = 0;
+
+      for (int c = 0; c < IoScheduler::kNClasses; c++)
+        queued += stats[c].mQueued;
+    }
+  }
+
+  scheduler.Release(queue);
+
+  for (size_t i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], 0);
+
+  return order;
+}
+
+
+//------------------------------------------------------------------------------
+// Without slots every IO passes and is counted
+//------------------------------------------------------------------------------
+void
+IoSchedulerTest::NoSlotsTest()
+{
+  const unsigned long fsid = 1;
+  const unsigned weights[IoScheduler::kNClasses] = {8, 2, 1};
+  IoScheduler scheduler;
+  IoScheduler::Queue* queue = scheduler.GetQueue(fsid);
+  IoScheduler::Stats stats[IoScheduler::kNClasses];
+  scheduler.Configure(fsid, 0, weights, 1.0, 0.0);
+
+  for (int i = 0; i < 100; i++)
+  {
+    IoScheduler::Slot slot(scheduler, queue, IoScheduler::kVerify, 4096);
+  }
+
+  CPPUNIT_ASSERT(!scheduler.Acquire(queue, IoScheduler::kInteractive, 1000));
+  CPPUNIT_ASSERT(scheduler.Sample(fsid, stats));
+  CPPUNIT_ASSERT_EQUAL(100ull, stats[IoScheduler::kVerify].mOps);
+  CPPUNIT_ASSERT_EQUAL(409600ull, stats[IoScheduler::kVerify].mBytes);
+  CPPUNIT_ASSERT_EQUAL(1ull, stats[IoScheduler::kInteractive].mOps);
+  CPPUNIT_ASSERT_EQUAL(1000ull, stats[IoScheduler::kInteractive].mBytes);
+  CPPUNIT_ASSERT_EQUAL(0ull, stats[IoScheduler::kVerify].mWaited);
+
+  // the counters are reset by the sample
+  CPPUNIT_ASSERT(scheduler.Sample(fsid, stats));
+  CPPUNIT_ASSERT_EQUAL(0ull, stats[IoScheduler::kVerify].mOps);
+  CPPUNIT_ASSERT(!scheduler.Sample(fsid + 1, stats));
+}
+
+
+//------------------------------------------------------------------------------
+// Waiting IOs are granted in the order of their virtual start time
+//------------------------------------------------------------------------------
+void
+IoSchedulerTest::OrderTest()
+{
+  const unsigned weights[IoScheduler::kNClasses] = {8, 2, 1};
+
+  // a user IO costs 1/8 of a verify IO: after the first IO of both classes,
+  // seven user IOs start before the second verify IO
+  CPPUNIT_ASSERT_EQUAL(std::string("uvuuuuuuuvvvvvvv"),
+                       GrantOrder(weights, "vvvvvvvvuuuuuuuu", 0));
+  // with equal weights the classes take turns
+  const unsigned equal[IoScheduler::kNClasses] = {1, 1, 1};
+  CPPUNIT_ASSERT_EQUAL(std::string("uvuvuvuv"),
+                       GrantOrder(equal, "uuuuvvvv", 65536));
+}
+
+
+//------------------------------------------------------------------------------
+// Busy classes share the slot in the ratio of their weights
+//------------------------------------------------------------------------------
+void
+IoSchedulerTest::WeightTest()
+{
+  const unsigned weights[IoScheduler::kNClasses] = {8, 2, 1};
+  std::string classes;
+
+  for (int i = 0; i < 33; i++)
+    classes += "utv";
+
+  // all the classes stay busy during the first 33 grants
+  std::string order = GrantOrder(weights, classes, 65536).substr(0, 33);
+  long user = std::count(order.begin(), order.end(), 'u');
+  long transfer = std::count(order.begin(), order.end(), 't');
+  long verify = std::count(order.begin(), order.end(), 'v');
+  CPPUNIT_ASSERT((user >= 23) && (user <= 25));
+  CPPUNIT_ASSERT((transfer >= 5) && (transfer <= 7));
+  CPPUNIT_ASSERT((verify >= 2) && (verify <= 4));
+}
@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+//! @file IoSchedulerTest.hh
+//! @author agent <agent@local>
+//! @brief Unit tests of the disk IO scheduler of the FST
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSFSTTEST_IOSCHEDULERTEST_HH__
+#define __EOSFSTTEST_IOSCHEDULERTEST_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <cppunit/extensions/HelperMacros.h>
+/*----------------------------------------------------------------------------*/
+#include "fst/IoScheduler.hh"
+/*----------------------------------------------------------------------------*/
+#include <string>
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+//! Declaration of IoSchedulerTest class
+//------------------------------------------------------------------------------
+class IoSchedulerTest: public CppUnit::TestCase
+{
+  CPPUNIT_TEST_SUITE(IoSchedulerTest);
+    CPPUNIT_TEST(NoSlotsTest);
+    CPPUNIT_TEST(OrderTest);
+    CPPUNIT_TEST(WeightTest);
+  CPPUNIT_TEST_SUITE_END();
+
+ protected:
+
+  //----------------------------------------------------------------------------
+  //! Test that without slots every IO passes and is counted
+  //----------------------------------------------------------------------------
+  void NoSlotsTest();
+
+
+  //----------------------------------------------------------------------------
+  //! Test that the waiting IOs are granted in the order of their virtual
+  //! start time
+  //----------------------------------------------------------------------------
+  void OrderTest();
+
+
+  //----------------------------------------------------------------------------
+  //! Test that busy classes share the slot in the ratio of their weights
+  //----------------------------------------------------------------------------
+  void WeightTest();
+
+ private:
+
+  //----------------------------------------------------------------------------
+  //! Queue IOs behind a slot held by a transfer, release the slot and get
+  //! the classes of the IOs in the order they were granted
+  //!
+  //! @param weights weight of every class
+  //! @param classes classes of the IOs in the order they arrive
+  //! @param bytes size of every IO
+  //!
+  //! @return one character per granted IO, 'u', 't' or 'v'
+  //----------------------------------------------------------------------------
+  std::string GrantOrder(const unsigned* weights, const std::string& classes,
+                         size_t bytes);
+};
+
+#endif // __EOSFSTTEST_IOSCHEDULERTEST_HH__
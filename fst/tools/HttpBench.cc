@@ -0,0 +1,613 @@
+// ----------------------------------------------------------------------
+// File: HttpBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// HTTP PUT/GET throughput benchmark: every thread uploads its own set of files
+// below the given URL and downloads them again. Requests are sent to the MGM
+// (or any other HTTP endpoint) and redirections to the FSTs are followed,
+// keeping one persistent connection per thread and endpoint.
+//------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+static std::string gUrl;
+static std::string gCgi;
+static size_t gThreads = 8;
+static size_t gFiles = 16;
+static size_t gSize = 16 * 1024 * 1024;
+static bool gPut = true;
+static bool gGet = true;
+static const int sMaxRedirects = 4;
+
+static double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+//------------------------------------------------------------------------------
+// Split http://host[:port]/path[?cgi] into endpoint and request target
+//------------------------------------------------------------------------------
+static bool
+ParseUrl (const std::string& url, std::string& host, std::string& port,
+          std::string& target)
+{
+  if (url.compare(0, 7, "http://"))
+    return false;
+
+  size_t spos = url.find('/', 7);
+  std::string hostport = url.substr(7, (spos == std::string::npos) ?
+                                    std::string::npos : spos - 7);
+  target = (spos == std::string::npos) ? "/" : url.substr(spos);
+  size_t cpos = hostport.rfind(':');
+
+  if (cpos == std::string::npos)
+  {
+    host = hostport;
+    port = "80";
+  }
+  else
+  {
+    host = hostport.substr(0, cpos);
+    port = hostport.substr(cpos + 1);
+  }
+
+  return !host.empty();
+}
+
+//------------------------------------------------------------------------------
+// Persistent client connection
+//------------------------------------------------------------------------------
+class Connection
+{
+public:
+  int mFd;
+  std::string mEndpoint;
+  std::string mBuffer; //< received bytes not yet consumed
+
+  Connection () : mFd(-1) { }
+
+  ~Connection ()
+  {
+    Close();
+  }
+
+  void
+  Close ()
+  {
+    if (mFd >= 0)
+      close(mFd);
+
+    mFd = -1;
+    mBuffer.clear();
+  }
+
+  bool
+  Connect (const std::string& host, const std::string& port)
+  {
+    std::string endpoint = host + ":" + port;
+
+    if ((mFd >= 0) && (endpoint == mEndpoint))
+      return true;
+
+    Close();
+    struct addrinfo hints;
+    struct addrinfo* res = 0;
+    memset(&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res))
+      return false;
+
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+      mFd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+      if (mFd < 0)
+        continue;
+
+      if (!connect(mFd, ai->ai_addr, ai->ai_addrlen))
+        break;
+
+      close(mFd);
+      mFd = -1;
+    }
+
+    freeaddrinfo(res);
+
+    if (mFd < 0)
+      return false;
+
+    int one = 1;
+    setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    mEndpoint = endpoint;
+    return true;
+  }
+
+  bool
+  Send (const char* data, size_t len)
+  {
+    while (len)
+    {
+      ssize_t n = send(mFd, data, len, MSG_NOSIGNAL);
+
+      if (n <= 0)
+      {
+        if ((n < 0) && (errno == EINTR))
+          continue;
+
+        return false;
+      }
+
+      data += n;
+      len -= n;
+    }
+
+    return true;
+  }
+
+  bool
+  Fill ()
+  {
+    char buf[64 * 1024];
+    ssize_t n;
+
+    do
+    {
+      n = recv(mFd, buf, sizeof (buf), 0);
+    }
+    while ((n < 0) && (errno == EINTR));
+
+    if (n <= 0)
+      return false;
+
+    mBuffer.append(buf, n);
+    return true;
+  }
+
+  bool
+  Readable (int timeout_ms)
+  {
+    if (!mBuffer.empty())
+      return true;
+
+    struct pollfd pfd;
+    pfd.fd = mFd;
+    pfd.events = POLLIN;
+    return (poll(&pfd, 1, timeout_ms) > 0);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Response status line and headers needed by the benchmark
+//------------------------------------------------------------------------------
+struct Response
+{
+  int mCode;
+  long long mLength;
+  bool mClose;
+  bool mChunked;
+  std::string mLocation;
+};
+
+static bool
+ReadHeader (Connection& conn, Response& rsp)
+{
+  size_t end;
+
+  while ((end = conn.mBuffer.find("\r\n\r\n")) == std::string::npos)
+  {
+    if (!conn.Fill())
+      return false;
+  }
+
+  std::string header = conn.mBuffer.substr(0, end + 2);
+  conn.mBuffer.erase(0, end + 4);
+  rsp.mCode = 0;
+  rsp.mLength = -1;
+  rsp.mClose = false;
+  rsp.mChunked = false;
+  rsp.mLocation.clear();
+
+  if (sscanf(header.c_str(), "HTTP/%*d.%*d %d", &rsp.mCode) != 1)
+    return false;
+
+  size_t pos = header.find("\r\n");
+
+  while ((pos != std::string::npos) && (pos + 2 < header.length()))
+  {
+    size_t next = header.find("\r\n", pos + 2);
+    std::string line = header.substr(pos + 2, next - pos - 2);
+    size_t colon = line.find(':');
+    pos = next;
+
+    if (colon == std::string::npos)
+      continue;
+
+    std::string key = line.substr(0, colon);
+    std::string value = line.substr(colon + 1);
+
+    while (!value.empty() && (value[0] == ' '))
+      value.erase(0, 1);
+
+    if (!strcasecmp(key.c_str(), "content-length"))
+      rsp.mLength = strtoll(value.c_str(), 0, 10);
+    else if (!strcasecmp(key.c_str(), "location"))
+      rsp.mLocation = value;
+    else if (!strcasecmp(key.c_str(), "connection"))
+      rsp.mClose = !strcasecmp(value.c_str(), "close");
+    else if (!strcasecmp(key.c_str(), "transfer-encoding"))
+      rsp.mChunked = !strcasecmp(value.c_str(), "chunked");
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Consume the response body, returns the number of body bytes or -1
+//------------------------------------------------------------------------------
+static long long
+ReadBody (Connection& conn, Response& rsp)
+{
+  if (rsp.mChunked)
+    return -1;
+
+  if (rsp.mLength < 0)
+  {
+    // body delimited by the connection close
+    long long received = conn.mBuffer.size();
+    conn.mBuffer.clear();
+
+    while (conn.Fill())
+    {
+      received += conn.mBuffer.size();
+      conn.mBuffer.clear();
+    }
+
+    conn.Close();
+    return received;
+  }
+
+  long long left = rsp.mLength;
+
+  while (left)
+  {
+    if (conn.mBuffer.empty() && !conn.Fill())
+      return -1;
+
+    size_t n = ((long long) conn.mBuffer.size() < left) ?
+               conn.mBuffer.size() : (size_t) left;
+    conn.mBuffer.erase(0, n);
+    left -= n;
+  }
+
+  if (rsp.mClose)
+    conn.Close();
+
+  return rsp.mLength;
+}
+
+//------------------------------------------------------------------------------
+// Run one request following redirections, returns the HTTP status or -1
+//------------------------------------------------------------------------------
+static int
+Request (Connection* conns, const char* method, std::string url,
+         const char* body, size_t bodylen, long long& received)
+{
+  received = 0;
+
+  for (int redirect = 0; redirect <= sMaxRedirects; redirect++)
+  {
+    std::string host, port, target;
+
+    if (!ParseUrl(url, host, port, target))
+      return -1;
+
+    // keep one connection to the redirector and one to the data server
+    Connection& conn = conns[redirect ? 1 : 0];
+
+    if (!conn.Connect(host, port))
+      return -1;
+
+    char length[32];
+    snprintf(length, sizeof (length), "%llu", (unsigned long long) bodylen);
+    std::string header = method;
+    header += " ";
+    header += target;
+    header += " HTTP/1.1\r\nHost: ";
+    header += host + ":" + port;
+    header += "\r\nUser-Agent: eos-http-bench\r\n";
+
+    if (body)
+    {
+      header += "Content-Length: ";
+      header += length;
+      header += "\r\nExpect: 100-continue\r\n";
+    }
+
+    header += "\r\n";
+
+    if (!conn.Send(header.c_str(), header.length()))
+    {
+      // the server might have closed an idle persistent connection
+      conn.Close();
+
+      if (!conn.Connect(host, port) || !conn.Send(header.c_str(), header.length()))
+        return -1;
+    }
+
+    Response rsp;
+    bool bodySent = !body;
+
+    if (body)
+    {
+      // a redirector answers before the upload, a data server with 100
+      if (conn.Readable(1000))
+      {
+        if (!ReadHeader(conn, rsp))
+          return -1;
+
+        if (rsp.mCode == 100)
+        {
+          if (!conn.Send(body, bodylen))
+            return -1;
+
+          bodySent = true;
+
+          if (!ReadHeader(conn, rsp))
+            return -1;
+        }
+      }
+      else
+      {
+        if (!conn.Send(body, bodylen) || !ReadHeader(conn, rsp))
+          return -1;
+
+        bodySent = true;
+      }
+    }
+    else if (!ReadHeader(conn, rsp))
+    {
+      return -1;
+    }
+
+    long long nbody = ReadBody(conn, rsp);
+
+    if (nbody < 0)
+    {
+      conn.Close();
+      return -1;
+    }
+
+    if (!bodySent)
+    {
+      // the server still expects the announced body
+      conn.Close();
+    }
+
+    if ((rsp.mCode >= 300) && (rsp.mCode < 400) && !rsp.mLocation.empty())
+    {
+      url = rsp.mLocation;
+      continue;
+    }
+
+    received = nbody;
+    return rsp.mCode;
+  }
+
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+// Per-thread benchmark state
+//------------------------------------------------------------------------------
+struct Worker
+{
+  pthread_t mThread;
+  size_t mIndex;
+  bool mUpload;
+  const char* mData;
+  size_t mOps;
+  size_t mErrors;
+  unsigned long long mBytes;
+  Connection mConns[2];
+};
+
+static std::string
+FileUrl (size_t thread, size_t file)
+{
+  char name[64];
+  snprintf(name, sizeof (name), "bench.%03lu.%05lu", (unsigned long) thread,
+           (unsigned long) file);
+  std::string url = gUrl;
+
+  if (url[url.length() - 1] != '/')
+    url += "/";
+
+  url += name;
+
+  if (!gCgi.empty())
+  {
+    url += "?";
+    url += gCgi;
+  }
+
+  return url;
+}
+
+static void*
+RunWorker (void* arg)
+{
+  Worker* w = static_cast<Worker*> (arg);
+
+  for (size_t i = 0; i < gFiles; i++)
+  {
+    long long received = 0;
+    int code = Request(w->mConns, w->mUpload ? "PUT" : "GET",
+                       FileUrl(w->mIndex, i), w->mUpload ? w->mData : 0,
+                       w->mUpload ? gSize : 0, received);
+
+    if ((code < 200) || (code >= 300) ||
+        (!w->mUpload && (received != (long long) gSize)))
+    {
+      if (!w->mErrors)
+      {
+        fprintf(stderr, "error: %s %s failed with code %d (%lld bytes)\n",
+                w->mUpload ? "PUT" : "GET", FileUrl(w->mIndex, i).c_str(), code,
+                received);
+      }
+
+      w->mErrors++;
+      continue;
+    }
+
+    w->mOps++;
+    w->mBytes += gSize;
+  }
+
+  return 0;
+}
+
+static bool
+RunPhase (bool upload, const char* data)
+{
+  std::vector<Worker> workers(gThreads);
+  double start = Now();
+
+  for (size_t t = 0; t < gThreads; t++)
+  {
+    workers[t].mIndex = t;
+    workers[t].mUpload = upload;
+    workers[t].mData = data;
+    workers[t].mOps = workers[t].mErrors = 0;
+    workers[t].mBytes = 0;
+
+    if (pthread_create(&workers[t].mThread, 0, RunWorker, &workers[t]))
+    {
+      fprintf(stderr, "error: cannot start thread\n");
+      exit(-1);
+    }
+  }
+
+  size_t ops = 0;
+  size_t errors = 0;
+  unsigned long long bytes = 0;
+
+  for (size_t t = 0; t < gThreads; t++)
+  {
+    pthread_join(workers[t].mThread, 0);
+    ops += workers[t].mOps;
+    errors += workers[t].mErrors;
+    bytes += workers[t].mBytes;
+  }
+
+  double elapsed = Now() - start;
+  fprintf(stdout, "%-4s threads=%lu files=%lu size=%lu errors=%lu "
+          "time=%.02fs rate=%.02f MB/s ops=%.01f/s\n",
+          upload ? "PUT" : "GET", (unsigned long) gThreads,
+          (unsigned long) ops, (unsigned long) gSize, (unsigned long) errors,
+          elapsed, bytes / elapsed / 1000000.0, ops / elapsed);
+  return !errors;
+}
+
+static void
+Usage ()
+{
+  fprintf(stderr, "usage: eos-http-bench [-t <threads>] [-n <files-per-thread>] "
+          "[-s <size-bytes>] [-m put|get|putget] [-c <cgi>] http://<host>:<port>/<dir>/\n");
+  fprintf(stderr, "       PUT and/or GET <threads> x <files-per-thread> files "
+          "<dir>/bench.<thread>.<file> following redirections\n");
+  exit(-1);
+}
+
+int
+main (int argc, char* argv[])
+{
+  int c;
+
+  while ((c = getopt(argc, argv, "t:n:s:m:c:h")) != -1)
+  {
+    switch (c)
+    {
+    case 't':
+      gThreads = strtoul(optarg, 0, 10);
+      break;
+    case 'n':
+      gFiles = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      gSize = strtoul(optarg, 0, 10);
+      break;
+    case 'm':
+      gPut = strstr(optarg, "put");
+      gGet = strstr(optarg, "get");
+      break;
+    case 'c':
+      gCgi = optarg;
+      break;
+    default:
+      Usage();
+    }
+  }
+
+  if ((optind != argc - 1) || !gThreads || !gFiles || (!gPut && !gGet))
+    Usage();
+
+  gUrl = argv[optind];
+  std::string host, port, target;
+
+  if (!ParseUrl(gUrl, host, port, target))
+    Usage();
+
+  std::string data(gSize, '\0');
+
+  for (size_t i = 0; i < gSize; i++)
+    data[i] = (char) (i * 2654435761u >> 24);
+
+  bool ok = true;
+
+  if (gPut)
+    ok &= RunPhase(true, data.c_str());
+
+  if (gGet)
+    ok &= RunPhase(false, 0);
+
+  return ok ? 0 : -1;
+}
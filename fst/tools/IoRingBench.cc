@@ -0,0 +1,300 @@
+// ----------------------------------------------------------------------
+// File: IoRingBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Random IO rate of a local disk with synchronous pread/pwrite (queue depth 1)
+// compared to the io_uring queue used by the FST with 'fs config <fsid>
+// iodepth=<n>'. For every depth the given number of requests is kept in
+// flight until all the operations are done. Use -d on a file which does not
+// fit in the page cache (or on a block device) to measure the disk and not
+// the memory.
+//------------------------------------------------------------------------------
+
+#include "fst/io/IoRing.hh"
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+using eos::fst::IoRing;
+
+static size_t gBlockSize = 4096;
+static size_t gOps = 20000;
+static bool gWrite = false;
+static bool gDirect = false;
+static off_t gSize = 0;
+
+static double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static off_t
+RandomOffset ()
+{
+  return (off_t) ((((unsigned long long) random() << 31) | random()) %
+                  (gSize / gBlockSize)) * gBlockSize;
+}
+
+static void
+Report (const char* name, size_t ops, double elapsed)
+{
+  printf("%-12s %10lu ops %10.0f IOPS %10.02f MB/s %8.02f ms\n", name,
+         (unsigned long) ops, ops / elapsed,
+         ops * gBlockSize / elapsed / 1000000.0, elapsed * 1000.0);
+}
+
+//------------------------------------------------------------------------------
+// Synchronous pread/pwrite, one request after the other
+//------------------------------------------------------------------------------
+static bool
+RunSync (int fd, char* buffer)
+{
+  double start = Now();
+
+  for (size_t i = 0; i < gOps; i++)
+  {
+    off_t offset = RandomOffset();
+    ssize_t nbytes = gWrite ? pwrite(fd, buffer, gBlockSize, offset) :
+      pread(fd, buffer, gBlockSize, offset);
+
+    if (nbytes != (ssize_t) gBlockSize)
+    {
+      fprintf(stderr, "error: sync IO at offset %lld failed errno=%d\n",
+              (long long) offset, errno);
+      return false;
+    }
+  }
+
+  Report("sync", gOps, Now() - start);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Keep <depth> requests in flight on an io_uring
+//------------------------------------------------------------------------------
+static bool
+RunRing (int fd, char* buffers, unsigned depth)
+{
+  IoRing* ring = IoRing::Create(depth);
+
+  if (!ring)
+  {
+    fprintf(stderr, "error: failed to create an io_uring with depth %u\n", depth);
+    return false;
+  }
+
+  std::vector<IoRing::Request> requests(depth);
+  std::vector<IoRing::Batch> batches(depth);
+  size_t submitted = 0;
+  size_t done = 0;
+  bool ok = true;
+  double start = Now();
+
+  for (unsigned i = 0; (i < depth) && (submitted < gOps); i++, submitted++)
+  {
+    memset(&requests[i], 0, sizeof(requests[i]));
+    requests[i].fd = fd;
+    requests[i].write = gWrite;
+    requests[i].buffer = buffers + i * gBlockSize;
+    requests[i].length = gBlockSize;
+    requests[i].offset = RandomOffset();
+    ring->Submit(batches[i], &requests[i], 1);
+  }
+
+  // collect the slots round robin and refill them until all ops are done
+  for (unsigned i = 0; done < submitted; i = (i + 1) % depth)
+  {
+    ring->Wait(batches[i]);
+
+    if (requests[i].result != (ssize_t) gBlockSize)
+    {
+      fprintf(stderr, "error: ring IO at offset %lld failed result=%zd\n",
+              (long long) requests[i].offset, requests[i].result);
+      ok = false;
+    }
+
+    done++;
+
+    if (ok && (submitted < gOps))
+    {
+      requests[i].offset = RandomOffset();
+      ring->Submit(batches[i], &requests[i], 1);
+      submitted++;
+    }
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), "ring qd=%u", depth);
+
+  if (ok)
+    Report(name, done, Now() - start);
+
+  delete ring;
+  return ok;
+}
+
+static void
+Usage ()
+{
+  fprintf(stderr, "usage: eos-iodepth-bench [-b <block-size>] [-n <ops>] "
+          "[-q <depth>[,<depth>...]] [-s <file-size>] [-w] [-d] <file|device>\n");
+  fprintf(stderr, "       random reads (or writes with -w) with pread/pwrite "
+          "and with an io_uring of each depth (default 1,4,16,64),\n"
+          "       -d opens with O_DIRECT, -s creates/extends the file "
+          "to <file-size> bytes\n");
+  exit(-1);
+}
+
+int
+main (int argc, char* argv[])
+{
+  int c;
+  std::string depths = "1,4,16,64";
+  off_t create_size = 0;
+
+  while ((c = getopt(argc, argv, "b:n:q:s:wdh")) != -1)
+  {
+    switch (c)
+    {
+    case 'b':
+      gBlockSize = strtoul(optarg, 0, 10);
+      break;
+    case 'n':
+      gOps = strtoul(optarg, 0, 10);
+      break;
+    case 'q':
+      depths = optarg;
+      break;
+    case 's':
+      create_size = strtoll(optarg, 0, 10);
+      break;
+    case 'w':
+      gWrite = true;
+      break;
+    case 'd':
+      gDirect = true;
+      break;
+    default:
+      Usage();
+    }
+  }
+
+  if ((optind != argc - 1) || !gBlockSize || !gOps)
+    Usage();
+
+  int flags = (gWrite || create_size) ? (O_RDWR | O_CREAT) : O_RDONLY;
+
+  if (gDirect)
+    flags |= O_DIRECT;
+
+  int fd = open(argv[optind], flags, 0644);
+
+  if (fd < 0)
+  {
+    fprintf(stderr, "error: failed to open %s errno=%d\n", argv[optind], errno);
+    return -1;
+  }
+
+  struct stat buf;
+
+  if (fstat(fd, &buf))
+  {
+    fprintf(stderr, "error: failed to stat %s errno=%d\n", argv[optind], errno);
+    return -1;
+  }
+
+  gSize = S_ISBLK(buf.st_mode) ? lseek(fd, 0, SEEK_END) : buf.st_size;
+
+  if (create_size > gSize)
+  {
+    if (posix_fallocate(fd, 0, create_size))
+    {
+      fprintf(stderr, "error: failed to allocate %lld bytes\n",
+              (long long) create_size);
+      return -1;
+    }
+
+    gSize = create_size;
+  }
+
+  if (gSize < (off_t) gBlockSize)
+  {
+    fprintf(stderr, "error: %s is smaller than one block, use -s\n",
+            argv[optind]);
+    return -1;
+  }
+
+  std::vector<unsigned> qd;
+
+  for (const char* s = depths.c_str(); *s; )
+  {
+    char* end = 0;
+    unsigned depth = strtoul(s, &end, 10);
+
+    if (!depth || (end == s))
+      Usage();
+
+    qd.push_back(depth);
+    s = (*end == ',') ? end + 1 : end;
+  }
+
+  unsigned maxdepth = 1;
+
+  for (size_t i = 0; i < qd.size(); i++)
+    maxdepth = (qd[i] > maxdepth) ? qd[i] : maxdepth;
+
+  // aligned buffers so that the same runs work with O_DIRECT
+  void* buffers = 0;
+
+  if (posix_memalign(&buffers, 4096, maxdepth * gBlockSize))
+  {
+    fprintf(stderr, "error: failed to allocate the buffers\n");
+    return -1;
+  }
+
+  memset(buffers, 0xaa, maxdepth * gBlockSize);
+  printf("%s : %s %lu-byte blocks over %lld bytes%s\n\n", argv[optind],
+         gWrite ? "random writes of" : "random reads of",
+         (unsigned long) gBlockSize, (long long) gSize,
+         gDirect ? " with O_DIRECT" : "");
+  bool ok = RunSync(fd, (char*) buffers);
+
+  for (size_t i = 0; ok && (i < qd.size()); i++)
+    ok = RunRing(fd, (char*) buffers, qd[i]);
+
+  free(buffers);
+  close(fd);
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,389 @@
+// ----------------------------------------------------------------------
+// File: IoSchedulerBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Latency of small random user reads on a disk while a drain copies files on
+// the same disk, without and with the IO scheduler of the FST ('fs config
+// <fsid> iosched=<slots>'). The drain streams read large blocks sequentially
+// from the test file and write them to <file>.drain like the drain jobs do
+// with the replicas of a filesystem. Three runs are made: user reads alone,
+// user reads during the drain, user reads during the drain with the
+// scheduler. Use -d on a file which does not fit in the page cache to measure
+// the disk and not the memory.
+//------------------------------------------------------------------------------
+
+#include "fst/IoScheduler.hh"
+#include "fst/Load.hh"
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+using eos::fst::IoScheduler;
+
+static const unsigned long sFsid = 1;
+static size_t gUserBlock = 16384;
+static size_t gDrainBlock = 4 * 1024 * 1024;
+static size_t gUserReads = 2000;
+static unsigned gStreams = 4;
+static unsigned gSlots = 1;
+static unsigned gWeights[IoScheduler::kNClasses] = {8, 2, 1};
+static unsigned gMaxLoad = 0;
+static bool gDirect = false;
+static off_t gSize = 0;
+static int gFd = -1;
+static int gDrainFd = -1;
+static std::string gPath;
+
+static IoScheduler gScheduler;
+static IoScheduler::Queue* gQueue = gScheduler.GetQueue(sFsid);
+static eos::fst::Load gLoad(1);
+static volatile bool gRunning = false;
+static unsigned gActiveSlots = 0;
+static double gLastLoad = 0;
+static XrdSysMutex gDrainMutex;
+static unsigned long long gDrainBytes = 0;
+
+static double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Feed the scheduler with the disk load once per second like the publisher
+// of the FST does
+//------------------------------------------------------------------------------
+static void*
+ConfigureThread (void* arg)
+{
+  while (gRunning)
+  {
+    gLastLoad = gLoad.GetDiskRate(gPath.c_str(), "millisIO") / 1000.0;
+    gScheduler.Configure(sFsid, gActiveSlots, gWeights, gLastLoad,
+                         gMaxLoad / 100.0);
+
+    for (int i = 0; (i < 10) && gRunning; i++)
+      usleep(100000);
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// One drain stream copying its part of the file block by block
+//------------------------------------------------------------------------------
+static void*
+DrainThread (void* arg)
+{
+  unsigned stream = (unsigned) (unsigned long) arg;
+  off_t part = (gSize / gStreams) / gDrainBlock * gDrainBlock;
+  off_t start = stream * part;
+  off_t offset = start;
+  void* buffer = 0;
+
+  if (!part || posix_memalign(&buffer, 4096, gDrainBlock))
+    return 0;
+
+  while (gRunning)
+  {
+    if (offset + (off_t) gDrainBlock > start + part)
+      offset = start;
+
+    ssize_t nread = 0;
+    {
+      IoScheduler::Slot slot(gScheduler, gQueue, IoScheduler::kTransfer,
+                             gDrainBlock);
+      nread = pread(gFd, buffer, gDrainBlock, offset);
+    }
+
+    if (nread > 0)
+    {
+      IoScheduler::Slot slot(gScheduler, gQueue, IoScheduler::kTransfer, nread);
+
+      if (pwrite(gDrainFd, buffer, nread, offset) != nread)
+      {
+        fprintf(stderr, "error: drain write at offset %lld failed errno=%d\n",
+                (long long) offset, errno);
+        break;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "error: drain read at offset %lld failed errno=%d\n",
+              (long long) offset, errno);
+      break;
+    }
+
+    offset += nread;
+    XrdSysMutexHelper lock(gDrainMutex);
+    gDrainBytes += nread;
+  }
+
+  free(buffer);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Random user reads with or without drain streams running in parallel
+//------------------------------------------------------------------------------
+static bool
+Run (const char* name, unsigned streams, unsigned slots)
+{
+  void* buffer = 0;
+
+  if (posix_memalign(&buffer, 4096, gUserBlock))
+    return false;
+
+  gActiveSlots = slots;
+  gDrainBytes = 0;
+  gRunning = true;
+  gScheduler.Configure(sFsid, gActiveSlots, gWeights, gLastLoad,
+                       gMaxLoad / 100.0);
+  pthread_t configure;
+  std::vector<pthread_t> drains(streams);
+  pthread_create(&configure, 0, ConfigureThread, 0);
+
+  for (unsigned i = 0; i < streams; i++)
+    pthread_create(&drains[i], 0, DrainThread, (void*) (unsigned long) i);
+
+  // let the drain streams fill the disk queue
+  if (streams)
+    sleep(1);
+
+  std::vector<double> latency;
+  bool ok = true;
+  double start = Now();
+  unsigned long long drainbytes = 0;
+  {
+    XrdSysMutexHelper lock(gDrainMutex);
+    drainbytes = gDrainBytes;
+  }
+
+  for (size_t i = 0; i < gUserReads; i++)
+  {
+    off_t offset = (off_t) ((((unsigned long long) random() << 31) | random()) %
+                            (gSize / gUserBlock)) * gUserBlock;
+    double t0 = Now();
+    ssize_t nread = 0;
+    {
+      IoScheduler::Slot slot(gScheduler, gQueue, IoScheduler::kInteractive,
+                             gUserBlock);
+      nread = pread(gFd, buffer, gUserBlock, offset);
+    }
+    latency.push_back(Now() - t0);
+
+    if (nread != (ssize_t) gUserBlock)
+    {
+      fprintf(stderr, "error: user read at offset %lld failed errno=%d\n",
+              (long long) offset, errno);
+      ok = false;
+      break;
+    }
+  }
+
+  double elapsed = Now() - start;
+  {
+    XrdSysMutexHelper lock(gDrainMutex);
+    drainbytes = gDrainBytes - drainbytes;
+  }
+  gRunning = false;
+
+  for (unsigned i = 0; i < streams; i++)
+    pthread_join(drains[i], 0);
+
+  pthread_join(configure, 0);
+  free(buffer);
+
+  if (!ok)
+    return false;
+
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+
+  for (size_t i = 0; i < latency.size(); i++)
+    sum += latency[i];
+
+  IoScheduler::Stats stats[IoScheduler::kNClasses];
+  gScheduler.Sample(sFsid, stats);
+  printf("%-16s avg %7.02f p50 %7.02f p90 %7.02f p99 %7.02f p99.9 %7.02f "
+         "max %7.02f ms | %7.0f reads/s | drain %7.02f MB/s | user waited "
+         "%llu/%llu\n", name, sum * 1000.0 / latency.size(),
+         latency[latency.size() / 2] * 1000.0,
+         latency[latency.size() * 9 / 10] * 1000.0,
+         latency[latency.size() * 99 / 100] * 1000.0,
+         latency[latency.size() * 999 / 1000] * 1000.0,
+         latency.back() * 1000.0, latency.size() / elapsed,
+         drainbytes / elapsed / 1000000.0,
+         stats[IoScheduler::kInteractive].mWaited,
+         stats[IoScheduler::kInteractive].mOps);
+  return true;
+}
+
+static void
+Usage ()
+{
+  fprintf(stderr, "usage: eos-iosched-bench [-b <user-block>] [-B <drain-block>] "
+          "[-n <user-reads>] [-t <drain-streams>] [-q <slots>]\n"
+          "                         [-w <user>,<transfer>] [-L <load-%%>] "
+          "[-s <file-size>] [-d] <file>\n");
+  fprintf(stderr, "       random user reads alone, during a drain and during a "
+          "drain with the IO scheduler,\n"
+          "       -q and -w are the 'iosched' and 'iosched.user/transfer' "
+          "settings (default 1 and 8,2),\n"
+          "       -L enforces the slots only above the given disk load like "
+          "'iosched.load' (default 0 = always),\n"
+          "       -d opens with O_DIRECT, -s creates/extends the file to "
+          "<file-size> bytes\n");
+  exit(-1);
+}
+
+int
+main (int argc, char* argv[])
+{
+  int c;
+  off_t create_size = 0;
+
+  while ((c = getopt(argc, argv, "b:B:n:t:q:w:L:s:dh")) != -1)
+  {
+    switch (c)
+    {
+    case 'b':
+      gUserBlock = strtoul(optarg, 0, 10);
+      break;
+    case 'B':
+      gDrainBlock = strtoul(optarg, 0, 10);
+      break;
+    case 'n':
+      gUserReads = strtoul(optarg, 0, 10);
+      break;
+    case 't':
+      gStreams = strtoul(optarg, 0, 10);
+      break;
+    case 'q':
+      gSlots = strtoul(optarg, 0, 10);
+      break;
+    case 'w':
+      if (sscanf(optarg, "%u,%u", &gWeights[IoScheduler::kInteractive],
+                 &gWeights[IoScheduler::kTransfer]) != 2)
+        Usage();
+      break;
+    case 'L':
+      gMaxLoad = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      create_size = strtoll(optarg, 0, 10);
+      break;
+    case 'd':
+      gDirect = true;
+      break;
+    default:
+      Usage();
+    }
+  }
+
+  if ((optind != argc - 1) || !gUserBlock || !gDrainBlock || !gUserReads ||
+      !gStreams || !gSlots)
+    Usage();
+
+  gPath = argv[optind];
+  int flags = O_RDWR | O_CREAT | (gDirect ? O_DIRECT : 0);
+  gFd = open(gPath.c_str(), flags, 0644);
+  gDrainFd = open((gPath + ".drain").c_str(), flags, 0644);
+
+  if ((gFd < 0) || (gDrainFd < 0))
+  {
+    fprintf(stderr, "error: failed to open %s errno=%d\n", gPath.c_str(), errno);
+    return -1;
+  }
+
+  struct stat buf;
+
+  if (fstat(gFd, &buf))
+  {
+    fprintf(stderr, "error: failed to stat %s errno=%d\n", gPath.c_str(), errno);
+    return -1;
+  }
+
+  gSize = buf.st_size;
+
+  if (create_size > gSize)
+  {
+    // real data, an unwritten extent would not be read from the disk
+    void* block = 0;
+
+    if (posix_memalign(&block, 4096, gDrainBlock))
+      return -1;
+
+    memset(block, 0xaa, gDrainBlock);
+
+    for (off_t offset = gSize / gDrainBlock * gDrainBlock; offset < create_size;
+         offset += gDrainBlock)
+    {
+      if (pwrite(gFd, block, gDrainBlock, offset) != (ssize_t) gDrainBlock)
+      {
+        fprintf(stderr, "error: failed to write %lld bytes\n",
+                (long long) create_size);
+        return -1;
+      }
+    }
+
+    free(block);
+    fsync(gFd);
+    gSize = create_size;
+  }
+
+  if (gSize < (off_t) (gStreams * gDrainBlock))
+  {
+    fprintf(stderr, "error: %s is smaller than one drain block per stream, "
+            "use -s\n", gPath.c_str());
+    return -1;
+  }
+
+  gLoad.Monitor();
+  printf("%s : %lu-byte user reads, %u drain streams of %lu-byte blocks over "
+         "%lld bytes%s\n", gPath.c_str(), (unsigned long) gUserBlock, gStreams,
+         (unsigned long) gDrainBlock, (long long) gSize,
+         gDirect ? " with O_DIRECT" : "");
+  printf("scheduler : %u slots, weights user=%u transfer=%u, enforced above "
+         "%u%% disk load\n\n", gSlots, gWeights[IoScheduler::kInteractive],
+         gWeights[IoScheduler::kTransfer], gMaxLoad);
+  bool ok = Run("idle", 0, 0) && Run("drain", gStreams, 0) &&
+    Run("drain+iosched", gStreams, gSlots);
+  close(gDrainFd);
+  close(gFd);
+  unlink((gPath + ".drain").c_str());
+  return ok ? 0 : -1;
+}
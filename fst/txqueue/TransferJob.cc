@@ -31,6 +31,8 @@
 #include "fst/txqueue/TransferJob.hh"
 #include "fst/Config.hh"
 #include "fst/XrdFstOfs.hh"
+#include "fst/io/FileIoPlugin.hh"
+#include "fst/io/AsyncMetaHandler.hh"
 #include "mgm/txengine/TransferEngine.hh"
 /* ------------------------------------------------------------------------- */
 #include <fstream>
@@ -41,6 +43,8 @@
 #include <sys/wait.h>
 #include <uuid/uuid.h>
 #include <math.h>
+#include <sys/time.h>
+#include <algorithm>
 
 /* ------------------------------------------------------------------------- */
 
@@ -213,7 +217,8 @@ TransferJob::GetTargetUrl ()
 
 /* ------------------------------------------------------------------------- */
 int
-TransferJob::SendState (int state, const char* logfile, float progress)
+TransferJob::SendState (int state, const char* logfile, float progress,
+                        const char* loginfo)
 {
   XrdSysMutexHelper lock(SendMutex);
   // assemble the opaque tags to be send to the manager
@@ -238,13 +243,14 @@ TransferJob::SendState (int state, const char* logfile, float progress)
     txinfo += state;
     // log state transitions in the FST log file
     eos_static_info("txid=%lld state=%s", mId, eos::mgm::TransferEngine::GetTransferState(state));
-    if (logfile)
+    if (logfile || loginfo)
     {
       XrdOucString loginfob64 = "";
-      std::string loginfo;
-      eos::common::StringConversion::LoadFileIntoString(logfile, loginfo);
+      std::string loginfos = loginfo ? loginfo : "";
+      if (logfile)
+        eos::common::StringConversion::LoadFileIntoString(logfile, loginfos);
 
-      eos::common::SymKey::Base64Encode((char*) loginfo.c_str(), loginfo.length(), loginfob64);
+      eos::common::SymKey::Base64Encode((char*) loginfos.c_str(), loginfos.length(), loginfob64);
       if (loginfob64.length())
       {
         // append this log
@@ -298,6 +304,241 @@ TransferJob::SendState (int state, const char* logfile, float progress)
   return rc;
 }
 
+/* ------------------------------------------------------------------------- */
+int
+TransferJob::Copy (const char* source, const char* target, std::string& log)
+{
+  // This runs the equivalent of 'XrdSecPROTOCOL=sss eoscp -n -p src dst' in
+  // the scheduler thread executing this job: the target path is created if
+  // needed and both ends authenticate with sss, requested per URL with
+  // xrd.wantprot since the environment is shared by the whole process. The
+  // source is read synchronously while the previous block is written
+  // asynchronously (the write handler keeps its own copy of the data), the
+  // queue bandwidth is re-read for every block so that a change of the
+  // drain/balance rate applies immediately.
+  const size_t blocksize = 4 * 1024 * 1024;
+  uint16_t timeout = (mTimeOut > 65535) ? 65535 : mTimeOut;
+  int rc = 0;
+  int64_t filesize = -1;
+  int64_t offset = 0;
+  bool canceled = false;
+  struct stat st;
+  struct timeval start, now;
+  FileIo* src = FileIoPlugin::GetIoObject(eos::common::LayoutId::kXrdCl);
+  FileIo* dst = FileIoPlugin::GetIoObject(eos::common::LayoutId::kXrdCl);
+  AsyncMetaHandler* whandler = 0;
+  char* buffer = (char*) malloc(blocksize);
+  std::string errmsg = "";
+  gettimeofday(&start, 0);
+  // reference point for the bandwidth regulation
+  struct timeval bwstart = start;
+  int64_t bwoffset = 0;
+  size_t bandwidth = mQueue->GetBandwidth();
+  time_t lastprogress = start.tv_sec;
+  std::string srcurl = source;
+  std::string dsturl = target;
+  srcurl += (srcurl.find('?') == std::string::npos) ? "?" : "&";
+  srcurl += "xrd.wantprot=sss";
+  dsturl += (dsturl.find('?') == std::string::npos) ? "?" : "&";
+  dsturl += "xrd.wantprot=sss";
+
+  if (!src || !dst || !buffer)
+  {
+    errmsg = "unable to allocate the transfer objects";
+    rc = ENOMEM;
+    goto done;
+  }
+
+  if (src->Open(srcurl, SFS_O_RDONLY, 0, "", timeout))
+  {
+    errmsg = "cannot open source: ";
+    errmsg += src->GetLastErrMsg();
+    rc = errno ? errno : EIO;
+    goto done;
+  }
+
+  if (!src->Stat(&st, timeout))
+    filesize = st.st_size;
+
+  if (dst->Open(dsturl, SFS_O_CREAT | SFS_O_RDWR | SFS_O_MKPTH,
+                S_IRUSR | S_IWUSR | S_IRGRP, "", timeout))
+  {
+    errmsg = "cannot open destination: ";
+    errmsg += dst->GetLastErrMsg();
+    rc = errno ? errno : EIO;
+    src->Close(timeout);
+    goto done;
+  }
+
+  whandler = static_cast<AsyncMetaHandler*> (dst->GetAsyncHandler());
+
+  while (1)
+  {
+    int64_t nread = src->Read(offset, buffer, blocksize, timeout);
+
+    if (nread < 0)
+    {
+      errmsg = "read error: ";
+      errmsg += src->GetLastErrMsg();
+      rc = errno ? errno : EIO;
+      break;
+    }
+
+    if (whandler && (whandler->WaitOK() != XrdCl::errNone))
+    {
+      errmsg = "write error: ";
+      errmsg += dst->GetLastErrMsg();
+      rc = EIO;
+      break;
+    }
+
+    if (!nread)
+      break;
+
+    if (dst->WriteAsync(offset, buffer, nread, timeout) != nread)
+    {
+      errmsg = "write error: ";
+      errmsg += dst->GetLastErrMsg();
+      rc = errno ? errno : EIO;
+      break;
+    }
+
+    offset += nread;
+    gettimeofday(&now, 0);
+
+    if ((now.tv_sec - start.tv_sec) > mTimeOut)
+    {
+      errmsg = "transfer timed out";
+      rc = ETIME;
+      break;
+    }
+
+    size_t bw = mQueue->GetBandwidth();
+
+    if (bw != bandwidth)
+    {
+      bandwidth = bw;
+      bwstart = now;
+      bwoffset = offset;
+    }
+    else if (bandwidth)
+    {
+      // sleep until the bytes copied match the bandwidth in MB/s
+      float elapsed = (now.tv_sec - bwstart.tv_sec) * 1000.0 +
+        (now.tv_usec - bwstart.tv_usec) / 1000.0;
+      float expected = (offset - bwoffset) / (float) bandwidth / 1000.0;
+
+      if (elapsed < expected)
+        usleep((int) (1000 * (expected - elapsed)));
+    }
+
+    if (mId && (filesize > 0) && (now.tv_sec != lastprogress))
+    {
+      float progress = 100.0 * offset / filesize;
+      lastprogress = now.tv_sec;
+
+      if (fabs(mLastProgress - progress) > 1)
+      {
+        // send only if there is a significant change, at most at 1 Hz
+        if (SendState(0, 0, progress) == -EIDRM)
+        {
+          eos_static_warning("job %lld has been canceled", mId);
+          canceled = true;
+          errmsg = "transfer canceled";
+          rc = ECANCELED;
+          break;
+        }
+
+        mLastProgress = progress;
+      }
+    }
+  }
+
+  if (rc && whandler)
+    whandler->WaitOK();
+
+  src->Close(timeout);
+
+  if (rc)
+  {
+    // the target FST drops the replica instead of committing it
+    dst->Remove(timeout);
+    dst->Close(timeout);
+  }
+  else if (dst->Close(timeout))
+  {
+    errmsg = "cannot close destination: ";
+    errmsg += dst->GetLastErrMsg();
+    rc = errno ? errno : EIO;
+  }
+
+done:
+  delete src;
+  delete dst;
+  free(buffer);
+  gettimeofday(&now, 0);
+  float realtime = (now.tv_sec - start.tv_sec) +
+    (now.tv_usec - start.tv_usec) / 1000000.0;
+
+  // the summary follows the eoscp output to keep eoscp.log uniform
+  char line[4096];
+  time_t rawtime = start.tv_sec;
+  char stime[64];
+  ctime_r(&rawtime, stime);
+  // strip the opaque information carrying the capabilities
+  std::string ssource = source;
+  std::string starget = target;
+  ssource.erase(std::min(ssource.find('?'), ssource.length()));
+  starget.erase(std::min(starget.find('?'), starget.length()));
+
+  log = "[eoscp] #################################################################\n";
+  snprintf(line, sizeof (line), "[eoscp] # Date                     : ( %lu ) %s",
+           (unsigned long) rawtime, stime);
+  log += line;
+
+  if (canceled)
+  {
+    snprintf(line, sizeof (line), "[eoscp] # Aborted transfer id=%lld\n", mId);
+    log += line;
+  }
+
+  snprintf(line, sizeof (line), "[eoscp] # Source Name [00]         : %s\n"
+           "[eoscp] # Destination Name [00]    : %s\n"
+           "[eoscp] # Data Copied [bytes]      : %lld\n"
+           "[eoscp] # Realtime [s]             : %f\n",
+           ssource.c_str(), starget.c_str(), (long long) offset, realtime);
+  log += line;
+
+  if (realtime > 0)
+  {
+    snprintf(line, sizeof (line), "[eoscp] # Eff.Copy. Rate[MB/s]     : %f\n",
+             offset / realtime / 1000000.0);
+    log += line;
+  }
+
+  if (bandwidth)
+  {
+    snprintf(line, sizeof (line), "[eoscp] # Bandwidth[MB/s]          : %d\n",
+             (int) bandwidth);
+    log += line;
+  }
+
+  if (rc)
+  {
+    snprintf(line, sizeof (line), "error: %s (errno=%d)\n", errmsg.c_str(), rc);
+    log += line;
+    eos_static_err("in-process transfer failed src=%s dst=%s errno=%d msg=\"%s\"",
+                   ssource.c_str(), starget.c_str(), rc, errmsg.c_str());
+  }
+  else
+  {
+    eos_static_info("in-process transfer done src=%s dst=%s bytes=%lld realtime=%.02f",
+                    ssource.c_str(), starget.c_str(), (long long) offset, realtime);
+  }
+
+  return rc;
+}
+
 /* ------------------------------------------------------------------------- */
 void
 TransferJob::DoIt ()
@@ -618,6 +859,45 @@ TransferJob::DoIt ()
     }
   }
 
+  // --------------------------------------------------------------------
+  // XRootD protocol on both ends is copied in-process, external protocols,
+  // user credentials (which have to go into the environment) and RAIN
+  // reconstruction still run eoscp in a transfer script
+  // --------------------------------------------------------------------
+  if (mSource.beginswith("root://") && mDestination.beginswith("root://") &&
+      !isReco && !iskrb5 && !isgsi && !noauth &&
+      !getenv("EOS_FST_TRANSFER_EXTERNAL"))
+  {
+    std::string log;
+
+    if (mId)
+      SendState(eos::mgm::TransferEngine::kRunning);
+
+    int rc = Copy(mSource.c_str(), mDestination.c_str(), log);
+
+    if (mId)
+    {
+      SendState(rc ? eos::mgm::TransferEngine::kFailed :
+                eos::mgm::TransferEngine::kDone, 0, 0.0, log.c_str());
+    }
+
+    eoscpLogMutex.Lock();
+    FILE* fout = fopen("/var/log/eos/fst/eoscp.log", "a+");
+
+    if (fout)
+    {
+      fputs(log.c_str(), fout);
+      fclose(fout);
+    }
+
+    eoscpLogMutex.UnLock();
+    unlink(fileCredential.c_str());
+    // we are over running
+    mQueue->DecRunning();
+    delete this;
+    return;
+  }
+
   // --------------------------------------------------------------------
   // create a transfer/stagein script
   // --------------------------------------------------------------------
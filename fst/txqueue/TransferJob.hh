@@ -71,7 +71,21 @@ public:
 
   XrdSysMutex SendMutex; // protecting the send state function against paralle usage
 
-  int SendState (int state, const char* logfile = 0, float progress = 0.0);
+  int SendState (int state, const char* logfile = 0, float progress = 0.0,
+                 const char* loginfo = 0);
+
+  // ---------------------------------------------------------------------------
+  //! Copy source to target within the FST process using the XRootD FileIo
+  //! plugin, throttled to the current queue bandwidth. The progress of
+  //! scheduled transfers is sent directly to the MGM.
+  //!
+  //! @param source source URL with opaque information
+  //! @param target target URL with opaque information
+  //! @param log summary of the transfer in the eoscp log format
+  //!
+  //! @return 0 if successful, otherwise an errno
+  // ---------------------------------------------------------------------------
+  int Copy (const char* source, const char* target, std::string& log);
 
   static void* StaticProgress (void*);
   void* Progress ();
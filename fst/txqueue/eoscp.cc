@@ -42,6 +42,7 @@
 #include "XrdCl/XrdClFile.hh"
 #include "XrdCl/XrdClDefaultEnv.hh"
 #include "XrdOuc/XrdOucString.hh"
+#include "XrdSys/XrdSysPthread.hh"
 #include "fst/layout/RaidDpLayout.hh"
 #include "fst/layout/ReedSLayout.hh"
 #include "fst/io/AsyncMetaHandler.hh"
@@ -52,6 +53,8 @@
 
 #define PROGRAM "eoscp"
 #define DEFAULTBUFFERSIZE 4*1024*1024
+#define DEFAULTPIPELINEDEPTH 4
+#define MAXPIPELINEDEPTH 64
 #define MAXSRCDST    16
 
 using eos::common::LayoutId;
@@ -115,8 +118,33 @@ uint32_t buffersize = DEFAULTBUFFERSIZE;
 
 double read_wait = 0; ///< statistics about total read time
 double write_wait = 0; ///< statistics about total write time
+double xs_wait = 0; ///< statistics about total checksum time
 char* buffer = NULL; ///< used for doing the reading
-bool first_time = true; ///< first time prefetch two blocks
+
+//..............................................................................
+// Copy pipeline: the source is read into a ring of blocks by the read stage
+// (with several async requests in flight for xroot sources) while the main
+// thread writes the blocks to all destinations and the checksum stage adds
+// them to the checksum. A block is reused once both consumers are done.
+//..............................................................................
+struct PipeBlock
+{
+  char* buffer; ///< data of the block
+  uint32_t length; ///< requested length
+  int64_t nread; ///< bytes read, -1 on error
+  bool pending; ///< an async read is in flight for this block
+};
+
+int pipelinedepth = DEFAULTPIPELINEDEPTH; ///< number of blocks in the ring
+std::vector<PipeBlock> pipeBlocks; ///< ring of blocks
+XrdSysCondVar pipeCond(0); ///< protects and signals all the pipe* variables
+long long pipeRead = 0; ///< blocks handed over by the read stage
+long long pipeWritten = 0; ///< blocks consumed by the write stage
+long long pipeSummed = 0; ///< blocks consumed by the checksum stage
+long long pipeEnd = -1; ///< number of blocks of the file, -1 while unknown
+bool pipeError = false; ///< the read stage failed
+int pipePending = 0; ///< async reads in flight
+struct timespec pipeReadStart; ///< since when async reads are in flight
 
 //..............................................................................
 // RAID related variables
@@ -165,7 +193,7 @@ char *destination[MAXSRCDST];
 void
 usage ()
 {
-  fprintf(stderr, "Usage: %s [-5] [-0] [-X <type>] [-t <mb/s>] [-h] [-v] [-V] [-d] [-l] [-b <size>] [-T <size>] [-Y] [-n] [-s] [-u <id>] [-g <id>] [-S <#>] [-D <#>] [-O <filename>] [-N <name>]<src1> [src2...] <dst1> [dst2...]\n", PROGRAM);
+  fprintf(stderr, "Usage: %s [-5] [-0] [-X <type>] [-t <mb/s>] [-h] [-v] [-V] [-d] [-l] [-b <size>] [-B <depth>] [-T <size>] [-Y] [-n] [-s] [-u <id>] [-g <id>] [-S <#>] [-D <#>] [-O <filename>] [-N <name>]<src1> [src2...] <dst1> [dst2...]\n", PROGRAM);
   fprintf(stderr, "       -h           : help\n");
   fprintf(stderr, "       -d           : debug mode\n");
   fprintf(stderr, "       -v           : verbose mode\n");
@@ -173,6 +201,7 @@ usage ()
   fprintf(stderr, "       -l           : try to force the destination to the local disk server [not supported]\n");
   fprintf(stderr, "       -a           : append to the file rather than truncate an existing file\n");
   fprintf(stderr, "       -b <size>    : use <size> as buffer size for copy operations\n");
+  fprintf(stderr, "       -B <depth>   : keep <depth> buffers in flight between reading, writing and checksumming (default %d)\n", DEFAULTPIPELINEDEPTH);
   fprintf(stderr, "       -T <size>    : use <size> as target size for copies from STDIN\n");
   fprintf(stderr, "       -m <mode>    : set the mode for the destination file\n");
   fprintf(stderr, "       -n           : hide progress bar\n");
@@ -361,6 +390,23 @@ print_summary (VectLocationType& src,
       COUT(("[eoscp] # Bandwidth[MB/s]          : %d\n", (int) bandwidth));
     }
 
+    COUT(("[eoscp] # Pipeline Depth           : %d\n", pipelinedepth));
+
+    if (read_wait > 0)
+    {
+      COUT(("[eoscp] # Read Stage Rate[MB/s]    : %f\n", bytesread / read_wait / 1000.0));
+    }
+
+    if (write_wait > 0)
+    {
+      COUT(("[eoscp] # Write Stage Rate[MB/s]   : %f\n", bytesread / write_wait / 1000.0));
+    }
+
+    if (computeXS && (xs_wait > 0))
+    {
+      COUT(("[eoscp] # Checksum Stage Rate[MB/s]: %f\n", bytesread / xs_wait / 1000.0));
+    }
+
     if (computeXS)
     {
       COUT(("[eoscp] # Checksum Type %s        : ", xsString.c_str()));
@@ -398,6 +444,23 @@ print_summary (VectLocationType& src,
       COUT(("bandwidth=%d ", (int) bandwidth));
     }
 
+    COUT(("pipeline_depth=%d ", pipelinedepth));
+
+    if (read_wait > 0)
+    {
+      COUT(("read_rate=%f ", bytesread / read_wait / 1000.0));
+    }
+
+    if (write_wait > 0)
+    {
+      COUT(("write_rate=%f ", bytesread / write_wait / 1000.0));
+    }
+
+    if (computeXS && (xs_wait > 0))
+    {
+      COUT(("checksum_rate=%f ", bytesread / xs_wait / 1000.0));
+    }
+
     if (computeXS)
     {
       COUT(("checksum_type=%s ", xsString.c_str()));
@@ -443,7 +506,19 @@ print_progbar (unsigned long long bytesread, unsigned long long size)
 
   float abs_time = ((float) ((abs_stop_time.tv_sec - abs_start_time.tv_sec) * 1000 +
                              (abs_stop_time.tv_usec - abs_start_time.tv_usec) / 1000));
-  CERR(("| %.02f %% [%.01f MB/s]\r", 100.0 * bytesread / size, bytesread / abs_time / 1000.0));
+  CERR(("| %.02f %% [%.01f MB/s]", 100.0 * bytesread / size, bytesread / abs_time / 1000.0));
+
+  //............................................................................
+  // Throughput of each pipeline stage while it was busy, the slowest one is
+  // limiting the copy
+  //............................................................................
+  CERR((" [rd %.01f wr %.01f", read_wait ? bytesread / read_wait / 1000.0 : 0,
+        write_wait ? bytesread / write_wait / 1000.0 : 0));
+
+  if (computeXS)
+    CERR((" xs %.01f", xs_wait ? bytesread / xs_wait / 1000.0 : 0));
+
+  CERR((" MB/s]\r"));
 }
 
 
@@ -491,6 +566,282 @@ abort_handler (int)
 
 
 
+//------------------------------------------------------------------------------
+// Elapsed milliseconds between two time specs
+//------------------------------------------------------------------------------
+
+double
+elapsed_ms (struct timespec& start, struct timespec& end)
+{
+  return static_cast<double> ((end.tv_sec - start.tv_sec) * 1000.0 +
+                              (end.tv_nsec - start.tv_nsec) / 1000000.0);
+}
+
+
+//------------------------------------------------------------------------------
+// Handler of an async read of the read stage
+//------------------------------------------------------------------------------
+
+class PipeReadHandler : public XrdCl::ResponseHandler
+{
+public:
+
+  PipeReadHandler (PipeBlock* block) : mBlock (block) { }
+
+  virtual void
+  HandleResponse (XrdCl::XRootDStatus* status, XrdCl::AnyObject* response)
+  {
+    XrdCl::ChunkInfo* chunk = 0;
+    int64_t nread = -1;
+
+    if (status->IsOK() && response)
+    {
+      response->Get(chunk);
+
+      if (chunk)
+        nread = chunk->length;
+    }
+
+    pipeCond.Lock();
+    mBlock->nread = nread;
+    mBlock->pending = false;
+
+    if (!--pipePending)
+    {
+      struct timespec now;
+      eos::common::Timing::GetTimeSpec(now);
+      read_wait += elapsed_ms(pipeReadStart, now);
+    }
+
+    pipeCond.Broadcast();
+    pipeCond.UnLock();
+    delete status;
+    delete response;
+    delete this;
+  }
+
+private:
+  PipeBlock* mBlock;
+};
+
+
+//------------------------------------------------------------------------------
+// Read stage - fills the free blocks of the ring in file order. For xroot
+// sources reads for all free blocks are in flight, the other sources are read
+// synchronously block by block.
+//------------------------------------------------------------------------------
+
+void*
+read_stage (void*)
+{
+  long long issued = 0; // blocks for which the read was started
+  long long delivered = 0; // blocks handed over to the consumers
+  long long reqbytes = 0; // bytes requested so far, used for ranges
+  bool eof = false; // no more reads to start
+  struct timespec start, end;
+
+  pipeCond.Lock();
+
+  while (1)
+  {
+    bool progress = false;
+    // blocks up to this one are not used anymore by any consumer
+    long long limit = (computeXS ? std::min(pipeWritten, pipeSummed) : pipeWritten) +
+      pipelinedepth;
+
+    while (!eof && (issued < limit))
+    {
+      PipeBlock& block = pipeBlocks[issued % pipelinedepth];
+      block.length = buffersize;
+      block.nread = 0;
+
+      //........................................................................
+      // For ranges we have to adjust the last block
+      //........................................................................
+      if ((stopbyte >= 0) && (((stopbyte - startbyte) - reqbytes) < buffersize))
+      {
+        block.length = (stopbyte - startbyte) - reqbytes;
+      }
+
+      issued++;
+      progress = true;
+
+      if (!block.length)
+      {
+        // this block is delivered as end of file
+        eof = true;
+        break;
+      }
+
+      if (src_type[0] == XRD_ACCESS)
+      {
+        PipeReadHandler* handler = new PipeReadHandler(&block);
+        uint64_t offset = offsetXrd;
+        block.pending = true;
+
+        if (!pipePending++)
+        {
+          eos::common::Timing::GetTimeSpec(pipeReadStart);
+        }
+
+        offsetXrd += block.length;
+        reqbytes += block.length;
+        pipeCond.UnLock();
+        XrdCl::XRootDStatus rstatus = src_handler[0].second->Read(offset,
+                                                                  block.length,
+                                                                  block.buffer,
+                                                                  handler);
+        pipeCond.Lock();
+
+        if (!rstatus.IsOK())
+        {
+          delete handler;
+          block.pending = false;
+          block.nread = -1;
+          pipePending--;
+          eof = true;
+        }
+      }
+      else
+      {
+        char* ptr_buffer = block.buffer;
+        uint32_t length = block.length;
+        int nread = -1;
+        pipeCond.UnLock();
+        eos::common::Timing::GetTimeSpec(start);
+
+        switch (src_type[0])
+        {
+        case LOCAL_ACCESS:
+        case CONSOLE_ACCESS:
+          nread = read(src_handler[0].first,
+                       static_cast<void *> (ptr_buffer),
+                       length);
+          break;
+
+        case RAID_ACCESS:
+          nread = redundancyObj->Read(offsetXrd, ptr_buffer, length);
+          offsetXrd += nread;
+          break;
+
+        case XRD_ACCESS:
+          break;
+        }
+
+        eos::common::Timing::GetTimeSpec(end);
+        pipeCond.Lock();
+        read_wait += elapsed_ms(start, end);
+        block.nread = nread;
+
+        if (nread > 0)
+        {
+          reqbytes += nread;
+        }
+        else
+        {
+          eof = true;
+        }
+
+        // hand the block over before reading the next one
+        break;
+      }
+    }
+
+    //..........................................................................
+    // Hand over the completed blocks in file order
+    //..........................................................................
+    while ((pipeEnd < 0) && (delivered < issued) &&
+           !pipeBlocks[delivered % pipelinedepth].pending)
+    {
+      PipeBlock& block = pipeBlocks[delivered % pipelinedepth];
+      delivered++;
+      progress = true;
+
+      if (block.nread < 0)
+      {
+        pipeError = true;
+        pipeEnd = delivered - 1;
+      }
+      else if (block.nread == 0)
+      {
+        pipeEnd = delivered - 1;
+      }
+      else
+      {
+        pipeRead = delivered;
+
+        // a short xroot read is the end of the file
+        if ((src_type[0] == XRD_ACCESS) && (block.nread < block.length))
+          pipeEnd = delivered;
+      }
+
+      if (pipeEnd >= 0)
+      {
+        eof = true;
+      }
+    }
+
+    if (progress)
+    {
+      pipeCond.Broadcast();
+    }
+
+    if ((pipeEnd >= 0) && !pipePending)
+    {
+      // no read into the ring anymore
+      break;
+    }
+
+    if (!progress)
+    {
+      pipeCond.Wait();
+    }
+  }
+
+  pipeCond.UnLock();
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Checksum stage - adds the blocks in file order to the checksum
+//------------------------------------------------------------------------------
+
+void*
+checksum_stage (void*)
+{
+  struct timespec start, end;
+  pipeCond.Lock();
+
+  while (1)
+  {
+    while ((pipeSummed >= pipeRead) && ((pipeEnd < 0) || (pipeSummed < pipeEnd)))
+    {
+      pipeCond.Wait();
+    }
+
+    if ((pipeEnd >= 0) && (pipeSummed >= pipeEnd))
+    {
+      break;
+    }
+
+    PipeBlock& block = pipeBlocks[pipeSummed % pipelinedepth];
+    pipeCond.UnLock();
+    eos::common::Timing::GetTimeSpec(start);
+    xsObj->Add(static_cast<const char*> (block.buffer), block.nread, offsetXS);
+    offsetXS += block.nread;
+    eos::common::Timing::GetTimeSpec(end);
+    pipeCond.Lock();
+    xs_wait += elapsed_ms(start, end);
+    pipeSummed++;
+    pipeCond.Broadcast();
+  }
+
+  pipeCond.UnLock();
+  return 0;
+}
+
+
 //------------------------------------------------------------------------------
 // Main function
 //------------------------------------------------------------------------------
@@ -504,7 +855,7 @@ main (int argc, char* argv[])
   extern char* optarg;
   extern int optind;
 
-  while ((c = getopt(argc, argv, "nshdvlipfce:P:X:b:m:u:g:t:S:D:5ar:N:L:RT:O:V0")) != -1)
+  while ((c = getopt(argc, argv, "nshdvlipfce:P:X:b:B:m:u:g:t:S:D:5ar:N:L:RT:O:V0")) != -1)
   {
     switch (c)
     {
@@ -702,6 +1053,14 @@ main (int argc, char* argv[])
         exit(-1);
       }
       break;
+    case 'B':
+      pipelinedepth = atoi(optarg);
+      if ((pipelinedepth < 1) || (pipelinedepth > MAXPIPELINEDEPTH))
+      {
+        fprintf(stderr, "error: pipeline depth can only be 1 <= depth <= %d\n", MAXPIPELINEDEPTH);
+        exit(-1);
+      }
+      break;
     case 'T':
       targetsize = strtoull(optarg, 0, 10);
       break;
@@ -759,17 +1118,29 @@ main (int argc, char* argv[])
   //............................................................................
   // Allocate the buffer used for copy
   //............................................................................
-  buffer = new char[2 * buffersize];
+  buffer = new char[(size_t) pipelinedepth * buffersize];
 
   if ((!buffer))
   {
-    fprintf(stderr, "error: cannot allocate buffer of size %d\n", 2 * buffersize);
+    fprintf(stderr, "error: cannot allocate buffer of size %llu\n",
+            (unsigned long long) pipelinedepth * buffersize);
     exit(-ENOMEM);
   }
 
   if (debug)
   {
-    fprintf(stderr, "[eoscp]: allocate copy buffer with %d bytes\n", 2 * buffersize);
+    fprintf(stderr, "[eoscp]: allocate copy buffer with %llu bytes\n",
+            (unsigned long long) pipelinedepth * buffersize);
+  }
+
+  pipeBlocks.resize(pipelinedepth);
+
+  for (int i = 0; i < pipelinedepth; i++)
+  {
+    pipeBlocks[i].buffer = buffer + (size_t) i * buffersize;
+    pipeBlocks[i].length = 0;
+    pipeBlocks[i].nread = 0;
+    pipeBlocks[i].pending = false;
   }
 
 
@@ -2009,12 +2380,26 @@ main (int argc, char* argv[])
   }
 
   //............................................................................
-  // Do the actual copy operation
+  // Do the actual copy operation - start the read and checksum stages and
+  // write the blocks to all the destinations in this thread
   //............................................................................
-  char* ptr_buffer = buffer;
   long long totalbytes = 0;
-  double wait_time = 0;
   struct timespec start, end;
+  pthread_t read_tid = 0;
+  pthread_t xs_tid = 0;
+
+  if (XrdSysThread::Run(&read_tid, read_stage, 0, XRDSYSTHREAD_HOLD, "eoscp read stage"))
+  {
+    fprintf(stderr, "error: cannot start the read stage\n");
+    exit(-errno);
+  }
+
+  if (computeXS &&
+      XrdSysThread::Run(&xs_tid, checksum_stage, 0, XRDSYSTHREAD_HOLD, "eoscp checksum stage"))
+  {
+    fprintf(stderr, "error: cannot start the checksum stage\n");
+    exit(-errno);
+  }
 
   stopwritebyte = startwritebyte;
   while (1)
@@ -2056,73 +2441,26 @@ main (int argc, char* argv[])
     }
 
     //..........................................................................
-    // For ranges we have to adjust the last buffersize
+    // Wait for the next block from the read stage
     //..........................................................................
-    if ((stopbyte >= 0) &&
-        (((stopbyte - startbyte) - totalbytes) < buffersize))
-    {
-      buffersize = (stopbyte - startbyte) - totalbytes;
-    }
-
-    int nread = -1;
-
-    switch (src_type[0])
-    {
-    case LOCAL_ACCESS:
-    case CONSOLE_ACCESS:
-      nread = read(src_handler[0].first,
-                   static_cast<void *> (ptr_buffer),
-                   buffersize);
-      break;
-
-    case RAID_ACCESS:
-    {
-      nread = redundancyObj->Read(offsetXrd, ptr_buffer, buffersize);
-      offsetXrd += nread;
-    }
-      break;
-
-    case XRD_ACCESS:
-    {
-      eos::common::Timing::GetTimeSpec(start);
-      uint32_t xnread = 0;
-      status = src_handler[0].second->Read(offsetXrd, buffersize, ptr_buffer, xnread);
-      nread = xnread;
-      if (!status.IsOK())
-      {
-        fprintf(stderr, "Error while doing reading. \n");
-        exit(-1);
-      }
-
-      eos::common::Timing::GetTimeSpec(end);
-      wait_time = static_cast<double> ((end.tv_sec * 1000 + end.tv_nsec / 1000000)-
-                                       (start.tv_sec * 1000 + start.tv_nsec / 1000000));
-      read_wait += wait_time;
-      offsetXrd += nread;
-    }
-      break;
-    }
+    pipeCond.Lock();
 
-    if (nread < 0)
+    while ((pipeWritten >= pipeRead) && ((pipeEnd < 0) || (pipeWritten < pipeEnd)))
     {
-      fprintf(stderr, "error: read failed on file %s - destination file "
-              "is incomplete!\n", src_location[0].second.c_str());
-      exit(-EIO);
+      pipeCond.Wait();
     }
 
-    if (nread == 0)
+    if ((pipeEnd >= 0) && (pipeWritten >= pipeEnd))
     {
-      // end of file
+      pipeCond.UnLock();
       break;
     }
 
-    if (computeXS)
-    {
-      xsObj->Add(static_cast<const char*> (ptr_buffer), nread, offsetXS);
-      offsetXS += nread;
-    }
-
+    char* ptr_buffer = pipeBlocks[pipeWritten % pipelinedepth].buffer;
+    int nread = pipeBlocks[pipeWritten % pipelinedepth].nread;
+    pipeCond.UnLock();
     int nwrite = 0;
+    eos::common::Timing::GetTimeSpec(start);
 
     for (int i = 0; i < ndst; i++)
     {
@@ -2146,14 +2484,9 @@ main (int argc, char* argv[])
 
       case XRD_ACCESS:
       {
-        // Do writes in async mode
-        eos::common::Timing::GetTimeSpec(start);
+        // Do writes in async mode, the handler keeps a copy of the data
         status = dst_handler[i].second->WriteAsync(stopwritebyte, ptr_buffer, nread);
         nwrite = nread;
-        eos::common::Timing::GetTimeSpec(end);
-        wait_time = static_cast<double> ((end.tv_sec * 1000 + end.tv_nsec / 1000000)-
-                                         (start.tv_sec * 1000 + start.tv_nsec / 1000000));
-        write_wait += wait_time;
       }
         break;
       }
@@ -2167,13 +2500,34 @@ main (int argc, char* argv[])
       }
     }
 
+    eos::common::Timing::GetTimeSpec(end);
     totalbytes += nwrite;
     stopwritebyte += nwrite;
+    pipeCond.Lock();
+    write_wait += elapsed_ms(start, end);
+    pipeWritten++;
+    pipeCond.Broadcast();
+    pipeCond.UnLock();
   } // end while(1)
 
+  XrdSysThread::Join(read_tid, NULL);
+
+  if (xs_tid)
+  {
+    XrdSysThread::Join(xs_tid, NULL);
+  }
+
+  if (pipeError)
+  {
+    fprintf(stderr, "error: read failed on file %s - destination file "
+            "is incomplete!\n", src_location[0].second.c_str());
+    exit(-EIO);
+  }
+
   // Wait for all async write requests before moving on
   eos::common::Timing::GetTimeSpec(start);
   eos::fst::AsyncMetaHandler* ptr_handler = 0;
+  double wait_time = 0;
   bool write_error = false;
 
   for (int i = 0; i < ndst; i++)
@@ -2727,12 +2727,14 @@ xrd_flush (int fd)
     fabst->mMutexRW.WriteLock();
     XFC->ForceAllWrites(fabst);
     fabst->mMutexRW.UnLock();
-    eos::common::ConcurrentQueue<error_type> err_queue = fabst->GetErrorQueue();
+    // The error stays queued and is reported again by the next calls - only
+    // the oldest error is looked at, so they are reported in order
+    eos::common::ConcurrentQueue<error_type>& err_queue = fabst->GetErrorQueue();
     error_type error;
 
-    if (err_queue.try_pop(error))
+    if (err_queue.front(error))
     {
-      eos_static_info("Extract error from queue");
+      eos_static_info("Read error from queue");
       retc = error.first;
     }
   }
@@ -3372,12 +3372,14 @@ filesystem::flush (int fd, uid_t uid, gid_t gid, pid_t pid)
  {
    fabst->mMutexRW.WriteLock ();
    XFC->ForceAllWrites (fabst.get(), false);
-   eos::common::ConcurrentQueue<error_type> err_queue = fabst->GetErrorQueue ();
+   // The error stays queued and is reported again by the next calls - only
+   // the oldest error is looked at, so they are reported in order
+   eos::common::ConcurrentQueue<error_type>& err_queue = fabst->GetErrorQueue ();
    error_type error;
 
-   if (err_queue.try_pop (error))
+   if (err_queue.front (error))
    {
-     eos_static_info ("Extract error from queue");
+     eos_static_info ("Read error from queue");
      retc = error.first;
    }
 
@@ -3640,12 +3642,14 @@ filesystem::pwrite (int fildes,
    XFC->SubmitWrite (fab, const_cast<void*> (buf), offset, nbyte);
    ret = nbyte;
 
-   eos::common::ConcurrentQueue<error_type> err_queue = fabst->GetErrorQueue ();
+   // The error stays queued and is reported again by the next calls - only
+   // the oldest error is looked at, so they are reported in order
+   eos::common::ConcurrentQueue<error_type>& err_queue = fabst->GetErrorQueue ();
    error_type error;
 
-   if (err_queue.try_pop (error))
+   if (err_queue.front (error))
    {
-     eos_static_info ("Extract error from queue");
+     eos_static_info ("Read error from queue");
      ret = error.first;
    }
    fabst->mMutexRW.UnLock ();
@@ -26,6 +26,9 @@
 #include "mgm/Access.hh"
 #include "mgm/FsView.hh"
 /*----------------------------------------------------------------------------*/
+#include <sys/time.h>
+#include <sched.h>
+/*----------------------------------------------------------------------------*/
 
 
 EOSMGMNAMESPACE_BEGIN
@@ -79,6 +82,30 @@ std::map<gid_t, std::string> Access::gGroupRedirection;
 //! global rw mutex protecting all static singletons
 eos::common::RWMutex Access::gAccessMutex;
 
+//! empty snapshot returned before the first compilation
+const Access::Rules Access::gNoRules;
+
+//! published snapshot of the compiled rules
+const Access::Rules* volatile Access::gRules = &Access::gNoRules;
+
+//! pin counters of the readers taking a reference, selected by gEpoch
+volatile int Access::gEpoch = 0;
+volatile int Access::gPinned[2] = {0, 0};
+
+//! generation of the rule maps and of the published snapshot
+unsigned long long Access::gGeneration = 1;
+unsigned long long Access::gCompiledGeneration = 0;
+
+//! any rate rule in the published snapshot
+volatile bool Access::gRateRules = false;
+
+//! token buckets of the rate rules
+XrdSysMutex Access::gRateMutex;
+Access::RateBucket Access::gRateBuckets[Access::sRateBuckets];
+
+//! a rate rule allows a burst of 5 seconds of traffic
+const double Access::sRateBurst = 5.0;
+
 /*----------------------------------------------------------------------------*/
 //! constant used in the configuration store
 const char* Access::gUserKey = "BanUsers";
@@ -114,7 +141,7 @@ Access::Reset ()
  */
 /*----------------------------------------------------------------------------*/
 {
-  eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+  Access::RulesWriteLock lock;
   Access::gBannedUsers.clear();
   Access::gBannedGroups.clear();
   Access::gBannedHosts.clear();
@@ -141,7 +168,7 @@ Access::ApplyAccessConfig (bool applyredirectandstall)
 /*----------------------------------------------------------------------------*/
 {
   Access::Reset();
-  eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+  Access::RulesWriteLock lock;
   std::string userval = FsView::gFsView.GetGlobalConfig(gUserKey);
   std::string groupval = FsView::gFsView.GetGlobalConfig(gGroupKey);
   std::string hostval = FsView::gFsView.GetGlobalConfig(gHostKey);
@@ -427,6 +454,520 @@ Access::StoreAccessConfig ()
   return true;
 }
 
+/*----------------------------------------------------------------------------*/
+Access::Rules::Rules () : banned(false), restricted(false), refs(1)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Constructor of an empty rule snapshot
+ */
+/*----------------------------------------------------------------------------*/
+{
+  bannedUsers.set_empty_key((uid_t) - 1);
+  bannedGroups.set_empty_key((gid_t) - 1);
+  bannedHosts.set_empty_key("");
+  allowedUsers.set_empty_key((uid_t) - 1);
+  allowedGroups.set_empty_key((gid_t) - 1);
+  allowedHosts.set_empty_key("");
+  stallByKey.set_empty_key("");
+  redirectByKey.set_empty_key("");
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+ParseRedirect (const std::string& target, Access::Redirect& redirect,
+               const char* tag)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Parse a '<host>[:<port>]' redirection target
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::string delimiter = ":";
+  std::vector<std::string> tokens;
+  eos::common::StringConversion::Tokenize(target, tokens, delimiter);
+  redirect.set = true;
+  redirect.tag = tag;
+  redirect.host = tokens.size() ? tokens[0] : "";
+  redirect.port = (tokens.size() > 1) ? atoi(tokens[1].c_str()) : 0;
+
+  if (!redirect.port)
+    redirect.port = 1094;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+CompileStall (const std::string& key, Access::Stall& stall)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Fill a stall decision from the stall rule 'key'
+ *
+ * A missing rule results in a decision without stall time, exactly like the
+ * previous evaluation of gStallRules[key] in ShouldStall.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::map<std::string, std::string>::const_iterator it;
+  stall.set = true;
+  it = Access::gStallRules.find(key);
+  stall.time = (it != Access::gStallRules.end()) ? atoi(it->second.c_str()) : 0;
+  it = Access::gStallComment.find(key);
+  stall.comment = (it != Access::gStallComment.end()) ? it->second : "";
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t
+RuleHash (const std::string& key)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief 64-bit FNV-1a hash of a rule key
+ */
+/*----------------------------------------------------------------------------*/
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < key.length(); ++i)
+  {
+    hash ^= (unsigned char) key[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::Compile ()
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function compiling the rule maps into a new immutable snapshot
+ * which is published to the request threads by a pointer swap.
+ *
+ * Has to be called with a write lock on gAccessMutex (see RulesWriteLock).
+ * A replaced snapshot is deleted when its last RulesRef goes away.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  Rules* rules = new Rules();
+  std::map<std::string, std::string>::const_iterator it;
+
+  rules->bannedUsers.insert(gBannedUsers.begin(), gBannedUsers.end());
+  rules->bannedGroups.insert(gBannedGroups.begin(), gBannedGroups.end());
+  rules->bannedHosts.insert(gBannedHosts.begin(), gBannedHosts.end());
+  rules->allowedUsers.insert(gAllowedUsers.begin(), gAllowedUsers.end());
+  rules->allowedGroups.insert(gAllowedGroups.begin(), gAllowedGroups.end());
+  rules->allowedHosts.insert(gAllowedHosts.begin(), gAllowedHosts.end());
+  rules->banned = (gBannedUsers.size() || gBannedGroups.size() ||
+                   gBannedHosts.size());
+  rules->restricted = (gAllowedUsers.size() || gAllowedGroups.size() ||
+                       gAllowedHosts.size());
+
+  // ---------------------------------------------------------------------------
+  // stall decision table - same precedence as the former evaluation
+  // ---------------------------------------------------------------------------
+  for (int mode = 0; mode < 3; mode++)
+  {
+    Stall& stall = rules->userStall[mode];
+
+    if (gStallRules.size() && gStallGlobal)
+      CompileStall("*", stall);
+    else if ((mode != 1) && gStallRead)
+      CompileStall("r:*", stall);
+    else if ((mode == 1) && gStallWrite)
+      CompileStall("w:*", stall);
+  }
+
+  // admin/root is only stalled for global stalls
+  if (gStallRules.count("*"))
+    CompileStall("*", rules->rootStall);
+
+  for (it = gStallRules.begin(); it != gStallRules.end(); ++it)
+  {
+    rules->stallByKey[it->first] = atoi(it->second.c_str());
+
+    if (!gStallUserGroup || (it->first.find("rate:") != 0))
+      continue;
+
+    // rate:<user|group>:<name|id|*>:<cmd>
+    RateRule rule;
+    std::string spec;
+
+    if (it->first.find("rate:user:") == 0)
+    {
+      rule.group = false;
+      spec = it->first.substr(10);
+    }
+    else if (it->first.find("rate:group:") == 0)
+    {
+      rule.group = true;
+      spec = it->first.substr(11);
+    }
+    else
+    {
+      continue;
+    }
+
+    size_t pos = spec.rfind(":");
+
+    if ((pos == std::string::npos) || (pos == 0) || (pos + 1 == spec.length()))
+    {
+      eos_static_warning("msg=\"ignoring malformed rate rule\" rule=\"%s\"",
+                         it->first.c_str());
+      continue;
+    }
+
+    std::string id = spec.substr(0, pos);
+    int errc = 0;
+    rule.cmd = spec.substr(pos + 1);
+    rule.wildcard = (id == "*");
+    rule.id = 0;
+
+    if (!rule.wildcard)
+    {
+      rule.id = rule.group ? eos::common::Mapping::GroupNameToGid(id, errc) :
+        eos::common::Mapping::UserNameToUid(id, errc);
+
+      if (errc)
+      {
+        eos_static_warning("msg=\"ignoring rate rule for unknown %s\" rule=\"%s\"",
+                           rule.group ? "group" : "user", it->first.c_str());
+        continue;
+      }
+    }
+
+    rule.hash = RuleHash(it->first);
+    // the former 5s average cut-off tolerated 33% above the configured rate
+    rule.rate = strtod(it->second.c_str(), 0) * 1.33;
+    std::map<std::string, std::string>::const_iterator cit =
+      gStallComment.find(it->first);
+    rule.comment = (cit != gStallComment.end()) ? cit->second : "";
+    rules->rateRules.push_back(rule);
+  }
+
+  for (int mode = 0; mode < 3; mode++)
+  {
+    Redirect& redirect = rules->redirect[mode];
+
+    if ((it = gRedirectionRules.find("*")) != gRedirectionRules.end())
+      ParseRedirect(it->second, redirect, "Redirect");
+    else if ((mode == 1) &&
+             ((it = gRedirectionRules.find("w:*")) != gRedirectionRules.end()))
+      ParseRedirect(it->second, redirect, "RedirectW");
+    else if ((mode == 0) &&
+             ((it = gRedirectionRules.find("r:*")) != gRedirectionRules.end()))
+      ParseRedirect(it->second, redirect, "RedirectR");
+    else if ((mode == 2) &&
+             ((it = gRedirectionRules.find("w:*")) != gRedirectionRules.end()))
+      ParseRedirect(it->second, redirect, "RedirectR-Master");
+  }
+
+  for (it = gRedirectionRules.begin(); it != gRedirectionRules.end(); ++it)
+    ParseRedirect(it->second, rules->redirectByKey[it->first], "Redirect");
+
+  // ---------------------------------------------------------------------------
+  // publish the snapshot - readers which might still load the old pointer are
+  // pinned in one of the two counters, flipping the epoch twice and waiting
+  // for the drained counter guarantees that all of them took their reference
+  // before the publication reference of the old snapshot is dropped
+  // ---------------------------------------------------------------------------
+  const Rules* old = gRules;
+  __sync_synchronize();
+  gRules = rules;
+  gRateRules = !rules->rateRules.empty();
+  gCompiledGeneration = gGeneration;
+
+  for (int flip = 0; flip < 2; flip++)
+  {
+    int epoch = gEpoch;
+    __sync_synchronize();
+    gEpoch = epoch ^ 1;
+    __sync_synchronize();
+
+    // the window of a pinned reader is a pointer load and an increment
+    while (__sync_fetch_and_add(&gPinned[epoch & 1], 0))
+      sched_yield();
+  }
+
+  Release(old);
+}
+
+/*----------------------------------------------------------------------------*/
+const Access::Rules*
+Access::Acquire ()
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function taking a reference to the current snapshot
+ *
+ * Never returns 0 and never locks.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  int epoch = gEpoch & 1;
+  __sync_fetch_and_add(&gPinned[epoch], 1);
+  const Rules* rules = gRules;
+  __sync_fetch_and_add(&rules->refs, 1);
+  __sync_fetch_and_sub(&gPinned[epoch], 1);
+  return rules;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::Release (const Rules* rules)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function dropping a reference to a snapshot
+ *
+ * The last reference of a replaced snapshot deletes it.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (!__sync_sub_and_fetch(&rules->refs, 1) && (rules != &gNoRules))
+    delete rules;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::SetRule (std::map<std::string, std::string>& rules,
+                 const std::string& key, const std::string& value)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function setting a rule - only a new value is a change
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::map<std::string, std::string>::iterator it = rules.find(key);
+
+  if ((it != rules.end()) && (it->second == value))
+    return;
+
+  rules[key] = value;
+  gGeneration++;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::EraseRule (std::map<std::string, std::string>& rules,
+                   const std::string& key)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function removing a rule - only an existing rule is a change
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (rules.erase(key))
+    gGeneration++;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::SetFlag (bool& flag, bool value)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function setting a rule flag - only a new value is a change
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (flag == value)
+    return;
+
+  flag = value;
+  gGeneration++;
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+Access::BucketKey (const RateRule& rule, uint32_t id)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Key of the token bucket of a rate rule and a user/group
+ *
+ * Keys 0 and 1 are reserved (0 marks a free slot of the bucket table).
+ */
+/*----------------------------------------------------------------------------*/
+{
+  uint64_t key = rule.hash ^ ((uint64_t) id * 0x9e3779b97f4a7c15ULL);
+  return (key < 2) ? key + 2 : key;
+}
+
+/*----------------------------------------------------------------------------*/
+static double
+BucketTime ()
+/*----------------------------------------------------------------------------*/
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+/*----------------------------------------------------------------------------*/
+static double
+BucketTokens (double tokens, double last, double rate, double now)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Tokens of a bucket refilled at 'rate' tokens/s up to sRateBurst
+ * seconds of traffic
+ */
+/*----------------------------------------------------------------------------*/
+{
+  double capacity = rate * Access::sRateBurst;
+
+  if (now > last)
+    tokens += (now - last) * rate;
+
+  return (tokens > capacity) ? capacity : tokens;
+}
+
+/*----------------------------------------------------------------------------*/
+Access::RateBucket*
+Access::FindBucket (uint64_t key, double now)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function looking up the token bucket of key
+ *
+ * @param key bucket key (see BucketKey)
+ * @param now current time to create a missing bucket, 0 for a lookup only
+ *
+ * The table uses linear probing and slots are never freed, so a lookup stops
+ * at the first free slot. A new bucket reuses the first idle bucket on its
+ * probe path, i.e. one which is full again, otherwise the first free slot.
+ * Creating buckets needs gRateMutex, lookups need no lock.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  RateBucket* reuse = 0;
+
+  for (size_t i = 0; i < sRateProbes; ++i)
+  {
+    RateBucket* bucket = &gRateBuckets[(key + i) & (sRateBuckets - 1)];
+    uint64_t bkey = bucket->key;
+
+    if (bkey == key)
+      return bucket;
+
+    if (!now)
+    {
+      if (!bkey)
+        return 0;
+
+      continue;
+    }
+
+    if (!bkey || (!reuse &&
+                  (BucketTokens(bucket->tokens, bucket->last, bucket->rate, now) >=
+                   (bucket->rate * sRateBurst))))
+    {
+      if (!reuse)
+        reuse = bucket;
+
+      if (!bkey)
+        break;
+    }
+  }
+
+  return reuse;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Access::ChargeRate (const char* tag, uid_t uid, gid_t gid, unsigned long val)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function charging operations to the rate token buckets
+ *
+ * @param tag MgmStats tag of the operation
+ * @param uid user executing the operation
+ * @param gid group executing the operation
+ * @param val number of operations
+ *
+ * This is a no-op without locking or taking a snapshot reference if no rate
+ * rule is defined.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (!gRateRules)
+    return;
+
+  RulesRef rules;
+
+  if (!rules->rateRules.size())
+    return;
+
+  double now = 0;
+
+  for (size_t i = 0; i < rules->rateRules.size(); ++i)
+  {
+    const RateRule& rule = rules->rateRules[i];
+    uint32_t id = rule.group ? gid : uid;
+
+    if ((!rule.wildcard && (rule.id != id)) || (rule.cmd != tag))
+      continue;
+
+    if (!now)
+      now = BucketTime();
+
+    uint64_t key = BucketKey(rule, id);
+    XrdSysMutexHelper lock(gRateMutex);
+    RateBucket* bucket = FindBucket(key, now);
+
+    if (!bucket)
+    {
+      eos_static_warning("msg=\"rate bucket table full - not accounted\" "
+                         "rule=%s id=%u", rule.cmd.c_str(), id);
+      continue;
+    }
+
+    if (bucket->key != key)
+    {
+      // a new bucket starts full - publish the key after its content
+      bucket->tokens = rule.rate * sRateBurst;
+      bucket->last = now;
+      bucket->rate = rule.rate;
+      __sync_synchronize();
+      bucket->key = key;
+    }
+
+    bucket->tokens = BucketTokens(bucket->tokens, bucket->last, rule.rate,
+                                  now) - val;
+    bucket->last = now;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+const Access::RateRule*
+Access::RateExceeded (const Rules* rules, uid_t uid, gid_t gid)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Static function checking the rate token buckets of a user
+ *
+ * The buckets are only read, a bucket updated concurrently is seen either
+ * before or after the update.
+ *
+ * @return first rate rule whose token bucket is exhausted or 0
+ */
+/*----------------------------------------------------------------------------*/
+{
+  double now = 0;
+
+  for (size_t i = 0; i < rules->rateRules.size(); ++i)
+  {
+    const RateRule& rule = rules->rateRules[i];
+    uint32_t id = rule.group ? gid : uid;
+
+    if (!rule.wildcard && (rule.id != id))
+      continue;
+
+    if (!now)
+      now = BucketTime();
+
+    RateBucket* bucket = FindBucket(BucketKey(rule, id));
+
+    if (bucket && (BucketTokens(bucket->tokens, bucket->last, rule.rate,
+                                now) < 0))
+      return &rule;
+  }
+
+  return 0;
+}
+
 EOSMGMNAMESPACE_END
 
 
@@ -38,12 +38,18 @@
 #include "mgm/Namespace.hh"
 #include "common/RWMutex.hh"
 /*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <google/dense_hash_map>
+#include <google/dense_hash_set>
+/*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
 #include <map>
 #include <vector>
 #include <string>
 #include <set>
+#include <stdint.h>
 
 /*----------------------------------------------------------------------------*/
 
@@ -63,7 +69,13 @@ EOSMGMNAMESPACE_BEGIN
  *'w:*" => everything get's stalled in write operations as above.\n\n
  * The same syntax is used in gRedirectionRules to define r+w, 
  * r or w operation redirection. 
- * The value in this map is defined as '<host>:<port>'
+ * The value in this map is defined as '<host>:<port>'\n\n
+ * All writers modify the maps under an Access::RulesWriteLock. When the lock
+ * is released and the rules have changed the maps are compiled into an
+ * immutable Access::Rules snapshot which is published by a pointer swap. The
+ * request path (ShouldStall, ShouldRedirect, HasStall, HasRedirect,
+ * BOUNCE_NOT_ALLOWED) holds an Access::RulesRef on the snapshot and never
+ * takes gAccessMutex. A replaced snapshot is deleted with its last reference.
  */
 /*----------------------------------------------------------------------------*/
 class Access
@@ -151,6 +163,169 @@ public:
   //! global rw mutex protecting all static set's and maps in Access
   static eos::common::RWMutex gAccessMutex;
 
+  // ---------------------------------------------------------------------------
+  //! Redirection target of a compiled rule
+  // ---------------------------------------------------------------------------
+  struct Redirect
+  {
+    bool set; //< rule is defined
+    std::string host; //< target host
+    int port; //< target port
+    const char* tag; //< MgmStats tag counting the redirection
+
+    Redirect () : set(false), port(0), tag("Redirect") { }
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Stall decision of a compiled rule
+  // ---------------------------------------------------------------------------
+  struct Stall
+  {
+    bool set; //< decision taken by this entry
+    int time; //< stall time in seconds (0 = no stall)
+    std::string comment; //< comment displayed to the client
+
+    Stall () : set(false), time(0) { }
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Pre-parsed 'rate:<user|group>:<id>:<cmd>' stall rule
+  // ---------------------------------------------------------------------------
+  struct RateRule
+  {
+    uint64_t hash; //< hash of the rule key identifying its token buckets
+    bool group; //< group instead of user rule
+    bool wildcard; //< rule applies to every user/group
+    uint32_t id; //< uid/gid if not a wildcard rule
+    std::string cmd; //< MgmStats tag charged against the rule
+    double rate; //< allowed rate in Hz
+    std::string comment; //< stall comment
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Immutable snapshot of all access rules
+  //!
+  //! The stall and redirect decisions are precomputed per access mode
+  //! (0 = read, 1 = write, 2 = read on master - see ACCESSMODE_XX in Macros.hh)
+  // ---------------------------------------------------------------------------
+  struct Rules
+  {
+    google::dense_hash_set<uid_t> bannedUsers;
+    google::dense_hash_set<gid_t> bannedGroups;
+    google::dense_hash_set<std::string> bannedHosts;
+    google::dense_hash_set<uid_t> allowedUsers;
+    google::dense_hash_set<gid_t> allowedGroups;
+    google::dense_hash_set<std::string> allowedHosts;
+    bool banned; //< any ban rule defined
+    bool restricted; //< any allowed rule defined
+
+    Stall userStall[3]; //< stall decision for users (uid>3) per access mode
+    Stall rootStall; //< stall decision for admin/root
+    Redirect redirect[3]; //< redirection decision per access mode
+    std::vector<RateRule> rateRules; //< rate rules evaluated per user
+
+    google::dense_hash_map<std::string, int> stallByKey; //< stall time by rule
+    google::dense_hash_map<std::string, Redirect> redirectByKey; //< redirection by rule
+
+    mutable int refs; //< references of RulesRef holders and of the publication
+
+    Rules ();
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Scoped reference to the current rule snapshot - the snapshot is deleted
+  //! when it has been replaced and the last reference goes away
+  // ---------------------------------------------------------------------------
+  class RulesRef
+  {
+  public:
+
+    RulesRef () : mRules(Acquire()) { }
+
+    ~RulesRef ()
+    {
+      Release(mRules);
+    }
+
+    const Rules*
+    operator-> () const
+    {
+      return mRules;
+    }
+
+    const Rules*
+    get () const
+    {
+      return mRules;
+    }
+
+  private:
+    const Rules* mRules;
+
+    RulesRef (const RulesRef&);
+    RulesRef& operator= (const RulesRef&);
+  };
+
+  // ---------------------------------------------------------------------------
+  //! Scoped write lock for the access rules - publishes a new snapshot of the
+  //! rules when it goes out of scope and the rules have changed
+  //!
+  //! @param changes the holder modifies the maps directly, otherwise only the
+  //!        modifications done by SetRule/EraseRule/SetFlag count as change
+  // ---------------------------------------------------------------------------
+  class RulesWriteLock
+  {
+  public:
+
+    RulesWriteLock (bool changes = true)
+    {
+      gAccessMutex.LockWrite();
+
+      if (changes)
+        gGeneration++;
+    }
+
+    ~RulesWriteLock ()
+    {
+      if (gGeneration != gCompiledGeneration)
+        Compile();
+
+      gAccessMutex.UnLockWrite();
+    }
+  };
+
+  //! seconds of traffic allowed as burst by a rate token bucket
+  static const double sRateBurst;
+
+  // ---------------------------------------------------------------------------
+  //! Set, erase or update a rule and count it as change if the value differs
+  //! - have to be called with a RulesWriteLock
+  // ---------------------------------------------------------------------------
+  static void SetRule (std::map<std::string, std::string>& rules,
+                       const std::string& key, const std::string& value);
+  static void EraseRule (std::map<std::string, std::string>& rules,
+                         const std::string& key);
+  static void SetFlag (bool& flag, bool value);
+
+  // ---------------------------------------------------------------------------
+  //! Compile the rule maps into a new snapshot and publish it - has to be
+  //! called with a write lock on gAccessMutex
+  // ---------------------------------------------------------------------------
+  static void Compile ();
+
+  // ---------------------------------------------------------------------------
+  //! Charge 'val' operations of type 'tag' to the rate token buckets of uid/gid
+  // ---------------------------------------------------------------------------
+  static void ChargeRate (const char* tag, uid_t uid, gid_t gid,
+                          unsigned long val);
+
+  // ---------------------------------------------------------------------------
+  //! Check the rate rules for uid/gid - returns the exhausted rule or 0.
+  //! Never locks, the token buckets are only read.
+  // ---------------------------------------------------------------------------
+  static const RateRule* RateExceeded (const Rules* rules, uid_t uid,
+                                       gid_t gid);
+
   // ---------------------------------------------------------------------------
   // reset/cleear all access rules
   // ---------------------------------------------------------------------------
@@ -167,6 +342,50 @@ public:
   // shared hash/config engine
   // ---------------------------------------------------------------------------
   static bool StoreAccessConfig ();
+
+private:
+
+  // ---------------------------------------------------------------------------
+  //! Token bucket of one rate rule and user/group - the slots of the table
+  //! are written under gRateMutex and read without lock
+  // ---------------------------------------------------------------------------
+  struct RateBucket
+  {
+    volatile uint64_t key; //< bucket key, 0 = free slot
+    volatile double tokens; //< available operations
+    volatile double last; //< time of the last refill
+    volatile double rate; //< refill rate of the rule
+  };
+
+  static const size_t sRateBuckets = 16 * 1024; //< slots of the bucket table (power of 2)
+  static const size_t sRateProbes = 64; //< max. probed slots per lookup
+
+  static const Rules* volatile gRules; //< published snapshot
+  static const Rules gNoRules; //< snapshot used before the first Compile
+  static volatile int gEpoch; //< selects the pin counter of new readers
+  static volatile int gPinned[2]; //< readers between loading gRules and taking a reference
+  static unsigned long long gGeneration; //< bumped by every rule change
+  static unsigned long long gCompiledGeneration; //< generation of the published snapshot
+  static volatile bool gRateRules; //< any rate rule in the published snapshot
+  static XrdSysMutex gRateMutex; //< serializes the bucket updates
+  static RateBucket gRateBuckets[sRateBuckets]; //< token buckets
+
+  // ---------------------------------------------------------------------------
+  //! Take/drop a reference to the current snapshot
+  // ---------------------------------------------------------------------------
+  static const Rules* Acquire ();
+  static void Release (const Rules* rules);
+
+  // ---------------------------------------------------------------------------
+  //! Find the bucket of key - with 'now' set a missing bucket is created in a
+  //! free slot or in the slot of an idle bucket (needs gRateMutex)
+  // ---------------------------------------------------------------------------
+  static RateBucket* FindBucket (uint64_t key, double now = 0);
+
+  // ---------------------------------------------------------------------------
+  //! Key of the token bucket of a rule and user/group
+  // ---------------------------------------------------------------------------
+  static uint64_t BucketKey (const RateRule& rule, uint32_t id);
 };
 
 EOSMGMNAMESPACE_END
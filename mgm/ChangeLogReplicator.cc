@@ -0,0 +1,960 @@
+// ----------------------------------------------------------------------
+// File: ChangeLogReplicator.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/ChangeLogReplicator.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysTimer.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sstream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+const size_t ChangeLogReplicator::sBlockSize = 4 * 1024 * 1024;
+const size_t ChangeLogReplicator::sWindowSize = 32 * 1024 * 1024;
+const time_t ChangeLogReplicator::sPeerTimeout = 10;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ChangeLogReplicator::ChangeLogReplicator():
+  mRole(Role::kNone),
+  mThread(0),
+  mRunning(false),
+  mPort(0),
+  mInotifyFd(-1),
+  mConnected(false),
+  mLastReceived(0),
+  mReconnects(0)
+{
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+ChangeLogReplicator::~ChangeLogReplicator()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+// Configure the replicated streams
+//------------------------------------------------------------------------------
+void
+ChangeLogReplicator::SetupStreams(const std::string& files_log,
+                                  const std::string& dirs_log)
+{
+  mStreams.clear();
+  mStreams.resize(2);
+  mStreams[0].mName = "files";
+  mStreams[0].mPath = files_log;
+  mStreams[1].mName = "directories";
+  mStreams[1].mPath = dirs_log;
+}
+
+//------------------------------------------------------------------------------
+// Start the source thread
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::StartSource(int port, const std::string& files_log,
+                                 const std::string& dirs_log)
+{
+  Stop();
+  XrdSysMutexHelper lock(mMutex);
+  mPort = port;
+  SetupStreams(files_log, dirs_log);
+  mFollowers.clear();
+  mBuffer.resize(sBlockSize);
+  mRunning = true;
+
+  if (XrdSysThread::Run(&mThread, ChangeLogReplicator::StaticSource,
+                        static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                        "ChangeLog Replication Source"))
+  {
+    eos_err("msg=\"unable to start changelog replication source\"");
+    mRunning = false;
+    mThread = 0;
+    return false;
+  }
+
+  mRole = Role::kSource;
+  eos_notice("msg=\"started changelog replication source\" port=%d", port);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Start the sink thread
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::StartSink(const std::string& master_host, int port,
+                               const std::string& identity,
+                               const std::string& files_log,
+                               const std::string& dirs_log)
+{
+  Stop();
+  XrdSysMutexHelper lock(mMutex);
+  mPort = port;
+  mMasterHost = master_host;
+  mIdentity = identity;
+  size_t dpos = mMasterHost.find(":");
+
+  if (dpos != std::string::npos)
+    mMasterHost.erase(dpos);
+
+  SetupStreams(files_log, dirs_log);
+  mConnected = false;
+  mRunning = true;
+
+  if (XrdSysThread::Run(&mThread, ChangeLogReplicator::StaticSink,
+                        static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                        "ChangeLog Replication Sink"))
+  {
+    eos_err("msg=\"unable to start changelog replication sink\"");
+    mRunning = false;
+    mThread = 0;
+    return false;
+  }
+
+  mRole = Role::kSink;
+  eos_notice("msg=\"started changelog replication sink\" master=%s port=%d",
+             mMasterHost.c_str(), port);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Stop the running thread - the loops poll with a 1s timeout and check the
+// running flag, so we don't need to cancel them in the middle of a write
+//------------------------------------------------------------------------------
+void
+ChangeLogReplicator::Stop()
+{
+  pthread_t thread;
+  {
+    XrdSysMutexHelper lock(mMutex);
+    thread = mThread;
+    mRunning = false;
+  }
+
+  if (thread)
+    XrdSysThread::Join(thread, 0);
+
+  XrdSysMutexHelper lock(mMutex);
+
+  for (size_t i = 0; i < mStreams.size(); ++i)
+    CloseStream(mStreams[i]);
+
+  if (mInotifyFd >= 0)
+  {
+    close(mInotifyFd);
+    mInotifyFd = -1;
+  }
+
+  mFollowers.clear();
+  mConnected = false;
+  mThread = 0;
+  mRole = Role::kNone;
+}
+
+//------------------------------------------------------------------------------
+// Static thread startup functions
+//------------------------------------------------------------------------------
+void*
+ChangeLogReplicator::StaticSource(void* arg)
+{
+  return reinterpret_cast<ChangeLogReplicator*>(arg)->Source();
+}
+
+void*
+ChangeLogReplicator::StaticSink(void* arg)
+{
+  return reinterpret_cast<ChangeLogReplicator*>(arg)->Sink();
+}
+
+//------------------------------------------------------------------------------
+// Current time in milliseconds
+//------------------------------------------------------------------------------
+unsigned long long
+ChangeLogReplicator::NowMs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (unsigned long long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+//------------------------------------------------------------------------------
+// Find the index of a stream by name
+//------------------------------------------------------------------------------
+int
+ChangeLogReplicator::StreamIndex(const std::string& name)
+{
+  for (size_t i = 0; i < mStreams.size(); ++i)
+  {
+    if (mStreams[i].mName == name)
+      return (int) i;
+  }
+
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+// Open the local file of a stream
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::OpenStream(Stream& stream, bool create)
+{
+  CloseStream(stream);
+  int flags = create ? (O_RDWR | O_CREAT) : O_RDONLY;
+  stream.mFd = open(stream.mPath.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP);
+
+  if (stream.mFd < 0)
+    return false;
+
+  struct stat buf;
+
+  if (fstat(stream.mFd, &buf))
+  {
+    CloseStream(stream);
+    return false;
+  }
+
+  stream.mInode = buf.st_ino;
+  stream.mSize = buf.st_size;
+  stream.mGrowth.clear();
+#ifdef __linux__
+
+  if (!create && (mInotifyFd >= 0))
+    stream.mWatchFd = inotify_add_watch(mInotifyFd, stream.mPath.c_str(),
+                                        IN_MODIFY | IN_MOVE_SELF);
+
+#endif
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Close the local file of a stream
+//------------------------------------------------------------------------------
+void
+ChangeLogReplicator::CloseStream(Stream& stream)
+{
+#ifdef __linux__
+
+  if ((stream.mWatchFd >= 0) && (mInotifyFd >= 0))
+    inotify_rm_watch(mInotifyFd, stream.mWatchFd);
+
+#endif
+  stream.mWatchFd = -1;
+
+  if (stream.mFd >= 0)
+    close(stream.mFd);
+
+  stream.mFd = -1;
+  stream.mInode = 0;
+  stream.mSize = 0;
+}
+
+//------------------------------------------------------------------------------
+// Refresh sizes of the source streams and detect replaced changelog files
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::RefreshStreams(std::vector<bool>& replaced)
+{
+  bool any = false;
+  unsigned long long now_ms = NowMs();
+  replaced.assign(mStreams.size(), false);
+
+  for (size_t i = 0; i < mStreams.size(); ++i)
+  {
+    Stream& stream = mStreams[i];
+    struct stat buf;
+
+    if (stream.mFd < 0)
+    {
+      // The changelog might not exist yet (fresh instance)
+      if (OpenStream(stream, false))
+      {
+        replaced[i] = true;
+        any = true;
+      }
+
+      continue;
+    }
+
+    // A different inode behind the path means the file was compacted
+    if (!::stat(stream.mPath.c_str(), &buf) && (buf.st_ino != stream.mInode))
+    {
+      eos_notice("msg=\"changelog has been replaced\" path=%s",
+                 stream.mPath.c_str());
+      OpenStream(stream, false);
+      replaced[i] = true;
+      any = true;
+      continue;
+    }
+
+    if (!fstat(stream.mFd, &buf) && ((uint64_t) buf.st_size > stream.mSize))
+    {
+      stream.mSize = buf.st_size;
+      stream.mGrowth.push_back(std::make_pair(stream.mSize, now_ms));
+    }
+  }
+
+  return any;
+}
+
+//------------------------------------------------------------------------------
+// Lag in ms of an acknowledged offset: age of the oldest growth sample which
+// is not yet covered by the acknowledged offset
+//------------------------------------------------------------------------------
+unsigned long long
+ChangeLogReplicator::LagMs(const Stream& stream, uint64_t acked,
+                           unsigned long long now_ms)
+{
+  for (auto it = stream.mGrowth.begin(); it != stream.mGrowth.end(); ++it)
+  {
+    if (it->first > acked)
+      return (now_ms > it->second) ? (now_ms - it->second) : 0;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Send a multipart message
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::SendParts(zmq::socket_t& socket,
+                               const std::string* identity,
+                               const std::vector<std::string>& parts,
+                               const char* payload, size_t payload_len)
+{
+  try
+  {
+    if (identity)
+    {
+      if (!socket.send(identity->c_str(), identity->length(),
+                       ZMQ_SNDMORE | ZMQ_DONTWAIT))
+        return false;
+    }
+
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+      bool last = (!payload) && (i + 1 == parts.size());
+
+      if ((socket.send(parts[i].c_str(), parts[i].length(),
+                       (last ? 0 : ZMQ_SNDMORE) | ZMQ_DONTWAIT) == 0) &&
+          parts[i].length())
+        return false;
+    }
+
+    if (payload)
+    {
+      zmq::message_t msg(payload_len);
+      memcpy(msg.data(), payload, payload_len);
+
+      if (!socket.send(msg, ZMQ_DONTWAIT))
+        return false;
+    }
+  }
+  catch (zmq::error_t& e)
+  {
+    eos_static_err("msg=\"replication send failed\" err=\"%s\"", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Receive all frames of a multipart message without blocking
+//------------------------------------------------------------------------------
+bool
+ChangeLogReplicator::RecvParts(zmq::socket_t& socket,
+                               std::vector<std::string>& parts)
+{
+  parts.clear();
+  int more = 0;
+  size_t more_size = sizeof(more);
+
+  try
+  {
+    do
+    {
+      zmq::message_t msg;
+
+      if (!socket.recv(&msg, parts.empty() ? ZMQ_DONTWAIT : 0))
+        return false;
+
+      parts.push_back(std::string((const char*) msg.data(), msg.size()));
+      socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+    }
+    while (more);
+  }
+  catch (zmq::error_t& e)
+  {
+    eos_static_err("msg=\"replication receive failed\" err=\"%s\"", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Push pending data of all subscribed streams to a follower
+//------------------------------------------------------------------------------
+void
+ChangeLogReplicator::PushFollower(zmq::socket_t& socket, Follower& follower)
+{
+  for (size_t i = 0; i < mStreams.size(); ++i)
+  {
+    Stream& stream = mStreams[i];
+    FollowerStream& fs = follower.mStreams[i];
+
+    if (!fs.mSubscribed || (stream.mFd < 0))
+      continue;
+
+    while ((fs.mSent < stream.mSize) && ((fs.mSent - fs.mAcked) < sWindowSize))
+    {
+      size_t len = stream.mSize - fs.mSent;
+
+      if (len > sBlockSize)
+        len = sBlockSize;
+
+      ssize_t nread = pread(stream.mFd, &mBuffer[0], len, fs.mSent);
+
+      if (nread <= 0)
+      {
+        eos_err("msg=\"failed to read changelog\" path=%s offset=%llu errno=%d",
+                stream.mPath.c_str(), (unsigned long long) fs.mSent, errno);
+        break;
+      }
+
+      std::vector<std::string> parts;
+      char soff[32];
+      char ssize[32];
+      snprintf(soff, sizeof(soff), "%llu", (unsigned long long) fs.mSent);
+      snprintf(ssize, sizeof(ssize), "%llu", (unsigned long long) stream.mSize);
+      parts.push_back("data");
+      parts.push_back(stream.mName);
+      parts.push_back(soff);
+      parts.push_back(ssize);
+
+      // A full send queue means the follower is too slow, retry next round
+      if (!SendParts(socket, &follower.mIdentity, parts, &mBuffer[0], nread))
+        break;
+
+      fs.mSent += nread;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Source loop: wait for changelog modifications (inotify) or follower
+// messages and push new data immediately
+//------------------------------------------------------------------------------
+void*
+ChangeLogReplicator::Source()
+{
+  zmq::context_t context(1);
+  zmq::socket_t socket(context, ZMQ_ROUTER);
+  int linger = 0;
+  socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+  std::ostringstream sstr;
+  sstr << "tcp://*:" << mPort;
+
+  try
+  {
+    socket.bind(sstr.str().c_str());
+  }
+  catch (zmq::error_t& e)
+  {
+    eos_crit("msg=\"unable to bind replication socket\" url=%s err=\"%s\"",
+             sstr.str().c_str(), e.what());
+    return 0;
+  }
+
+  {
+    XrdSysMutexHelper lock(mMutex);
+#ifdef __linux__
+    mInotifyFd = inotify_init1(IN_NONBLOCK);
+
+    if (mInotifyFd < 0)
+      eos_warning("msg=\"unable to initialize inotify - using 1s polling\"");
+
+#endif
+
+    for (size_t i = 0; i < mStreams.size(); ++i)
+      OpenStream(mStreams[i], false);
+  }
+
+  std::vector<std::string> parts;
+  std::vector<bool> replaced;
+  time_t last_ping = time(NULL);
+
+  while (mRunning)
+  {
+    zmq::pollitem_t items[2];
+    int nitems = 1;
+    items[0].socket = (void*) socket;
+    items[0].fd = 0;
+    items[0].events = ZMQ_POLLIN;
+    items[0].revents = 0;
+
+    if (mInotifyFd >= 0)
+    {
+      items[1].socket = 0;
+      items[1].fd = mInotifyFd;
+      items[1].events = ZMQ_POLLIN;
+      items[1].revents = 0;
+      nitems = 2;
+    }
+
+    try
+    {
+      zmq::poll(items, nitems, 1000);
+    }
+    catch (zmq::error_t& e)
+    {
+      if (e.num() != EINTR)
+      {
+        eos_err("msg=\"replication poll failed\" err=\"%s\"", e.what());
+        XrdSysTimer sleeper;
+        sleeper.Wait(100);
+      }
+    }
+
+#ifdef __linux__
+
+    // Drain the inotify events, we re-stat all streams anyway
+    if ((nitems == 2) && items[1].revents)
+    {
+      char evbuf[4096];
+
+      while (read(mInotifyFd, evbuf, sizeof(evbuf)) > 0);
+    }
+
+#endif
+    XrdSysMutexHelper lock(mMutex);
+    time_t now = time(NULL);
+
+    // Handle follower messages
+    while (RecvParts(socket, parts))
+    {
+      if (parts.size() < 2)
+        continue;
+
+      Follower& follower = mFollowers[parts[0]];
+
+      if (follower.mIdentity.empty())
+      {
+        follower.mIdentity = parts[0];
+        follower.mStreams.resize(mStreams.size());
+        eos_notice("msg=\"new changelog follower\" id=%s", parts[0].c_str());
+      }
+
+      follower.mLastSeen = now;
+
+      if ((parts[1] == "sub") && (parts.size() == 4))
+      {
+        int idx = StreamIndex(parts[2]);
+
+        if (idx < 0)
+          continue;
+
+        uint64_t offset = strtoull(parts[3].c_str(), 0, 10);
+        FollowerStream& fs = follower.mStreams[idx];
+
+        if (offset > mStreams[idx].mSize)
+        {
+          // The follower copy is longer than ours - it has to restart
+          std::vector<std::string> reset;
+          reset.push_back("reset");
+          reset.push_back(parts[2]);
+          SendParts(socket, &follower.mIdentity, reset);
+          fs.mSubscribed = false;
+          eos_warning("msg=\"follower changelog is longer - reset\" id=%s "
+                      "stream=%s offset=%llu size=%llu", parts[0].c_str(),
+                      parts[2].c_str(), (unsigned long long) offset,
+                      (unsigned long long) mStreams[idx].mSize);
+          continue;
+        }
+
+        fs.mSubscribed = true;
+        fs.mSent = fs.mAcked = offset;
+        eos_info("msg=\"follower subscribed\" id=%s stream=%s offset=%llu",
+                 parts[0].c_str(), parts[2].c_str(), (unsigned long long) offset);
+      }
+      else if ((parts[1] == "ack") && (parts.size() == 4))
+      {
+        int idx = StreamIndex(parts[2]);
+
+        if (idx < 0)
+          continue;
+
+        uint64_t offset = strtoull(parts[3].c_str(), 0, 10);
+        FollowerStream& fs = follower.mStreams[idx];
+
+        if (offset > fs.mAcked)
+          fs.mAcked = offset;
+      }
+    }
+
+    // Pick up new data and replaced (compacted) changelog files
+    if (RefreshStreams(replaced))
+    {
+      for (auto it = mFollowers.begin(); it != mFollowers.end(); ++it)
+      {
+        for (size_t i = 0; i < replaced.size(); ++i)
+        {
+          if (replaced[i] && it->second.mStreams[i].mSubscribed)
+          {
+            std::vector<std::string> reset;
+            reset.push_back("reset");
+            reset.push_back(mStreams[i].mName);
+            SendParts(socket, &it->second.mIdentity, reset);
+            it->second.mStreams[i].mSubscribed = false;
+          }
+        }
+      }
+    }
+
+    // Drop silent followers - they resubscribe when they come back
+    for (auto it = mFollowers.begin(); it != mFollowers.end();)
+    {
+      if ((now - it->second.mLastSeen) > sPeerTimeout)
+      {
+        eos_warning("msg=\"dropping silent changelog follower\" id=%s",
+                    it->first.c_str());
+        mFollowers.erase(it++);
+      }
+      else
+        ++it;
+    }
+
+    for (auto it = mFollowers.begin(); it != mFollowers.end(); ++it)
+    {
+      PushFollower(socket, it->second);
+
+      // Heartbeat which also announces the source size for the lag
+      if (now != last_ping)
+      {
+        for (size_t i = 0; i < mStreams.size(); ++i)
+        {
+          if (!it->second.mStreams[i].mSubscribed)
+            continue;
+
+          std::vector<std::string> ping;
+          char ssize[32];
+          snprintf(ssize, sizeof(ssize), "%llu",
+                   (unsigned long long) mStreams[i].mSize);
+          ping.push_back("ping");
+          ping.push_back(mStreams[i].mName);
+          ping.push_back(ssize);
+          SendParts(socket, &it->second.mIdentity, ping);
+        }
+      }
+    }
+
+    last_ping = now;
+
+    // Forget growth samples acknowledged by every follower
+    for (size_t i = 0; i < mStreams.size(); ++i)
+    {
+      uint64_t min_acked = mStreams[i].mSize;
+
+      for (auto it = mFollowers.begin(); it != mFollowers.end(); ++it)
+      {
+        if (it->second.mStreams[i].mSubscribed &&
+            (it->second.mStreams[i].mAcked < min_acked))
+          min_acked = it->second.mStreams[i].mAcked;
+      }
+
+      while (!mStreams[i].mGrowth.empty() &&
+             ((mStreams[i].mGrowth.front().first <= min_acked) ||
+              (mStreams[i].mGrowth.size() > 4096)))
+        mStreams[i].mGrowth.pop_front();
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Sink loop: (re-)connect to the master, subscribe with the local sizes,
+// append the received blocks and acknowledge them once they are on disk
+//------------------------------------------------------------------------------
+void*
+ChangeLogReplicator::Sink()
+{
+  std::ostringstream sstr;
+  sstr << "tcp://" << mMasterHost << ":" << mPort;
+  std::vector<std::string> parts;
+
+  while (mRunning)
+  {
+    zmq::context_t context(1);
+    zmq::socket_t socket(context, ZMQ_DEALER);
+    int linger = 0;
+    socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+    socket.setsockopt(ZMQ_IDENTITY, mIdentity.c_str(), mIdentity.length());
+
+    try
+    {
+      socket.connect(sstr.str().c_str());
+    }
+    catch (zmq::error_t& e)
+    {
+      eos_err("msg=\"unable to connect replication socket\" url=%s err=\"%s\"",
+              sstr.str().c_str(), e.what());
+      XrdSysTimer sleeper;
+      sleeper.Wait(1000);
+      continue;
+    }
+
+    {
+      XrdSysMutexHelper lock(mMutex);
+      mReconnects++;
+
+      for (size_t i = 0; i < mStreams.size(); ++i)
+      {
+        if (!OpenStream(mStreams[i], true))
+          eos_err("msg=\"unable to open changelog copy\" path=%s errno=%d",
+                  mStreams[i].mPath.c_str(), errno);
+
+        std::vector<std::string> sub;
+        char soff[32];
+        snprintf(soff, sizeof(soff), "%llu",
+                 (unsigned long long) mStreams[i].mSize);
+        sub.push_back("sub");
+        sub.push_back(mStreams[i].mName);
+        sub.push_back(soff);
+        SendParts(socket, 0, sub);
+      }
+    }
+
+    time_t last_rx = time(NULL);
+    time_t last_ping = last_rx;
+
+    while (mRunning)
+    {
+      zmq::pollitem_t items[1];
+      items[0].socket = (void*) socket;
+      items[0].fd = 0;
+      items[0].events = ZMQ_POLLIN;
+      items[0].revents = 0;
+
+      try
+      {
+        zmq::poll(items, 1, 1000);
+      }
+      catch (zmq::error_t& e)
+      {
+        if (e.num() != EINTR)
+          break;
+      }
+
+      XrdSysMutexHelper lock(mMutex);
+      std::vector<bool> dirty(mStreams.size(), false);
+      time_t now = time(NULL);
+
+      while (RecvParts(socket, parts))
+      {
+        last_rx = now;
+        mLastReceived = now;
+        mConnected = true;
+
+        if (parts.size() < 2)
+          continue;
+
+        int idx = StreamIndex(parts[1]);
+
+        if (idx < 0)
+          continue;
+
+        Stream& stream = mStreams[idx];
+
+        if ((parts[0] == "data") && (parts.size() == 5) && (stream.mFd >= 0))
+        {
+          uint64_t offset = strtoull(parts[2].c_str(), 0, 10);
+          stream.mRemoteSize = strtoull(parts[3].c_str(), 0, 10);
+          const std::string& payload = parts[4];
+
+          if (offset > stream.mSize)
+          {
+            // We lost a block - resubscribe at our end of file
+            std::vector<std::string> sub;
+            char soff[32];
+            snprintf(soff, sizeof(soff), "%llu", (unsigned long long) stream.mSize);
+            sub.push_back("sub");
+            sub.push_back(stream.mName);
+            sub.push_back(soff);
+            SendParts(socket, 0, sub);
+            continue;
+          }
+
+          // Skip anything we already have (duplicate after resubscription)
+          size_t skip = stream.mSize - offset;
+
+          if (skip >= payload.length())
+            continue;
+
+          ssize_t nwrite = pwrite(stream.mFd, payload.c_str() + skip,
+                                  payload.length() - skip, stream.mSize);
+
+          if (nwrite != (ssize_t)(payload.length() - skip))
+          {
+            eos_crit("msg=\"failed to append changelog copy\" path=%s errno=%d",
+                     stream.mPath.c_str(), errno);
+            continue;
+          }
+
+          stream.mSize += nwrite;
+          dirty[idx] = true;
+        }
+        else if (parts[0] == "reset")
+        {
+          // The master changelog was replaced - keep our copy as a backup
+          char backup[4096];
+          snprintf(backup, sizeof(backup), "%s.%lu", stream.mPath.c_str(),
+                   (unsigned long) now);
+          eos_notice("msg=\"changelog reset by master\" path=%s backup=%s",
+                     stream.mPath.c_str(), backup);
+          CloseStream(stream);
+
+          if (::rename(stream.mPath.c_str(), backup))
+            eos_err("msg=\"failed to rename changelog copy\" path=%s errno=%d",
+                    stream.mPath.c_str(), errno);
+
+          OpenStream(stream, true);
+          std::vector<std::string> sub;
+          sub.push_back("sub");
+          sub.push_back(stream.mName);
+          sub.push_back("0");
+          SendParts(socket, 0, sub);
+        }
+        else if ((parts[0] == "ping") && (parts.size() == 3))
+        {
+          stream.mRemoteSize = strtoull(parts[2].c_str(), 0, 10);
+        }
+      }
+
+      // Acknowledge only what is durable - one sync per batch of messages
+      for (size_t i = 0; i < dirty.size(); ++i)
+      {
+        if (!dirty[i])
+          continue;
+
+        fdatasync(mStreams[i].mFd);
+        std::vector<std::string> ack;
+        char soff[32];
+        snprintf(soff, sizeof(soff), "%llu", (unsigned long long) mStreams[i].mSize);
+        ack.push_back("ack");
+        ack.push_back(mStreams[i].mName);
+        ack.push_back(soff);
+        SendParts(socket, 0, ack);
+      }
+
+      if (now != last_ping)
+      {
+        std::vector<std::string> ping;
+        ping.push_back("ping");
+        SendParts(socket, 0, ping);
+        last_ping = now;
+      }
+
+      if ((now - last_rx) > sPeerTimeout)
+      {
+        eos_warning("msg=\"changelog master silent - reconnecting\" url=%s",
+                    sstr.str().c_str());
+        mConnected = false;
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Print the replication state and the lag of all followers/streams
+//------------------------------------------------------------------------------
+void
+ChangeLogReplicator::PrintOut(XrdOucString& out)
+{
+  XrdSysMutexHelper lock(mMutex);
+  char line[1024];
+
+  if (mRole == Role::kSource)
+  {
+    unsigned long long now_ms = NowMs();
+    snprintf(line, sizeof(line), " replication=source followers=%lu",
+             (unsigned long) mFollowers.size());
+    out += line;
+
+    for (auto it = mFollowers.begin(); it != mFollowers.end(); ++it)
+    {
+      for (size_t i = 0; i < mStreams.size(); ++i)
+      {
+        const FollowerStream& fs = it->second.mStreams[i];
+
+        if (!fs.mSubscribed)
+          continue;
+
+        uint64_t lag = (mStreams[i].mSize > fs.mAcked) ?
+                       (mStreams[i].mSize - fs.mAcked) : 0;
+        snprintf(line, sizeof(line), " replication:%s:%s:lag=%llu "
+                 "replication:%s:%s:lag-ms=%llu", it->first.c_str(),
+                 mStreams[i].mName.c_str(), (unsigned long long) lag,
+                 it->first.c_str(), mStreams[i].mName.c_str(),
+                 LagMs(mStreams[i], fs.mAcked, now_ms));
+        out += line;
+      }
+    }
+  }
+  else if (mRole == Role::kSink)
+  {
+    snprintf(line, sizeof(line), " replication=sink replication:state=%s "
+             "replication:reconnects=%llu replication:last-rx=%lu",
+             mConnected ? "connected" : "disconnected", mReconnects,
+             (unsigned long)(mLastReceived ? (time(NULL) - mLastReceived) : 0));
+    out += line;
+
+    for (size_t i = 0; i < mStreams.size(); ++i)
+    {
+      uint64_t lag = (mStreams[i].mRemoteSize > mStreams[i].mSize) ?
+                     (mStreams[i].mRemoteSize - mStreams[i].mSize) : 0;
+      snprintf(line, sizeof(line), " replication:%s:lag=%llu",
+               mStreams[i].mName.c_str(), (unsigned long long) lag);
+      out += line;
+    }
+  }
+}
+
+EOSMGMNAMESPACE_END
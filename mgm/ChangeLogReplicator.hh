@@ -0,0 +1,277 @@
+// ----------------------------------------------------------------------
+// File: ChangeLogReplicator.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_CHANGELOGREPLICATOR__HH__
+#define __EOSMGM_CHANGELOGREPLICATOR__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Namespace.hh"
+#include "common/Logging.hh"
+#include "common/ZMQ.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdOuc/XrdOucString.hh"
+#include "XrdSys/XrdSysPthread.hh"
+/*----------------------------------------------------------------------------*/
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Push based replication of the namespace changelog files from the master
+//! to the slave MGM.
+//!
+//! On the master the replicator runs as a source: it binds a ZMQ ROUTER
+//! socket, watches the local changelog files with inotify and pushes every
+//! appended block to all subscribed followers as soon as it is committed.
+//! On the slave it runs as a sink: it connects with a DEALER socket,
+//! subscribes with the current size of its local copies, appends the received
+//! blocks and acknowledges the durable offsets. After a reconnect the sink
+//! simply resubscribes with its local sizes, so the stream resumes where it
+//! stopped. The slave namespace follower keeps reading the local copies as
+//! before, but it is now woken up milliseconds after the master commit.
+//!
+//! Wire protocol (multipart messages, all numbers in ASCII):
+//!   sink -> source : "sub"  <stream> <offset>
+//!                    "ack"  <stream> <offset>
+//!                    "ping"
+//!   source -> sink : "data" <stream> <offset> <source-size> <payload>
+//!                    "reset" <stream>
+//!                    "ping" <stream> <source-size>
+//------------------------------------------------------------------------------
+class ChangeLogReplicator : public eos::common::LogId
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Replicator role
+  //----------------------------------------------------------------------------
+  struct Role
+  {
+    enum Type
+    {
+      kNone   = 0,
+      kSource = 1,
+      kSink   = 2
+    };
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  ChangeLogReplicator();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  virtual ~ChangeLogReplicator();
+
+  //----------------------------------------------------------------------------
+  //! Start streaming the local changelog files to followers (master side)
+  //!
+  //! @param port TCP port to bind
+  //! @param files_log local file changelog path
+  //! @param dirs_log local directory changelog path
+  //!
+  //! @return true if the source thread was started
+  //----------------------------------------------------------------------------
+  bool StartSource(int port, const std::string& files_log,
+                   const std::string& dirs_log);
+
+  //----------------------------------------------------------------------------
+  //! Start receiving changelog files from a master (slave side)
+  //!
+  //! @param master_host host[:port] of the master MGM
+  //! @param port TCP port of the master replicator
+  //! @param identity identity announced to the master (our hostname)
+  //! @param files_log local copy of the master file changelog
+  //! @param dirs_log local copy of the master directory changelog
+  //!
+  //! @return true if the sink thread was started
+  //----------------------------------------------------------------------------
+  bool StartSink(const std::string& master_host, int port,
+                 const std::string& identity, const std::string& files_log,
+                 const std::string& dirs_log);
+
+  //----------------------------------------------------------------------------
+  //! Stop the running source or sink thread
+  //----------------------------------------------------------------------------
+  void Stop();
+
+  //----------------------------------------------------------------------------
+  //! Get the current role
+  //----------------------------------------------------------------------------
+  Role::Type
+  GetRole()
+  {
+    XrdSysMutexHelper lock(mMutex);
+    return mRole;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Append the replication state and lag metrics to out (used by ns stat)
+  //----------------------------------------------------------------------------
+  void PrintOut(XrdOucString& out);
+
+  static const size_t sBlockSize; ///< max. payload of a data message
+  static const size_t sWindowSize; ///< max. un-acknowledged bytes per follower
+  static const time_t sPeerTimeout; ///< seconds before a silent peer is dropped
+
+private:
+  //----------------------------------------------------------------------------
+  //! Changelog file replicated by the stream
+  //----------------------------------------------------------------------------
+  struct Stream
+  {
+    std::string mName; ///< stream name used on the wire
+    std::string mPath; ///< local changelog path
+    int mFd; ///< file descriptor of the local changelog
+    int mWatchFd; ///< inotify watch descriptor
+    ino_t mInode; ///< inode of the opened changelog
+    uint64_t mSize; ///< size of the local changelog
+    uint64_t mRemoteSize; ///< source size as announced by the master (sink)
+    //! (offset, time in ms) samples of the source growth used for lag in ms
+    std::deque< std::pair<uint64_t, unsigned long long> > mGrowth;
+
+    Stream() : mFd(-1), mWatchFd(-1), mInode(0), mSize(0), mRemoteSize(0) {}
+  };
+
+  //----------------------------------------------------------------------------
+  //! Per stream state of a follower as seen by the source
+  //----------------------------------------------------------------------------
+  struct FollowerStream
+  {
+    bool mSubscribed; ///< follower subscribed to this stream
+    uint64_t mSent; ///< offset up to which data has been sent
+    uint64_t mAcked; ///< offset acknowledged as durable by the follower
+
+    FollowerStream() : mSubscribed(false), mSent(0), mAcked(0) {}
+  };
+
+  //----------------------------------------------------------------------------
+  //! Follower as seen by the source
+  //----------------------------------------------------------------------------
+  struct Follower
+  {
+    std::string mIdentity; ///< ZMQ identity of the follower
+    time_t mLastSeen; ///< last time we received a message
+    std::vector<FollowerStream> mStreams; ///< indexed like mStreams
+  };
+
+  XrdSysMutex mMutex; ///< protects the state shown in PrintOut
+  Role::Type mRole; ///< current role
+  pthread_t mThread; ///< source or sink thread
+  volatile bool mRunning; ///< flag to terminate the running thread
+  int mPort; ///< replication port
+  int mInotifyFd; ///< inotify descriptor used by the source
+  std::string mMasterHost; ///< master host for the sink
+  std::string mIdentity; ///< identity of the sink
+  std::vector<Stream> mStreams; ///< replicated streams (files, directories)
+  std::map<std::string, Follower> mFollowers; ///< followers of the source
+  bool mConnected; ///< sink has received data from the master recently
+  time_t mLastReceived; ///< last time the sink received a message
+  unsigned long long mReconnects; ///< number of sink (re-)connections
+  std::vector<char> mBuffer; ///< read buffer of the source
+
+  //----------------------------------------------------------------------------
+  //! Thread startup functions
+  //----------------------------------------------------------------------------
+  static void* StaticSource(void* arg);
+  static void* StaticSink(void* arg);
+
+  //----------------------------------------------------------------------------
+  //! Source thread loop
+  //----------------------------------------------------------------------------
+  void* Source();
+
+  //----------------------------------------------------------------------------
+  //! Sink thread loop
+  //----------------------------------------------------------------------------
+  void* Sink();
+
+  //----------------------------------------------------------------------------
+  //! Configure the two replicated streams
+  //----------------------------------------------------------------------------
+  void SetupStreams(const std::string& files_log, const std::string& dirs_log);
+
+  //----------------------------------------------------------------------------
+  //! Open (or re-open after a replacement) the local file of a stream
+  //!
+  //! @param stream stream to open
+  //! @param create create the file if it does not exist (sink)
+  //!
+  //! @return true if the stream file is open
+  //----------------------------------------------------------------------------
+  bool OpenStream(Stream& stream, bool create);
+
+  //----------------------------------------------------------------------------
+  //! Close the local file of a stream
+  //----------------------------------------------------------------------------
+  void CloseStream(Stream& stream);
+
+  //----------------------------------------------------------------------------
+  //! Find the index of a stream by name, -1 if unknown
+  //----------------------------------------------------------------------------
+  int StreamIndex(const std::string& name);
+
+  //----------------------------------------------------------------------------
+  //! Refresh the size of all streams and detect replaced changelog files
+  //!
+  //! @return true if any stream has been replaced (compaction on the master)
+  //----------------------------------------------------------------------------
+  bool RefreshStreams(std::vector<bool>& replaced);
+
+  //----------------------------------------------------------------------------
+  //! Push pending data of all streams to a follower within its window
+  //----------------------------------------------------------------------------
+  void PushFollower(zmq::socket_t& socket, Follower& follower);
+
+  //----------------------------------------------------------------------------
+  //! Send a multipart message, optionally prefixed by a ROUTER identity
+  //----------------------------------------------------------------------------
+  static bool SendParts(zmq::socket_t& socket, const std::string* identity,
+                        const std::vector<std::string>& parts,
+                        const char* payload = 0, size_t payload_len = 0);
+
+  //----------------------------------------------------------------------------
+  //! Receive all frames of a multipart message
+  //----------------------------------------------------------------------------
+  static bool RecvParts(zmq::socket_t& socket, std::vector<std::string>& parts);
+
+  //----------------------------------------------------------------------------
+  //! Lag in milliseconds of an acknowledged offset of a source stream
+  //----------------------------------------------------------------------------
+  static unsigned long long LagMs(const Stream& stream, uint64_t acked,
+                                  unsigned long long now_ms);
+
+  //----------------------------------------------------------------------------
+  //! Current time in milliseconds
+  //----------------------------------------------------------------------------
+  static unsigned long long NowMs();
+};
+
+EOSMGMNAMESPACE_END
+
+#endif // __EOSMGM_CHANGELOGREPLICATOR__HH__
@@ -643,12 +643,13 @@ ConfigEngine::ResetConfig ()
   (void) Quota::CleanUp();
 
   eos::common::Mapping::gMapMutex.LockWrite();
+  eos::common::Mapping::InvalidateIdCache();
   eos::common::Mapping::gUserRoleVector.clear();
   eos::common::Mapping::gGroupRoleVector.clear();
   eos::common::Mapping::gVirtualUidMap.clear();
   eos::common::Mapping::gVirtualGidMap.clear();
-  eos::common::Mapping::gMapMutex.UnLockWrite();
   eos::common::Mapping::gAllowedTidentMatches.clear();
+  eos::common::Mapping::gMapMutex.UnLockWrite();
 
   Access::Reset();
 
@@ -683,12 +684,13 @@ ConfigEngine::ApplyConfig (XrdOucString &err)
   (void) Quota::CleanUp();
 
   eos::common::Mapping::gMapMutex.LockWrite();
+  eos::common::Mapping::InvalidateIdCache();
   eos::common::Mapping::gUserRoleVector.clear();
   eos::common::Mapping::gGroupRoleVector.clear();
   eos::common::Mapping::gVirtualUidMap.clear();
   eos::common::Mapping::gVirtualGidMap.clear();
-  eos::common::Mapping::gMapMutex.UnLockWrite();
   eos::common::Mapping::gAllowedTidentMatches.clear();
+  eos::common::Mapping::gMapMutex.UnLockWrite();
 
   Access::Reset();
 
@@ -46,6 +46,16 @@ GeoTreeEngine gGeoTreeEngine;
 
 const size_t GeoTreeEngine::gGeoBufferSize = sizeof(FastPlacementTree) + FastPlacementTree::sGetMaxDataMemSize(); // we assume that all the trees have the same max size, we should take the max of all the sizes otherwise
 __thread void* GeoTreeEngine::tlGeoBuffer = NULL;
+__thread void* GeoTreeEngine::tlGeoSnapshot = NULL;
+__thread const void* GeoTreeEngine::tlGeoSnapshotSource = NULL;
+__thread size_t GeoTreeEngine::tlGeoSnapshotGeneration = 0;
+size_t GeoTreeEngine::gFastStructGeneration = 0;
+__thread const FsGroup* GeoTreeEngine::tlEntryGroup = NULL;
+__thread GeoTreeEngine::TreeMapEntry* GeoTreeEngine::tlEntry = NULL;
+__thread size_t GeoTreeEngine::tlEntryGeneration = 0;
+__thread bool GeoTreeEngine::tlTreeMapLocked = false;
+__thread size_t GeoTreeEngine::tlReaderSlot = 0;
+size_t GeoTreeEngine::gReaderSlotCounter = 0;
 pthread_key_t GeoTreeEngine::gPthreadKey;
 __thread const FsGroup* GeoTreeEngine::tlCurrentGroup = NULL;
 
@@ -350,7 +360,11 @@ bool GeoTreeEngine::insertFsIntoGroup(FileSystem *fs ,
   {
     pTreeMapMutex.LockWrite();
     mapEntry->group = group;
-    pGroup2TreeMapEntry[group] = mapEntry;
+    if(pGroup2TreeMapEntry[group] != mapEntry)
+    {
+      pGroup2TreeMapEntry[group] = mapEntry;
+      AtomicInc(pTreeMapGeneration);
+    }
     pFs2TreeMapEntry[fsid] = mapEntry;
     pFsId2FsPtr[fsid] = fs;
     pTreeMapMutex.UnLockWrite();
@@ -496,6 +510,7 @@ bool GeoTreeEngine::removeFsFromGroup(FileSystem *fs ,
     if(mapEntry->fs2SlowTreeNode.empty())
     {
       pGroup2TreeMapEntry.erase(group); // prevent from access by other threads
+      AtomicInc(pTreeMapGeneration); // including the ones using their thread local entry
       pPendingDeletions.push_back(mapEntry);
     }
     mapEntry->slowTreeMutex.UnLockWrite();
@@ -706,20 +721,15 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
 
   // find the entry in the map
   tlCurrentGroup = group;
-  TreeMapEntry *entry;
+  TreeMapEntry *entry = getTreeMapEntry(group);
+  if(!entry)
   {
-    RWMutexReadLock lock(this->pTreeMapMutex);
-    if(!pGroup2TreeMapEntry.count(group))
-    {
-      eos_err("could not find the requested placement group in the map");
-      return false;
-    }
-    entry = pGroup2TreeMapEntry[group];
-    AtomicInc(entry->fastStructLockWaitersCount);
+    eos_err("could not find the requested placement group in the map");
+    return false;
   }
 
-  // readlock the original fast structure
-  entry->doubleBufferMutex.LockRead();
+  // get the current fast structures (no lock, a swap waits for us to release them)
+  FastStructures *ft = entry->acquireForeground();
 
   // locate the existing replicas and the excluded fs in the tree
   vector<SchedTreeBase::tFastTreeIdx> newReplicasIdx(nNewReplicas),*existingReplicasIdx=NULL,*excludeFsIdx=NULL,*forceBrIdx=NULL;
@@ -732,7 +742,7 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
     for(auto it = existingReplicas->begin(); it != existingReplicas->end(); ++it , ++count)
     {
       const SchedTreeBase::tFastTreeIdx *idx = static_cast<const SchedTreeBase::tFastTreeIdx*>(0);
-      if(!entry->foregroundFastStruct->fs2TreeIdx->get(*it,idx) && !(*fsidsgeotags)[count].empty())
+      if(!ft->fs2TreeIdx->get(*it,idx) && !(*fsidsgeotags)[count].empty())
       {
 	// the fs is not in that group.
 	// this could happen because the former file scheduler
@@ -740,8 +750,8 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
 	// with the new geoscheduler, it should not happen
 
 	// in that case, we try to match a filesystem having the same geotag
-	SchedTreeBase::tFastTreeIdx idx = entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode((*fsidsgeotags)[count].c_str());
-	if(idx && (*entry->foregroundFastStruct->treeInfo)[idx].nodeType == SchedTreeBase::TreeNodeInfo::fs)
+	SchedTreeBase::tFastTreeIdx idx = ft->tag2NodeIdx->getClosestFastTreeNode((*fsidsgeotags)[count].c_str());
+	if(idx && (*ft->treeInfo)[idx].nodeType == SchedTreeBase::TreeNodeInfo::fs)
 	{
 	  if((std::find(existingReplicasIdx->begin(),existingReplicasIdx->end(),idx) == existingReplicasIdx->end()))
 	  existingReplicasIdx->push_back(idx);
@@ -764,7 +774,7 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
     for(auto it = excludeFs->begin(); it != excludeFs->end(); ++it)
     {
       const SchedTreeBase::tFastTreeIdx *idx;
-      if(!entry->foregroundFastStruct->fs2TreeIdx->get(*it,idx))
+      if(!ft->fs2TreeIdx->get(*it,idx))
       {
 	// the excluded fs might belong to another group
 	// so it's not an error condition
@@ -784,7 +794,7 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
     for(auto it = excludeGeoTags->begin(); it != excludeGeoTags->end(); ++it)
     {
       SchedTreeBase::tFastTreeIdx idx;
-      idx=entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
+      idx=ft->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
       excludeFsIdx->push_back(idx);
     }
   }
@@ -795,7 +805,7 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
     for(auto it = forceGeoTags->begin(); it != forceGeoTags->end(); ++it)
     {
       SchedTreeBase::tFastTreeIdx idx;
-      idx=entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
+      idx=ft->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
       forceBrIdx->push_back(idx);
     }
   }
@@ -803,7 +813,7 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
   SchedTreeBase::tFastTreeIdx startFromNode=0;
   if(!startFromGeoTag.empty())
   {
-    startFromNode=entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(startFromGeoTag.c_str());
+    startFromNode=ft->tag2NodeIdx->getClosestFastTreeNode(startFromGeoTag.c_str());
   }
 
   // actually do the job
@@ -812,15 +822,15 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
   {
     case regularRO:
     case regularRW:
-    success = placeNewReplicas(entry,nNewReplicas,&newReplicasIdx,entry->foregroundFastStruct->placementTree,
+    success = placeNewReplicas(ft,nNewReplicas,&newReplicasIdx,ft->placementTree,
 	existingReplicasIdx,bookingSize,startFromNode,nCollocatedReplicas,excludeFsIdx,forceBrIdx,pSkipSaturatedPlct);
     break;
     case draining:
-    success = placeNewReplicas(entry,nNewReplicas,&newReplicasIdx,entry->foregroundFastStruct->drnPlacementTree,
+    success = placeNewReplicas(ft,nNewReplicas,&newReplicasIdx,ft->drnPlacementTree,
 	existingReplicasIdx,bookingSize,startFromNode,nCollocatedReplicas,excludeFsIdx,forceBrIdx,pSkipSaturatedDrnPlct);
     break;
     case balancing:
-    success = placeNewReplicas(entry,nNewReplicas,&newReplicasIdx,entry->foregroundFastStruct->blcPlacementTree,
+    success = placeNewReplicas(ft,nNewReplicas,&newReplicasIdx,ft->blcPlacementTree,
 	existingReplicasIdx,bookingSize,startFromNode,nCollocatedReplicas,excludeFsIdx,forceBrIdx,pSkipSaturatedBlcPlct);
     break;
     default:
@@ -834,21 +844,21 @@ bool GeoTreeEngine::placeNewReplicasOneGroup( FsGroup* group, const size_t &nNew
   for(auto it = newReplicasIdx.begin(); it != newReplicasIdx.end(); ++it)
   {
     const SchedTreeBase::tFastTreeIdx *idx=NULL;
-    const unsigned int fsid = (*entry->foregroundFastStruct->treeInfo)[*it].fsId;
-    entry->foregroundFastStruct->fs2TreeIdx->get(fsid,idx);
-    const char netSpeedClass = (*entry->foregroundFastStruct->treeInfo)[*idx].netSpeedClass;
+    const unsigned int fsid = (*ft->treeInfo)[*it].fsId;
+    ft->fs2TreeIdx->get(fsid,idx);
+    const char netSpeedClass = (*ft->treeInfo)[*idx].netSpeedClass;
     newReplicas->push_back(fsid);
     // apply the penalties
-    if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.dlScore>0)
-    applyDlScorePenalty(entry,*idx,pPlctDlScorePenalty[netSpeedClass]);
-    if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.ulScore>0)
-    applyUlScorePenalty(entry,*idx,pPlctUlScorePenalty[netSpeedClass]);
+    if(ft->placementTree->pNodes[*idx].fsData.dlScore>0)
+    applyDlScorePenalty(ft,*idx,pPlctDlScorePenalty[netSpeedClass]);
+    if(ft->placementTree->pNodes[*idx].fsData.ulScore>0)
+    applyUlScorePenalty(ft,*idx,pPlctUlScorePenalty[netSpeedClass]);
   }
 
   // unlock, cleanup
   cleanup:
   if(!success) newReplicas->clear();
-  entry->doubleBufferMutex.UnLockRead();
+  entry->releaseForeground(ft);
   AtomicDec(entry->fastStructLockWaitersCount);
   if(existingReplicasIdx) delete existingReplicasIdx;
   if(excludeFsIdx) delete excludeFsIdx;
@@ -884,20 +894,15 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
 
   // find the entry in the map
   tlCurrentGroup = group;
-  TreeMapEntry *entry;
+  TreeMapEntry *entry = getTreeMapEntry(group);
+  if(!entry)
   {
-    RWMutexReadLock lock(this->pTreeMapMutex);
-    if(!pGroup2TreeMapEntry.count(group))
-    {
-      eos_err("could not find the requested placement group in the map");
-      return false;
-    }
-    entry = pGroup2TreeMapEntry[group];
-    AtomicInc(entry->fastStructLockWaitersCount);
+    eos_err("could not find the requested placement group in the map");
+    return false;
   }
 
-  // readlock the original fast structure
-  entry->doubleBufferMutex.LockRead();
+  // get the current fast structures (no lock, a swap waits for us to release them)
+  FastStructures *ft = entry->acquireForeground();
 
   // locate the existing replicas and the excluded fs in the tree
   vector<SchedTreeBase::tFastTreeIdx> accessedReplicasIdx(nAccessReplicas),*existingReplicasIdx=NULL,*excludeFsIdx=NULL,*forceBrIdx=NULL;
@@ -909,7 +914,7 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
     for(auto it = existingReplicas->begin(); it != existingReplicas->end(); ++it)
     {
       const SchedTreeBase::tFastTreeIdx *idx;
-      if(!entry->foregroundFastStruct->fs2TreeIdx->get(*it,idx))
+      if(!ft->fs2TreeIdx->get(*it,idx))
       {
 	eos_warning("could not place preexisting replica on the fast tree");
 	continue;
@@ -924,7 +929,7 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
     for(auto it = excludeFs->begin(); it != excludeFs->end(); ++it)
     {
       const SchedTreeBase::tFastTreeIdx *idx;
-      if(!entry->foregroundFastStruct->fs2TreeIdx->get(*it,idx))
+      if(!ft->fs2TreeIdx->get(*it,idx))
       {
 	eos_warning("could not place excluded fs on the fast tree");
 	continue;
@@ -942,7 +947,7 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
     for(auto it = excludeGeoTags->begin(); it != excludeGeoTags->end(); ++it)
     {
       SchedTreeBase::tFastTreeIdx idx;
-      idx=entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
+      idx=ft->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
       excludeFsIdx->push_back(idx);
     }
   }
@@ -953,33 +958,33 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
     for(auto it = forceGeoTags->begin(); it != forceGeoTags->end(); ++it)
     {
       SchedTreeBase::tFastTreeIdx idx;
-      idx=entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
+      idx=ft->tag2NodeIdx->getClosestFastTreeNode(it->c_str());
       forceBrIdx->push_back(idx);
     }
   }
 
   // find the closest tree node to the accesser
-  SchedTreeBase::tFastTreeIdx accesserNode = entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(accesserGeotag.c_str());;
+  SchedTreeBase::tFastTreeIdx accesserNode = ft->tag2NodeIdx->getClosestFastTreeNode(accesserGeotag.c_str());;
 
   // actually do the job
   unsigned char success = 0;
   switch(type)
   {
     case regularRO:
-    success = accessReplicas(entry,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
-	entry->foregroundFastStruct->rOAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedAccess);
+    success = accessReplicas(ft,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
+	ft->rOAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedAccess);
     break;
     case regularRW:
-    success = accessReplicas(entry,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
-	entry->foregroundFastStruct->rWAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedAccess);
+    success = accessReplicas(ft,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
+	ft->rWAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedAccess);
     break;
     case draining:
-    success = accessReplicas(entry,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
-	entry->foregroundFastStruct->drnAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedDrnAccess);
+    success = accessReplicas(ft,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
+	ft->drnAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedDrnAccess);
     break;
     case balancing:
-    success = accessReplicas(entry,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
-	entry->foregroundFastStruct->blcAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedBlcAccess);
+    success = accessReplicas(ft,nAccessReplicas,&accessedReplicasIdx,accesserNode,existingReplicasIdx,
+	ft->blcAccessTree,excludeFsIdx,forceBrIdx,pSkipSaturatedBlcAccess);
     break;
     default:
     ;
@@ -992,25 +997,25 @@ bool GeoTreeEngine::accessReplicasOneGroup(FsGroup* group, const size_t &nAccess
   for(auto it = accessedReplicasIdx.begin(); it != accessedReplicasIdx.end(); ++it)
   {
     const SchedTreeBase::tFastTreeIdx *idx=NULL;
-    const unsigned int fsid = (*entry->foregroundFastStruct->treeInfo)[*it].fsId;
-    if(!entry->foregroundFastStruct->fs2TreeIdx->get(fsid,idx))
+    const unsigned int fsid = (*ft->treeInfo)[*it].fsId;
+    if(!ft->fs2TreeIdx->get(fsid,idx))
     {
       eos_crit("inconsistency : cannot retrieve index of selected fs though it should be in the tree");
       success = false;
       goto cleanup;
     }
-    const char netSpeedClass = (*entry->foregroundFastStruct->treeInfo)[*idx].netSpeedClass;
+    const char netSpeedClass = (*ft->treeInfo)[*idx].netSpeedClass;
     accessedReplicas->push_back(fsid);
     // apply the penalties
-    if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.dlScore>=pAccessDlScorePenalty[netSpeedClass])
-    applyDlScorePenalty(entry,*idx,pAccessDlScorePenalty[netSpeedClass]);
-    if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.ulScore>=pAccessUlScorePenalty[netSpeedClass])
-    applyUlScorePenalty(entry,*idx,pAccessUlScorePenalty[netSpeedClass]);
+    if(ft->placementTree->pNodes[*idx].fsData.dlScore>=pAccessDlScorePenalty[netSpeedClass])
+    applyDlScorePenalty(ft,*idx,pAccessDlScorePenalty[netSpeedClass]);
+    if(ft->placementTree->pNodes[*idx].fsData.ulScore>=pAccessUlScorePenalty[netSpeedClass])
+    applyUlScorePenalty(ft,*idx,pAccessUlScorePenalty[netSpeedClass]);
   }
 
   // unlock, cleanup
   cleanup:
-  entry->doubleBufferMutex.UnLockRead();
+  entry->releaseForeground(ft);
   AtomicDec(entry->fastStructLockWaitersCount);
   if(existingReplicasIdx) delete existingReplicasIdx;
   if(excludeFsIdx) delete excludeFsIdx;
@@ -1058,7 +1063,10 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
 
   // maps tree maps entries (i.e. scheduling groups) to fsids containing a replica being available and the corresponding fastTreeIndex
   map<TreeMapEntry*,vector< pair<FileSystem::fsid_t,SchedTreeBase::tFastTreeIdx> > > entry2FsId;
+  // maps tree maps entries to the fast structures acquired for them
+  map<TreeMapEntry*,FastStructures*> entry2Ft;
   TreeMapEntry *entry=NULL;
+  FastStructures *ft=NULL;
   {
     // lock the scheduling group -> trees map so that the a map entry cannot be delete while processing it
     RWMutexReadLock lock(this->pTreeMapMutex);
@@ -1073,41 +1081,44 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
       }
       entry = mentry->second;
 
-      // lock the double buffering to make sure all the fast trees are not modified
+      // acquire the fast structures to make sure they are not modified
       if(!entry2FsId.count(entry))
       {
-        // if the entry is already there, it was locked already
-        entry->doubleBufferMutex.LockRead();
+        // if the entry is already there, they were acquired already
+        ft = entry->acquireForeground();
         // to prevent the destruction of the entry
         AtomicInc(entry->fastStructLockWaitersCount);
       }
+      else
+      ft = entry2Ft[entry];
 
       const SchedTreeBase::tFastTreeIdx *idx;
-      if(!entry->foregroundFastStruct->fs2TreeIdx->get(*exrepIt,idx) )
+      if(!ft->fs2TreeIdx->get(*exrepIt,idx) )
       {
         eos_warning("cannot find fs in the scheduling group in the 2nd pass");
         if(!entry2FsId.count(entry))
         {
-          entry->doubleBufferMutex.UnLockRead();
+          entry->releaseForeground(ft);
           AtomicDec(entry->fastStructLockWaitersCount);
         }
         continue;
       }
+      entry2Ft[entry] = ft;
       // check if the fs is available
       bool isValid = false;
       switch(type)
       {
         case regularRO:
-        isValid = entry->foregroundFastStruct->rOAccessTree->pBranchComp.isValidSlot(&entry->foregroundFastStruct->rOAccessTree->pNodes[*idx].fsData,&freeSlot);
+        isValid = ft->rOAccessTree->pBranchComp.isValidSlot(&ft->rOAccessTree->pNodes[*idx].fsData,&freeSlot);
         break;
         case regularRW:
-        isValid = entry->foregroundFastStruct->rWAccessTree->pBranchComp.isValidSlot(&entry->foregroundFastStruct->rWAccessTree->pNodes[*idx].fsData,&freeSlot);
+        isValid = ft->rWAccessTree->pBranchComp.isValidSlot(&ft->rWAccessTree->pNodes[*idx].fsData,&freeSlot);
         break;
         case draining:
-        isValid = entry->foregroundFastStruct->drnAccessTree->pBranchComp.isValidSlot(&entry->foregroundFastStruct->drnAccessTree->pNodes[*idx].fsData,&freeSlot);
+        isValid = ft->drnAccessTree->pBranchComp.isValidSlot(&ft->drnAccessTree->pNodes[*idx].fsData,&freeSlot);
         break;
         case balancing:
-        isValid = entry->foregroundFastStruct->blcAccessTree->pBranchComp.isValidSlot(&entry->foregroundFastStruct->blcAccessTree->pNodes[*idx].fsData,&freeSlot);
+        isValid = ft->blcAccessTree->pBranchComp.isValidSlot(&ft->blcAccessTree->pNodes[*idx].fsData,&freeSlot);
         break;
         default:
         break;
@@ -1165,7 +1176,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
           buffer[0]=0;
           buf = buffer;
           for(auto it = entryIt->second.begin(); it!= entryIt->second.end(); ++it)
-          buf += sprintf(buf,"%s  ",(*entryIt->first->foregroundFastStruct->treeInfo)[it->second].fullGeotag.c_str());
+          buf += sprintf(buf,"%s  ",(*entry2Ft[entryIt->first]->treeInfo)[it->second].fullGeotag.c_str());
           eos_debug("existing replicas geotags in geotree -> %s", buffer);
         }
 
@@ -1174,9 +1185,10 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
         continue;
 
         entry = entryIt->first;
+        ft = entry2Ft[entry];
 
         // find the closest tree node to the accesser
-        accesserNode = entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(accesserGeotag.c_str());;
+        accesserNode = ft->tag2NodeIdx->getClosestFastTreeNode(accesserGeotag.c_str());;
 
         // fill a vector with the indices of the replicas
         vector<SchedTreeBase::tFastTreeIdx> existingReplicasIdx(entryIt->second.size());
@@ -1189,27 +1201,27 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
         switch(type)
         {
           case regularRO:
-          retCode = accessReplicas(entryIt->first,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
-              entry->foregroundFastStruct->rOAccessTree,NULL,NULL,pSkipSaturatedAccess);
+          retCode = accessReplicas(ft,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
+              ft->rOAccessTree,NULL,NULL,pSkipSaturatedAccess);
           break;
           case regularRW:
-          retCode = accessReplicas(entryIt->first,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
-              entry->foregroundFastStruct->rWAccessTree,NULL,NULL,pSkipSaturatedAccess);
+          retCode = accessReplicas(ft,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
+              ft->rWAccessTree,NULL,NULL,pSkipSaturatedAccess);
           break;
           case draining:
-          retCode = accessReplicas(entryIt->first,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
-              entry->foregroundFastStruct->drnAccessTree,NULL,NULL,pSkipSaturatedDrnAccess);
+          retCode = accessReplicas(ft,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
+              ft->drnAccessTree,NULL,NULL,pSkipSaturatedDrnAccess);
           break;
           case balancing:
-          retCode = accessReplicas(entryIt->first,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
-              entry->foregroundFastStruct->blcAccessTree,NULL,NULL,pSkipSaturatedBlcAccess);
+          retCode = accessReplicas(ft,1,&accessedReplicasIdx,accesserNode,&existingReplicasIdx,
+              ft->blcAccessTree,NULL,NULL,pSkipSaturatedBlcAccess);
           break;
           default:
           break;
         }
         if(!retCode) goto cleanup;
 
-        const string &fsGeotag = (*entryIt->first->foregroundFastStruct->treeInfo)[*accessedReplicasIdx.begin()].fullGeotag;
+        const string &fsGeotag = (*ft->treeInfo)[*accessedReplicasIdx.begin()].fullGeotag;
         unsigned geoScore = 0;
         size_t kmax = min(accesserGeotag.length(),fsGeotag.length());
         for(size_t k=0; k<kmax; k++)
@@ -1227,7 +1239,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
         }
 
         geoScore2Fs[geoScore].push_back(
-            (*entryIt->first->foregroundFastStruct->treeInfo)[*accessedReplicasIdx.begin()].fsId);
+            (*ft->treeInfo)[*accessedReplicasIdx.begin()].fsId);
       }
 
       // randomly choose a fs among the highest scored ones
@@ -1261,7 +1273,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
       buf += sprintf(buf,"%lu  ",(unsigned long)(*it));
 
       eos_debug("existing replicas fs id's -> %s", buffer);
-      eos_debug("accesser closest node to %s index -> %d  /  %s",accesserGeotag.c_str(), (int)accesserNode,(*entry->foregroundFastStruct->treeInfo)[accesserNode].fullGeotag.c_str());
+      eos_debug("accesser closest node to %s index -> %d  /  %s",accesserGeotag.c_str(), (int)accesserNode,(*ft->treeInfo)[accesserNode].fullGeotag.c_str());
       eos_debug("selected FsId -> %d / idx %d", (int)selectedFsId,(int)fsIndex);
     }
   }
@@ -1286,18 +1298,21 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
       if(!pFs2TreeMapEntry.count(fs))
         continue;
       entry = pFs2TreeMapEntry[fs];
+      if(!entry2Ft.count(entry))
+        continue;
+      ft = entry2Ft[entry];
       const SchedTreeBase::tFastTreeIdx *idx;
-      if(entry->foregroundFastStruct->fs2TreeIdx->get(fs,idx))
+      if(ft->fs2TreeIdx->get(fs,idx))
       {
-        const char netSpeedClass = (*entry->foregroundFastStruct->treeInfo)[*idx].netSpeedClass;
+        const char netSpeedClass = (*ft->treeInfo)[*idx].netSpeedClass;
         // every available box will push data
-        if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.ulScore>=pAccessUlScorePenalty[netSpeedClass])
-        applyUlScorePenalty(entry,*idx,pAccessUlScorePenalty[netSpeedClass]);
+        if(ft->placementTree->pNodes[*idx].fsData.ulScore>=pAccessUlScorePenalty[netSpeedClass])
+        applyUlScorePenalty(ft,*idx,pAccessUlScorePenalty[netSpeedClass]);
         // every available box will have to pull data if it's a RW access (or if it's a gateway)
         if( (type==regularRW) || (j==fsIndex && nAccessReplicas>1) )
         {
-          if(entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.dlScore>=pAccessDlScorePenalty[netSpeedClass])
-          applyDlScorePenalty(entry,*idx,pAccessDlScorePenalty[netSpeedClass]);
+          if(ft->placementTree->pNodes[*idx].fsData.dlScore>=pAccessDlScorePenalty[netSpeedClass])
+          applyDlScorePenalty(ft,*idx,pAccessDlScorePenalty[netSpeedClass]);
         }
       }
       else
@@ -1316,7 +1331,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t &nAccessReplicas,
   cleanup:
   for(auto cit = entry2FsId.begin(); cit != entry2FsId.end(); cit++ )
   {
-    cit->first->doubleBufferMutex.UnLockRead();
+    cit->first->releaseForeground(entry2Ft[cit->first]);
     AtomicDec(cit->first->fastStructLockWaitersCount);
   }
   return returnCode;
@@ -1849,6 +1864,9 @@ bool GeoTreeEngine::updateTreeInfo(const map<string,int> &updates)
       AtomicCAS((*entry->foregroundFastStruct->penalties)[cur.second].dlScorePenalty,(*entry->foregroundFastStruct->penalties)[cur.second].dlScorePenalty,(char)0);
       AtomicCAS((*entry->foregroundFastStruct->penalties)[cur.second].ulScorePenalty,(*entry->foregroundFastStruct->penalties)[cur.second].ulScorePenalty,(char)0);
     }
+    // the penalties are now part of the scores : invalidate the thread local copies made with the previous counters
+    __sync_synchronize();
+    entry->foregroundFastStruct->generation = nextGeneration();
   }
   pTreeMapMutex.UnLockRead();
   // timestamp the current frame
@@ -1962,7 +1980,8 @@ bool GeoTreeEngine::getGroupsFromFsIds(const std::vector<FileSystem::fsid_t> fsi
   std::vector<std::pair<size_t,size_t> > groupcount;
   groupcount.reserve(fsids.size());
   {
-    RWMutexReadLock lock(this->pTreeMapMutex);
+    // the map might already be locked for a batch by the current thread
+    if(!tlTreeMapLocked) pTreeMapMutex.LockRead();
     for(auto it = fsids.begin(); it != fsids.end(); ++ it)
     {
       if(pFs2TreeMapEntry.count(*it))
@@ -2001,6 +2020,7 @@ bool GeoTreeEngine::getGroupsFromFsIds(const std::vector<FileSystem::fsid_t> fsi
 	result = false;
       }
     }
+    if(!tlTreeMapLocked) pTreeMapMutex.UnLockRead();
   }
 
   if(sortedgroups)
@@ -42,6 +42,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sched.h>
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -122,6 +123,22 @@ class GeoTreeEngine : public eos::common::LogId
 //**********************************************************
 // BEGIN INTERNAL CLASSES
 //**********************************************************
+  /*----------------------------------------------------------------------------*/
+  /**
+   * @brief counter of the threads currently reading a fast structures buffer
+   *        the threads are spread over several slots (one cache line each)
+   *        so that the readers do not contend on a single counter
+   *
+   */
+  /*----------------------------------------------------------------------------*/
+  static const size_t sReaderSlots = 32;
+  struct ReaderSlot
+  {
+    volatile size_t count;
+    char pad[64-sizeof(size_t)];
+    ReaderSlot() : count(0) {}
+  };
+
   /*----------------------------------------------------------------------------*/
   /**
    * @brief this structure holds all the fast structures needed to carry out
@@ -131,6 +148,8 @@ class GeoTreeEngine : public eos::common::LogId
   /*----------------------------------------------------------------------------*/
   struct FastStructures
   {
+    // threads using this buffer as the foreground fast structures
+    ReaderSlot readers[sReaderSlots];
     FastROAccessTree* rOAccessTree;
     FastRWAccessTree* rWAccessTree;
     FastBalancingAccessTree* blcAccessTree;
@@ -142,9 +161,13 @@ class GeoTreeEngine : public eos::common::LogId
     Fs2TreeIdxMap* fs2TreeIdx;
     GeoTag2NodeIdxMap* tag2NodeIdx;
     tPenaltiesVec *penalties;
+    // changes every time this buffer is published and every time its penalty counters are reset
+    // a thread-local copy of one of the trees is valid as long as the generation is the same
+    volatile size_t generation;
 
     FastStructures()
     {
+      generation = 0;
       rOAccessTree = new FastROAccessTree;
       rOAccessTree->selfAllocate(FastROAccessTree::sGetMaxNodeCount());
       rWAccessTree = new FastRWAccessTree;
@@ -204,6 +227,14 @@ class GeoTreeEngine : public eos::common::LogId
       if(tag2NodeIdx) delete tag2NodeIdx;
     }
 
+    size_t activeReaders() const
+    {
+      size_t count = 0;
+      for(size_t k = 0; k < sReaderSlots; k++)
+      count += readers[k].count;
+      return count;
+    }
+
     bool DeepCopyTo (FastStructures *target)
     {
       if(
@@ -275,12 +306,15 @@ class GeoTreeEngine : public eos::common::LogId
     // ===== Fast Structures Management and Double Buffering ====== //
     FastStructures fastStructures[2];
     // the pointed object is read only accessed by several thread
-    FastStructures *foregroundFastStruct;
+    // it is published atomically and should only be read through acquireForeground/releaseForeground
+    FastStructures * volatile foregroundFastStruct;
     // the pointed object is accessed in read /write only by the thread update
     FastStructures *backgroundFastStruct;
-    // the two previous pointers are swapped once an update is done. To do so, we need a mutex and a counter (for deletion)
-    // every access to *mForegroundFastStruct for reading should be protected by a LockRead to mDoubleBufferMutex
-    // when swapping mForegroundFastStruct and mBackgroundFastStruct is needed a LockWrite is taken to mDoubleBufferMutex
+    // the two previous pointers are swapped once an update is done
+    // the placement and access operations take no lock : they register in a reader slot of the foreground buffer
+    // a swap publishes the new foreground and then waits for the readers of the retired one before it can be modified again
+    // every modification of *mBackgroundFastStruct should be protected by a LockRead to mDoubleBufferMutex
+    // swapping mForegroundFastStruct and mBackgroundFastStruct takes a LockWrite to mDoubleBufferMutex
     eos::common::RWMutex doubleBufferMutex;
     size_t fastStructLockWaitersCount;
     bool fastStructModified;
@@ -305,8 +339,43 @@ class GeoTreeEngine : public eos::common::LogId
 
     void swapFastStructBuffers()
     {
-      eos::common::RWMutexWriteLock lock(doubleBufferMutex);
-      std::swap(foregroundFastStruct,backgroundFastStruct);
+      FastStructures *retired;
+      {
+	eos::common::RWMutexWriteLock lock(doubleBufferMutex);
+	retired = foregroundFastStruct;
+	backgroundFastStruct->generation = nextGeneration();
+	// publish the new foreground
+	__sync_synchronize();
+	foregroundFastStruct = backgroundFastStruct;
+	__sync_synchronize();
+	backgroundFastStruct = retired;
+      }
+      // grace period : the readers which got the retired buffer before the swap must be done with it
+      // before the updater modifies it as the new background
+      // the background is only modified by the updater thread which is the caller, so the write lock
+      // is not needed for the wait and the background modifiers are not blocked behind slow readers
+      while(retired->activeReaders())
+      sched_yield();
+    }
+
+    // get the current foreground fast structures, they stay valid until releaseForeground is called
+    FastStructures* acquireForeground()
+    {
+      size_t slot = readerSlot();
+      while(true)
+      {
+	FastStructures *ft = foregroundFastStruct;
+	AtomicInc(ft->readers[slot].count);
+	// if a swap happened meanwhile, the swapper might not have seen us : retry on the new foreground
+	if(ft == foregroundFastStruct)
+	return ft;
+	AtomicDec(ft->readers[slot].count);
+      }
+    }
+
+    void releaseForeground(FastStructures *ft)
+    {
+      AtomicDec(ft->readers[readerSlot()].count);
     }
 
     void updateBGFastStructuresConfigParam(
@@ -524,11 +593,41 @@ protected:
   std::map<FileSystem::fsid_t,FileSystem*> pFsId2FsPtr;
   /// protects all the above maps
   eos::common::RWMutex pTreeMapMutex;
+  /// changes every time an entry is added to or removed from pGroup2TreeMapEntry (under the write lock)
+  volatile size_t pTreeMapGeneration;
+  /// lookups using the thread local entry of their group without the map lock, see getTreeMapEntry
+  volatile size_t pLookupEpoch;
+  volatile size_t pLookupPins[2];
+  /// last entry looked up by the current thread
+  static __thread const FsGroup* tlEntryGroup;
+  static __thread TreeMapEntry* tlEntry;
+  static __thread size_t tlEntryGeneration;
+  /// pTreeMapMutex is read locked by the current thread for a batch
+  static __thread bool tlTreeMapLocked;
   //
   // => thread local data
   //
   /// Thread local buffer to hold a working copy of a fast structure
   static __thread void* tlGeoBuffer;
+  /// Thread local copy of the last fast tree used by the current thread without the penalties
+  /// the working copy is made from it as long as the tree is not published again
+  static __thread void* tlGeoSnapshot;
+  static __thread const void* tlGeoSnapshotSource;
+  static __thread size_t tlGeoSnapshotGeneration;
+  static size_t gFastStructGeneration;
+  static inline size_t nextGeneration()
+  {
+    return AtomicInc(gFastStructGeneration)+1;
+  }
+  /// Reader slot of the current thread (+1, 0 means not assigned yet)
+  static __thread size_t tlReaderSlot;
+  static size_t gReaderSlotCounter;
+  static inline size_t readerSlot()
+  {
+    if(!tlReaderSlot)
+    tlReaderSlot = 1 + (AtomicInc(gReaderSlotCounter) % sReaderSlots);
+    return tlReaderSlot-1;
+  }
   static pthread_key_t gPthreadKey;
   /// Current scheduling group for the current thread
   static __thread const FsGroup* tlCurrentGroup;
@@ -584,6 +683,14 @@ protected:
   /// Clean
   void checkPendingDeletions()
   {
+    if(pPendingDeletions.empty())
+    return;
+
+    // the pending entries are not in the map anymore but a lookup from a thread local entry might
+    // have checked the map generation before it changed : wait for the lookups in progress to be done
+    // after that, such a lookup either registered in fastStructLockWaitersCount or missed the entry
+    waitForLookups();
+
     int count = 0;
     auto lastEntry = pPendingDeletions.begin();
     bool eraseLastEntry = false;
@@ -604,13 +711,106 @@ protected:
     eos_debug("%d pending deletions executed",count);
   }
 
+  void waitForLookups()
+  {
+    for(int flip = 0; flip < 2; flip++)
+    {
+      size_t epoch = pLookupEpoch;
+      __sync_synchronize();
+      pLookupEpoch = epoch+1;
+      __sync_synchronize();
+      while(pLookupPins[epoch&1])
+      sched_yield();
+    }
+  }
+
+  /// Get the entry of a scheduling group and register in its fastStructLockWaitersCount
+  /// a repeated lookup of the same group by a thread does not take pTreeMapMutex
+  /// as long as no entry was added to or removed from the map
+  TreeMapEntry* getTreeMapEntry(const FsGroup* group)
+  {
+    if(tlEntry && tlEntryGroup == group)
+    {
+      size_t epoch = pLookupEpoch&1;
+      AtomicInc(pLookupPins[epoch]);
+      if(tlEntryGeneration == pTreeMapGeneration)
+      {
+	TreeMapEntry *entry = tlEntry;
+	AtomicInc(entry->fastStructLockWaitersCount);
+	AtomicDec(pLookupPins[epoch]);
+	return entry;
+      }
+      AtomicDec(pLookupPins[epoch]);
+    }
+
+    // the map might already be locked for a batch by the current thread
+    if(!tlTreeMapLocked) pTreeMapMutex.LockRead();
+    TreeMapEntry *entry = NULL;
+    auto it = pGroup2TreeMapEntry.find(group);
+    if(it != pGroup2TreeMapEntry.end())
+    {
+      entry = it->second;
+      AtomicInc(entry->fastStructLockWaitersCount);
+      tlEntryGroup = group;
+      tlEntry = entry;
+      tlEntryGeneration = pTreeMapGeneration;
+    }
+    if(!tlTreeMapLocked) pTreeMapMutex.UnLockRead();
+    return entry;
+  }
+
+  /// Get a working copy of one of the trees of the acquired fast structures ft
+  /// the tree is copied from the shared buffer only once per generation, the next calls
+  /// copy the thread local snapshot and apply the penalties of the other placements/accesses
+  template<class T> T* getWorkingCopy(FastStructures *ft, const T *source)
+  {
+    // allocate the buffers only once for the lifetime of the thread
+    if(!tlGeoBuffer)
+    {
+      size_t size = (gGeoBufferSize+63) & ~((size_t)63);
+      tlGeoBuffer = tlAlloc(2*size);
+      tlGeoSnapshot = (char*)tlGeoBuffer + size;
+      tlGeoSnapshotSource = NULL;
+    }
+
+    T *snapshot = (T*)tlGeoSnapshot;
+    size_t generation = ft->generation;
+    __sync_synchronize();
+    if(tlGeoSnapshotSource != source || tlGeoSnapshotGeneration != generation)
+    {
+      tlGeoSnapshotSource = NULL;
+      if(source->copyToBuffer((char*)tlGeoSnapshot,gGeoBufferSize))
+      return NULL;
+      // remove the penalties applied since the last reset to get the published scores
+      size_t count = std::min(ft->penalties->size(),(size_t)snapshot->getNodeCount());
+      for(size_t idx = 0; idx < count; idx++)
+      {
+	snapshot->pNodes[idx].fsData.dlScore += (*ft->penalties)[idx].dlScorePenalty;
+	snapshot->pNodes[idx].fsData.ulScore += (*ft->penalties)[idx].ulScorePenalty;
+      }
+      tlGeoSnapshotSource = source;
+      tlGeoSnapshotGeneration = generation;
+    }
+
+    if(snapshot->copyToBuffer((char*)tlGeoBuffer,gGeoBufferSize))
+    return NULL;
+    T *tree = (T*)tlGeoBuffer;
+    // apply the current penalties
+    size_t count = std::min(ft->penalties->size(),(size_t)tree->getNodeCount());
+    for(size_t idx = 0; idx < count; idx++)
+    {
+      tree->pNodes[idx].fsData.dlScore -= (*ft->penalties)[idx].dlScorePenalty;
+      tree->pNodes[idx].fsData.ulScore -= (*ft->penalties)[idx].ulScorePenalty;
+    }
+    return tree;
+  }
+
   /// thread-local buffer management
   static void tlFree( void *arg);
   static char* tlAlloc( size_t size);
 
-  inline void applyDlScorePenalty(TreeMapEntry *entry, const SchedTreeBase::tFastTreeIdx &idx, const char &penalty, bool background=false)
+  inline void applyDlScorePenalty(FastStructures *ft, const SchedTreeBase::tFastTreeIdx &idx, const char &penalty, bool background=false)
   {
-    FastStructures *ft = background?entry->backgroundFastStruct:entry->foregroundFastStruct;
     AtomicSub(ft->placementTree->pNodes[idx].fsData.dlScore,penalty);
     AtomicSub(ft->drnPlacementTree->pNodes[idx].fsData.dlScore,penalty);
     AtomicSub(ft->blcPlacementTree->pNodes[idx].fsData.dlScore,penalty);
@@ -625,9 +825,8 @@ protected:
   }
 
 
-  inline void applyUlScorePenalty(TreeMapEntry *entry, const SchedTreeBase::tFastTreeIdx &idx, const char &penalty, bool background=false)
+  inline void applyUlScorePenalty(FastStructures *ft, const SchedTreeBase::tFastTreeIdx &idx, const char &penalty, bool background=false)
   {
-    FastStructures *ft = background?entry->backgroundFastStruct:entry->foregroundFastStruct;
     AtomicSub(ft->placementTree->pNodes[idx].fsData.ulScore,penalty);
     AtomicSub(ft->drnPlacementTree->pNodes[idx].fsData.ulScore,penalty);
     AtomicSub(ft->blcPlacementTree->pNodes[idx].fsData.ulScore,penalty);
@@ -652,12 +851,12 @@ protected:
         circIdx=((pCircSize+circIdx-1)%pCircSize) )
     {
       if(entry->foregroundFastStruct->placementTree->pNodes[idx].fsData.dlScore>0)
-      applyDlScorePenalty(entry,idx,
+      applyDlScorePenalty(entry->backgroundFastStruct,idx,
                           pCircFrCnt2FsPenalties[circIdx][fsid].dlScorePenalty,
                           true
                           );
       if(entry->foregroundFastStruct->placementTree->pNodes[idx].fsData.ulScore>0)
-      applyUlScorePenalty(entry,idx,
+      applyUlScorePenalty(entry->backgroundFastStruct,idx,
                           pCircFrCnt2FsPenalties[circIdx][fsid].ulScorePenalty,
                           true
                           );
@@ -679,7 +878,7 @@ protected:
 //    }
   }
 
-  template<class T> bool placeNewReplicas(TreeMapEntry* entry, const size_t &nNewReplicas,
+  template<class T> bool placeNewReplicas(FastStructures* ft, const size_t &nNewReplicas,
 
       std::vector<SchedTreeBase::tFastTreeIdx> *newReplicas,
       T *placementTree,
@@ -691,7 +890,7 @@ protected:
       std::vector<SchedTreeBase::tFastTreeIdx> *forceNodes=NULL,
       bool skipSaturated=false)
   {
-    // a read lock is supposed to be acquired on the fast structures
+    // the fast structures are supposed to be acquired (acquireForeground)
 
     bool updateNeeded = false;
 
@@ -703,15 +902,12 @@ protected:
     }
 
     // make a working copy of the required fast tree
-    // allocate the buffer only once for the lifetime of the thread
-    if(!tlGeoBuffer) tlGeoBuffer = tlAlloc(gGeoBufferSize);
-
-    if(placementTree->copyToBuffer((char*)tlGeoBuffer,gGeoBufferSize))
+    T *tree = getWorkingCopy(ft,placementTree);
+    if(!tree)
     {
       eos_crit("could not make a working copy of the fast tree");
       return false;
     }
-    T *tree = (T*)tlGeoBuffer;
 
     if(forceNodes)
     {
@@ -815,7 +1011,7 @@ protected:
     return true;
   }
 
-  template<class T> unsigned char accessReplicas(TreeMapEntry* entry, const size_t &nNewReplicas,
+  template<class T> unsigned char accessReplicas(FastStructures* ft, const size_t &nNewReplicas,
       std::vector<SchedTreeBase::tFastTreeIdx> *accessedReplicas,
       SchedTreeBase::tFastTreeIdx accesserNode,
       std::vector<SchedTreeBase::tFastTreeIdx> *existingReplicas,
@@ -833,15 +1029,12 @@ protected:
     }
 
     // make a working copy of the required fast tree
-    // allocate the buffer only once for the lifetime of the thread
-    if(!tlGeoBuffer) tlGeoBuffer = tlAlloc(gGeoBufferSize);
-
-    if(accessTree->copyToBuffer((char*)tlGeoBuffer,gGeoBufferSize))
+    T *tree = getWorkingCopy(ft,accessTree);
+    if(!tree)
     {
       eos_crit("could not make a working copy of the fast tree");
       return 0;
     }
-    T *tree = (T*)tlGeoBuffer;
     eos_static_debug("saturationTresh original=%d / copy=%d",(int)accessTree->pBranchComp.saturationThresh,(int)tree->pBranchComp.saturationThresh);
 
     if(forceNodes)
@@ -1033,6 +1226,7 @@ public:
   pPenaltyUpdateRate(1),
   pFillRatioLimit(80),pFillRatioCompTol(100),pSaturationThres(10),
   pTimeFrameDurationMs(1000),pPublishToPenaltyDelayMs(1000),
+  pTreeMapGeneration(0),pLookupEpoch(0),
   pCircSize(30),pFrameCount(0), pCircFrCnt2FsPenalties(pCircSize),
   pMaxNetSpeedClass(0),
   pPlctDlScorePenaltyF(8,10),pPlctUlScorePenaltyF(8,10),     // 8 is just a simple way to deal with the initialiaztion of the vector (it's an overshoot but the overhead is tiny)
@@ -1050,6 +1244,7 @@ public:
     pAddRmFsMutex.SetBlocking(true);
     configMutex.SetBlocking(true);
     pTreeMapMutex.SetBlocking(true);
+    pLookupPins[0] = pLookupPins[1] = 0;
     for(auto it=pCircFrCnt2FsPenalties.begin(); it!=pCircFrCnt2FsPenalties.end(); it++)
       it->reserve(100);
     // create the thread local key to handle allocation/destruction of thread local geobuffers
@@ -1175,6 +1370,23 @@ public:
       std::vector<std::string> *excludeGeoTags=NULL,
       std::vector<std::string> *forceGeoTags=NULL);
 
+  // ---------------------------------------------------------------------------
+  //! Keep the scheduling group map locked for a batch of placements
+  //! done by the current thread : until unlockForBatch is called,
+  //! placeNewReplicasOneGroup and getGroupsFromFsIds don't lock it again
+  // ---------------------------------------------------------------------------
+  void lockForBatch()
+  {
+    pTreeMapMutex.LockRead();
+    tlTreeMapLocked = true;
+  }
+
+  void unlockForBatch()
+  {
+    tlTreeMapLocked = false;
+    pTreeMapMutex.UnLockRead();
+  }
+
   // ---------------------------------------------------------------------------
   //! Access several replicas in one scheduling group.
   // @param group
@@ -44,6 +44,152 @@ const char* Iostat::gIostatReportNamespace = "iostat::reportnamespace";
 const char* Iostat::gIostatPopularity = "iostat::popularity";
 const char* Iostat::gIostatUdpTargetList = "iostat::udptargets";
 
+const char* Iostat::gIostatTags[] = {
+  "bytes_read", "bytes_written", "read_calls", "readv_calls", "write_calls",
+  "fwd_seeks", "bwd_seeks", "xl_fwd_seeks", "xl_bwd_seeks", "bytes_fwd_seek",
+  "bytes_bwd_wseek", "bytes_xl_fwd_seek", "bytes_xl_bwd_wseek",
+  "disk_time_read", "disk_time_write"
+};
+
+const size_t Iostat::gIostatNumTags = sizeof (Iostat::gIostatTags) / sizeof (Iostat::gIostatTags[0]);
+
+/* ------------------------------------------------------------------------- */
+IostatHeavyHitters::IostatHeavyHitters () : mCapacity (IOSTAT_POPULARITY_CAPACITY), mByBytes (false)
+{
+  mIndex.set_empty_key(0);
+  mIndex.set_deleted_key(1);
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::Init (size_t capacity, bool bybytes)
+{
+  mCapacity = capacity ? capacity : 1;
+  mByBytes = bybytes;
+  Clear();
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::Clear ()
+{
+  mEntries.clear();
+  mIndex.clear();
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::Swap (size_t a, size_t b)
+{
+  std::swap(mEntries[a], mEntries[b]);
+  mIndex[mEntries[a].id] = a;
+  mIndex[mEntries[b].id] = b;
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::SiftUp (size_t pos)
+{
+  while (pos)
+  {
+    size_t parent = (pos - 1) / 2;
+    if (mEntries[parent].weight <= mEntries[pos].weight)
+      break;
+    Swap(parent, pos);
+    pos = parent;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::SiftDown (size_t pos)
+{
+  while (1)
+  {
+    size_t lightest = pos;
+    size_t left = 2 * pos + 1;
+    size_t right = left + 1;
+    if ((left < mEntries.size()) && (mEntries[left].weight < mEntries[lightest].weight))
+      lightest = left;
+    if ((right < mEntries.size()) && (mEntries[right].weight < mEntries[lightest].weight))
+      lightest = right;
+    if (lightest == pos)
+      break;
+    Swap(lightest, pos);
+    pos = lightest;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::Add (uint64_t id, const std::string& path,
+                         unsigned long long nread, unsigned long long rb)
+{
+  // ---------------------------------------------------------------------------
+  // ! space saving: a new prefix replaces the lightest entry and inherits its
+  // ! weight as error, so memory is bounded by the capacity and every prefix
+  // ! heavier than total/capacity is guaranteed to be tracked
+  // ---------------------------------------------------------------------------
+  unsigned long long weight = mByBytes ? rb : nread;
+  google::dense_hash_map<uint64_t, size_t>::iterator it = mIndex.find(id);
+
+  if (it != mIndex.end())
+  {
+    Entry& entry = mEntries[it->second];
+    entry.weight += weight;
+    entry.nread += nread;
+    entry.rb += rb;
+    SiftDown(it->second);
+    return;
+  }
+
+  if (!weight)
+    return;
+
+  Entry entry;
+  entry.id = id;
+  entry.path = path;
+  entry.weight = weight;
+  entry.error = 0;
+  entry.nread = nread;
+  entry.rb = rb;
+
+  if (mEntries.size() < mCapacity)
+  {
+    mEntries.push_back(entry);
+    mIndex[id] = mEntries.size() - 1;
+    SiftUp(mEntries.size() - 1);
+    return;
+  }
+
+  // evict the lightest entry
+  mIndex.erase(mEntries[0].id);
+  entry.error = mEntries[0].weight;
+  entry.weight += mEntries[0].weight;
+  mEntries[0] = entry;
+  mIndex[id] = 0;
+  SiftDown(0);
+}
+
+/* ------------------------------------------------------------------------- */
+void
+IostatHeavyHitters::Get (std::vector<const Entry*>& entries) const
+{
+  entries.reserve(entries.size() + mEntries.size());
+  for (size_t i = 0; i < mEntries.size(); i++)
+    entries.push_back(&mEntries[i]);
+}
+
+/* ------------------------------------------------------------------------- */
+Iostat::IostatShard::IostatShard (Iostat* iostat) :
+mIostat (iostat), mThread (0), mUid (gIostatNumTags), mGid (gIostatNumTags),
+mAvgUid (gIostatNumTags), mAvgGid (gIostatNumTags), mLastPopularityBin (0),
+mPending (0), mLastMerge (0)
+{
+  for (size_t i = 0; i < IOSTAT_POPULARITY_HISTORY_DAYS; i++)
+    mPopularity[i].set_empty_key(0);
+}
+
 /* ------------------------------------------------------------------------- */
 Iostat::Iostat ()
 {
@@ -81,10 +227,16 @@ Iostat::Iostat ()
 
   for (size_t i = 0; i < IOSTAT_POPULARITY_HISTORY_DAYS; i++)
   {
-    IostatPopularity[i].set_deleted_key("");
-    IostatPopularity[i].resize(100000);
+    IostatPopularityNread[i].Init(IOSTAT_POPULARITY_CAPACITY, false);
+    IostatPopularityRb[i].Init(IOSTAT_POPULARITY_CAPACITY, true);
   }
 
+  for (size_t i = 0; i < IOSTAT_RECEIVER_THREADS; i++)
+  {
+    mShards.push_back(new IostatShard(this));
+  }
+
+  mNextShard = 0;
   IostatLastPopularityBin = 0;
   mReportPopularity = true;
   mReportNamespace = false;
@@ -201,6 +353,11 @@ Iostat::Start ()
 
   if (!mRunning)
   {
+    mReportStore.SetPath(gOFS->IoReportStorePath.c_str());
+    for (size_t i = 0; i < mShards.size(); i++)
+    {
+      XrdSysThread::Run(&mShards[i]->mThread, Iostat::StaticWorker, static_cast<void *> (mShards[i]), XRDSYSTHREAD_HOLD, "Report Digest Thread");
+    }
     mClient.Subscribe();
     XrdSysThread::Run(&thread, Iostat::StaticReceive, static_cast<void *> (this), XRDSYSTHREAD_HOLD, "Report Receiver Thread");
     mRunning = true;
@@ -220,6 +377,16 @@ Iostat::Stop ()
   {
     XrdSysThread::Cancel(thread);
     XrdSysThread::Join(thread, NULL);
+    // let the digest threads drain their queues and merge their shards
+    for (size_t i = 0; i < mShards.size(); i++)
+    {
+      XrdMqMessage* stop = 0;
+      mShards[i]->mQueue.push(stop);
+    }
+    for (size_t i = 0; i < mShards.size(); i++)
+    {
+      XrdSysThread::Join(mShards[i]->mThread, NULL);
+    }
     mRunning = false;
     mClient.Unsubscribe();
     return true;
@@ -240,6 +407,10 @@ Iostat::~Iostat ()
     XrdSysThread::Cancel(cthread);
     XrdSysThread::Join(cthread, NULL);
   }
+  for (size_t i = 0; i < mShards.size(); i++)
+  {
+    delete mShards[i];
+  }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -256,209 +427,287 @@ Iostat::StaticCirculate (void* arg)
   return reinterpret_cast<Iostat*> (arg)->Circulate();
 }
 
+/* ------------------------------------------------------------------------- */
+void*
+Iostat::StaticWorker (void* arg)
+{
+  IostatShard* shard = reinterpret_cast<IostatShard*> (arg);
+  return shard->mIostat->Worker(shard);
+}
+
 /* ------------------------------------------------------------------------- */
 void*
 Iostat::Receive (void)
 {
+  // ---------------------------------------------------------------------------
+  // ! dispatch the report messages round-robin to the receiver shards
+  // ---------------------------------------------------------------------------
   while (1)
   {
     XrdMqMessage* newmessage = 0;
     while ((newmessage = mClient.RecvMessage()))
     {
-      XrdOucString body = newmessage->GetBody();
-      while (body.replace("&&", "&"))
+      mShards[mNextShard++ % mShards.size()]->mQueue.push(newmessage);
+    }
+    XrdSysThread::SetCancelOn();
+    XrdSysTimer sleeper;
+    sleeper.Snooze(1);
+    XrdSysThread::CancelPoint();
+    XrdSysThread::SetCancelOff();
+
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+void*
+Iostat::Worker (IostatShard* shard)
+{
+  // ---------------------------------------------------------------------------
+  // ! digest messages into the shard - the shard is merged every second, every
+  // ! 4096 reports and whenever the queue runs empty
+  // ---------------------------------------------------------------------------
+  while (1)
+  {
+    XrdMqMessage* message = 0;
+
+    if (!shard->mQueue.try_pop(message))
+    {
       {
+        XrdSysMutexHelper sLock(shard->mMutex);
+        MergeShard(*shard);
       }
-      XrdOucEnv ioreport(body.c_str());
-      eos::common::Report* report = new eos::common::Report(ioreport);
-      Add("bytes_read", report->uid, report->gid, report->rb, report->ots, report->cts);
-      Add("bytes_written", report->uid, report->gid, report->wb, report->ots, report->cts);
-      Add("read_calls", report->uid, report->gid, report->nrc, report->ots, report->cts);
-      Add("readv_calls", report->uid, report->gid, report->rv_op, report->ots, report->cts);      
-      Add("write_calls", report->uid, report->gid, report->nwc, report->ots, report->cts);
-      Add("fwd_seeks", report->uid, report->gid, report->nfwds, report->ots, report->cts);
-      Add("bwd_seeks", report->uid, report->gid, report->nbwds, report->ots, report->cts);
-      Add("xl_fwd_seeks", report->uid, report->gid, report->nxlfwds, report->ots, report->cts);
-      Add("xl_bwd_seeks", report->uid, report->gid, report->nxlbwds, report->ots, report->cts);
-      Add("bytes_fwd_seek", report->uid, report->gid, report->sfwdb, report->ots, report->cts);
-      Add("bytes_bwd_wseek", report->uid, report->gid, report->sbwdb, report->ots, report->cts);
-      Add("bytes_xl_fwd_seek", report->uid, report->gid, report->sxlfwdb, report->ots, report->cts);
-      Add("bytes_xl_bwd_wseek", report->uid, report->gid, report->sxlbwdb, report->ots, report->cts);
-      Add("disk_time_read", report->uid, report->gid, (unsigned long long) report->rt, report->ots, report->cts);
-      Add("disk_time_write", report->uid, report->gid, (unsigned long long) report->wt, report->ots, report->cts);
-
-      // do the UDP broadcasting here
+      // write the buffered records once the queue is drained
+      mReportStore.Flush();
+      shard->mQueue.wait_pop(message);
+    }
+
+    if (!message)
+      break;
+
+    XrdSysMutexHelper sLock(shard->mMutex);
+    Digest(*shard, message);
+
+    if ((shard->mPending >= 4096) || (shard->mLastMerge != time(NULL)))
+      MergeShard(*shard);
+  }
+
+  {
+    XrdSysMutexHelper sLock(shard->mMutex);
+    MergeShard(*shard);
+  }
+  mReportStore.Flush();
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Digest (IostatShard& shard, XrdMqMessage* message)
+{
+  XrdOucString body = message->GetBody();
+  while (body.replace("&&", "&"))
+  {
+  }
+  XrdOucEnv ioreport(body.c_str());
+  eos::common::Report* report = new eos::common::Report(ioreport);
+  AddShard(shard, 0, report->uid, report->gid, report->rb, report->ots, report->cts); // bytes_read
+  AddShard(shard, 1, report->uid, report->gid, report->wb, report->ots, report->cts); // bytes_written
+  AddShard(shard, 2, report->uid, report->gid, report->nrc, report->ots, report->cts); // read_calls
+  AddShard(shard, 3, report->uid, report->gid, report->rv_op, report->ots, report->cts); // readv_calls
+  AddShard(shard, 4, report->uid, report->gid, report->nwc, report->ots, report->cts); // write_calls
+  AddShard(shard, 5, report->uid, report->gid, report->nfwds, report->ots, report->cts); // fwd_seeks
+  AddShard(shard, 6, report->uid, report->gid, report->nbwds, report->ots, report->cts); // bwd_seeks
+  AddShard(shard, 7, report->uid, report->gid, report->nxlfwds, report->ots, report->cts); // xl_fwd_seeks
+  AddShard(shard, 8, report->uid, report->gid, report->nxlbwds, report->ots, report->cts); // xl_bwd_seeks
+  AddShard(shard, 9, report->uid, report->gid, report->sfwdb, report->ots, report->cts); // bytes_fwd_seek
+  AddShard(shard, 10, report->uid, report->gid, report->sbwdb, report->ots, report->cts); // bytes_bwd_wseek
+  AddShard(shard, 11, report->uid, report->gid, report->sxlfwdb, report->ots, report->cts); // bytes_xl_fwd_seek
+  AddShard(shard, 12, report->uid, report->gid, report->sxlbwdb, report->ots, report->cts); // bytes_xl_bwd_wseek
+  AddShard(shard, 13, report->uid, report->gid, (unsigned long long) report->rt, report->ots, report->cts); // disk_time_read
+  AddShard(shard, 14, report->uid, report->gid, (unsigned long long) report->wt, report->ots, report->cts); // disk_time_write
+
+  // do the UDP broadcasting here
+  {
+    XrdSysMutexHelper mLock(BroadcastMutex);
+    if (mUdpPopularityTarget.size())
+    {
+      UdpBroadCast(report);
+    }
+  }
+
+  // do the domain accounting here      
+  if (report->path.substr(0, 11) == "/replicate:")
+  {
+    // check if this is a replication path
+    // push into the 'eos' domain
+    if (report->rb)
+      shard.mAvgDomainIOrb["eos"].Add(report->rb, report->ots, report->cts);
+    if (report->wb)
+      shard.mAvgDomainIOwb["eos"].Add(report->wb, report->ots, report->cts);
+  }
+  else
+  {
+    bool dfound = false;
+
+    if (mReportPopularity)
+    {
+      // do the popularity accounting here for everything which is not replication!
+      AddToPopularity(shard, report->path, report->rb, report->ots, report->cts);
+    }
+
+    size_t pos = 0;
+    if ((pos = report->sec_domain.rfind(".")) != std::string::npos)
+    {
+      // we can sort in by domain
+      std::string sdomain = report->sec_domain.substr(pos);
+      if (IoDomains.find(sdomain) != IoDomains.end())
       {
-        XrdSysMutexHelper mLock(BroadcastMutex);
-        if (mUdpPopularityTarget.size())
-        {
-          UdpBroadCast(report);
-        }
+        if (report->rb)
+          shard.mAvgDomainIOrb[sdomain].Add(report->rb, report->ots, report->cts);
+        if (report->wb)
+          shard.mAvgDomainIOwb[sdomain].Add(report->wb, report->ots, report->cts);
+        dfound = true;
       }
+    }
 
-      // do the domain accounting here      
-      if (report->path.substr(0, 11) == "/replicate:")
+    // do the node accounting here - keep the node list small !!!
+    std::set<std::string>::const_iterator nit;
+    for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++)
+    {
+      if (*nit == report->sec_host.substr(0, nit->length()))
       {
-        // check if this is a replication path
-        // push into the 'eos' domain
-        Mutex.Lock();
         if (report->rb)
-          IostatAvgDomainIOrb["eos"].Add(report->rb, report->ots, report->cts);
+          shard.mAvgDomainIOrb[*nit].Add(report->rb, report->ots, report->cts);
         if (report->wb)
-          IostatAvgDomainIOwb["eos"].Add(report->wb, report->ots, report->cts);
-        Mutex.UnLock();
+          shard.mAvgDomainIOwb[*nit].Add(report->wb, report->ots, report->cts);
+        dfound = true;
       }
-      else
-      {
-        bool dfound = false;
+    }
 
-        if (mReportPopularity)
-        {
-          // do the popularity accounting here for everything which is not replication!
-          AddToPopularity(report->path, report->rb, report->ots, report->cts);
-        }
+    if (!dfound)
+    {
+      // push into the 'other' domain
+      if (report->rb)
+        shard.mAvgDomainIOrb["other"].Add(report->rb, report->ots, report->cts);
+      if (report->wb)
+        shard.mAvgDomainIOwb["other"].Add(report->wb, report->ots, report->cts);
+    }
+  }
 
-        size_t pos = 0;
-        if ((pos = report->sec_domain.rfind(".")) != std::string::npos)
-        {
-          // we can sort in by domain
-          std::string sdomain = report->sec_domain.substr(pos);
-          if (IoDomains.find(sdomain) != IoDomains.end())
-          {
-            Mutex.Lock();
-            if (report->rb)
-              IostatAvgDomainIOrb[sdomain].Add(report->rb, report->ots, report->cts);
-            if (report->wb)
-              IostatAvgDomainIOwb[sdomain].Add(report->wb, report->ots, report->cts);
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
+  // do the application accounting here      
+  std::string apptag = "other";
+  if (report->sec_app.length())
+  {
+    apptag = report->sec_app;
+  }
 
-        // do the node accounting here - keep the node list small !!!
-        std::set<std::string>::const_iterator nit;
-        for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++)
-        {
-          if (*nit == report->sec_host.substr(0, nit->length()))
-          {
-            Mutex.Lock();
-            if (report->rb)
-              IostatAvgDomainIOrb[*nit].Add(report->rb, report->ots, report->cts);
-            if (report->wb)
-              IostatAvgDomainIOwb[*nit].Add(report->wb, report->ots, report->cts);
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
+  // push into the app accounting
+  if (report->rb)
+    shard.mAvgAppIOrb[apptag].Add(report->rb, report->ots, report->cts);
+  if (report->wb)
+    shard.mAvgAppIOwb[apptag].Add(report->wb, report->ots, report->cts);
 
-        if (!dfound)
-        {
-          // push into the 'other' domain
-          Mutex.Lock();
-          if (report->rb)
-            IostatAvgDomainIOrb["other"].Add(report->rb, report->ots, report->cts);
-          if (report->wb)
-            IostatAvgDomainIOwb["other"].Add(report->wb, report->ots, report->cts);
-          Mutex.UnLock();
-        }
-      }
+  if (mReport || mReportNamespace)
+  {
+    // add the record to the daily binary report segment - records with
+    // namespace reporting enabled are added to the path index
+    if (!mReportStore.Append(*report, mReportNamespace))
+    {
+      eos_static_err("failed to append report to store <%s>",
+                     gOFS->IoReportStorePath.c_str());
+    }
+  }
 
-      // do the application accounting here      
-      std::string apptag = "other";
-      if (report->sec_app.length())
-      {
-        apptag = report->sec_app;
-      }
+  shard.mPending++;
+  delete report;
+  delete message;
+}
 
-      // push into the app accounting
-      Mutex.Lock();
-      if (report->rb)
-        IostatAvgAppIOrb[apptag].Add(report->rb, report->ots, report->cts);
-      if (report->wb)
-        IostatAvgAppIOwb[apptag].Add(report->wb, report->ots, report->cts);
-      Mutex.UnLock();
+/* ------------------------------------------------------------------------- */
+void
+Iostat::MergeShard (IostatShard& shard)
+{
+  if (!shard.mPending)
+    return;
 
-      if (mReport)
-      {
-        // add the record to a daily report log file
+  {
+    XrdSysMutexHelper mLock(Mutex);
 
-        static XrdOucString openreportfile = "";
-        static FILE* openreportfd = 0;
-        time_t now = time(NULL);
-        struct tm nowtm;
-        XrdOucString reportfile = "";
+    for (size_t t = 0; t < gIostatNumTags; t++)
+    {
+      if (shard.mUid[t].empty())
+        continue;
 
-        if (localtime_r(&now, &nowtm))
-        {
-          static char logfile[4096];
-          snprintf(logfile, sizeof (logfile) - 1, "%s/%04u/%02u/%04u%02u%02u.eosreport",
-                   gOFS->IoReportStorePath.c_str(),
-                   1900 + nowtm.tm_year,
-                   nowtm.tm_mon + 1,
-                   1900 + nowtm.tm_year,
-                   nowtm.tm_mon + 1,
-                   nowtm.tm_mday);
-
-          reportfile = logfile;
-
-          if (reportfile == openreportfile)
-          {
-            // just add it here;
-            if (openreportfd)
-            {
-              fprintf(openreportfd, "%s\n", body.c_str());
-              fflush(openreportfd);
-            }
-          }
-          else
-          {
-            if (openreportfd)
-              fclose(openreportfd);
+      std::string tag = gIostatTags[t];
+      google::sparse_hash_map<uid_t, unsigned long long>& uidmap = IostatUid[tag];
+      google::sparse_hash_map<gid_t, unsigned long long>& gidmap = IostatGid[tag];
+      google::sparse_hash_map<uid_t, IostatAvg>& avguidmap = IostatAvgUid[tag];
+      google::sparse_hash_map<gid_t, IostatAvg>& avggidmap = IostatAvgGid[tag];
+      google::sparse_hash_map<uid_t, unsigned long long>::const_iterator it;
+      google::sparse_hash_map<uid_t, IostatAvg>::const_iterator ait;
 
-            eos::common::Path cPath(reportfile.c_str());
-            if (cPath.MakeParentPath(S_IRWXU))
-            {
-              openreportfd = fopen(reportfile.c_str(), "a+");
-              if (openreportfd)
-              {
-                fprintf(openreportfd, "%s\n", body.c_str());
-                fflush(openreportfd);
-              }
-              openreportfile = reportfile;
-            }
-          }
-        }
-      }
+      for (it = shard.mUid[t].begin(); it != shard.mUid[t].end(); ++it)
+        uidmap[it->first] += it->second;
 
-      if (mReportNamespace)
-      {
-        // add the record into the report namespace file
-        char path[4096];
-        snprintf(path, sizeof (path) - 1, "%s/%s", gOFS->IoReportStorePath.c_str(), report->path.c_str());
-        eos::common::Path cPath(path);
+      for (it = shard.mGid[t].begin(); it != shard.mGid[t].end(); ++it)
+        gidmap[it->first] += it->second;
 
-        if (cPath.MakeParentPath(S_IRWXU))
-        {
-          FILE* freport = fopen(path, "a+");
-          if (freport)
-          {
-            fprintf(freport, "%s\n", body.c_str());
-            fclose(freport);
-          }
-        }
+      for (ait = shard.mAvgUid[t].begin(); ait != shard.mAvgUid[t].end(); ++ait)
+        avguidmap[ait->first].Merge(ait->second);
+
+      for (ait = shard.mAvgGid[t].begin(); ait != shard.mAvgGid[t].end(); ++ait)
+        avggidmap[ait->first].Merge(ait->second);
+
+      shard.mUid[t].clear();
+      shard.mGid[t].clear();
+      shard.mAvgUid[t].clear();
+      shard.mAvgGid[t].clear();
+    }
+
+    google::sparse_hash_map<std::string, IostatAvg>::const_iterator dit;
+
+    for (dit = shard.mAvgDomainIOrb.begin(); dit != shard.mAvgDomainIOrb.end(); ++dit)
+      IostatAvgDomainIOrb[dit->first].Merge(dit->second);
+
+    for (dit = shard.mAvgDomainIOwb.begin(); dit != shard.mAvgDomainIOwb.end(); ++dit)
+      IostatAvgDomainIOwb[dit->first].Merge(dit->second);
+
+    for (dit = shard.mAvgAppIOrb.begin(); dit != shard.mAvgAppIOrb.end(); ++dit)
+      IostatAvgAppIOrb[dit->first].Merge(dit->second);
+
+    for (dit = shard.mAvgAppIOwb.begin(); dit != shard.mAvgAppIOwb.end(); ++dit)
+      IostatAvgAppIOwb[dit->first].Merge(dit->second);
+
+    shard.mAvgDomainIOrb.clear();
+    shard.mAvgDomainIOwb.clear();
+    shard.mAvgAppIOrb.clear();
+    shard.mAvgAppIOwb.clear();
+  }
+
+  {
+    XrdSysMutexHelper pLock(PopularityMutex);
+    bool added = false;
+
+    for (size_t bin = 0; bin < IOSTAT_POPULARITY_HISTORY_DAYS; bin++)
+    {
+      google::dense_hash_map<uint64_t, PopularityDelta>::const_iterator pit;
+
+      for (pit = shard.mPopularity[bin].begin(); pit != shard.mPopularity[bin].end(); ++pit)
+      {
+        IostatPopularityNread[bin].Add(pit->first, pit->second.path, pit->second.nread, pit->second.rb);
+        IostatPopularityRb[bin].Add(pit->first, pit->second.path, pit->second.nread, pit->second.rb);
+        added = true;
       }
 
-      delete report;
-      delete newmessage;
+      shard.mPopularity[bin].clear();
     }
-    XrdSysThread::SetCancelOn();
-    XrdSysTimer sleeper;
-    sleeper.Snooze(1);
-    XrdSysThread::CancelPoint();
-    XrdSysThread::SetCancelOff();
 
+    if (added)
+      IostatLastPopularityBin = shard.mLastPopularityBin;
   }
-  return 0;
+
+  shard.mPending = 0;
+  shard.mLastMerge = time(NULL);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1165,10 +1414,29 @@ Iostat::PrintNs (XrdOucString &out, XrdOucString option)
   {
     PopularityMutex.Lock();
     size_t sbin = (IOSTAT_POPULARITY_HISTORY_DAYS + popularitybin - pbin) % IOSTAT_POPULARITY_HISTORY_DAYS;
-    google::sparse_hash_map<std::string, struct Popularity>::const_iterator it;
+    std::vector<const IostatHeavyHitters::Entry*> entries;
+    std::vector<popularity_t> popularity_nread;
+    std::vector<popularity_t> popularity_rb;
+
+    // the ranking metric of each sketch is its (upper bound) estimate
+    IostatPopularityNread[sbin].Get(entries);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      struct Popularity pop;
+      pop.nread = entries[i]->weight;
+      pop.rb = entries[i]->rb;
+      popularity_nread.push_back(popularity_t(entries[i]->path, pop));
+    }
 
-    std::vector<popularity_t> popularity_nread(IostatPopularity[sbin].begin(), IostatPopularity[sbin].end());
-    std::vector<popularity_t> popularity_rb(IostatPopularity[sbin].begin(), IostatPopularity[sbin].end());
+    entries.clear();
+    IostatPopularityRb[sbin].Get(entries);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      struct Popularity pop;
+      pop.nread = entries[i]->nread;
+      pop.rb = entries[i]->weight;
+      popularity_rb.push_back(popularity_t(entries[i]->path, pop));
+    }
 
     // sort them (backwards) by rb or nread
     std::sort(popularity_nread.begin(), popularity_nread.end(), PopularityCmp_nread());
@@ -1361,6 +1629,46 @@ Iostat::Restore ()
   return true;
 }
 
+/* ------------------------------------------------------------------------- */
+//! Visitor dumping namespace report records and summing up the transfers
+/* ------------------------------------------------------------------------- */
+class NamespaceReportVisitor : public eos::common::ReportStore::Visitor
+{
+public:
+  XrdOucString& out;
+  unsigned long long totalreadbytes;
+  unsigned long long totalwritebytes;
+  double totalreadtime;
+  double totalwritetime;
+  unsigned long long rcount;
+  unsigned long long wcount;
+
+  NamespaceReportVisitor (XrdOucString& stdOut) : out(stdOut), totalreadbytes(0),
+  totalwritebytes(0), totalreadtime(0), totalwritetime(0), rcount(0), wcount(0) { }
+
+  bool
+  Visit (eos::common::Report& report)
+  {
+    report.Dump(out);
+    double duration = ((report.cts - report.ots) +
+                       (1.0 * (report.ctms - report.otms) / 1000000));
+
+    if (!report.wb)
+    {
+      rcount++;
+      totalreadtime += duration;
+      totalreadbytes += report.rb;
+    }
+    else
+    {
+      wcount++;
+      totalwritetime += duration;
+      totalwritebytes += report.wb;
+    }
+    return true;
+  }
+};
+
 /* ------------------------------------------------------------------------- */
 bool
 Iostat::NamespaceReport (const char* path, XrdOucString &stdOut, XrdOucString &stdErr)
@@ -1369,41 +1677,34 @@ Iostat::NamespaceReport (const char* path, XrdOucString &stdOut, XrdOucString &s
   // ! print a report on the activity recorded in the namespace on the given path
   // ---------------------------------------------------------------------------
 
-  XrdOucString reportFile;
+  NamespaceReportVisitor visitor(stdOut);
+  std::string qpath = path;
 
+  // includes the records not yet flushed to the indexes
+  gOFS->IoStats.mReportStore.QueryLive(qpath, 0, 0, visitor);
+
+  // reports recorded in the legacy per-path text files
+  XrdOucString reportFile;
   reportFile = gOFS->IoReportStorePath.c_str();
   reportFile += "/";
   reportFile += path;
-
   std::ifstream inFile(reportFile.c_str());
   std::string reportLine;
 
-  unsigned long long totalreadbytes = 0;
-  unsigned long long totalwritebytes = 0;
-  double totalreadtime = 0;
-  double totalwritetime = 0;
-  unsigned long long rcount = 0;
-  unsigned long long wcount = 0;
-
   while (std::getline(inFile, reportLine))
   {
     XrdOucEnv ioreport(reportLine.c_str());
-    eos::common::Report* report = new eos::common::Report(ioreport);
-    report->Dump(stdOut);
-    if (!report->wb)
-    {
-      rcount++;
-      totalreadtime += ((report->cts - report->ots) + (1.0 * (report->ctms - report->otms) / 1000000));
-      totalreadbytes += report->rb;
-    }
-    else
-    {
-      wcount++;
-      totalwritetime += ((report->cts - report->ots) + (1.0 * (report->ctms - report->otms) / 1000000));
-      totalwritebytes += report->wb;
-    }
-    delete report;
+    eos::common::Report report(ioreport);
+    visitor.Visit(report);
   }
+
+  unsigned long long totalreadbytes = visitor.totalreadbytes;
+  unsigned long long totalwritebytes = visitor.totalwritebytes;
+  double totalreadtime = visitor.totalreadtime;
+  double totalwritetime = visitor.totalwritetime;
+  unsigned long long rcount = visitor.rcount;
+  unsigned long long wcount = visitor.wcount;
+
   stdOut += "----------------------- SUMMARY -------------------\n";
   char summaryline[4096];
   XrdOucString sizestring1, sizestring2;
@@ -1439,6 +1740,18 @@ Iostat::Circulate ()
     sc++;
     XrdSysTimer sleeper;
     sleeper.Wait(512);
+
+    // -------------------------------------------------------------------------
+    // ! stop the digest threads in shard order and merge their pending deltas,
+    // ! otherwise a delta of the bin about to be zeroed is merged after the
+    // ! stamp and survives for another cycle
+    // -------------------------------------------------------------------------
+    for (size_t i = 0; i < mShards.size(); i++)
+    {
+      mShards[i]->mMutex.Lock();
+      MergeShard(*mShards[i]);
+    }
+
     Mutex.Lock();
     google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, IostatAvg> >::iterator tit;
     google::sparse_hash_map<std::string, IostatAvg >::iterator dit;
@@ -1484,13 +1797,16 @@ Iostat::Circulate ()
 
     Mutex.UnLock();
 
+    for (size_t i = mShards.size(); i > 0; i--)
+      mShards[i - 1]->mMutex.UnLock();
+
     size_t popularitybin = (((time(NULL))) % (IOSTAT_POPULARITY_DAY * IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
     if (IostatLastPopularityBin != popularitybin)
     {
       // only if we enter a new bin we erase it 
       PopularityMutex.Lock();
-      IostatPopularity[popularitybin].clear();
-      IostatPopularity[popularitybin].resize(10000);
+      IostatPopularityNread[popularitybin].Clear();
+      IostatPopularityRb[popularitybin].Clear();
       IostatLastPopularityBin = popularitybin;
       PopularityMutex.UnLock();
     }
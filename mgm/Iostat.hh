@@ -31,13 +31,18 @@
 #include "common/FileId.hh"
 #include "common/Path.hh"
 #include "common/Report.hh"
+#include "common/ReportStore.hh"
+#include "common/ConcurrentQueue.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysPthread.hh"
 /*----------------------------------------------------------------------------*/
 #include <google/sparse_hash_map>
+#include <google/dense_hash_map>
 #include <sys/types.h>
+#include <stdint.h>
 #include <string>
 #include <set>
+#include <vector>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -50,6 +55,10 @@ EOSMGMNAMESPACE_BEGIN
 // define the history in days we want to do popularity tracking
 #define IOSTAT_POPULARITY_HISTORY_DAYS 7 
 #define IOSTAT_POPULARITY_DAY 86400
+// number of path prefixes kept per day in each popularity ranking
+#define IOSTAT_POPULARITY_CAPACITY 32768
+// number of threads digesting report messages
+#define IOSTAT_RECEIVER_THREADS 4
 
 class IostatAvg
 {
@@ -138,6 +147,18 @@ public:
     }
   }
 
+  void
+  Merge (const IostatAvg& other)
+  {
+    for (int i = 0; i < 60; i++)
+    {
+      avg86400[i] += other.avg86400[i];
+      avg3600[i] += other.avg3600[i];
+      avg300[i] += other.avg300[i];
+      avg60[i] += other.avg60[i];
+    }
+  }
+
   void
   StampZero ()
   {
@@ -189,6 +210,57 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+// ! bounded heavy-hitters sketch (space saving) keyed by interned path-prefix ids
+// -----------------------------------------------------------------------------
+
+class IostatHeavyHitters
+{
+public:
+
+  struct Entry
+  {
+    uint64_t id; // interned id (hash) of the path prefix
+    std::string path; // path prefix
+    unsigned long long weight; // estimated ranking weight (read count or bytes)
+    unsigned long long error; // max. overestimation of weight
+    unsigned long long nread; // read count seen since the entry was (re-)inserted
+    unsigned long long rb; // bytes read seen since the entry was (re-)inserted
+  };
+
+  IostatHeavyHitters ();
+
+  ~IostatHeavyHitters () { };
+
+  // set the number of tracked prefixes and rank by bytes or by read count
+  void Init (size_t capacity, bool bybytes);
+
+  // account reads of a prefix - evicts the lightest entry if the sketch is full
+  void Add (uint64_t id, const std::string& path, unsigned long long nread,
+            unsigned long long rb);
+
+  void Clear ();
+
+  size_t
+  Size ()
+  {
+    return mEntries.size ();
+  }
+
+  // get all tracked entries (unsorted)
+  void Get (std::vector<const Entry*>& entries) const;
+
+private:
+  size_t mCapacity;
+  bool mByBytes;
+  std::vector<Entry> mEntries; // min-heap ordered by weight
+  google::dense_hash_map<uint64_t, size_t> mIndex; // id => position in mEntries
+
+  void Swap (size_t a, size_t b);
+  void SiftUp (size_t pos);
+  void SiftDown (size_t pos);
+};
+
 class Iostat
 {
   // -------------------------------------------------------------
@@ -225,7 +297,8 @@ private:
 
   size_t IostatLastPopularityBin; // this points to the bin which was last used in IostatPopularity
 
-  google::sparse_hash_map<std::string, struct Popularity> IostatPopularity[ IOSTAT_POPULARITY_HISTORY_DAYS ];
+  IostatHeavyHitters IostatPopularityNread[ IOSTAT_POPULARITY_HISTORY_DAYS ]; // ranking by read count
+  IostatHeavyHitters IostatPopularityRb[ IOSTAT_POPULARITY_HISTORY_DAYS ]; // ranking by read bytes
 
   typedef std::pair<std::string, struct Popularity> popularity_t;
 
@@ -256,6 +329,55 @@ private:
 
   bool mReportPopularity; // indicates if we fill the popularity maps (protected by this::Mutex)
 
+  eos::common::ReportStore mReportStore; // binary report store written by the receiver threads
+
+  // -----------------------------------------------------------
+  // reports are digested by IOSTAT_RECEIVER_THREADS threads, each
+  // aggregating into its own shard which is merged periodically
+  // into the global maps (one lock per merge instead of per report)
+  // -----------------------------------------------------------
+
+  struct PopularityDelta
+  {
+    std::string path;
+    unsigned long long nread;
+    unsigned long long rb;
+
+    PopularityDelta () : nread (0), rb (0) { }
+  };
+
+  struct IostatShard
+  {
+    Iostat* mIostat;
+    pthread_t mThread;
+    XrdSysMutex mMutex; // held by the digest thread, taken by Circulate to stamp
+    eos::common::ConcurrentQueue<XrdMqMessage*> mQueue; // messages to digest, 0 terminates
+    std::vector< google::sparse_hash_map<uid_t, unsigned long long> > mUid; // indexed by tag id
+    std::vector< google::sparse_hash_map<gid_t, unsigned long long> > mGid;
+    std::vector< google::sparse_hash_map<uid_t, IostatAvg> > mAvgUid;
+    std::vector< google::sparse_hash_map<gid_t, IostatAvg> > mAvgGid;
+    google::sparse_hash_map<std::string, IostatAvg> mAvgDomainIOrb;
+    google::sparse_hash_map<std::string, IostatAvg> mAvgDomainIOwb;
+    google::sparse_hash_map<std::string, IostatAvg> mAvgAppIOrb;
+    google::sparse_hash_map<std::string, IostatAvg> mAvgAppIOwb;
+    google::dense_hash_map<uint64_t, PopularityDelta> mPopularity[ IOSTAT_POPULARITY_HISTORY_DAYS ];
+    size_t mLastPopularityBin;
+    size_t mPending; // reports aggregated since the last merge
+    time_t mLastMerge;
+
+    IostatShard (Iostat* iostat);
+  };
+
+  std::vector<IostatShard*> mShards;
+  size_t mNextShard; // round-robin dispatching of messages to shards
+
+  static const char* gIostatTags[]; // accounted tags, indexed by tag id
+  static const size_t gIostatNumTags;
+
+  void Digest (IostatShard& shard, XrdMqMessage* message);
+  void MergeShard (IostatShard& shard); // needs the shard mutex
+  void* Worker (IostatShard* shard);
+
 
   XrdSysMutex BroadcastMutex; // protecting the following set
   std::set<std::string> mUdpPopularityTarget; // contains all destinations for udp popularity packets
@@ -317,29 +439,58 @@ public:
   void UdpBroadCast (eos::common::Report*);
 
   static void* StaticReceive (void*);
+  static void* StaticWorker (void*);
   static void* StaticCirculate (void*);
   void* Receive ();
 
   static bool NamespaceReport (const char* path, XrdOucString &stdOut, XrdOucString &stdErr);
 
   void
-  AddToPopularity (std::string path, unsigned long long rb, time_t starttime, time_t stoptime)
+  AddToPopularity (IostatShard& shard, const std::string& path, unsigned long long rb, time_t starttime, time_t stoptime)
   {
+    // ---------------------------------------------------------------------------
+    // ! account all parent directories of path - the prefix ids are computed
+    // ! incrementally (FNV-1a) without allocating the sub path strings
+    // ---------------------------------------------------------------------------
     size_t popularitybin = (((starttime + stoptime) / 2) % (IOSTAT_POPULARITY_DAY * IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
-    PopularityMutex.Lock ();
-    eos::common::Path cPath (path.c_str ());
-    for (size_t k = 0; k < cPath.GetSubPathSize (); k++)
+    google::dense_hash_map<uint64_t, PopularityDelta>& delta = shard.mPopularity[popularitybin];
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t k = 0; k < path.length (); k++)
     {
-      std::string sp = cPath.GetSubPath (k);
-      IostatPopularity[popularitybin][sp].rb += rb;
-      IostatPopularity[popularitybin][sp].nread++;
+      if ((path[k] == '/') && k && (path[k - 1] == '/'))
+        continue;
+      hash ^= (unsigned char) path[k];
+      hash *= 1099511628211ULL;
+      if (path[k] == '/')
+      {
+        // 0 and 1 are the empty and deleted keys of the hash maps
+        PopularityDelta& d = delta[(hash < 2) ? hash + 2 : hash];
+        if (!d.nread)
+          d.path.assign (path, 0, k + 1);
+        d.rb += rb;
+        d.nread++;
+      }
     }
-    IostatLastPopularityBin = popularitybin;
-    PopularityMutex.UnLock ();
+    shard.mLastPopularityBin = popularitybin;
   }
 
   // stats collection
 
+  void
+  AddShard (IostatShard& shard, size_t tag, uid_t uid, gid_t gid, unsigned long val, time_t starttime, time_t stoptime)
+  {
+    // lock-free accounting into the shard of the calling digest thread
+    shard.mUid[tag][uid] += val;
+    shard.mGid[tag][gid] += val;
+    IostatAvg& avguid = shard.mAvgUid[tag][uid];
+    IostatAvg& avggid = shard.mAvgGid[tag][gid];
+    if (val)
+    {
+      avguid.Add (val, starttime, stoptime);
+      avggid.Add (val, starttime, stoptime);
+    }
+  }
+
   void
   Add (const char* tag, uid_t uid, gid_t gid, unsigned long val, time_t starttime, time_t stoptime)
   {
@@ -254,10 +254,11 @@ extern XrdMgmOfs* gOFS; //< global handle to XrdMgmOfs object
 // -----------------------------------------------------------------------------
 #define BOUNCE_NOT_ALLOWED						\
   /* for root, bin, daemon, admin we allow localhost connects or sss authentication always */ \
-  if ( ((vid.uid>3) || ( (vid.prot!="sss") && (vid.host != "localhost") && (vid.host != "localhost.localdomain"))) && (Access::gAllowedUsers.size() || Access::gAllowedGroups.size() || Access::gAllowedHosts.size() )) { \
-    if ( (!Access::gAllowedGroups.count(vid.gid)) &&			\
-	 (!Access::gAllowedUsers.count(vid.uid)) &&			\
-	 (!Access::gAllowedHosts.count(vid.host)) ) {			\
+  if ( ((vid.uid>3) || ( (vid.prot!="sss") && (vid.host != "localhost") && (vid.host != "localhost.localdomain")))) { \
+    Access::RulesRef __rules__;						\
+    if ( __rules__->restricted && (!__rules__->allowedGroups.count(vid.gid)) && \
+	 (!__rules__->allowedUsers.count(vid.uid)) &&			\
+	 (!__rules__->allowedHosts.count(vid.host)) ) {			\
       eos_err("user access restricted - not authorized identity used"); \
       return Emsg(epname, error, EACCES,"give access - user access restricted - not authorized identity used"); \
     }									\
@@ -267,10 +268,11 @@ extern XrdMgmOfs* gOFS; //< global handle to XrdMgmOfs object
 //! Bounce not-allowed-users in proc request Macro
 // -----------------------------------------------------------------------------
 #define PROC_BOUNCE_NOT_ALLOWED						\
-  if ((vid.uid>3) &&(Access::gAllowedUsers.size() || Access::gAllowedGroups.size() || Access::gAllowedHosts.size() )) { \
-    if ( (!Access::gAllowedGroups.count(vid.gid)) &&			\
-	 (!Access::gAllowedUsers.count(vid.uid)) &&			\
-	 (!Access::gAllowedHosts.count(vid.host)) ) {			\
+  if (vid.uid>3) {							\
+    Access::RulesRef __rules__;						\
+    if ( __rules__->restricted && (!__rules__->allowedGroups.count(vid.gid)) && \
+	 (!__rules__->allowedUsers.count(vid.uid)) &&			\
+	 (!__rules__->allowedHosts.count(vid.host)) ) {			\
       eos_err("user access restricted - not authorized identity used"); \
       retc = EACCES;							\
       stdErr += "error: user access restricted - not authorized identity used";	\
@@ -180,8 +180,19 @@ Master::Init()
     return false;
   }
 
+  std::string synccmd = ". /etc/sysconfig/eos; service eossync status || service eossync start ";
+
+  if (gOFS->mReplicationPort)
+  {
+    // the changelog files are streamed by the supervisor - eossync still
+    // replicates the configuration and the other files but no changelog
+    eos_notice("msg=\"changelog replication via stream\" port=%u",
+               gOFS->mReplicationPort);
+    synccmd = ". /etc/sysconfig/eos; service eossync status nochangelog || service eossync start nochangelog";
+  }
+
   // get eossync up if it is not up
-  eos::common::ShellCmd scmd2(". /etc/sysconfig/eos; service eossync status || service eossync start ");
+  eos::common::ShellCmd scmd2(synccmd.c_str());
   rc = scmd2.wait(30);
 
   if (rc.exit_code)
@@ -403,27 +414,28 @@ Master::Supervisor()
 				   IsMaster(), fRemoteMasterOk, fRemoteMasterRW,
 				   fThisHost.c_str(), fRemoteHost.c_str(),
 				   fMasterHost.c_str()));
-	eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+	// runs every second - only an actual change publishes new rules
+	Access::RulesWriteLock lock(false);
 
 	if (!IsMaster())
 	{
 	  if (fRemoteMasterOk && fRemoteMasterRW)
 	  {
 	    // Set the redirect for writes to the remote master
-	    Access::gRedirectionRules[std::string("w:*")] = fRemoteHost.c_str();
+	    Access::SetRule(Access::gRedirectionRules, "w:*", fRemoteHost.c_str());
 	    // Set the redirect for ENOENT to the remote master
-	    Access::gRedirectionRules[std::string("ENOENT:*")] = fRemoteHost.c_str();
+	    Access::SetRule(Access::gRedirectionRules, "ENOENT:*", fRemoteHost.c_str());
 	    // Remove the stall
-	    Access::gStallRules.erase(std::string("w:*"));
-	    Access::gStallWrite = false;
+	    Access::EraseRule(Access::gStallRules, "w:*");
+	    Access::SetFlag(Access::gStallWrite, false);
 	  }
 	  else
 	  {
 	    // Remove the redirect for writes and put a stall for writes
-	    Access::gRedirectionRules.erase(std::string("w:*"));
-	    Access::gStallRules[std::string("w:*")] = "60";
-	    Access::gStallWrite = true;
-	    Access::gRedirectionRules.erase(std::string("ENOENT:*"));
+	    Access::EraseRule(Access::gRedirectionRules, "w:*");
+	    Access::SetRule(Access::gStallRules, "w:*", "60");
+	    Access::SetFlag(Access::gStallWrite, true);
+	    Access::EraseRule(Access::gRedirectionRules, "ENOENT:*");
 	  }
 	}
 	else
@@ -432,23 +444,21 @@ Master::Supervisor()
 	  if (fRemoteMasterOk && fRemoteMasterRW && (fThisHost != fRemoteHost))
 	  {
 	    MasterLog(eos_crit("msg=\"dual RW master setup detected\""));
-	    Access::gStallRules[std::string("w:*")] = "60";
-	    Access::gStallWrite = true;
+	    Access::SetRule(Access::gStallRules, "w:*", "60");
+	    Access::SetFlag(Access::gStallWrite, true);
 	  }
 	  else
 	  {
 	    // Cemove any redirect or stall in this case
-	    if (Access::gRedirectionRules.count(std::string("w:*")))
-	      Access::gRedirectionRules.erase(std::string("w:*"));
+	    Access::EraseRule(Access::gRedirectionRules, "w:*");
 
 	    if (Access::gStallRules.count(std::string("w:*")))
 	    {
-	      Access::gStallRules.erase(std::string("w:*"));
-	      Access::gStallWrite = false;
+	      Access::EraseRule(Access::gStallRules, "w:*");
+	      Access::SetFlag(Access::gStallWrite, false);
 	    }
 
-	    if (Access::gRedirectionRules.count(std::string("ENOENT:*")))
-	      Access::gRedirectionRules.erase(std::string("ENOENT:*"));
+	    Access::EraseRule(Access::gRedirectionRules, "ENOENT:*");
 	  }
 	}
       }
@@ -488,7 +498,7 @@ Master::Supervisor()
       if (lDiskFull)
       {
 	// The disk is full, we stall every write
-	eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+	Access::RulesWriteLock lock;
 	pStallSetting = Access::gStallRules[std::string("w:*")];
 	Access::gStallRules[std::string("w:*")] = "60";
 	Access::gStallWrite = true;
@@ -501,6 +511,7 @@ Master::Supervisor()
 	MasterLog(eos_notice("status=\"disk space ok - removed stall\" "
 			     "path=%s freebyte=%s", gOFS->MgmMetaLogDir.c_str(),
 			     sizestring.c_str()));
+	Access::RulesWriteLock lock;
 
 	if (pStallSetting.length())
 	{
@@ -525,6 +536,7 @@ Master::Supervisor()
       pDiskFull = lDiskFull;
     }
 
+    ApplyReplicationRole();
     XrdSysThread::SetCancelOn();
     XrdSysTimer sleeper;
     sleeper.Wait(1000);
@@ -533,6 +545,46 @@ Master::Supervisor()
   return 0;
 }
 
+//------------------------------------------------------------------------------
+// Run the changelog replication as source on the master and as sink on the
+// slave - a role or changelog name change (transition) restarts the stream
+//------------------------------------------------------------------------------
+void
+Master::ApplyReplicationRole()
+{
+  if (!gOFS->mReplicationPort || (fThisHost == fRemoteHost))
+    return;
+
+  std::string files_log = gOFS->MgmNsFileChangeLogFile.c_str();
+  std::string dirs_log = gOFS->MgmNsDirChangeLogFile.c_str();
+
+  // Namespace not booted yet
+  if (files_log.empty() || dirs_log.empty())
+    return;
+
+  ChangeLogReplicator::Role::Type role = IsMaster() ?
+    ChangeLogReplicator::Role::kSource : ChangeLogReplicator::Role::kSink;
+
+  if ((fReplicator.GetRole() == role) && (fReplicatedFileLog == files_log))
+    return;
+
+  if (role == ChangeLogReplicator::Role::kSource)
+  {
+    if (fReplicator.StartSource(gOFS->mReplicationPort, files_log, dirs_log))
+      MasterLog(eos_info("msg=\"changelog replication source started\" port=%u",
+                         gOFS->mReplicationPort));
+  }
+  else
+  {
+    if (fReplicator.StartSink(fMasterHost.c_str(), gOFS->mReplicationPort,
+                              fThisHost.c_str(), files_log, dirs_log))
+      MasterLog(eos_info("msg=\"changelog replication sink started\" master=%s",
+                         fMasterHost.c_str()));
+  }
+
+  fReplicatedFileLog = files_log;
+}
+
 //------------------------------------------------------------------------------
 // Static thread startup function calling Compacting
 //------------------------------------------------------------------------------
@@ -1114,6 +1166,9 @@ Master::PrintOut(XrdOucString& out)
       out += fRemoteMq;
       out += "=down";
     }
+
+    // replication lag of the changelog stream (if enabled)
+    fReplicator.PrintOut(out);
   }
 }
 
@@ -1685,7 +1740,7 @@ Master::Master2MasterRO()
 
   // Stop the recycler thread
   gOFS->Recycler.Stop();
-  eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+  Access::RulesWriteLock lock;
   fRunningState = Run::State::kIsReadOnlyMaster;
   eos_alert("msg=\"running as master-ro\"");
   MasterLog(eos_notice("running in RO master mode"));
@@ -1705,7 +1760,7 @@ Master::MasterRO2Slave()
   {
     // Be aware of interference with the heart beat daemon (which does not
     // touch a generic stall yet)
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     // Remove redirects
     Access::gRedirectionRules.erase(std::string("w:*"));
     Access::gRedirectionRules.erase(std::string("ENOENT:*"));
@@ -1841,6 +1896,8 @@ Master::~Master()
     fThread = 0;
   }
 
+  fReplicator.Stop();
+
   if (fCompactingThread)
   {
     XrdSysThread::Cancel(fCompactingThread);
@@ -2450,7 +2507,10 @@ void
 Master::RedirectToRemoteMaster()
 {
   MasterLog(eos_info("msg=\"redirect to remote master\""));
-  Access::gRedirectionRules[std::string("*")] = fRemoteHost.c_str();
+  {
+    Access::RulesWriteLock lock;
+    Access::gRedirectionRules[std::string("*")] = fRemoteHost.c_str();
+  }
   eos::IChLogContainerMDSvc* eos_chlog_dirsvc =
     dynamic_cast<eos::IChLogContainerMDSvc*>(gOFS->eosDirectoryService);
   eos::IChLogFileMDSvc* eos_chlog_filesvc =
@@ -2571,7 +2631,7 @@ Master::RebootSlaveNamespace()
   }
   {
     // Be aware of interference with the heart beat daemon
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     // Remove global redirection
     Access::gRedirectionRules.erase(std::string("*"));
   }
@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include "common/Logging.hh"
 #include "mgm/Namespace.hh"
+#include "mgm/ChangeLogReplicator.hh"
 #include "namespace/utils/Locking.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
@@ -290,6 +291,8 @@ class Master : public eos::common::LogId
   unsigned long long fFileNamespaceInode; ///< inode number of the file namespace file
   unsigned long long fDirNamespaceInode; ///< inode number of the dir  namespace file
   bool fAutoRepair; ///< enable auto-repair to skip over broken records during compaction
+  ChangeLogReplicator fReplicator; ///< push based changelog replication
+  std::string fReplicatedFileLog; ///< file changelog handled by fReplicator
 
   //----------------------------------------------------------------------------
   // Lock class wrapper used by the namespace
@@ -427,6 +430,12 @@ class Master : public eos::common::LogId
   //----------------------------------------------------------------------------
   void* Compacting();
 
+  //----------------------------------------------------------------------------
+  //! Start/switch the changelog replication stream according to our role
+  //! (source on the master, sink on the slave) - called by the supervisor
+  //----------------------------------------------------------------------------
+  void ApplyReplicationRole();
+
   //----------------------------------------------------------------------------
   //! Supervisor Thread Start Function
   //----------------------------------------------------------------------------
@@ -1812,6 +1812,85 @@ Quota::FilePlacement(const std::string& space,
 				  truncate, forced_scheduling_group_index, bookingsize,schedtype);
 }
 
+//------------------------------------------------------------------------------
+// Take the placement decision for a batch of files
+//------------------------------------------------------------------------------
+int
+Quota::FilePlacementBatch(const std::string& space,
+			  eos::common::Mapping::VirtualIdentity_t& vid,
+			  const char* grouptag,
+			  std::vector<Scheduler::PlacementRequest>& requests,
+			  Scheduler::tPlctPolicy plctpolicy,
+			  const std::string& plctTrgGeotag,
+			  int forced_scheduling_group_index,
+			  eos::mgm::Scheduler::tSchedType schedtype)
+{
+  bool edquot = false;
+
+  // Check the quota of the whole batch under one lock - the volume and the
+  // inodes are cumulated per responsible quota node
+  if (FsView::gFsView.IsQuotaEnabled(space))
+  {
+    eos::common::RWMutexReadLock rd_quota_lock(pMapMutex);
+    std::map<SpaceQuota*, std::pair<long long, unsigned long> > booked;
+
+    for (auto it = requests.begin(); it != requests.end(); ++it)
+    {
+      if (it->retc)
+	continue;
+
+      SpaceQuota* squota = GetResponsibleSpaceQuota(it->path);
+
+      if (!squota)
+	continue;
+
+      // 0 = 1 replica !
+      unsigned int nfilesystems = eos::common::LayoutId::GetStripeNumber(it->lid) + 1;
+      std::pair<long long, unsigned long>& sum = booked[squota];
+
+      if (!squota->CheckWriteQuota(vid.uid, vid.gid,
+				   sum.first + 1ll * nfilesystems * it->bookingsize,
+				   sum.second + nfilesystems))
+      {
+	eos_static_debug("uid=%u gid=%u grouptag=%s path=%s has no quota left!",
+			 vid.uid, vid.gid, grouptag, it->path.c_str());
+	it->retc = EDQUOT;
+	edquot = true;
+	continue;
+      }
+
+      sum.first += 1ll * nfilesystems * it->bookingsize;
+      sum.second += nfilesystems;
+    }
+  }
+  else
+  {
+    eos_static_debug("quota is disabled for space=%s", space.c_str());
+  }
+
+  if (!FsView::gFsView.mSpaceGroupView.count(space))
+  {
+    eos_static_err("msg=\"no filesystem in space\" space=\"%s\"", space.c_str());
+
+    for (auto it = requests.begin(); it != requests.end(); ++it)
+    {
+      if (!it->retc)
+	it->retc = ENOSPC;
+
+      it->selected_filesystems.clear();
+    }
+
+    return ENOSPC;
+  }
+
+  // Call the scheduler implementation
+  int retc = Scheduler::FilePlacementBatch(space, vid, grouptag, requests,
+					   plctpolicy, plctTrgGeotag,
+					   forced_scheduling_group_index,
+					   schedtype);
+  return retc ? retc : (edquot ? EDQUOT : 0);
+}
+
 //------------------------------------------------------------------------------
 // Take the decision from where to access a file. The core of the
 // implementation is in the Scheduler and GeoTreeEngine.
@@ -566,6 +566,36 @@ public:
 		    unsigned long long bookingsize = 1024 * 1024 * 1024ll,
 		    eos::mgm::Scheduler::tSchedType schedtype=eos::mgm::Scheduler::regular);
 
+  //----------------------------------------------------------------------------
+  //! Take the placement decision for a batch of files. The quota is checked
+  //! for the cumulated volume of the batch under a single lock, the files
+  //! without quota get EDQUOT and the others are placed by the Scheduler in
+  //! one pass.
+  //!
+  //! @param space quota space name
+  //! @param vid virtual id of client
+  //! @param grouptag group tag for placement
+  //! @param requests files to place - the result of each one is stored in it
+  //! @param plctpolicy indicates if placement should be local/spread/hybrid
+  //! @param plctTrgGeotag indicates close to which Geotag collocated stripes
+  //!                      should be placed
+  //! @param forched_scheduling_group_index forced index for the scheduling
+  //!                      subgroup to start with
+  //! @param schedtype type of scheduling
+  //!
+  //! @return 0 if all files were placed, otherwise ENOSPC or EDQUOT
+  //! @warning Must be called with a lock on the FsView::gFsView::ViewMutex
+  //----------------------------------------------------------------------------
+  static
+  int FilePlacementBatch(const std::string& space,
+			 eos::common::Mapping::VirtualIdentity_t& vid,
+			 const char* grouptag,
+			 std::vector<Scheduler::PlacementRequest>& requests,
+			 Scheduler::tPlctPolicy plctpolicy,
+			 const std::string& plctTrgGeotag,
+			 int forced_scheduling_group_index = -1,
+			 eos::mgm::Scheduler::tSchedType schedtype=eos::mgm::Scheduler::regular);
+
   //----------------------------------------------------------------------------
   //! Take the decision from where to access a file. The core of the
   //! implementation is in the Scheduler and GeoTreeEngine.
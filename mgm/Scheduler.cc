@@ -26,6 +26,8 @@
 #include "mgm/Quota.hh"
 #include "GeoTreeEngine.hh"
 /*----------------------------------------------------------------------------*/
+#include <algorithm>
+/*----------------------------------------------------------------------------*/
 
 EOSMGMNAMESPACE_BEGIN
 
@@ -44,32 +46,17 @@ Scheduler::Scheduler() { }
 Scheduler::~Scheduler() { }
 
 //------------------------------------------------------------------------------
-// Take the decision where to place a new file in the system
+// Number of filesystems to place and how many of them are collocated
 //------------------------------------------------------------------------------
-int
-Scheduler::FilePlacement(const std::string& spacename,
-                         const char* path,
-                         eos::common::Mapping::VirtualIdentity_t& vid,
-                         const char* grouptag,
-                         unsigned long lid,
-                         std::vector<unsigned int>& alreadyused_filesystems,
-                         std::vector<unsigned int>& selected_filesystems,
-                         tPlctPolicy plctpolicy,
-                         const std::string& plctTrgGeotag,
-                         bool truncate,
-                         int forced_scheduling_group_index,
-                         unsigned long long bookingsize,
-                         tSchedType schedtype)
+void
+Scheduler::GetPlacementCounts(unsigned long lid, tPlctPolicy plctpolicy,
+                              unsigned int& nfilesystems,
+                              unsigned int& ncollocatedfs)
 {
-  eos_static_debug("requesting file placement from geolocation %s", vid.geolocation.c_str());
-  // the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
-  std::map<eos::common::FileSystem::fsid_t, float> availablefs;
-  std::map<eos::common::FileSystem::fsid_t, std::string> availablefsgeolocation;
-  std::list<eos::common::FileSystem::fsid_t> availablevector;
   // Compute the number of locations of stripes according to the placement policy
   // 0 = 1 replica !
-  unsigned int nfilesystems = eos::common::LayoutId::GetStripeNumber(lid) + 1; 
-  unsigned int ncollocatedfs = 0;
+  nfilesystems = eos::common::LayoutId::GetStripeNumber(lid) + 1;
+  ncollocatedfs = 0;
 
   switch (plctpolicy)
   {
@@ -98,12 +85,15 @@ Scheduler::FilePlacement(const std::string& spacename,
   case kGathered:
     ncollocatedfs = nfilesystems;
   }
+}
 
-  eos_static_debug("checking placement policy : policy is %d, nfilesystems is"
-                   " %d and ncollocated is %d", (int)plctpolicy, (int)nfilesystems,
-                   (int)ncollocatedfs);
-  uid_t uid = vid.uid;
-  gid_t gid = vid.gid;
+//------------------------------------------------------------------------------
+// Scheduling group cursor key
+//------------------------------------------------------------------------------
+std::string
+Scheduler::GetIndexTag(const char* grouptag,
+                       const eos::common::Mapping::VirtualIdentity_t& vid)
+{
   XrdOucString lindextag = "";
 
   if (grouptag)
@@ -112,129 +102,213 @@ Scheduler::FilePlacement(const std::string& spacename,
   }
   else
   {
-    lindextag += (int) uid;
+    lindextag += (int) vid.uid;
     lindextag += ":";
-    lindextag += (int) gid;
+    lindextag += (int) vid.gid;
   }
 
-  std::string indextag = lindextag.c_str();
-  std::set<FsGroup*>::const_iterator git;
-  std::vector<std::string> fsidsgeotags;
-  std::vector<FsGroup*> groupsToTry;
+  return lindextag.c_str();
+}
+
+//------------------------------------------------------------------------------
+// Placement of the requests of a batch in one scheduling group by the
+// GeoTreeEngine
+//------------------------------------------------------------------------------
+namespace
+{
+  struct GeoTreePlacer
+  {
+    GeoTreePlacer(Scheduler::tPlctPolicy plctpolicy,
+                  const std::string& plctTrgGeotag) :
+      mPlctPolicy(plctpolicy),
+      mPlctTrgGeotag(plctTrgGeotag),
+      mFsCount(0),
+      mCollocatedFsCount(0) { }
+
+    void Prepare(Scheduler::PlacementRequest& req,
+                 std::vector<FsGroup*>& groupsToTry);
+
+    bool Place(FsGroup* group, Scheduler::PlacementRequest& req);
+
+    Scheduler::tPlctPolicy mPlctPolicy;
+    const std::string& mPlctTrgGeotag;
+    unsigned int mFsCount; ///< filesystems to place for the current request
+    unsigned int mCollocatedFsCount; ///< collocated ones among them
+    std::vector<std::string> mFsGeotags; ///< geotags of the existing replicas
+  };
+}
+
+//------------------------------------------------------------------------------
+// Count the filesystems of a request and find the groups of its replicas
+//------------------------------------------------------------------------------
+void
+GeoTreePlacer::Prepare(Scheduler::PlacementRequest& req,
+                       std::vector<FsGroup*>& groupsToTry)
+{
+  Scheduler::GetPlacementCounts(req.lid, mPlctPolicy, mFsCount,
+                                mCollocatedFsCount);
+  eos_static_debug("checking placement policy : policy is %d, nfilesystems is"
+                   " %d and ncollocated is %d", (int)mPlctPolicy, (int)mFsCount,
+                   (int)mCollocatedFsCount);
+  mFsGeotags.clear();
 
   // If there are pre-existing replicas, check in which group they are located
   // and chose the group where they are located the most
-  if (!alreadyused_filesystems.empty())
+  if (!req.alreadyused_filesystems.empty())
   {
-    if (!gGeoTreeEngine.getGroupsFromFsIds(alreadyused_filesystems, &fsidsgeotags,
-                                           &groupsToTry))
+    if (!gGeoTreeEngine.getGroupsFromFsIds(req.alreadyused_filesystems,
+                                           &mFsGeotags, &groupsToTry))
     {
       eos_static_debug("could not retrieve scheduling group for all avoid fsids");
     }
   }
+}
 
-  // Place the group iterator
-  if (forced_scheduling_group_index >= 0)
+//------------------------------------------------------------------------------
+// Place a request in one scheduling group
+//------------------------------------------------------------------------------
+bool
+GeoTreePlacer::Place(FsGroup* group, Scheduler::PlacementRequest& req)
+{
+  // We search for available slots for replicas but all in the same group.
+  // If we fail on a group, we look in the next one  placement is spread
+  // out in all the tree to strengthen reliability ( -> "" )
+  bool placeRes = gGeoTreeEngine.placeNewReplicasOneGroup(group, mFsCount,
+                  &req.selected_filesystems, GeoTreeEngine::regularRW,
+                  &req.alreadyused_filesystems, &mFsGeotags, req.bookingsize,
+                  mPlctTrgGeotag, mCollocatedFsCount, NULL, NULL, NULL);
+
+  if (eos::common::Logging::gLogMask & LOG_MASK(LOG_DEBUG))
   {
-    for (git = FsView::gFsView.mSpaceGroupView[spacename].begin();
-         git != FsView::gFsView.mSpaceGroupView[spacename].end(); git++)
-    {
-      if ((*git)->GetIndex() == (unsigned int) forced_scheduling_group_index)
-        break;
-    }
+    char buffer[1024];
+    buffer[0] = 0;
+    char* buf = buffer;
 
-    if ((git != FsView::gFsView.mSpaceGroupView[spacename].end()) &&
-        ((*git)->GetIndex() != (unsigned int) forced_scheduling_group_index))
-    {
-      selected_filesystems.clear();
-      return ENOSPC;
-    }
+    for (auto it = req.selected_filesystems.begin();
+         it != req.selected_filesystems.end(); ++it)
+      buf += sprintf(buf, "%lu  ", (unsigned long)(*it));
+
+    eos_static_debug("GeoTree Placement returned %d with fs id's -> %s",
+                     (int)placeRes, buffer);
+  }
+
+  if (placeRes)
+  {
+    eos_static_debug("placing replicas for %s in subgroup %s", req.path.c_str(),
+                     group->mName.c_str());
   }
   else
   {
-    XrdSysMutexHelper scope_lock(pMapMutex);
+    eos_static_debug("could not place all replica(s) for %s in subgroup %s, "
+                     "checking next group", req.path.c_str(), group->mName.c_str());
+  }
 
-    if (schedulingGroup.count(indextag))
-    {
-      git = FsView::gFsView.mSpaceGroupView[spacename].find(
-              schedulingGroup[indextag]);
-      schedulingGroup[indextag] = *git;
-    }
-    else
-    {
-      git = FsView::gFsView.mSpaceGroupView[spacename].begin();
-      schedulingGroup[indextag] = *git;
-    }
+  return placeRes;
+}
 
-    git++;
+//------------------------------------------------------------------------------
+// Take the decision where to place a new file in the system
+//------------------------------------------------------------------------------
+int
+Scheduler::FilePlacement(const std::string& spacename,
+                         const char* path,
+                         eos::common::Mapping::VirtualIdentity_t& vid,
+                         const char* grouptag,
+                         unsigned long lid,
+                         std::vector<unsigned int>& alreadyused_filesystems,
+                         std::vector<unsigned int>& selected_filesystems,
+                         tPlctPolicy plctpolicy,
+                         const std::string& plctTrgGeotag,
+                         bool truncate,
+                         int forced_scheduling_group_index,
+                         unsigned long long bookingsize,
+                         tSchedType schedtype)
+{
+  eos_static_debug("requesting file placement from geolocation %s", vid.geolocation.c_str());
+  // A single file is a batch of one
+  std::vector<PlacementRequest> requests(1);
+  PlacementRequest& req = requests[0];
+  req.path = path ? path : "";
+  req.lid = lid;
+  req.bookingsize = bookingsize;
+  req.alreadyused_filesystems = alreadyused_filesystems;
+  req.selected_filesystems.swap(selected_filesystems);
+  int retc = FilePlacementBatch(spacename, vid, grouptag, requests, plctpolicy,
+                                plctTrgGeotag, forced_scheduling_group_index,
+                                schedtype);
+  selected_filesystems.swap(req.selected_filesystems);
+  return retc;
+}
 
-    if (git ==  FsView::gFsView.mSpaceGroupView[spacename].end())
-      git = FsView::gFsView.mSpaceGroupView[spacename].begin();
-  }
+//------------------------------------------------------------------------------
+// Take the placement decision for a batch of files in one pass
+//------------------------------------------------------------------------------
+int
+Scheduler::FilePlacementBatch(const std::string& spacename,
+                              eos::common::Mapping::VirtualIdentity_t& vid,
+                              const char* grouptag,
+                              std::vector<PlacementRequest>& requests,
+                              tPlctPolicy plctpolicy,
+                              const std::string& plctTrgGeotag,
+                              int forced_scheduling_group_index,
+                              tSchedType schedtype)
+{
+  // the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
+  std::map<std::string, std::set<FsGroup*> >::const_iterator sit =
+    FsView::gFsView.mSpaceGroupView.find(spacename);
+  std::vector<FsGroup*> groups;
+
+  if (sit != FsView::gFsView.mSpaceGroupView.end())
+    groups.assign(sit->second.begin(), sit->second.end());
+
+  std::string indextag = GetIndexTag(grouptag, vid);
+  FsGroup* lastgroup = 0;
+  size_t cursor = 0;
 
-  // We can loop over all existing scheduling views
-  for (unsigned int groupindex = 0;
-       groupindex < FsView::gFsView.mSpaceGroupView[spacename].size() +
-       groupsToTry.size();
-       groupindex++)
+  // Place the group cursor once for the whole batch
+  if (forced_scheduling_group_index < 0)
   {
-    // In case there are pre existing replicas, search for space in the groups
-    // they lay in first if it's unsuccessful, go to the other groups
-    FsGroup* group = groupindex < groupsToTry.size() ? groupsToTry[groupindex] : (*git);
-
-    // We search for available slots for replicas but all in the same group.
-    // If we fail on a group, we look in the next one  placement is spread
-    // out in all the tree to strengthen reliability ( -> "" )
-    bool placeRes = gGeoTreeEngine.placeNewReplicasOneGroup(group, nfilesystems,
-                    &selected_filesystems, GeoTreeEngine::regularRW,
-                    &alreadyused_filesystems, &fsidsgeotags, bookingsize,
-                    plctTrgGeotag, ncollocatedfs, NULL, NULL, NULL);
-
-    if (eos::common::Logging::gLogMask & LOG_MASK(LOG_DEBUG))
-    {
-      char buffer[1024];
-      buffer[0] = 0;
-      char* buf = buffer;
+    XrdSysMutexHelper scope_lock(pMapMutex);
 
-      for (auto it = selected_filesystems.begin(); it != selected_filesystems.end(); ++it)
-        buf += sprintf(buf, "%lu  ", (unsigned long)(*it));
+    if (schedulingGroup.count(indextag))
+      lastgroup = schedulingGroup[indextag];
+  }
 
-      eos_static_debug("GeoTree Placement returned %d with fs id's -> %s",
-                       (int)placeRes, buffer);
-    }
+  if (GetBatchCursor(groups, forced_scheduling_group_index, lastgroup, cursor))
+  {
+    eos_static_err("msg=\"forced scheduling group is not in the space\" "
+                   "space=\"%s\" group-index=%d", spacename.c_str(),
+                   forced_scheduling_group_index);
 
-    if (placeRes)
+    for (auto it = requests.begin(); it != requests.end(); ++it)
     {
-      eos_static_debug("placing replicas for %s in subgroup %s", path,
-                       group->mName.c_str());
-    }
-    else
-    {
-      eos_static_debug("could not place all replica(s) for %s in subgroup %s, "
-                       "checking next group", path, group->mName.c_str());
-    }
+      if (!it->retc)
+        it->retc = ENOSPC;
 
-    if (groupindex >= groupsToTry.size())
-    {
-      git++;
+      it->selected_filesystems.clear();
+    }
 
-      if (git == FsView::gFsView.mSpaceGroupView[spacename].end())
-        git = FsView::gFsView.mSpaceGroupView[spacename].begin();
+    return ENOSPC;
+  }
 
-      // remember the last group for that indextag
-      pMapMutex.Lock();
-      schedulingGroup[indextag] = *git;
-      pMapMutex.UnLock();
-    }
+  // Lock the scheduling group map of the GeoTreeEngine once for the batch
+  GeoTreePlacer placer(plctpolicy, plctTrgGeotag);
+  gGeoTreeEngine.lockForBatch();
+  size_t nfailed = PlaceBatch(groups, cursor, requests, placer);
+  gGeoTreeEngine.unlockForBatch();
 
-    if (placeRes)
-      return 0;
-    else
-      continue;
+  // remember the last group used for that indextag, the next batch starts
+  // with the one after it
+  if ((forced_scheduling_group_index < 0) && groups.size())
+  {
+    XrdSysMutexHelper scope_lock(pMapMutex);
+    schedulingGroup[indextag] = groups[(cursor + groups.size() - 1) % groups.size()];
   }
 
-  selected_filesystems.clear();
-  return ENOSPC;
+  eos_static_debug("batch of %lu files in space %s : %lu could not be placed",
+                   (unsigned long) requests.size(), spacename.c_str(),
+                   (unsigned long) nfailed);
+  return nfailed ? ENOSPC : 0;
 }
 
 //------------------------------------------------------------------------------
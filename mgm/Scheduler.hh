@@ -31,6 +31,9 @@
 #include "mgm/Namespace.hh"
 #include "mgm/FsView.hh"
 /*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <errno.h>
+#include <vector>
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
@@ -61,6 +64,24 @@ public:
   enum tSchedType
     { regular,balancing,draining};
 
+  //----------------------------------------------------------------------------
+  //! One file of a batch placement - requests with a non-zero retc on input
+  //! are skipped (e.g. rejected by the quota check)
+  //----------------------------------------------------------------------------
+  struct PlacementRequest
+  {
+    std::string path; //< file path
+    unsigned long lid; //< layout to be placed
+    unsigned long long bookingsize; //< size to book for the placement
+    std::vector<unsigned int> alreadyused_filesystems; //< filesystems to avoid
+    std::vector<unsigned int> selected_filesystems; //< [out] selected filesystems
+    int retc; //< [out] 0 if placed, otherwise ENOSPC/EDQUOT
+    int group_index; //< [out] index of the scheduling group used
+
+    PlacementRequest() :
+      lid(0), bookingsize(1024 * 1024 * 1024ll), retc(0), group_index(-1) { }
+  };
+
   //----------------------------------------------------------------------------
   //! Take the decision where to place a new file in the system.
   //!
@@ -98,6 +119,150 @@ public:
                            unsigned long long bookingsize = 1024 * 1024 * 1024ll,
                            tSchedType schedtype = regular);
 
+  //----------------------------------------------------------------------------
+  //! Take the placement decision for a batch of files in one pass.
+  //!
+  //! The space and the scheduling group cursor are resolved once for the
+  //! whole batch and consecutive files are spread over consecutive groups.
+  //!
+  //! @param spacename space name
+  //! @param vid virtual id of client
+  //! @param grouptag group tag for placement
+  //! @param requests files to place - the result of each one is stored in it
+  //! @param plctpolicy indicates if placement should be local/spread/hybrid
+  //! @param plctTrgGeotag indicates close to which Geotag collocated stripes
+  //!                      should be placed
+  //! @param forched_scheduling_group_index forced index for the scheduling
+  //!                      subgroup to start with
+  //! @param schedtype type of scheduling
+  //!
+  //! @return 0 if all the requests which were not skipped were placed,
+  //!         otherwise ENOSPC - also if the forced group is not in the space
+  //!
+  //! NOTE: Has to be called with a lock on the FsView::gFsView::ViewMutex
+  //----------------------------------------------------------------------------
+  static int FilePlacementBatch(const std::string& spacename,
+                                eos::common::Mapping::VirtualIdentity_t& vid,
+                                const char* grouptag,
+                                std::vector<PlacementRequest>& requests,
+                                tPlctPolicy plctpolicy,
+                                const std::string& plctTrgGeotag = "",
+                                int forced_scheduling_group_index = -1,
+                                tSchedType schedtype = regular);
+
+  //----------------------------------------------------------------------------
+  //! Number of filesystems to place for a layout and how many of them have to
+  //! be collocated according to the placement policy
+  //----------------------------------------------------------------------------
+  static void GetPlacementCounts(unsigned long lid, tPlctPolicy plctpolicy,
+                                 unsigned int& nfilesystems,
+                                 unsigned int& ncollocatedfs);
+
+  //----------------------------------------------------------------------------
+  //! Get the group where a batch placement starts
+  //!
+  //! @param groups scheduling groups of the space sorted by pointer
+  //! @param forced_scheduling_group_index forced group index or -1
+  //! @param lastgroup last group used for the group tag or 0
+  //! @param cursor [out] index in groups to start with
+  //!
+  //! @return 0 or ENOSPC if the forced group is not part of the space
+  //----------------------------------------------------------------------------
+  static int GetBatchCursor(const std::vector<FsGroup*>& groups,
+                            int forced_scheduling_group_index,
+                            FsGroup* lastgroup,
+                            size_t& cursor)
+  {
+    cursor = 0;
+
+    if (forced_scheduling_group_index >= 0)
+    {
+      for (cursor = 0; cursor < groups.size(); cursor++)
+      {
+        if (groups[cursor]->GetIndex() == (unsigned int) forced_scheduling_group_index)
+          return 0;
+      }
+
+      cursor = 0;
+      return ENOSPC;
+    }
+
+    if (lastgroup && groups.size())
+    {
+      std::vector<FsGroup*>::const_iterator git =
+        std::lower_bound(groups.begin(), groups.end(), lastgroup);
+
+      if ((git != groups.end()) && (*git == lastgroup))
+        cursor = (git - groups.begin() + 1) % groups.size();
+    }
+
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Place the requests of a batch over the scheduling groups. Every request
+  //! tries first the groups of its existing replicas and then the groups
+  //! starting at the cursor, the next request starts after the last group
+  //! tried from the cursor.
+  //!
+  //! @param groups scheduling groups of the space
+  //! @param cursor [in/out] index in groups to start with
+  //! @param requests files to place
+  //! @param placer provides void Prepare(PlacementRequest&,
+  //!        std::vector<FsGroup*>& groupsToTry) and
+  //!        bool Place(FsGroup*, PlacementRequest&)
+  //!
+  //! @return number of requests which could not be placed
+  //----------------------------------------------------------------------------
+  template<class Placer>
+  static size_t PlaceBatch(const std::vector<FsGroup*>& groups,
+                           size_t& cursor,
+                           std::vector<PlacementRequest>& requests,
+                           Placer& placer)
+  {
+    size_t nfailed = 0;
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+      PlacementRequest& req = requests[i];
+
+      if (req.retc)
+        continue;
+
+      std::vector<FsGroup*> groupsToTry;
+      placer.Prepare(req, groupsToTry);
+      req.retc = ENOSPC;
+      req.group_index = -1;
+
+      for (size_t groupindex = 0; groupindex < groups.size() + groupsToTry.size();
+           groupindex++)
+      {
+        FsGroup* group = groupindex < groupsToTry.size() ?
+                         groupsToTry[groupindex] : groups[cursor];
+        bool placeRes = placer.Place(group, req);
+
+        // the next file starts with the next group
+        if (groupindex >= groupsToTry.size())
+          cursor = (cursor + 1) % groups.size();
+
+        if (placeRes)
+        {
+          req.retc = 0;
+          req.group_index = group->GetIndex();
+          break;
+        }
+      }
+
+      if (req.retc)
+      {
+        req.selected_filesystems.clear();
+        nfailed++;
+      }
+    }
+
+    return nfailed;
+  }
+
   //----------------------------------------------------------------------------
   //! Take the decision from where to access a file.
   //!
@@ -138,6 +303,12 @@ public:
 
 protected:
 
+  //----------------------------------------------------------------------------
+  //! Scheduling group cursor key for a group tag or a client
+  //----------------------------------------------------------------------------
+  static std::string GetIndexTag(const char* grouptag,
+                                 const eos::common::Mapping::VirtualIdentity_t& vid);
+
   static XrdSysMutex pMapMutex; //< protect the following scheduling state maps
 
   //! Points to the current scheduling group where to start scheduling =>
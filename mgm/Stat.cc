@@ -28,6 +28,7 @@
 #include "mgm/XrdMgmOfs.hh"
 #include "mq/XrdMqSharedObject.hh"
 #include "mgm/Quota.hh"
+#include "mgm/Access.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
 
@@ -44,6 +45,8 @@ Stat::Add (const char* tag, uid_t uid, gid_t gid, unsigned long val)
   StatAvgUid[tag][uid].Add(val);
   StatAvgGid[tag][gid].Add(val);
   Mutex.UnLock();
+  // feed the token buckets of the rate stall rules
+  Access::ChargeRate(tag, uid, gid, val);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -39,6 +39,7 @@ Vid::Set (const char* value,
           bool storeConfig)
 {
   eos::common::RWMutexWriteLock lock(eos::common::Mapping::gMapMutex);
+  eos::common::Mapping::InvalidateIdCache();
 
   XrdOucEnv env(value);
   XrdOucString skey = env.Get("mgm.vid.key");
@@ -291,6 +292,7 @@ Vid::Rm (XrdOucEnv &env,
          bool storeConfig)
 {
   eos::common::RWMutexWriteLock lock(eos::common::Mapping::gMapMutex);
+  eos::common::Mapping::InvalidateIdCache();
   XrdOucString skey = env.Get("mgm.vid.key");
   XrdOucString vidcmd = env.Get("mgm.vid.cmd");
   int envlen = 0;
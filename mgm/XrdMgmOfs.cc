@@ -152,6 +152,7 @@ XrdMgmOfs::XrdMgmOfs (XrdSysError *ep):
   eos::common::LogId::SetSingleShotLogId();
 
   fsconfiglistener_tid = stats_tid = deletion_tid = 0;
+  mReplicationPort = 0;
   mZmqContext = new zmq::context_t(1);
 }
 
@@ -227,10 +228,12 @@ XrdMgmOfs::HasStall (const char* path,
 {
   if (!rule)
     return false;
-  eos::common::RWMutexReadLock lock(Access::gAccessMutex);
-  if (Access::gStallRules.count(std::string(rule)))
+  Access::RulesRef rules;
+  google::dense_hash_map<std::string, int>::const_iterator it =
+    rules->stallByKey.find(rule);
+  if (it != rules->stallByKey.end())
   {
-    stalltime = atoi(Access::gStallRules[std::string(rule)].c_str());
+    stalltime = it->second;
     stallmsg = "Attention: you are currently hold in this instance and each request is stalled for ";
     stallmsg += (int) stalltime;
     stallmsg += " seconds after an errno of type: ";
@@ -257,25 +260,13 @@ XrdMgmOfs::HasRedirect (const char* path,
     return false;
 
   std::string srule = rule;
-  eos::common::RWMutexReadLock lock(Access::gAccessMutex);
-  if (Access::gRedirectionRules.count(srule))
+  Access::RulesRef rules;
+  google::dense_hash_map<std::string, Access::Redirect>::const_iterator it =
+    rules->redirectByKey.find(srule);
+  if (it != rules->redirectByKey.end())
   {
-    std::string delimiter = ":";
-    std::vector<std::string> tokens;
-    eos::common::StringConversion::Tokenize(Access::gRedirectionRules[srule],
-                                            tokens, delimiter);
-    if (tokens.size() == 1)
-    {
-      host = tokens[0].c_str();
-      port = 1094;
-    }
-    else
-    {
-      host = tokens[0].c_str();
-      port = atoi(tokens[1].c_str());
-      if (port == 0)
-        port = 1094;
-    }
+    host = it->second.host.c_str();
+    port = it->second.port;
 
     eos_static_info("info=\"redirect\" path=\"%s\" host=%s port=%d errno=%s",
                     path, host.c_str(), port, rule);
@@ -495,6 +495,17 @@ public:
              bool follow = true,
              std::string* uri = 0);
 
+  // ---------------------------------------------------------------------------
+  // fill stat information from namespace meta data (namespace read-locked)
+  // ---------------------------------------------------------------------------
+  void _stat_set_file (eos::IFileMD* fmd,
+                       struct stat *buf,
+                       std::string* etag = 0);
+
+  void _stat_set_container (eos::IContainerMD* cmd,
+                            struct stat *buf,
+                            std::string* etag = 0);
+
 
   // ---------------------------------------------------------------------------
   // stat file to retrieve mode
@@ -1099,6 +1110,7 @@ public:
   unsigned int mFrontendPort; ///< frontend port number for incoming requests
   unsigned int mNumAuthThreads; ///< max number of auth worker threads
   zmq::context_t* mZmqContext; ///< ZMQ context for all the sockets
+  unsigned int mReplicationPort; ///< port of the changelog replication stream
   
   // ---------------------------------------------------------------------------
   // class objects
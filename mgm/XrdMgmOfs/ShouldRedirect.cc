@@ -48,7 +48,6 @@ XrdMgmOfs::ShouldRedirect (const char* function,
  */
 /*----------------------------------------------------------------------------*/
 {
-  eos::common::RWMutexReadLock lock(Access::gAccessMutex);
   if ((vid.host == "localhost") || (vid.host == "localhost.localdomain") || (vid.uid == 0))
   {
     if (MgmMaster.IsMaster() || (IS_ACCESSMODE_R))
@@ -58,61 +57,16 @@ XrdMgmOfs::ShouldRedirect (const char* function,
     }
   }
 
-  if (Access::gRedirectionRules.size())
-  {
-    bool c1 = Access::gRedirectionRules.count(std::string("*"));
-    bool c3 = (IS_ACCESSMODE_R && Access::gRedirectionRules.count(std::string("r:*")));
-    bool c2 = (IS_ACCESSMODE_W && Access::gRedirectionRules.count(std::string("w:*")));
-    bool c4 = (IS_ACCESSMODE_R_MASTER && Access::gRedirectionRules.count(std::string("w:*")));
-    if (c1 || c2 || c3 || c4)
-    {
-      // redirect
-      std::string delimiter = ":";
-      std::vector<std::string> tokens;
-      if (c1)
-      {
-        eos::common::StringConversion::Tokenize(Access::gRedirectionRules[std::string("*")], tokens, delimiter);
-        gOFS->MgmStats.Add("Redirect", vid.uid, vid.gid, 1);
-      }
-      else
-      {
-        if (c2)
-        {
-          eos::common::StringConversion::Tokenize(Access::gRedirectionRules[std::string("w:*")], tokens, delimiter);
-          gOFS->MgmStats.Add("RedirectW", vid.uid, vid.gid, 1);
-        }
-        else
-        {
-          if (c3)
-          {
-            eos::common::StringConversion::Tokenize(Access::gRedirectionRules[std::string("r:*")], tokens, delimiter);
-            gOFS->MgmStats.Add("RedirectR", vid.uid, vid.gid, 1);
-          }
-          else
-          {
-            if (c4)
-            {
-              eos::common::StringConversion::Tokenize(Access::gRedirectionRules[std::string("w:*")], tokens, delimiter);
-              gOFS->MgmStats.Add("RedirectR-Master", vid.uid, vid.gid, 1);
-            }
-          }
-        }
-      }
+  // the redirection target is precomputed per access mode in the rule snapshot
+  Access::RulesRef rules;
+  const Access::Redirect& redirect = rules->redirect[__AccessMode__];
 
-      if (tokens.size() == 1)
-      {
-        host = tokens[0].c_str();
-        port = 1094;
-      }
-      else
-      {
-        host = tokens[0].c_str();
-        port = atoi(tokens[1].c_str());
-        if (port == 0)
-          port = 1094;
-      }
-      return true;
-    }
+  if (redirect.set)
+  {
+    gOFS->MgmStats.Add(redirect.tag, vid.uid, vid.gid, 1);
+    host = redirect.host.c_str();
+    port = redirect.port;
+    return true;
   }
   return false;
 }
\ No newline at end of file
@@ -49,15 +49,16 @@ XrdMgmOfs::ShouldStall (const char* function,
 /*----------------------------------------------------------------------------*/
 {
   // ---------------------------------------------------------------------------
-  // check for user, group or host banning
+  // check for user, group or host banning - the rules are evaluated on an
+  // immutable snapshot, no lock is taken unless a rate rule applies
   // ---------------------------------------------------------------------------
-  eos::common::RWMutexReadLock lock(Access::gAccessMutex);
+  Access::RulesRef rules;
   std::string smsg = "";
   stalltime = 0;
 
   if ((vid.uid > 3))
   {
-    if (Access::gBannedUsers.count(vid.uid))
+    if (rules->banned && rules->bannedUsers.count(vid.uid))
     {
       // fuse clients don't get stalled by a booted namespace 
       if ( vid.app == "fuse" )
@@ -68,7 +69,7 @@ XrdMgmOfs::ShouldStall (const char* function,
       smsg = "you are banned in this instance - contact an administrator";
     }
     else
-      if (Access::gBannedGroups.count(vid.gid))
+      if (rules->banned && rules->bannedGroups.count(vid.gid))
     {
       // fuse clients don't get stalled by a booted namespace 
       if ( vid.app == "fuse" )
@@ -79,7 +80,7 @@ XrdMgmOfs::ShouldStall (const char* function,
       smsg = "your group is banned in this instance - contact an administrator";
     }
     else
-      if (Access::gBannedHosts.count(vid.host))
+      if (rules->banned && rules->bannedHosts.count(vid.host))
     {
       // fuse clients don't get stalled by a booted namespace 
       if ( vid.app == "fuse" )
@@ -90,95 +91,23 @@ XrdMgmOfs::ShouldStall (const char* function,
       smsg = "your client host is banned in this instance - contact an administrator";
     }
     else
-      if (Access::gStallRules.size() && (Access::gStallGlobal))
+      if (rules->userStall[__AccessMode__].set)
     {
-      // GLOBAL STALL
-      stalltime = atoi(Access::gStallRules[std::string("*")].c_str());
-      smsg = Access::gStallComment[std::string("*")];
+      // GLOBAL, READ or WRITE STALL
+      stalltime = rules->userStall[__AccessMode__].time;
+      smsg = rules->userStall[__AccessMode__].comment;
     }
     else
-      if ((IS_ACCESSMODE_R && (Access::gStallRead)) || (IS_ACCESSMODE_R_MASTER && (Access::gStallRead)))
+      if (rules->rateRules.size())
     {
-      // READ STALL
-      stalltime = atoi(Access::gStallRules[std::string("r:*")].c_str());
-      smsg = Access::gStallComment[std::string("r:*")];
-    }
-    else
-      if (IS_ACCESSMODE_W && (Access::gStallWrite))
-    {
-      stalltime = atoi(Access::gStallRules[std::string("w:*")].c_str());
-      smsg = Access::gStallComment[std::string("w:*")];
-    }
-    else
-      if (Access::gStallUserGroup)
-    {
-      std::string usermatch = "rate:user:";
-      usermatch += vid.uid_string;
-      std::string groupmatch = "rate:group:";
-      groupmatch += vid.gid_string;
-      std::string userwildcardmatch = "rate:user:*";
-      std::string groupwildcardmatch = "rate:group:*";
+      // USER or GROUP RATE STALL
+      const Access::RateRule* rule = Access::RateExceeded(rules.get(), vid.uid, vid.gid);
 
-      std::map<std::string, std::string>::const_iterator it;
-      for (it = Access::gStallRules.begin();
-              it != Access::gStallRules.end();
-              it++)
+      if (rule)
       {
-        std::string cmd = it->first.substr(it->first.rfind(":") + 1);
-        double cutoff = strtod(it->second.c_str(), 0) * 1.33;
-        if ((it->first.find(userwildcardmatch) == 0))
-        {
-          // catch all rule = global user rate cut
-          XrdSysMutexHelper statLock(gOFS->MgmStats.Mutex);
-          if (gOFS->MgmStats.StatAvgUid.count(cmd) &&
-              gOFS->MgmStats.StatAvgUid[cmd].count(vid.uid) &&
-              (gOFS->MgmStats.StatAvgUid[cmd][vid.uid].GetAvg5() > cutoff))
-          {
-            stalltime = 5;
-            smsg = Access::gStallComment[it->first];
-          }
-        }
-        else
-          if ((it->first.find(groupwildcardmatch) == 0))
-        {
-          // catch all rule = global user rate cut
-          XrdSysMutexHelper statLock(gOFS->MgmStats.Mutex);
-          if (gOFS->MgmStats.StatAvgGid.count(cmd) &&
-              gOFS->MgmStats.StatAvgGid[cmd].count(vid.gid) &&
-              (gOFS->MgmStats.StatAvgGid[cmd][vid.gid].GetAvg5() > cutoff))
-          {
-            stalltime = 5;
-            smsg = Access::gStallComment[it->first];
-          }
-        }
-        else
-          if ((it->first.find(usermatch) == 0))
-        {
-          // check user rule
-          if (gOFS->MgmStats.StatAvgUid.count(cmd) &&
-              gOFS->MgmStats.StatAvgUid[cmd].count(vid.uid) &&
-              (gOFS->MgmStats.StatAvgUid[cmd][vid.uid].GetAvg5() > cutoff))
-          {
-            // rate exceeded
-            stalltime = 5;
-            smsg = Access::gStallComment[it->first];
-          }
-        }
-        else
-          if ((it->first.find(groupmatch) == 0))
-        {
-          // check group rule
-          if (gOFS->MgmStats.StatAvgGid.count(cmd) &&
-              gOFS->MgmStats.StatAvgGid[cmd].count(vid.gid) &&
-              (gOFS->MgmStats.StatAvgGid[cmd][vid.gid].GetAvg5() > cutoff))
-          {
-            // rate exceeded
-            stalltime = 5;
-            smsg = Access::gStallComment[it->first];
-          }
-        }
+        stalltime = 5;
+        smsg = rule->comment;
       }
-
     }
     if (stalltime)
     {
@@ -196,21 +125,18 @@ XrdMgmOfs::ShouldStall (const char* function,
   {
     // admin/root is only stalled for global stalls not,
     // for write-only or read-only stalls
-    if (Access::gStallRules.size())
+    if (rules->rootStall.set)
     {
-      if (Access::gStallRules.count(std::string("*")))
+      if ((vid.host != "localhost.localdomain") && (vid.host != "localhost"))
       {
-        if ((vid.host != "localhost.localdomain") && (vid.host != "localhost"))
-        {
-          stalltime = atoi(Access::gStallRules[std::string("*")].c_str());
-          stallmsg = "Attention: you are currently hold in this instance and each request is stalled for ";
-          stallmsg += (int) stalltime;
-          stallmsg += " seconds ...";
-          eos_static_info("info=\"stalling access to\" uid=%u gid=%u host=%s",
-                          vid.uid, vid.gid, vid.host.c_str());
-          gOFS->MgmStats.Add("Stall", vid.uid, vid.gid, 1);
-          return true;
-        }
+        stalltime = rules->rootStall.time;
+        stallmsg = "Attention: you are currently hold in this instance and each request is stalled for ";
+        stallmsg += (int) stalltime;
+        stallmsg += " seconds ...";
+        eos_static_info("info=\"stalling access to\" uid=%u gid=%u host=%s",
+                        vid.uid, vid.gid, vid.host.c_str());
+        gOFS->MgmStats.Add("Stall", vid.uid, vid.gid, 1);
+        return true;
       }
     }
   }
@@ -120,7 +120,7 @@ xrdmgmofs_shutdown (int sig)
 
   // ---------------------------------------------------------------------------
   eos_static_warning("Shutdown:: set stall rule");
-  eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+  Access::RulesWriteLock lock;
   Access::gStallRules[std::string("*")] = "300";
 
   if (gOFS->ErrorLog)
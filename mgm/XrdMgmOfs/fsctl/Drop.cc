@@ -34,128 +34,158 @@
   MAYREDIRECT;
 
   EXEC_TIMING_BEGIN("Drop");
-  // drops a replica
+  // drops a replica - or with mgm.fids a comma separated list of replicas
+  // of the same filesystem (bulk drop sent by the FST deletion workers)
   int envlen;
   eos_thread_info("drop request for %s", env.Env(envlen));
   char* afid = env.Get("mgm.fid");
+  char* afids = env.Get("mgm.fids");
   char* afsid = env.Get("mgm.fsid");
 
-  if (afid && afsid)
+  if ((afid || afids) && afsid)
   {
     unsigned long fsid = strtoul(afsid, 0, 10);
+    std::vector<unsigned long long> fids;
 
-    // ---------------------------------------------------------------------
-    eos::common::RWMutexWriteLock lock(gOFS->eosViewRWMutex);
-    eos::IFileMD* fmd = 0;
-    eos::IContainerMD* container = 0;
-    eos::IQuotaNode* ns_quota = 0;
-
-    try
+    if (afid)
     {
-      fmd = eosFileService->getFileMD(eos::common::FileId::Hex2Fid(afid));
+      fids.push_back(eos::common::FileId::Hex2Fid(afid));
     }
-    catch (...)
+    else
     {
-      eos_thread_warning("no meta record exists anymore for fid=%s", afid);
-      fmd = 0;
-    }
+      std::vector<std::string> tokens;
+      std::string delimiter = ",";
+      eos::common::StringConversion::Tokenize(afids, tokens, delimiter);
 
-    if (fmd)
-    {
-      try
+      for (size_t i = 0; i < tokens.size(); i++)
       {
-        container = gOFS->eosDirectoryService->getContainerMD(fmd->getContainerId());
-      }
-      catch (eos::MDException &e)
-      {
-        container = 0;
+        if (tokens[i].length())
+          fids.push_back(eos::common::FileId::Hex2Fid(tokens[i].c_str()));
       }
     }
 
-    if (container)
-    {
-      try
-      {
-        ns_quota = gOFS->eosView->getQuotaNode(container);
-
-        if (ns_quota)
-          ns_quota->removeFile(fmd);
-      }
-      catch (eos::MDException &e)
-      {
-        ns_quota = 0;
-      }
-    }
+    // If mgm.dropall flag is set then it means we got a deleteOnClose
+    // at the gateway node and we need to delete all replicas
+    char* drop_all = afid ? env.Get("mgm.dropall") : 0;
 
-    if (fmd)
+    // the namespace lock is released every 256 files of a bulk drop
+    for (size_t n = 0; n < fids.size(); n += 256)
     {
-      try
+      // ---------------------------------------------------------------------
+      eos::common::RWMutexWriteLock lock(gOFS->eosViewRWMutex);
+
+      for (size_t i = n; (i < fids.size()) && (i < n + 256); i++)
       {
-        // If mgm.dropall flag is set then it means we got a deleteOnClose
-        // at the gateway node and we need to delete all replicas
-        char* drop_all = env.Get("mgm.dropall");
-        std::vector<unsigned int> drop_fsid;
-        bool updatestore = false;
+        unsigned long long fid = fids[i];
+        eos::IFileMD* fmd = 0;
+        eos::IContainerMD* container = 0;
+        eos::IQuotaNode* ns_quota = 0;
 
-        if (drop_all)
+        try
         {
-          for (unsigned int i = 0; i < fmd->getNumLocation(); i++)
-            drop_fsid.push_back(fmd->getLocation(i));
+          fmd = eosFileService->getFileMD(fid);
         }
-        else
+        catch (...)
         {
-          drop_fsid.push_back(fsid);
+          eos_thread_warning("no meta record exists anymore for fxid=%08llx", fid);
+          fmd = 0;
         }
 
-        // Drop the selected replicas
-        for (auto id = drop_fsid.begin(); id != drop_fsid.end(); id++)
+        if (fmd)
         {
-          eos_thread_debug("removing location %u of fid=%s", *id, afid);
-          updatestore = false;
-
-          if (fmd->hasLocation(*id))
+          try
           {
-            fmd->unlinkLocation(*id);
-            updatestore = true;
+            container = gOFS->eosDirectoryService->getContainerMD(fmd->getContainerId());
           }
-
-          if (fmd->hasUnlinkedLocation(*id))
+          catch (eos::MDException &e)
           {
-            fmd->removeLocation(*id);
-            updatestore = true;
+            container = 0;
           }
+        }
 
-          if (updatestore)
+        if (container)
+        {
+          try
           {
-            gOFS->eosView->updateFileStore(fmd);
-            // After update we have to get the new address - who knows ...
-            fmd = eosFileService->getFileMD(eos::common::FileId::Hex2Fid(afid));
-          }
+            ns_quota = gOFS->eosView->getQuotaNode(container);
 
-          if (ns_quota)
-            ns_quota->addFile(fmd);
+            if (ns_quota)
+              ns_quota->removeFile(fmd);
+          }
+          catch (eos::MDException &e)
+          {
+            ns_quota = 0;
+          }
         }
 
-        // Finally delete the record if all replicas are dropped
-        if ((!fmd->getNumUnlinkedLocation()) && (!fmd->getNumLocation()))
+        if (fmd)
         {
-          if (ns_quota)
+          try
           {
-            // If we were still attached to a container, we can now detach
-            // and count the file as removed
-            ns_quota->removeFile(fmd);
+            std::vector<unsigned int> drop_fsid;
+            bool updatestore = false;
+
+            if (drop_all)
+            {
+              for (unsigned int l = 0; l < fmd->getNumLocation(); l++)
+                drop_fsid.push_back(fmd->getLocation(l));
+            }
+            else
+            {
+              drop_fsid.push_back(fsid);
+            }
+
+            // Drop the selected replicas
+            for (auto id = drop_fsid.begin(); id != drop_fsid.end(); id++)
+            {
+              eos_thread_debug("removing location %u of fxid=%08llx", *id, fid);
+              updatestore = false;
+
+              if (fmd->hasLocation(*id))
+              {
+                fmd->unlinkLocation(*id);
+                updatestore = true;
+              }
+
+              if (fmd->hasUnlinkedLocation(*id))
+              {
+                fmd->removeLocation(*id);
+                updatestore = true;
+              }
+
+              if (updatestore)
+              {
+                gOFS->eosView->updateFileStore(fmd);
+                // After update we have to get the new address - who knows ...
+                fmd = eosFileService->getFileMD(fid);
+              }
+
+              if (ns_quota)
+                ns_quota->addFile(fmd);
+            }
+
+            // Finally delete the record if all replicas are dropped
+            if ((!fmd->getNumUnlinkedLocation()) && (!fmd->getNumLocation()))
+            {
+              if (ns_quota)
+              {
+                // If we were still attached to a container, we can now detach
+                // and count the file as removed
+                ns_quota->removeFile(fmd);
+              }
+
+              gOFS->eosView->removeFile(fmd);
+            }
           }
-
-          gOFS->eosView->removeFile(fmd);
+          catch (...)
+          {
+            eos_thread_warning("no meta record exists anymore for fxid=%08llx", fid);
+          };
         }
       }
-      catch (...)
-      {
-        eos_thread_warning("no meta record exists anymore for fid=%s", afid);
-      };
     }
 
-    gOFS->MgmStats.Add("Drop", vid.uid, vid.gid, 1);
+    gOFS->MgmStats.Add("Drop", vid.uid, vid.gid, fids.size());
 
     const char* ok = "OK";
     error.setErrInfo(strlen(ok) + 1, ok);
@@ -82,7 +82,7 @@ XrdMgmOfs::InitializeFileView ()
   bool oldstallglobal = false;
   // set the client stall
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (Access::gStallRules.count(std::string("*")))
     {
       if (!RemoveStallRuleAfterBoot)
@@ -263,7 +263,7 @@ XrdMgmOfs::InitializeFileView ()
                                    "seconds", (tstop - tstart)));
 
     {
-      eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+      Access::RulesWriteLock lock;
       if (oldstallrule.length())
       {
         Access::gStallRules[std::string("*")] = oldstallrule;
@@ -1145,6 +1145,22 @@ XrdMgmOfs::Configure (XrdSysError &Eroute)
             mFrontendPort = atoi(val);
           }
         }
+
+        // Configure the port of the changelog replication stream - if set it
+        // replaces the eosfilesync based changelog synchronization
+        if (!strcmp("replicationport", var))
+        {
+          if (!(val = Config.GetWord()))
+          {
+            Eroute.Emsg("Config", "argument for replication port invalid.");
+            NoGo = 1;
+          }
+          else
+          {
+            Eroute.Say("=====> mgmofs.replicationport: ", val, "");
+            mReplicationPort = atoi(val);
+          }
+        }
       }
     }
   }
@@ -1467,6 +1483,17 @@ XrdMgmOfs::Configure (XrdSysError &Eroute)
   if (getenv("EOS_MGM_ALIAS"))
     MgmOfsAlias = getenv("EOS_MGM_ALIAS");
 
+  // FSTs older than the binary capability format need the legacy one
+  if (getenv("EOS_MGM_LEGACY_CAPABILITY"))
+  {
+    XrdCapability::SetFormat(XrdCapability::kLegacyFormat);
+    Eroute.Say("=====> mgmofs.capability-format: legacy", "");
+  }
+  else
+  {
+    Eroute.Say("=====> mgmofs.capability-format: binary", "");
+  }
+
   // we don't put the alias we need call-back's to appear on our node
   if (MgmOfsAlias.length())
     Eroute.Say("=====> mgmofs.alias: ", MgmOfsAlias.c_str());
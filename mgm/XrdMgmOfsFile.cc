@@ -2056,6 +2056,12 @@ XrdMgmOfsFile::open (const char *inpath,
       redirectionhost += openOpaque->Get("eos.mtime");
     }
 
+    if (openOpaque->Get("eos.replicachain"))
+    {
+      redirectionhost += "&mgm.replicachain=";
+      redirectionhost += openOpaque->Get("eos.replicachain");
+    }
+
     // For the moment we redirect only on storage nodes
     redirectionhost += "&mgm.replicaindex=";
     redirectionhost += (int) fsIndex;
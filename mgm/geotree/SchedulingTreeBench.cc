@@ -0,0 +1,264 @@
+//------------------------------------------------------------------------------
+// @file SchedulingTreeBench.cc
+// @author agent <agent@local>
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Multi-threaded placement throughput of the fast trees, as done by the
+// GeoTreeEngine : every placement takes the foreground fast tree, makes its
+// working copy and books 3 replicas while an updater thread keeps refreshing
+// the background tree and swapping the buffers.
+// The foreground is protected either by a read lock on a RWMutex (the former
+// doubleBufferMutex scheme) or by the reader slots + grace period scheme.
+//------------------------------------------------------------------------------
+
+#undef NDEBUG
+#include "mgm/geotree/SchedulingSlowTree.hh"
+#include "common/Logging.hh"
+#include "common/RWMutex.hh"
+#include "XrdSys/XrdSysAtomics.hh"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace eos::mgm;
+
+const size_t groupSize = 100;
+const size_t nReplicas = 3;
+const size_t bufferSize = 16384;
+const size_t nReaderSlots = 32;
+const double runSeconds = 2.0;
+
+struct ReaderSlot
+{
+  volatile size_t count;
+  char pad[64-sizeof(size_t)];
+  ReaderSlot() : count(0) {}
+};
+
+struct Buffer
+{
+  FastPlacementTree plct;
+  FastBalancingPlacementTree blcPlct;
+  FastDrainingPlacementTree drnPlct;
+  FastROAccessTree roAccess;
+  FastRWAccessTree rwAccess;
+  FastBalancingAccessTree blcAccess;
+  FastDrainingAccessTree drnAccess;
+  SchedTreeBase::FastTreeInfo info;
+  Fs2TreeIdxMap fs2Idx;
+  GeoTag2NodeIdxMap geo2Idx;
+  ReaderSlot readers[nReaderSlots];
+
+  size_t activeReaders() const
+  {
+    size_t count = 0;
+    for(size_t k = 0; k < nReaderSlots; k++)
+    count += readers[k].count;
+    return count;
+  }
+};
+
+Buffer buffers[2];
+Buffer * volatile foreground = buffers;
+Buffer *background = buffers + 1;
+eos::common::RWMutex doubleBufferMutex;
+bool useLock = true;
+volatile bool stop = false;
+size_t slotCounter = 0;
+__thread size_t tlSlot = 0;
+
+static double now ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static size_t readerSlot ()
+{
+  if (!tlSlot) tlSlot = 1 + (AtomicInc(slotCounter) % nReaderSlots);
+  return tlSlot - 1;
+}
+
+static Buffer* acquire ()
+{
+  if (useLock)
+  {
+    doubleBufferMutex.LockRead ();
+    return foreground;
+  }
+  size_t slot = readerSlot ();
+  while (true)
+  {
+    Buffer *ft = foreground;
+    AtomicInc(ft->readers[slot].count);
+    if (ft == foreground) return ft;
+    AtomicDec(ft->readers[slot].count);
+  }
+}
+
+static void release (Buffer *ft)
+{
+  if (useLock)
+    doubleBufferMutex.UnLockRead ();
+  else
+    AtomicDec(ft->readers[readerSlot ()].count);
+}
+
+static void swapBuffers ()
+{
+  if (useLock)
+  {
+    eos::common::RWMutexWriteLock lock (doubleBufferMutex);
+    std::swap (foreground, background);
+    return;
+  }
+  Buffer *retired = foreground;
+  __sync_synchronize ();
+  foreground = background;
+  __sync_synchronize ();
+  background = retired;
+  while (retired->activeReaders ())
+    sched_yield ();
+}
+
+void* placer (void *arg)
+{
+  size_t *count = (size_t*) arg;
+  char buffer[bufferSize];
+  while (!stop)
+  {
+    Buffer *ft = acquire ();
+    assert(ft->plct.copyToBuffer (buffer, bufferSize) == 0);
+    FastPlacementTree *tree = (FastPlacementTree*) buffer;
+    SchedTreeBase::tFastTreeIdx idx;
+    for (size_t k = 0; k < nReplicas; k++)
+      tree->findFreeSlot (idx);
+    release (ft);
+    (*count)++;
+  }
+  return 0;
+}
+
+void* updater (void *arg)
+{
+  size_t *count = (size_t*) arg;
+  while (!stop)
+  {
+    // the engine refreshes the background trees before every swap
+    background->plct.updateTree ();
+    swapBuffers ();
+    (*count)++;
+    usleep (1000);
+  }
+  return 0;
+}
+
+int main (int argc, char* argv[])
+{
+  eos::common::Logging::Init ();
+  eos::common::Logging::SetUnit ("SchedulingTreeBench");
+  eos::common::Logging::SetLogPriority (LOG_INFO);
+  doubleBufferMutex.SetBlocking (true);
+  srand (0);
+
+  // one scheduling group : 5 sites x 4 racks x 5 hosts
+  SlowTree tree ("bench");
+  for (size_t fs = 0; fs < groupSize; fs++)
+  {
+    ostringstream oss;
+    oss << "site" << fs % 5 << "::rack" << (fs / 5) % 4 << "::host" << fs / 20;
+    SchedTreeBase::TreeNodeInfo info;
+    info.geotag = oss.str ();
+    oss << ".cern.ch";
+    info.host = oss.str ();
+    info.fsId = fs + 1;
+    SchedTreeBase::TreeNodeStateFloat state;
+    state.dlScore = 1.0;
+    state.ulScore = 1.0;
+    state.mStatus = SchedTreeBase::Available | SchedTreeBase::Writable | SchedTreeBase::Readable;
+    state.fillRatio = 0.5;
+    state.totalSpace = 2e12;
+    assert(tree.insert (&info, &state) != NULL);
+  }
+
+  for (int b = 0; b < 2; b++)
+  {
+    Buffer &buf = buffers[b];
+    buf.plct.selfAllocate (tree.getNodeCount ());
+    buf.blcPlct.selfAllocate (tree.getNodeCount ());
+    buf.drnPlct.selfAllocate (tree.getNodeCount ());
+    buf.roAccess.selfAllocate (tree.getNodeCount ());
+    buf.rwAccess.selfAllocate (tree.getNodeCount ());
+    buf.blcAccess.selfAllocate (tree.getNodeCount ());
+    buf.drnAccess.selfAllocate (tree.getNodeCount ());
+    assert(tree.buildFastStrctures (&buf.plct, &buf.roAccess, &buf.rwAccess, &buf.blcPlct, &buf.blcAccess,
+                                    &buf.drnPlct, &buf.drnAccess, &buf.info, &buf.fs2Idx, &buf.geo2Idx));
+  }
+
+  size_t maxThreads = (argc > 1) ? atoi (argv[1]) : 16;
+  cout << "PLACEMENT THROUGHPUT (" << nReplicas << " replicas per placement, " << groupSize
+       << " fs, buffers swapped every ms)" << endl;
+  cout << setw (8) << "threads" << setw (22) << "rwmutex [plct/s]" << setw (22) << "reader slots [plct/s]" << endl;
+
+  for (size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+  {
+    cout << setw (8) << nThreads;
+    for (int mode = 0; mode < 2; mode++)
+    {
+      useLock = (mode == 0);
+      stop = false;
+      vector<pthread_t> tids (nThreads);
+      vector<size_t> counts (nThreads * 16, 0); // one cache line per thread
+      size_t swaps = 0;
+      pthread_t utid;
+      double start = now ();
+      for (size_t i = 0; i < nThreads; i++)
+        pthread_create (&tids[i], 0, placer, &counts[i * 16]);
+      pthread_create (&utid, 0, updater, &swaps);
+      usleep ((useconds_t) (runSeconds * 1e6));
+      stop = true;
+      for (size_t i = 0; i < nThreads; i++)
+        pthread_join (tids[i], 0);
+      pthread_join (utid, 0);
+      double elapsed = now () - start;
+      size_t total = 0;
+      for (size_t i = 0; i < nThreads; i++)
+        total += counts[i * 16];
+      cout << setw (22) << (size_t) (total / elapsed);
+    }
+    cout << endl;
+  }
+
+  return 0;
+}
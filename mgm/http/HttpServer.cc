@@ -185,9 +185,25 @@ HttpServer::Handler (void                  *cls,
 
   // Create the response
   struct MHD_Response *mhdResponse;
-  mhdResponse = MHD_create_response_from_buffer(response->GetBodySize(), (void*)
-                                                response->GetBody().c_str(),
-                                                MHD_RESPMEM_MUST_COPY);
+  bool streamed = false;
+
+  if (response->mStreamBody)
+  {
+    // the body is built while it is sent - once created the response owns
+    // the handler and frees it with StreamFreeCallback
+    mhdResponse = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN,
+                                                    256 * 1024,
+                                                    &HttpServer::StreamReaderCallback,
+                                                    (void*) protocolHandler,
+                                                    &HttpServer::StreamFreeCallback);
+    streamed = (mhdResponse != 0);
+  }
+  else
+  {
+    mhdResponse = MHD_create_response_from_buffer(response->GetBodySize(), (void*)
+                                                  response->GetBody().c_str(),
+                                                  MHD_RESPMEM_MUST_COPY);
+  }
 
   if (mhdResponse)
   {
@@ -203,19 +219,43 @@ HttpServer::Handler (void                  *cls,
                                  mhdResponse);
     eos_static_debug("msg=\"MHD_queue_response\" retc=%d", ret);
     MHD_destroy_response(mhdResponse);
-    delete protocolHandler;
+
+    if (!streamed)
+      delete protocolHandler;
+
     *ptr = 0;
     return ret;
   }
   else
   {
-    eos_static_crit("msg=\"response creation failed\"");
+    // the free callback of a response which could not be created is never
+    // called - the handler of a streamed body is still ours
+    eos_static_crit("msg=\"response creation failed\" streamed=%d",
+                    response->mStreamBody);
     delete protocolHandler;
     *ptr = 0;
     return MHD_NO;
   }
 }
 
+/*----------------------------------------------------------------------------*/
+ssize_t
+HttpServer::StreamReaderCallback (void *cls, uint64_t pos, char *buf, size_t max)
+{
+  eos::common::ProtocolHandler *handler =
+    static_cast<eos::common::ProtocolHandler*> (cls);
+  eos::common::HttpResponse *response = handler->GetResponse();
+  ssize_t nread = response ? response->StreamBody(buf, max) : -1;
+  return (nread < 0) ? MHD_CONTENT_READER_END_OF_STREAM : nread;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+HttpServer::StreamFreeCallback (void *cls)
+{
+  delete static_cast<eos::common::ProtocolHandler*> (cls);
+}
+
 //#endif
 
 /*----------------------------------------------------------------------------*/
@@ -79,6 +79,29 @@ public:
            size_t                *upload_data_size,
            void                 **ptr);
 
+  /**
+   * Stream reader callback function producing the next part of a streamed
+   * response body
+   *
+   * @param cls  the protocol handler owning the response
+   * @param pos  position in the body
+   * @param buf  buffer to fill
+   * @param max  size of the buffer
+   *
+   * @return number of bytes placed in buf or MHD_CONTENT_READER_END_OF_STREAM
+   */
+  static ssize_t
+  StreamReaderCallback (void *cls, uint64_t pos, char *buf, size_t max);
+
+  /**
+   * Stream free callback function deleting the protocol handler when the
+   * streamed response has been sent
+   *
+   * @param cls  the protocol handler owning the response
+   */
+  static void
+  StreamFreeCallback (void *cls);
+
   /**
    * HTTP complete handler function on MGM
    *
@@ -0,0 +1,140 @@
+// ----------------------------------------------------------------------
+// File: S3Listing.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/http/s3/S3Listing.hh"
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+#include <algorithm>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+namespace
+{
+  /**
+   * Orders index entries by the name they point to
+   */
+  struct EntryLess
+  {
+    const char *mPool;
+
+    EntryLess (const char *pool) : mPool(pool) { }
+
+    bool
+    operator() (uint64_t left, uint64_t right) const
+    {
+      return strcmp(mPool + (left >> 1), mPool + (right >> 1)) < 0;
+    }
+
+    bool
+    operator() (const char *left, uint64_t right) const
+    {
+      return strcmp(left, mPool + (right >> 1)) < 0;
+    }
+  };
+}
+
+/*----------------------------------------------------------------------------*/
+S3Listing::S3Listing () :
+  mCreated(time(NULL)), mLastAccess(mCreated), mMTimeSec(0), mMTimeNsec(0),
+  mNumEntries(0) { }
+
+/*----------------------------------------------------------------------------*/
+void
+S3Listing::Add (const std::string &name, bool container)
+{
+  mIndex.push_back((((uint64_t) mPool.length()) << 1) | (container ? 1 : 0));
+  mPool += name;
+
+  if (container)
+  {
+    mPool += '/';
+  }
+
+  mPool += '\0';
+}
+
+/*----------------------------------------------------------------------------*/
+void
+S3Listing::Seal ()
+{
+  std::sort(mIndex.begin(), mIndex.end(), EntryLess(mPool.c_str()));
+}
+
+/*----------------------------------------------------------------------------*/
+size_t
+S3Listing::Seek (const std::string &prefix, const std::string &marker) const
+{
+  if (marker.empty())
+  {
+    return 0;
+  }
+
+  if (marker.compare(0, prefix.length(), prefix))
+  {
+    // the marker is not in this directory - all keys sort either after or
+    // before it
+    return (marker < prefix) ? 0 : Size();
+  }
+
+  std::string rest = marker.substr(prefix.length());
+  return std::upper_bound(mIndex.begin(), mIndex.end(), rest.c_str(),
+                          EntryLess(mPool.c_str())) - mIndex.begin();
+}
+
+/*----------------------------------------------------------------------------*/
+void
+S3XmlWriter::Text (const char *value)
+{
+  const char *start = value;
+
+  for (const char *c = value; *c; c++)
+  {
+    const char *entity = 0;
+
+    switch (*c)
+    {
+    case '&': entity = "&amp;";
+      break;
+    case '<': entity = "&lt;";
+      break;
+    case '>': entity = "&gt;";
+      break;
+    case '"': entity = "&quot;";
+      break;
+    case '\'': entity = "&apos;";
+      break;
+    default:
+      continue;
+    }
+
+    mOut.append(start, c - start);
+    mOut += entity;
+    start = c + 1;
+  }
+
+  mOut += start;
+}
+
+EOSMGMNAMESPACE_END
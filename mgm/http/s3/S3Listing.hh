@@ -0,0 +1,164 @@
+// ----------------------------------------------------------------------
+// File: S3Listing.hh
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/**
+ * @file  S3Listing.hh
+ *
+ * @brief sorted, compact snapshot of a bucket directory used to serve paged
+ *        bucket listings and a small XML writer for the listing responses
+ */
+
+#ifndef __EOSMGM_S3LISTING__HH__
+#define __EOSMGM_S3LISTING__HH__
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Namespace.hh"
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+EOSMGMNAMESPACE_BEGIN
+
+class S3Listing
+{
+private:
+  std::string           mPool;  //< all names, '\0' terminated
+  std::vector<uint64_t> mIndex; //< sorted (offset in mPool << 1 | is container)
+
+public:
+  time_t   mCreated;       //< time the snapshot was taken
+  time_t   mLastAccess;    //< last time the snapshot was used
+  uint64_t mMTimeSec;      //< directory mtime (s) at snapshot time
+  uint64_t mMTimeNsec;     //< directory mtime (ns) at snapshot time
+  uint64_t mNumEntries;    //< number of files and subdirectories at snapshot time
+
+  S3Listing ();
+
+  /**
+   * Add an entry - Seal has to be called once all entries are added
+   *
+   * @param name       entry name
+   * @param container  true if the entry is a subdirectory
+   */
+  void
+  Add (const std::string &name, bool container);
+
+  /**
+   * Sort the entries
+   */
+  void
+  Seal ();
+
+  /**
+   * @return number of entries
+   */
+  size_t
+  Size () const { return mIndex.size(); }
+
+  /**
+   * @return name of entry i - subdirectories end with '/' so that the entries
+   *         sort like the S3 keys they are listed as
+   */
+  const char*
+  Name (size_t i) const { return mPool.c_str() + (mIndex[i] >> 1); }
+
+  /**
+   * @return true if entry i is a subdirectory
+   */
+  bool
+  IsContainer (size_t i) const { return (mIndex[i] & 1); }
+
+  /**
+   * Position of the first entry listed after a marker
+   *
+   * @param prefix  listed directory relative to the bucket ('' or 'dir/')
+   * @param marker  S3 marker (a key of the bucket) or ''
+   *
+   * @return index of the first entry whose key sorts after the marker
+   */
+  size_t
+  Seek (const std::string &prefix, const std::string &marker) const;
+};
+
+/**
+ * Appends XML elements to a response buffer
+ */
+class S3XmlWriter
+{
+private:
+  std::string &mOut;
+
+public:
+  S3XmlWriter (std::string &out) : mOut(out) { }
+
+  /**
+   * Append value with the XML special characters escaped
+   */
+  void
+  Text (const char *value);
+
+  void
+  Open (const char *tag)
+  {
+    mOut += '<';
+    mOut += tag;
+    mOut += '>';
+  }
+
+  void
+  Close (const char *tag)
+  {
+    mOut += "</";
+    mOut += tag;
+    mOut += '>';
+  }
+
+  void
+  Element (const char *tag, const char *value)
+  {
+    if (!*value)
+    {
+      mOut += '<';
+      mOut += tag;
+      mOut += "/>";
+      return;
+    }
+
+    Open(tag);
+    Text(value);
+    Close(tag);
+  }
+
+  void
+  Element (const char *tag, const std::string &value)
+  {
+    Element(tag, value.c_str());
+  }
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
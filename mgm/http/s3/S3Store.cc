@@ -35,6 +35,9 @@ EOSMGMNAMESPACE_BEGIN
 
 #define XML_V1_UTF8 "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
 
+const size_t S3Store::sMaxListings = 64;
+const time_t S3Store::sListingLifetime = 300;
+
 /*----------------------------------------------------------------------------*/
 S3Store::S3Store (const char *s3defpath)
 {
@@ -216,6 +219,102 @@ S3Store::ListBuckets (const std::string &id)
   return response;
 }
 
+/*----------------------------------------------------------------------------*/
+std::shared_ptr<S3Listing>
+S3Store::GetListing (const std::string &path)
+{
+  eos::IContainerMD::mtime_t mtime;
+  uint64_t nentries = 0;
+  time_t now = time(NULL);
+
+  {
+    eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
+
+    try
+    {
+      eos::IContainerMD* cmd = gOFS->eosView->getContainer(path.c_str());
+      cmd->getMTime(mtime);
+      nentries = cmd->getNumFiles() + cmd->getNumContainers();
+    }
+    catch (eos::MDException &e)
+    {
+      return std::shared_ptr<S3Listing>();
+    }
+  }
+
+  {
+    XrdSysMutexHelper lLock(mListingMutex);
+    auto it = mListings.find(path);
+
+    // a snapshot is valid as long as the directory did not change
+    if ((it != mListings.end()) &&
+        ((uint64_t) mtime.tv_sec == it->second->mMTimeSec) &&
+        ((uint64_t) mtime.tv_nsec == it->second->mMTimeNsec) &&
+        (nentries == it->second->mNumEntries) &&
+        ((now - it->second->mCreated) < sListingLifetime))
+    {
+      it->second->mLastAccess = now;
+      return it->second;
+    }
+  }
+
+  std::shared_ptr<S3Listing> listing(new S3Listing());
+
+  {
+    eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
+
+    try
+    {
+      eos::IContainerMD* cmd = gOFS->eosView->getContainer(path.c_str());
+      std::set<std::string> names = cmd->getNameFiles();
+
+      for (auto it = names.begin(); it != names.end(); ++it)
+      {
+        listing->Add(*it, false);
+      }
+
+      names = cmd->getNameContainers();
+
+      for (auto it = names.begin(); it != names.end(); ++it)
+      {
+        listing->Add(*it, true);
+      }
+
+      cmd->getMTime(mtime);
+      listing->mMTimeSec = mtime.tv_sec;
+      listing->mMTimeNsec = mtime.tv_nsec;
+      listing->mNumEntries = cmd->getNumFiles() + cmd->getNumContainers();
+    }
+    catch (eos::MDException &e)
+    {
+      return std::shared_ptr<S3Listing>();
+    }
+  }
+
+  listing->Seal();
+
+  XrdSysMutexHelper lLock(mListingMutex);
+
+  if ((mListings.size() >= sMaxListings) && !mListings.count(path))
+  {
+    // evict the least recently used snapshot
+    auto oldest = mListings.begin();
+
+    for (auto it = mListings.begin(); it != mListings.end(); ++it)
+    {
+      if (it->second->mLastAccess < oldest->second->mLastAccess)
+      {
+        oldest = it;
+      }
+    }
+
+    mListings.erase(oldest);
+  }
+
+  mListings[path] = listing;
+  return listing;
+}
+
 /*----------------------------------------------------------------------------*/
 eos::common::HttpResponse*
 S3Store::ListBucket (const std::string &bucket, const std::string &query)
@@ -250,23 +349,11 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
     }
   }
 
-  std::string result = XML_V1_UTF8;
-  result += "<ListBucketResult xmlns=\"http://doc.s3.amazonaws.com/2006-03-01\">";
-  result += "<Name>";
-  result += bucket;
-  result += "</Name>";
-
   XrdOucEnv parameter(query.c_str());
-  XrdOucString stdErr;
-  XrdMgmOfsDirectory bucketdir;
-  uint64_t cnt = 0;
   uint64_t max_keys = 1000;
   std::string marker = "";
   std::string prefix = "";
 
-  // indicates that the given marker has been found in the list and output starts
-  bool marker_found = true;
-
   const char* val = 0;
   if ((val = parameter.Get("max-keys")))
   {
@@ -284,54 +371,25 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
   {
     prefix = val;
   }
-  if (marker.length())
-  {
-    marker_found = false;
-  }
 
   std::string lPrefix = prefix;
-  if (prefix == "")
-  {
-    //    lPrefix = "/";
-  }
-
-  eos_static_info("msg=\"listing\" bucket=%s prefix=%s", bucket.c_str(),
-                  lPrefix.c_str());
-
-  if (!prefix.length())
-  {
-    result += "<Prefix/>";
-  }
-  else
-  {
-    result += "<Prefix>";
-    result += prefix;
-    result += "</Prefix>";
-  }
 
-  if ((!marker.length() || (!marker.c_str())))
-  {
-    result += "<Marker/>";
-  }
-  else
-  {
-    result += "<Marker>";
-    result += marker;
-    result += "</Marker>";
-  }
+  eos_static_info("msg=\"listing\" bucket=%s prefix=%s marker=%s", bucket.c_str(),
+                  lPrefix.c_str(), marker.c_str());
 
-  result += "<Delimiter>/</Delimiter>";
-  result += "<MaxKeys>";
-  char smaxkeys[16];
+  std::string result = XML_V1_UTF8;
+  // ~400 bytes per listed key
+  result.reserve(1024 + 400 * std::min(max_keys, (uint64_t) 100000));
+  S3XmlWriter xml(result);
+  result += "<ListBucketResult xmlns=\"http://doc.s3.amazonaws.com/2006-03-01\">";
+  xml.Element("Name", bucket);
+  xml.Element("Prefix", prefix);
+  xml.Element("Marker", marker);
+  xml.Element("Delimiter", "/");
+  char smaxkeys[32];
   snprintf(smaxkeys, sizeof (smaxkeys) - 1, "%llu",
            (unsigned long long) max_keys);
-  result += smaxkeys;
-  result += "</MaxKeys>";
-
-  bool truncated = false;
-
-  size_t truncate_pos = result.length() + 13;
-  result += "<IsTruncated>false</IsTruncated>";
+  xml.Element("MaxKeys", smaxkeys);
 
   XrdOucString sPrefix = lPrefix.c_str();
   if (!sPrefix.endswith("/") && sPrefix.length())
@@ -339,143 +397,148 @@ S3Store::ListBucket (const std::string &bucket, const std::string &query)
     lPrefix += "/";
   }
 
-  int listrc = bucketdir.open((mS3ContainerPath[bucket] + lPrefix).c_str(),
-                              vid, (const char*) 0);
+  std::string dirpath = mS3ContainerPath[bucket] + lPrefix;
+  std::shared_ptr<S3Listing> listing = GetListing(dirpath);
+  bool truncated = false;
+  std::string nextmarker;
 
-  if (!listrc)
+  // meta data of one listed entry, collected under the namespace lock and
+  // formatted after releasing it
+  struct Entry
+  {
+    std::string key;
+    bool container;
+    bool exists;
+    time_t mtime;
+    std::string etag;
+    unsigned long long size;
+    uid_t uid;
+    gid_t gid;
+  };
+
+  std::vector<Entry> page;
+
+  if (listing)
   {
-    const char* dname1 = 0;
+    size_t pos = listing->Seek(lPrefix, marker);
+    size_t end = pos + std::min((uint64_t) (listing->Size() - pos), max_keys);
+    page.resize(end - pos);
 
-    while ((dname1 = bucketdir.nextEntry()))
     {
-      // loop over the directory contents
+      RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
+      eos::IContainerMD* cmd = 0;
 
-      std::string sdname = dname1;
-      if ((sdname == ".") || (sdname == ".."))
+      try
       {
-        continue;
+        cmd = gOFS->eosView->getContainer(dirpath.c_str());
       }
-
-      if (cnt > max_keys)
+      catch (eos::MDException &e)
       {
-        truncated = true;
-        // don't return more than max-keys
-        break;
+        cmd = 0;
       }
-      std::string objectname = lPrefix;
 
-      std::string fullname;
-      objectname += sdname;
-      fullname = mS3ContainerPath[bucket];
-      fullname += objectname;
-
-      if (!marker_found)
+      for (size_t i = pos; i < end; i++)
       {
-        if (marker == objectname)
+        Entry &entry = page[i - pos];
+        entry.key = lPrefix;
+        entry.key += listing->Name(i);
+        entry.container = listing->IsContainer(i);
+        entry.exists = entry.container;
+
+        if (entry.container || !cmd)
         {
-          marker_found = true;
+          continue;
         }
-        continue;
-      }
 
-      // get the file md object
-      gOFS->eosViewRWMutex.LockRead();
-      eos::IFileMD* fmd = 0;
+        eos::IFileMD* fmd = cmd->findFile(listing->Name(i));
 
-      try
-      {
-        fmd = gOFS->eosView->getFile(fullname.c_str());
-        std::unique_ptr<eos::IFileMD> fmd_cpy{fmd->clone()};
-
-        gOFS->eosViewRWMutex.UnLockRead();
-        //-------------------------------------------
-
-        result += "<Contents>";
-        result += "<Key>";
-        result += objectname.c_str();
-        result += "</Key>";
-        result += "<LastModified>";
+        if (!fmd)
+        {
+          // deleted since the snapshot was taken
+          continue;
+        }
 
         eos::IFileMD::ctime_t mtime;
-        fmd_cpy->getMTime(mtime);
-
-        result += Timing::UnixTimstamp_to_ISO8601(mtime.tv_sec);
-        result += "</LastModified>";
-        result += "<ETag>";
-        for (unsigned int i = 0; i < LayoutId::GetChecksumLen(fmd_cpy->getLayoutId()); i++)
+        fmd->getMTime(mtime);
+        entry.exists = true;
+        entry.mtime = mtime.tv_sec;
+        entry.size = fmd->getSize();
+        entry.uid = fmd->getCUid();
+        entry.gid = fmd->getCGid();
+
+        for (unsigned int k = 0; k < LayoutId::GetChecksumLen(fmd->getLayoutId()); k++)
         {
           char hb[3];
-          sprintf(hb, "%02x", (unsigned char) (fmd_cpy->getChecksum().getDataPtr()[i]));
-          result += hb;
+          sprintf(hb, "%02x", (unsigned char) (fmd->getChecksum().getDataPtr()[k]));
+          entry.etag += hb;
         }
-        result += "</ETag>";
-        result += "<Size>";
-        std::string sconv;
-        result += StringConversion::GetSizeString(sconv, (unsigned long long)
-                                                  fmd_cpy->getSize());
-        result += "</Size>";
-        result += "<StorageClass>STANDARD</StorageClass>";
-        result += "<Owner>";
-        result += "<ID>";
-        int errc = 0;
-        result += Mapping::UidToUserName(fmd_cpy->getCUid(), errc);
-        result += "</ID>";
-        result += "<DisplayName>";
-        result += Mapping::UidToUserName(fmd_cpy->getCUid(), errc);
-        result += ":";
-        result += Mapping::GidToGroupName(fmd_cpy->getCGid(), errc);
-        result += "</DisplayName>";
-        result += "</Owner>";
-        result += "</Contents>";
-      }
-      catch (eos::MDException &e)
-      {
-        gOFS->eosViewRWMutex.UnLockRead();
-        //-------------------------------------------
       }
+    }
 
-      if (!fmd)
-      {
-        // TODO: add the real container info here ...
-        // this must be a container
-        result += "<Contents>";
-        result += "<Key>";
-        result += objectname.c_str();
-        result += "/";
-        result += "</Key>";
-        result += "<LastModified>";
-        result += Timing::UnixTimstamp_to_ISO8601(time(NULL));
-        result += "</LastModified>";
-        result += "<ETag>";
-        result += "</ETag>";
-        result += "<Size>0</Size>";
-        result += "<StorageClass>STANDARD</StorageClass>";
-        result += "<Owner>";
-        result += "<ID>";
-        result += "0";
-        result += "</ID>";
-        result += "<DisplayName>";
-        result += "fake";
-        result += ":";
-        result += "fake";
-        result += "</DisplayName>";
-        result += "</Owner>";
-        result += "</Contents>";
+    if (end < listing->Size())
+    {
+      truncated = true;
 
-      }
-      cnt++;
-      if (truncated)
+      if (!page.empty())
       {
-        break;
+        nextmarker = page.back().key;
       }
     }
   }
 
-  bucketdir.close();
+  // the truncation and the next marker precede the contents
+  xml.Element("IsTruncated", truncated ? "true" : "false");
 
-  if (truncated)
+  if (truncated && nextmarker.length())
   {
-    result.replace(truncate_pos, 19, "true</IsTruncated> ");
+    xml.Element("NextMarker", nextmarker);
+  }
+
+  if (page.size())
+  {
+    std::string now = Timing::UnixTimstamp_to_ISO8601(time(NULL));
+
+    for (auto it = page.begin(); it != page.end(); ++it)
+    {
+      if (!it->exists)
+      {
+        continue;
+      }
+
+      xml.Open("Contents");
+      xml.Element("Key", it->key);
+
+      if (it->container)
+      {
+        // TODO: add the real container info here ...
+        xml.Element("LastModified", now);
+        xml.Element("ETag", "");
+        xml.Element("Size", "0");
+        xml.Element("StorageClass", "STANDARD");
+        xml.Open("Owner");
+        xml.Element("ID", "0");
+        xml.Element("DisplayName", "fake:fake");
+        xml.Close("Owner");
+      }
+      else
+      {
+        int errc = 0;
+        std::string sconv;
+        xml.Element("LastModified", Timing::UnixTimstamp_to_ISO8601(it->mtime));
+        xml.Element("ETag", it->etag);
+        xml.Element("Size", StringConversion::GetSizeString(sconv, it->size));
+        xml.Element("StorageClass", "STANDARD");
+        xml.Open("Owner");
+        std::string user = Mapping::UidToUserName(it->uid, errc);
+        xml.Element("ID", user);
+        user += ":";
+        user += Mapping::GidToGroupName(it->gid, errc);
+        xml.Element("DisplayName", user);
+        xml.Close("Owner");
+      }
+
+      xml.Close("Contents");
+    }
   }
 
   result += "</ListBucketResult>";
@@ -35,9 +35,12 @@
 #include "common/http/HttpResponse.hh"
 #include "common/RWMutex.hh"
 #include "mgm/Namespace.hh"
+#include "mgm/http/s3/S3Listing.hh"
 /*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysPthread.hh"
 /*----------------------------------------------------------------------------*/
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 /*----------------------------------------------------------------------------*/
@@ -55,6 +58,22 @@ private:
   std::map<std::string, std::string>           mS3Keys;                //< map pointing from user name to user secret key
   std::map<std::string, std::string>           mS3ContainerPath;       //< map pointing from container name to path
   std::string                                  mS3DefContainer;        //< path where all s3 objects are defined
+  XrdSysMutex                                  mListingMutex;          //< mutex protecting mListings
+  std::map<std::string, std::shared_ptr<S3Listing> > mListings;       //< sorted snapshots of listed bucket directories
+
+  static const size_t sMaxListings;     //< max. number of cached directory snapshots
+  static const time_t sListingLifetime; //< max. age of a directory snapshot
+
+  /**
+   * Get the sorted snapshot of a bucket directory - it is reused by the
+   * following page requests as long as the directory does not change
+   *
+   * @param path  namespace path of the directory
+   *
+   * @return snapshot or an empty pointer if the directory does not exist
+   */
+  std::shared_ptr<S3Listing>
+  GetListing (const std::string &path);
 
 public:
 
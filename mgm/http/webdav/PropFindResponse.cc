@@ -121,32 +121,23 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
     }
   }
 
-  // Build the response
-  // xml declaration
-  xml_node<> *decl = mXMLResponseDocument.allocate_node(node_declaration);
-  decl->append_attribute(AllocateAttribute("version", "1.0"));
-  decl->append_attribute(AllocateAttribute("encoding", "utf-8"));
-  mXMLResponseDocument.append_node(decl);
-
-  // <multistatus/> node
-  xml_node<> *multistatusNode = AllocateNode("d:multistatus");
-
-  multistatusNode->append_attribute(AllocateAttribute("xmlns:d", "DAV:"));
-
-  multistatusNode->append_attribute(
-                                    AllocateAttribute(eos::common::OwnCloud::OwnCloudNs(),
-                                                      eos::common::OwnCloud::OwnCloudNsUrl()));
-
-  mXMLResponseDocument.append_node(multistatusNode);
-
   // Is the requested resource a file or directory?
   XrdOucErrInfo error;
   struct stat statInfo;
   std::string etag;
   memset(&statInfo, 0, sizeof (struct stat));
+  mUrl = request->GetUrl();
+  mHrefUrl = request->GetUrl(true);
 
-  gOFS->_stat(request->GetUrl().c_str(), &statInfo, error, *mVirtualIdentity,
-              (const char*) 0, &etag);
+  eos_static_debug("url=%s", mUrl.c_str());
+  if (gOFS->_stat(eos::common::Path(mUrl.c_str()).GetPath(), &statInfo, error,
+                  *mVirtualIdentity, (const char*) 0, &etag))
+  {
+    eos_static_err("msg=\"error stating %s: %s\"", mUrl.c_str(),
+                   error.getErrText());
+    SetResponseCode(ResponseCodes::NOT_FOUND);
+    return this;
+  }
 
   // Figure out what we actually need to do
   std::string depth = request->GetHeaders()["depth"];
@@ -161,70 +152,65 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
   //  }
 
   eos_static_debug("depth=%s, isdir=%d", depth.c_str(), S_ISDIR(statInfo.st_mode));
-  xml_node<> *responseNode = 0;
+
+  // xml declaration and <multistatus/> element
+  mStreamBuffer = "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<d:multistatus xmlns:d=\"DAV:\" ";
+  mStreamBuffer += eos::common::OwnCloud::OwnCloudNs();
+  mStreamBuffer += "=\"";
+  mStreamBuffer += eos::common::OwnCloud::OwnCloudNsUrl();
+  mStreamBuffer += "\">";
+
   if (depth == "0" || !S_ISDIR(statInfo.st_mode))
   {
-    // Simply stat the file or direcAtory
-    responseNode = BuildResponseNode(request->GetUrl(), request->GetUrl(true));
-    if (responseNode)
-    {
-      multistatusNode->append_node(responseNode);
-    }
-    else
-    {
-      return this;
-    }
+    // Simply stat the file or directory
+    AppendResponse(mStreamBuffer, mUrl, mHrefUrl, statInfo, etag);
   }
 
   else if (depth == "1")
   {
     // Stat the resource and all child resources
     XrdMgmOfsDirectory directory;
-    int listrc = directory._open(request->GetUrl().c_str(), *mVirtualIdentity,
+    int listrc = directory._open(mUrl.c_str(), *mVirtualIdentity,
                                  (const char*) 0);
 
-    responseNode = BuildResponseNode(request->GetUrl().c_str(), request->GetUrl(true).c_str());
-
-    if (responseNode)
+    if (listrc)
     {
-      multistatusNode->append_node(responseNode);
+      eos_static_warning("msg=\"error opening directory\"");
+      SetResponseCode(HttpResponse::BAD_REQUEST);
+      return this;
     }
 
-    if (!listrc)
+    AppendResponse(mStreamBuffer, mUrl, mHrefUrl, statInfo, etag);
+
+    std::vector<std::string> names;
+    const char *val;
+    while ((val = directory.nextEntry()))
     {
-      const char *val;
-      while ((val = directory.nextEntry()))
+      XrdOucString entryname = val;
+      // don't display . .., atomic(+version) uploads and version directories
+      if (entryname.beginswith(EOS_COMMON_PATH_VERSION_FILE_PREFIX) ||
+          entryname.beginswith(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) ||
+          entryname.beginswith(EOS_WEBDAV_HIDE_IN_PROPFIND_PREFIX) ||
+          (entryname == ".") ||
+          (entryname == ".."))
       {
-        XrdOucString entryname = val;
-        // don't display . .., atomic(+version) uploads and version directories
-        if (entryname.beginswith(EOS_COMMON_PATH_VERSION_FILE_PREFIX) ||
-            entryname.beginswith(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) ||
-            entryname.beginswith(EOS_WEBDAV_HIDE_IN_PROPFIND_PREFIX) ||
-            (entryname == ".") ||
-            (entryname == ".."))
-        {
-          // skip over . .. and hidden files
-          continue;
-        }
-
-        // one response node for each file...
-        eos::common::Path path((request->GetUrl() + std::string("/") + std::string(val)).c_str());
-        eos::common::Path refpath((request->GetUrl(true) + std::string("/") + std::string(val)).c_str());
-        responseNode = BuildResponseNode(path.GetPath(), refpath.GetPath());
-        if (responseNode)
-        {
-          multistatusNode->append_node(responseNode);
-        }
-        else
-        {
-          return this;
-        }
+        // skip over . .. and hidden files
+        continue;
       }
+      names.push_back(val);
     }
-    else
+
+    // the child metadata is taken in one namespace pass and the response
+    // elements are produced while the response is sent
+    CollectEntries(names);
+
+    SetResponseCode(HttpResponse::MULTI_STATUS);
+    AddHeader("Content-Type", "application/xml; charset=utf-8");
+
+    if (mEntries.size() > 1024)
     {
-      eos_static_warning("msg=\"error opening directory\"");
-      SetResponseCode(HttpResponse::BAD_REQUEST);
+      mStreamBody = true;
       return this;
     }
   }
@@ -243,9 +229,15 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
     return this;
   }
 
+  // small responses are sent in one piece with a content length
   std::string responseString;
-  rapidxml::print(std::back_inserter(responseString), mXMLResponseDocument, rapidxml::print_no_indenting);
-  mXMLResponseDocument.clear();
+  char buffer[64 * 1024];
+  ssize_t nread;
+
+  while ((nread = StreamBody(buffer, sizeof (buffer))) > 0)
+  {
+    responseString.append(buffer, nread);
+  }
 
   SetResponseCode(HttpResponse::MULTI_STATUS);
   AddHeader("Content-Length", std::to_string((long long) responseString.size()));
@@ -255,6 +247,180 @@ PropFindResponse::BuildResponse (eos::common::HttpRequest *request)
   return this;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+PropFindResponse::CollectEntries (const std::vector<std::string> &names)
+{
+  eos::common::Path cPath(mUrl.c_str());
+  mEntries.resize(names.size());
+  gOFS->MgmStats.Add("Stat", mVirtualIdentity->uid, mVirtualIdentity->gid,
+                     names.size());
+
+  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+  eos::IContainerMD* cmd = 0;
+
+  try
+  {
+    cmd = gOFS->eosView->getContainer(cPath.GetPath());
+  }
+  catch (eos::MDException &e)
+  {
+    eos_static_debug("msg=\"exception\" ec=%d emsg=\"%s\"",
+                     e.getErrno(), e.getMessage().str().c_str());
+  }
+
+  size_t n = 0;
+
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    Entry &entry = mEntries[n];
+    entry.mName = names[i];
+    entry.mValid = false;
+
+    if (cmd)
+    {
+      eos::IFileMD* fmd = cmd->findFile(names[i]);
+
+      if (fmd)
+      {
+        // links are resolved by path when the entry is streamed
+        if (!fmd->isLink())
+        {
+          gOFS->_stat_set_file(fmd, &entry.mStat, &entry.mETag);
+          entry.mValid = true;
+        }
+      }
+      else
+      {
+        eos::IContainerMD* dmd = cmd->findContainer(names[i]);
+
+        if (!dmd)
+        {
+          // removed after the listing
+          continue;
+        }
+
+        gOFS->_stat_set_container(dmd, &entry.mStat, &entry.mETag);
+        entry.mValid = true;
+      }
+    }
+
+    n++;
+  }
+
+  mEntries.resize(n);
+}
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+PropFindResponse::StreamBody (char *buf, size_t max)
+{
+  // keep at least one buffer of XML ahead
+  while ((mStreamBuffer.size() - mStreamOffset < max) && !mStreamDone)
+  {
+    if (mStreamOffset)
+    {
+      mStreamBuffer.erase(0, mStreamOffset);
+      mStreamOffset = 0;
+    }
+
+    if (mNextEntry == mEntries.size())
+    {
+      mStreamBuffer += "</d:multistatus>";
+      mStreamDone = true;
+      std::vector<Entry>().swap(mEntries);
+      break;
+    }
+
+    Entry &entry = mEntries[mNextEntry++];
+    eos::common::Path path((mUrl + std::string("/") + entry.mName).c_str());
+    eos::common::Path refpath((mHrefUrl + std::string("/") + entry.mName).c_str());
+
+    if (!entry.mValid)
+    {
+      XrdOucErrInfo error;
+
+      if (gOFS->_stat(path.GetPath(), &entry.mStat, error, *mVirtualIdentity,
+                      (const char*) 0, &entry.mETag))
+      {
+        eos_static_err("msg=\"error stating %s: %s\"", path.GetPath(),
+                       error.getErrText());
+        continue;
+      }
+    }
+
+    const std::string *filePerm = 0;
+
+    if ((mRequestPropertyTypes & PropertyTypes::GET_OCPERM) &&
+        !S_ISDIR(entry.mStat.st_mode))
+    {
+      // the permissions of a file are given by its parent directory
+      if (!mFilePermValid)
+      {
+        XrdOucErrInfo error;
+        gOFS->acc_access(path.GetPath(), error, *mVirtualIdentity, mFilePerm);
+        mFilePermValid = true;
+      }
+
+      filePerm = &mFilePerm;
+    }
+
+    AppendResponse(mStreamBuffer, path.GetPath(), refpath.GetPath(),
+                   entry.mStat, entry.mETag, filePerm);
+  }
+
+  size_t nread = mStreamBuffer.size() - mStreamOffset;
+
+  if (nread > max)
+    nread = max;
+
+  if (!nread)
+    return -1;
+
+  memcpy(buf, mStreamBuffer.c_str() + mStreamOffset, nread);
+  mStreamOffset += nread;
+  return nread;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+PropFindResponse::AppendElement (std::string &out, const char *tag,
+                                 const char *value)
+{
+  out += '<';
+  out += tag;
+
+  if (!*value)
+  {
+    out += "/>";
+    return;
+  }
+
+  out += '>';
+
+  for (const char *c = value; *c; ++c)
+  {
+    switch (*c)
+    {
+    case '<': out += "&lt;";
+      break;
+    case '>': out += "&gt;";
+      break;
+    case '\'': out += "&apos;";
+      break;
+    case '"': out += "&quot;";
+      break;
+    case '&': out += "&amp;";
+      break;
+    default: out += *c;
+    }
+  }
+
+  out += "</";
+  out += tag;
+  out += '>';
+}
+
 /*----------------------------------------------------------------------------*/
 void
 PropFindResponse::ParseRequestPropertyTypes (rapidxml::xml_node<> *node)
@@ -320,18 +486,18 @@ PropFindResponse::ParseRequestPropertyTypes (rapidxml::xml_node<> *node)
 }
 
 /*----------------------------------------------------------------------------*/
-rapidxml::xml_node<>*
-PropFindResponse::BuildResponseNode (const std::string &url, const std::string &hrefurl)
+void
+PropFindResponse::AppendResponse (std::string &out,
+                                  const std::string &url,
+                                  const std::string &hrefurl,
+                                  const struct stat &statInfo,
+                                  const std::string &etag,
+                                  const std::string *filePerm)
 {
-  using namespace rapidxml;
-
-  XrdMgmOfsDirectory directory;
   XrdOucErrInfo error;
-  struct stat statInfo;
-  std::string etag;
   std::string id;
-
-  bool allpropresponse = false;
+  bool allpropresponse = (mRequestPropertyTypes & PropertyTypes::ALLPROP_MARKER);
+  bool isdir = S_ISDIR(statInfo.st_mode);
 
   XrdOucString urlp = url.c_str();
   XrdOucString hrefp = hrefurl.c_str();
@@ -343,235 +509,138 @@ PropFindResponse::BuildResponseNode (const std::string &url, const std::string &
   {
   }
 
-  // Is the requested resource a file or directory?
-  eos_static_debug("url=%s", urlp.c_str());
-  if (gOFS->_stat(urlp.c_str(), &statInfo, error, *mVirtualIdentity,
-                  (const char*) 0, &etag))
-  {
-    eos_static_err("msg=\"error stating %s: %s\"", urlp.c_str(),
-                   error.getErrText());
-    SetResponseCode(ResponseCodes::NOT_FOUND);
-    return NULL;
-  }
   eos_static_debug("url=%s etag=%s", urlp.c_str(), etag.c_str());
 
   // encode the url's
   urlp = EncodeURI(urlp.c_str()).c_str();
   hrefp = EncodeURI(hrefp.c_str()).c_str();
 
-  // <response/> node
-  xml_node<> *responseNode = AllocateNode("d:response");
-
-  // <href/> node
-  xml_node<> *href = AllocateNode("d:href");
-
-  if (S_ISDIR(statInfo.st_mode))
+  if (isdir)
   {
     if (hrefp[hrefp.length() - 1] != '/')
       hrefp += "/";
   }
 
-  SetValue(href, hrefp.c_str());
-  responseNode->append_node(href);
-
-  // <propstat/> node for "found" properties
-  xml_node<> *propstatFound = AllocateNode("d:propstat");
-  responseNode->append_node(propstatFound);
-
-  // <status/> "found" node
-  xml_node<> *statusFound = AllocateNode("d:status");
-  SetValue(statusFound, "HTTP/1.1 200 OK");
-  propstatFound->append_node(statusFound);
-
-  // <prop/> "found" node
-  xml_node<> *propFound = AllocateNode("d:prop");
-  propstatFound->append_node(propFound);
-
-  // <propstat/> node for "not found" properties
-  xml_node<> *propstatNotFound = AllocateNode("d:propstat");
-  responseNode->append_node(propstatNotFound);
-
-  // <status/> "not found" node
-  xml_node<> *statusNotFound = AllocateNode("d:status");
-  SetValue(statusNotFound, "HTTP/1.1 404 Not Found");
-  propstatNotFound->append_node(statusNotFound);
-
-  // <prop/> "not found" node
-  xml_node<> *propNotFound = AllocateNode("d:prop");
-  propstatNotFound->append_node(propNotFound);
-
-  xml_node<> *contentLength = 0;
-  xml_node<> *lastModified = 0;
-  xml_node<> *resourceType = 0;
-  xml_node<> *checkedIn = 0;
-  xml_node<> *checkedOut = 0;
-  xml_node<> *creationDate = 0;
-  xml_node<> *eTag = 0;
-  xml_node<> *displayName = 0;
-  xml_node<> *contentType = 0;
-  xml_node<> *quotaAvail = 0;
-  xml_node<> *quotaUsed = 0;
-  xml_node<> *ocid = 0;
-  xml_node<> *ocsize = 0;
-  xml_node<> *ocperm = 0;
-
-  if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_LENGTH)
-    contentLength = AllocateNode("d:getcontentlength");
-  if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_TYPE)
-    contentType = AllocateNode("d:getcontenttype");
-  if (mRequestPropertyTypes & PropertyTypes::GET_LAST_MODIFIED)
-    lastModified = AllocateNode("d:getlastmodified");
-  if (mRequestPropertyTypes & PropertyTypes::CREATION_DATE)
-    creationDate = AllocateNode("d:creationdate");
-  if (mRequestPropertyTypes & PropertyTypes::RESOURCE_TYPE)
-    resourceType = AllocateNode("d:resourcetype");
-  if (mRequestPropertyTypes & PropertyTypes::DISPLAY_NAME)
-    displayName = AllocateNode("d:displayname");
-  if (mRequestPropertyTypes & PropertyTypes::GET_ETAG)
-    eTag = AllocateNode("d:getetag");
-  if (mRequestPropertyTypes & PropertyTypes::CHECKED_IN)
-    checkedIn = AllocateNode("d:checked-in");
-  if (mRequestPropertyTypes & PropertyTypes::CHECKED_OUT)
-    checkedOut = AllocateNode("d:checked-out");
-  if (mRequestPropertyTypes & PropertyTypes::GET_OCID)
-    ocid = AllocateNode("oc:id");
-  if (mRequestPropertyTypes & PropertyTypes::GET_OCSIZE)
-    ocsize = AllocateNode("oc:size");
-  if (mRequestPropertyTypes & PropertyTypes::GET_OCPERM)
-    ocperm = AllocateNode("oc:permissions");
-  if (mRequestPropertyTypes & PropertyTypes::ALLPROP_MARKER)
-    allpropresponse = true;
-
-  if ((S_ISDIR(statInfo.st_mode)) &&
-      ((mRequestPropertyTypes & PropertyTypes::QUOTA_AVAIL) ||
-      (mRequestPropertyTypes & PropertyTypes::QUOTA_USED)))
-  {
-    // -----------------------------------------------------------
-    // retrieve the current quota
-    // -----------------------------------------------------------
-    std::string path = url.c_str();
-    if (path.substr(path.length() - 1, 1) != "/")
-    {
-      path += "/";
-    }
-
-    long long maxbytes = 0;
-    long long freebytes = 0;
-    Quota::GetIndividualQuota(*mVirtualIdentity, path, maxbytes, freebytes);
+  // <response/> element with <href/>
+  out += "<d:response>";
+  AppendElement(out, "d:href", hrefp.c_str());
 
-    if (mRequestPropertyTypes & PropertyTypes::QUOTA_AVAIL)
-    {
-      std::string sQuotaAvail;
-      quotaAvail = AllocateNode("d:quota-available-bytes");
-      if (quotaAvail)
-        SetValue(quotaAvail, eos::common::StringConversion::GetSizeString(sQuotaAvail, (unsigned long long) freebytes));
-    }
-    if (mRequestPropertyTypes & PropertyTypes::QUOTA_USED)
-    {
-      std::string sQuotaUsed;
-      quotaUsed = AllocateNode("d:quota-used-bytes");
-      SetValue(quotaUsed, eos::common::StringConversion::GetSizeString(sQuotaUsed, (unsigned long long) statInfo.st_size));
-    }
-  }
+  // <prop/> contents for "found" and "not found" properties
+  std::string found;
+  std::string notFound;
 
   // getlastmodified, creationdate, displayname and getetag properties are
   // common to all resources
-  if (lastModified)
+  if (mRequestPropertyTypes & PropertyTypes::GET_LAST_MODIFIED)
   {
-    std::string lm = eos::common::Timing::utctime(
-                                                  statInfo.st_mtim.tv_sec);
-    SetValue(lastModified, lm.c_str());
-    propFound->append_node(lastModified);
+    AppendElement(found, "d:getlastmodified",
+                  eos::common::Timing::utctime(statInfo.st_mtim.tv_sec).c_str());
   }
 
-  if (creationDate)
+  if (mRequestPropertyTypes & PropertyTypes::CREATION_DATE)
   {
-    std::string cd = eos::common::Timing::UnixTimstamp_to_ISO8601(
-                                                                  statInfo.st_ctim.tv_sec);
-    SetValue(creationDate, cd.c_str());
-    propFound->append_node(creationDate);
+    AppendElement(found, "d:creationdate",
+                  eos::common::Timing::UnixTimstamp_to_ISO8601(
+                                                               statInfo.st_ctim.tv_sec).c_str());
   }
 
-  if (eTag)
-  {
-    SetValue(eTag, etag.c_str());
-    propFound->append_node(eTag);
-  }
+  if (mRequestPropertyTypes & PropertyTypes::GET_ETAG)
+    AppendElement(found, "d:getetag", etag.c_str());
 
-  if (ocid)
+  if (mRequestPropertyTypes & PropertyTypes::GET_OCID)
   {
-    SetValue(ocid, eos::common::StringConversion::GetSizeString(id, (unsigned long long) statInfo.st_ino));
-    propFound->append_node(ocid);
+    AppendElement(found, "oc:id",
+                  eos::common::StringConversion::GetSizeString(id, (unsigned long long) statInfo.st_ino));
   }
 
-  if (ocsize)
+  if (mRequestPropertyTypes & PropertyTypes::GET_OCSIZE)
   {
-    SetValue(ocsize, eos::common::StringConversion::GetSizeString(id, (unsigned long long) statInfo.st_size));
-    propFound->append_node(ocsize);
+    AppendElement(found, "oc:size",
+                  eos::common::StringConversion::GetSizeString(id, (unsigned long long) statInfo.st_size));
   }
 
-  if (ocperm)
+  if (mRequestPropertyTypes & PropertyTypes::GET_OCPERM)
   {
     // test access permissions
     std::string oc_perm = "";
-    gOFS->acc_access(url.c_str(), error, *mVirtualIdentity, oc_perm);
-    SetValue(ocperm, oc_perm.c_str());
-    propFound->append_node(ocperm);
+
+    if (filePerm)
+      oc_perm = *filePerm;
+    else
+      gOFS->acc_access(url.c_str(), error, *mVirtualIdentity, oc_perm);
+
+    AppendElement(found, "oc:permissions", oc_perm.c_str());
   }
 
-  if (displayName)
+  if (mRequestPropertyTypes & PropertyTypes::DISPLAY_NAME)
   {
     eos::common::Path path(urlp.c_str());
     eos_static_debug("msg=\"display name: %s\"", path.GetName());
-    SetValue(displayName, path.GetName());
-    propFound->append_node(displayName);
+    AppendElement(found, "d:displayname", path.GetName());
   }
 
   // Directory
-  if (S_ISDIR(statInfo.st_mode))
+  if (isdir)
   {
-    if (resourceType)
-    {
-      xml_node<> *container = AllocateNode("d:collection");
-      resourceType->append_node(container);
-      propFound->append_node(resourceType);
-    }
+    if (mRequestPropertyTypes & PropertyTypes::RESOURCE_TYPE)
+      found += "<d:resourcetype><d:collection/></d:resourcetype>";
 
     if (!allpropresponse)
     {
       // ANDROID does not digest this response properly in allprop requests
-      if (contentLength) propNotFound->append_node(contentLength);
+      if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_LENGTH)
+        notFound += "<d:getcontentlength/>";
     }
 
-    if (contentType)
-    {
-      SetValue(contentType, "httpd/unix-directory");
-      propFound->append_node(contentType);
-    }
-    if (quotaAvail)
-    {
-      propFound->append_node(quotaAvail);
-    }
-    if (quotaUsed)
+    if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_TYPE)
+      AppendElement(found, "d:getcontenttype", "httpd/unix-directory");
+
+    if ((mRequestPropertyTypes & PropertyTypes::QUOTA_AVAIL) ||
+        (mRequestPropertyTypes & PropertyTypes::QUOTA_USED))
     {
-      propFound->append_node(quotaUsed);
+      // -----------------------------------------------------------
+      // retrieve the current quota
+      // -----------------------------------------------------------
+      std::string path = url.c_str();
+      if (path.substr(path.length() - 1, 1) != "/")
+      {
+        path += "/";
+      }
+
+      long long maxbytes = 0;
+      long long freebytes = 0;
+      Quota::GetIndividualQuota(*mVirtualIdentity, path, maxbytes, freebytes);
+
+      if (mRequestPropertyTypes & PropertyTypes::QUOTA_AVAIL)
+      {
+        std::string sQuotaAvail;
+        AppendElement(found, "d:quota-available-bytes",
+                      eos::common::StringConversion::GetSizeString(sQuotaAvail, (unsigned long long) freebytes));
+      }
+      if (mRequestPropertyTypes & PropertyTypes::QUOTA_USED)
+      {
+        std::string sQuotaUsed;
+        AppendElement(found, "d:quota-used-bytes",
+                      eos::common::StringConversion::GetSizeString(sQuotaUsed, (unsigned long long) statInfo.st_size));
+      }
     }
   }
 
     // File
   else
   {
-    if (resourceType) propFound->append_node(resourceType);
+    if (mRequestPropertyTypes & PropertyTypes::RESOURCE_TYPE)
+      found += "<d:resourcetype/>";
 
-    if (contentLength)
+    if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_LENGTH)
     {
-      SetValue(contentLength, std::to_string((long long) statInfo.st_size).c_str());
-      propFound->append_node(contentLength);
+      AppendElement(found, "d:getcontentlength",
+                    std::to_string((long long) statInfo.st_size).c_str());
     }
-    if (contentType)
+    if (mRequestPropertyTypes & PropertyTypes::GET_CONTENT_TYPE)
     {
-      SetValue(contentType, HttpResponse::ContentType(url.c_str()).c_str());
-      propFound->append_node(contentType);
+      AppendElement(found, "d:getcontenttype",
+                    HttpResponse::ContentType(url.c_str()).c_str());
     }
   }
 
@@ -579,11 +648,18 @@ PropFindResponse::BuildResponseNode (const std::string &url, const std::string &
   if (!allpropresponse)
   {
     // ANDROID does not digest this response properly in allprop requests
-    if (checkedIn) propNotFound->append_node(checkedIn);
-    if (checkedOut) propNotFound->append_node(checkedOut);
+    if (mRequestPropertyTypes & PropertyTypes::CHECKED_IN)
+      notFound += "<d:checked-in/>";
+    if (mRequestPropertyTypes & PropertyTypes::CHECKED_OUT)
+      notFound += "<d:checked-out/>";
   }
 
-  return responseNode;
+  // <propstat/> elements for "found" and "not found" properties
+  out += "<d:propstat><d:status>HTTP/1.1 200 OK</d:status>";
+  out += found.empty() ? "<d:prop/>" : "<d:prop>" + found + "</d:prop>";
+  out += "</d:propstat><d:propstat><d:status>HTTP/1.1 404 Not Found</d:status>";
+  out += notFound.empty() ? "<d:prop/>" : "<d:prop>" + notFound + "</d:prop>";
+  out += "</d:propstat></d:response>";
 }
 
 /*----------------------------------------------------------------------------*/
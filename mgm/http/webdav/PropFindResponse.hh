@@ -38,6 +38,9 @@
 #include "mgm/Namespace.hh"
 #include "common/Mapping.hh"
 /*----------------------------------------------------------------------------*/
+#include <sys/stat.h>
+#include <string>
+#include <vector>
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 // rapidjason header file violates ordered prototype delcaration
@@ -96,9 +99,29 @@ public:
     ALLPROP_MARKER = 0xf000
   };
 
+  /**
+   * Metadata of a child resource collected in the namespace pass
+   */
+  struct Entry
+  {
+    std::string mName;  //!< name in the requested directory
+    struct stat mStat;  //!< stat information
+    std::string mETag;  //!< ETag
+    bool        mValid; //!< false if the entry has to be stat'ed by path
+  };
+
 protected:
   int mRequestPropertyTypes; //!< properties that were requested
   eos::common::Mapping::VirtualIdentity *mVirtualIdentity; //!< virtual identity for this client
+  std::string        mUrl;           //!< requested resource
+  std::string        mHrefUrl;       //!< requested resource as seen by the client
+  std::vector<Entry> mEntries;       //!< children of a Depth:1 request
+  size_t             mNextEntry;     //!< next child to stream
+  std::string        mFilePerm;      //!< oc:permissions shared by all child files
+  bool               mFilePermValid; //!< mFilePerm has been computed
+  std::string        mStreamBuffer;  //!< XML produced but not yet sent
+  size_t             mStreamOffset;  //!< bytes of mStreamBuffer already sent
+  bool               mStreamDone;    //!< closing tag has been produced
 
 public:
 
@@ -110,7 +133,8 @@ public:
   PropFindResponse (eos::common::HttpRequest *request,
                     eos::common::Mapping::VirtualIdentity *vid) :
   WebDAVResponse (request), mRequestPropertyTypes (NONE),
-  mVirtualIdentity (vid)
+  mVirtualIdentity (vid), mNextEntry (0), mFilePermValid (false),
+  mStreamOffset (0), mStreamDone (false)
   {
     static bool initialized = false;
     if (!initialized)
@@ -155,15 +179,41 @@ public:
   ParseRequestPropertyTypes (rapidxml::xml_node<> *node);
 
   /**
-   * Build a response XML <response/> node containing the properties that were
-   * requested, whether they were found or not, etc (see RFC)
+   * Append a response XML <response/> element containing the properties that
+   * were requested, whether they were found or not, etc (see RFC)
+   *
+   * @param out       the XML output
+   * @param url       the URL of the resource to build a response for
+   * @param hrefurl   the URL of the resource as seen by the client
+   * @param statInfo  stat information of the resource
+   * @param etag      ETag of the resource
+   * @param filePerm  oc:permissions of the resource if it is a file and they
+   *                  are already known, otherwise 0
+   */
+  void
+  AppendResponse (std::string &out, const std::string &url,
+                  const std::string &hrefurl, const struct stat &statInfo,
+                  const std::string &etag, const std::string *filePerm = 0);
+
+  /**
+   * Collect the metadata of all listed children of the requested directory
+   * in one namespace pass
    *
-   * @param url  the URL of the resource to build a response node for
+   * @param names  the names of the children to list
+   */
+  void
+  CollectEntries (const std::vector<std::string> &names);
+
+  /**
+   * Produce the next part of a Depth:1 multistatus response
    *
-   * @return the newly build response node
+   * @param buf  buffer to fill
+   * @param max  size of the buffer
+   *
+   * @return number of bytes placed in buf or -1 at the end of the response
    */
-  rapidxml::xml_node<>*
-  BuildResponseNode (const std::string &url, const std::string &hrefurl);
+  virtual ssize_t
+  StreamBody (char *buf, size_t max);
 
   /**
    * Convert the given property type string into its integer constant
@@ -202,6 +252,13 @@ public:
    */
   std::string
   EncodeURI (const char* uri);
+
+  /**
+   * Append an XML element with the XML special characters of the value
+   * escaped - an empty value gives an empty element
+   */
+  static void
+  AppendElement (std::string &out, const char *tag, const char *value);
 };
 
 /*----------------------------------------------------------------------------*/
@@ -60,7 +60,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "ban")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (user.length())
     {
       int errc = 0;
@@ -136,7 +136,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "unban")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (user.length())
     {
       int errc = 0;
@@ -250,7 +250,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "allow")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (user.length())
     {
       int errc = 0;
@@ -325,7 +325,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "unallow")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (user.length())
     {
       int errc = 0;
@@ -438,7 +438,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "set")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (redirect.length() && ((type.length() == 0) || (type == "r") || (type == "w") || (type == "ENONET") || (type == "ENOENT") ) )
     {
       if (type == "r")
@@ -582,7 +582,7 @@ ProcCommand::Access ()
 
   if (mSubCmd == "rm")
   {
-    eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
+    Access::RulesWriteLock lock;
     if (redirect.length())
     {
       if ((Access::gRedirectionRules.count(std::string("*")) && ((type.length() == 0))) ||
@@ -246,7 +246,8 @@ proc_fs_config (std::string &identifier, std::string &key, std::string &value, X
     {
       // check the allowed strings
       if (((key == "configstatus") && (eos::common::FileSystem::GetConfigStatusFromString(value.c_str()) != eos::common::FileSystem::kUnknown)) ||
-          (((key == "headroom") || (key == "scaninterval") || (key == "graceperiod") || (key == "drainperiod"))))
+          (((key == "headroom") || (key == "scaninterval") || (key == "graceperiod") || (key == "drainperiod") || (key == "iodepth") ||
+           (key == "iosched") || (key == "iosched.load") || (key == "iosched.user") || (key == "iosched.transfer") || (key == "iosched.verify"))))
       {
 
         std::string nodename = fs->GetString("host");
@@ -264,7 +265,8 @@ proc_fs_config (std::string &identifier, std::string &key, std::string &value, X
         }
         else
         {
-          if ((key == "headroom") || (key == "scaninterval") || (key == "graceperiod") || (key == "drainperiod"))
+          if ((key == "headroom") || (key == "scaninterval") || (key == "graceperiod") || (key == "drainperiod") || (key == "iodepth") ||
+              (key == "iosched") || (key == "iosched.load") || (key == "iosched.user") || (key == "iosched.transfer") || (key == "iosched.verify"))
           {
             fs->SetLongLong(key.c_str(), eos::common::StringConversion::GetSizeFromString(value.c_str()));
             FsView::gFsView.StoreFsConfig(fs);
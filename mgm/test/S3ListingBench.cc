@@ -0,0 +1,192 @@
+// ----------------------------------------------------------------------
+// File: S3ListingBench.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+// Paged S3 bucket listing throughput against the bucket size: every page
+// resumes at the marker returned by the previous one. The sorted snapshot
+// seeks the marker in log time, the former listing skipped all entries of the
+// (re-built) directory set up to the marker.
+//------------------------------------------------------------------------------
+
+#undef NDEBUG
+#include "mgm/http/s3/S3Listing.hh"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <set>
+#include <string>
+
+using namespace eos::mgm;
+
+static const size_t sPageSize = 1000;
+
+static double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static std::string
+ObjectName (size_t i)
+{
+  char name[64];
+  snprintf(name, sizeof (name), "run%04lu/file.%08lu.root",
+           (unsigned long) (i % 997), (unsigned long) i);
+  return name;
+}
+
+//------------------------------------------------------------------------------
+// Page through the bucket with the sorted snapshot
+//------------------------------------------------------------------------------
+static size_t
+ListSnapshot (const S3Listing &listing, const std::string &prefix)
+{
+  std::string marker;
+  size_t listed = 0;
+
+  while (true)
+  {
+    std::string result;
+    S3XmlWriter xml(result);
+    size_t pos = listing.Seek(prefix, marker);
+    size_t end = std::min(listing.Size(), pos + sPageSize);
+
+    for (size_t i = pos; i < end; i++)
+    {
+      xml.Open("Contents");
+      marker = prefix;
+      marker += listing.Name(i);
+      xml.Element("Key", marker);
+      xml.Element("Size", "0");
+      xml.Close("Contents");
+      listed++;
+    }
+
+    if (end == listing.Size())
+      break;
+  }
+
+  return listed;
+}
+
+//------------------------------------------------------------------------------
+// Page through the bucket like the former implementation
+//------------------------------------------------------------------------------
+static size_t
+ListLinear (const std::set<std::string> &names, const std::string &prefix)
+{
+  std::string marker;
+  size_t listed = 0;
+
+  while (true)
+  {
+    // the directory listing was re-built for every page
+    std::set<std::string> dh_list(names);
+    std::string result;
+    bool marker_found = marker.empty();
+    size_t cnt = 0;
+    bool truncated = false;
+
+    for (auto it = dh_list.begin(); it != dh_list.end(); ++it)
+    {
+      std::string objectname = prefix + *it;
+
+      if (!marker_found)
+      {
+        if (marker == objectname)
+          marker_found = true;
+
+        continue;
+      }
+
+      if (cnt == sPageSize)
+      {
+        truncated = true;
+        break;
+      }
+
+      result += "<Contents><Key>";
+      result += objectname;
+      result += "</Key><Size>0</Size></Contents>";
+      marker = objectname;
+      cnt++;
+      listed++;
+    }
+
+    if (!truncated)
+      break;
+  }
+
+  return listed;
+}
+
+int
+main (int argc, char* argv[])
+{
+  size_t maxSize = (argc > 1) ? strtoul(argv[1], 0, 10) : 1000000;
+  size_t maxLinear = 100000;
+  std::string prefix = "data/";
+
+  fprintf(stdout, "%12s %20s %20s %20s\n", "objects", "snapshot [s]",
+          "paged [keys/s]", "linear [keys/s]");
+
+  for (size_t size = 1000; size <= maxSize; size *= 10)
+  {
+    std::set<std::string> names;
+
+    for (size_t i = 0; i < size; i++)
+      names.insert(ObjectName(i));
+
+    double start = Now();
+    S3Listing listing;
+
+    for (auto it = names.begin(); it != names.end(); ++it)
+      listing.Add(*it, false);
+
+    listing.Seal();
+    double snapshot = Now() - start;
+    start = Now();
+    assert(ListSnapshot(listing, prefix) == size);
+    double paged = Now() - start;
+    fprintf(stdout, "%12lu %20.3f %20.0f", (unsigned long) size, snapshot,
+            size / paged);
+
+    if (size <= maxLinear)
+    {
+      start = Now();
+      assert(ListLinear(names, prefix) == size);
+      fprintf(stdout, " %20.0f\n", size / (Now() - start));
+    }
+    else
+    {
+      fprintf(stdout, " %20s\n", "-");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+// ----------------------------------------------------------------------
+// File: SchedulerBatchTest.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Scheduler.hh"
+/*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <errno.h>
+/*----------------------------------------------------------------------------*/
+
+using namespace eos::mgm;
+
+//------------------------------------------------------------------------------
+// Scheduling group with a given index
+//------------------------------------------------------------------------------
+class TestGroup : public FsGroup
+{
+public:
+
+  TestGroup(const char* name, unsigned int index) : FsGroup(name)
+  {
+    mIndex = index;
+  }
+};
+
+//------------------------------------------------------------------------------
+// Placer with a number of free files per group - the groups of the existing
+// replicas are the groups of the filesystems (fsid = group index)
+//------------------------------------------------------------------------------
+struct TestPlacer
+{
+  TestPlacer(std::vector<FsGroup*>& groups) : mGroups(groups) { }
+
+  void Prepare(Scheduler::PlacementRequest& req,
+               std::vector<FsGroup*>& groupsToTry)
+  {
+    for (size_t i = 0; i < req.alreadyused_filesystems.size(); i++)
+    {
+      for (size_t g = 0; g < mGroups.size(); g++)
+      {
+        if (mGroups[g]->GetIndex() == req.alreadyused_filesystems[i])
+          groupsToTry.push_back(mGroups[g]);
+      }
+    }
+  }
+
+  bool Place(FsGroup* group, Scheduler::PlacementRequest& req)
+  {
+    mTried.push_back(group->GetIndex());
+
+    if (!mFree[group])
+      return false;
+
+    mFree[group]--;
+    req.selected_filesystems.push_back(100 + group->GetIndex());
+    return true;
+  }
+
+  std::vector<FsGroup*>& mGroups;
+  std::map<FsGroup*, int> mFree; ///< files which still fit in a group
+  std::vector<unsigned int> mTried; ///< indices of the groups tried in order
+};
+
+static int gFailed = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "FAILED line %d: %s\n", __LINE__, #cond);         \
+      gFailed++;                                                        \
+    }                                                                   \
+  } while (0)
+
+int
+main()
+{
+  TestGroup g0("default.0", 0), g1("default.1", 1), g2("default.2", 2);
+  std::set<FsGroup*> sorted;
+  sorted.insert(&g0);
+  sorted.insert(&g1);
+  sorted.insert(&g2);
+  // the scheduler gets the groups of a space in the order of the set
+  std::vector<FsGroup*> groups(sorted.begin(), sorted.end());
+  size_t cursor = 0;
+
+  // ---------------------------------------------------------------------------
+  // Forced group: found, not found
+  // ---------------------------------------------------------------------------
+  CHECK(Scheduler::GetBatchCursor(groups, 1, 0, cursor) == 0);
+  CHECK(groups[cursor]->GetIndex() == 1);
+  CHECK(Scheduler::GetBatchCursor(groups, 7, 0, cursor) == ENOSPC);
+  CHECK(Scheduler::GetBatchCursor(std::vector<FsGroup*>(), 0, 0, cursor) == ENOSPC);
+
+  // ---------------------------------------------------------------------------
+  // Cursor: first group without history, the one after the last group used
+  // ---------------------------------------------------------------------------
+  CHECK(Scheduler::GetBatchCursor(groups, -1, 0, cursor) == 0);
+  CHECK(cursor == 0);
+  CHECK(Scheduler::GetBatchCursor(groups, -1, groups[1], cursor) == 0);
+  CHECK(cursor == 2);
+  CHECK(Scheduler::GetBatchCursor(groups, -1, groups[2], cursor) == 0);
+  CHECK(cursor == 0);
+
+  // ---------------------------------------------------------------------------
+  // Consecutive files start on consecutive groups, a full group is skipped,
+  // files rejected by the quota are left alone
+  // ---------------------------------------------------------------------------
+  {
+    TestPlacer placer(groups);
+    placer.mFree[groups[0]] = 10;
+    placer.mFree[groups[1]] = 0;
+    placer.mFree[groups[2]] = 10;
+    std::vector<Scheduler::PlacementRequest> requests(4);
+    requests[2].retc = EDQUOT;
+    cursor = 0;
+    CHECK(Scheduler::PlaceBatch(groups, cursor, requests, placer) == 0);
+    CHECK(requests[0].retc == 0);
+    CHECK(requests[0].group_index == (int) groups[0]->GetIndex());
+    // groups[1] is full, the file goes to the next one
+    CHECK(requests[1].retc == 0);
+    CHECK(requests[1].group_index == (int) groups[2]->GetIndex());
+    CHECK(requests[2].retc == EDQUOT);
+    CHECK(requests[2].selected_filesystems.empty());
+    CHECK(requests[3].retc == 0);
+    CHECK(requests[3].group_index == (int) groups[0]->GetIndex());
+    CHECK(placer.mTried.size() == 4);
+    CHECK(cursor == 1);
+  }
+
+  // ---------------------------------------------------------------------------
+  // No space left: every group is tried once and the selection is cleared
+  // ---------------------------------------------------------------------------
+  {
+    TestPlacer placer(groups);
+    std::vector<Scheduler::PlacementRequest> requests(2);
+    placer.mFree[groups[2]] = 1;
+    cursor = 2;
+    CHECK(Scheduler::PlaceBatch(groups, cursor, requests, placer) == 1);
+    CHECK(requests[0].retc == 0);
+    CHECK(requests[0].group_index == (int) groups[2]->GetIndex());
+    CHECK(requests[1].retc == ENOSPC);
+    CHECK(requests[1].group_index == -1);
+    CHECK(requests[1].selected_filesystems.empty());
+    CHECK(placer.mTried.size() == 1 + groups.size());
+  }
+
+  // ---------------------------------------------------------------------------
+  // The groups of the existing replicas are tried first and don't move the
+  // cursor
+  // ---------------------------------------------------------------------------
+  {
+    TestPlacer placer(groups);
+    placer.mFree[&g2] = 1;
+    placer.mFree[groups[0]] += 1;
+    std::vector<Scheduler::PlacementRequest> requests(1);
+    requests[0].alreadyused_filesystems.push_back(2);
+    cursor = 0;
+    CHECK(Scheduler::PlaceBatch(groups, cursor, requests, placer) == 0);
+    CHECK(requests[0].group_index == 2);
+    CHECK(placer.mTried.size() == 1);
+    CHECK(cursor == 0);
+  }
+
+  if (gFailed)
+  {
+    fprintf(stderr, "%d check(s) failed\n", gFailed);
+    return 1;
+  }
+
+  fprintf(stdout, "all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,266 @@
+// ----------------------------------------------------------------------
+// File: IoReportConvert.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "common/Report.hh"
+#include "common/ReportStore.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdOuc/XrdOucEnv.hh"
+/*----------------------------------------------------------------------------*/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+// Converts the text reports written by the MGM Iostat (daily *.eosreport files
+// or the per-path report namespace) into the binary, indexed report store.
+// Every record is appended to the segment of the day of its close timestamp.
+// With --dump the records of a store are printed in the text format, one
+// report per line, which is what console/eosreport reads.
+//------------------------------------------------------------------------------
+
+typedef std::map<std::string, eos::common::ReportStore*> store_map_t;
+
+static unsigned long long nrecords = 0;
+static unsigned long long nfiles = 0;
+
+//------------------------------------------------------------------------------
+// Append all records of a text report file
+//------------------------------------------------------------------------------
+static bool
+ConvertFile (const std::string& path, const std::string& storepath,
+             store_map_t& stores)
+{
+  std::ifstream inFile(path.c_str());
+  std::string reportLine;
+
+  if (!inFile.good())
+  {
+    fprintf(stderr, "error: cannot open report file %s\n", path.c_str());
+    return false;
+  }
+
+  while (std::getline(inFile, reportLine))
+  {
+    if (reportLine.empty())
+      continue;
+
+    while (reportLine.find("&&") != std::string::npos)
+      reportLine.replace(reportLine.find("&&"), 2, "&");
+
+    XrdOucEnv ioreport(reportLine.c_str());
+    eos::common::Report report(ioreport);
+
+    if (!report.cts)
+      continue;
+
+    // one writer per segment keeps the segments and their indexes consistent
+    std::string day = eos::common::ReportStore::SegmentName(storepath, report.cts);
+
+    if (!stores.count(day))
+    {
+      if (stores.size() >= 64)
+      {
+        // bound the number of open segments - reopening appends at the end
+        for (store_map_t::iterator it = stores.begin(); it != stores.end(); ++it)
+        {
+          it->second->Close();
+          delete it->second;
+        }
+
+        stores.clear();
+      }
+
+      stores[day] = new eos::common::ReportStore();
+      stores[day]->SetPath(storepath);
+    }
+
+    if (!stores[day]->Append(report, true, report.cts))
+    {
+      fprintf(stderr, "error: failed to append record of %s to the store %s\n",
+              path.c_str(), storepath.c_str());
+      return false;
+    }
+
+    nrecords++;
+  }
+
+  nfiles++;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Walk a report directory and convert all matching files
+//------------------------------------------------------------------------------
+static bool
+ConvertTree (const std::string& path, const std::string& storepath,
+             bool ns, store_map_t& stores)
+{
+  struct stat buf;
+
+  if (stat(path.c_str(), &buf))
+  {
+    fprintf(stderr, "error: cannot stat %s\n", path.c_str());
+    return false;
+  }
+
+  if (!S_ISDIR(buf.st_mode))
+    return ConvertFile(path, storepath, stores);
+
+  DIR* dir = opendir(path.c_str());
+
+  if (!dir)
+  {
+    fprintf(stderr, "error: cannot open directory %s\n", path.c_str());
+    return false;
+  }
+
+  struct dirent* entry;
+  std::vector<std::string> entries;
+
+  while ((entry = readdir(dir)))
+  {
+    std::string name = entry->d_name;
+
+    if ((name == ".") || (name == ".."))
+      continue;
+
+    entries.push_back(name);
+  }
+
+  closedir(dir);
+  bool ok = true;
+
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    std::string name = entries[i];
+    std::string fullpath = path + "/" + name;
+
+    if (stat(fullpath.c_str(), &buf))
+      continue;
+
+    if (S_ISDIR(buf.st_mode))
+    {
+      ok &= ConvertTree(fullpath, storepath, ns, stores);
+      continue;
+    }
+
+    // never convert an existing binary store
+    if ((name.find(".eosreport.bin") != std::string::npos))
+      continue;
+
+    bool daily = ((name.length() > 10) &&
+                  (name.compare(name.length() - 10, 10, ".eosreport") == 0));
+
+    // daily logs and the report namespace contain the same records
+    if (daily != !ns)
+      continue;
+
+    ok &= ConvertFile(fullpath, storepath, stores);
+  }
+
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Print the records of a query in the text report format
+//------------------------------------------------------------------------------
+class DumpVisitor : public eos::common::ReportStore::Visitor
+{
+public:
+
+  bool
+  Visit (eos::common::Report& report)
+  {
+    fprintf(stdout, "log=%s&path=%s&ruid=%u&rgid=%u&td=%s&host=%s&lid=%lu"
+            "&fid=%llu&fsid=%lu&ots=%llu&otms=%llu&cts=%llu&ctms=%llu"
+            "&rb=%llu&wb=%llu&nrc=%llu&nwc=%llu&osize=%llu&csize=%llu\n",
+            report.logid.c_str(), report.path.c_str(), (unsigned) report.uid,
+            (unsigned) report.gid, report.td.c_str(), report.host.c_str(),
+            report.lid, report.fid, report.fsid, report.ots, report.otms,
+            report.cts, report.ctms, report.rb, report.wb, report.nrc,
+            report.nwc, report.osize, report.csize);
+    return !ferror(stdout);
+  }
+};
+
+int
+main (int argc, char* argv[])
+{
+  std::vector<std::string> args;
+  bool ns = false;
+  bool dump = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--namespace"))
+      ns = true;
+    else if (!strcmp(argv[i], "--dump"))
+      dump = true;
+    else
+      args.push_back(argv[i]);
+  }
+
+  if (dump && (args.size() >= 1) && (args.size() <= 4))
+  {
+    // --dump <store-dir> [<from> [<to> [<path>]]]
+    time_t from = (args.size() > 1) ? strtoul(args[1].c_str(), 0, 10) : 0;
+    time_t to = (args.size() > 2) ? strtoul(args[2].c_str(), 0, 10) : 0;
+    std::string qpath = (args.size() > 3) ? args[3] : "";
+    DumpVisitor visitor;
+    eos::common::ReportStore::Query(args[0], qpath, from, to, visitor);
+    return ferror(stdout) ? -1 : 0;
+  }
+
+  if (dump || (args.size() < 1) || (args.size() > 2))
+  {
+    fprintf(stderr, "usage: eos-ioreport-convert [--namespace] <text-report-dir|file> [<store-dir>]\n");
+    fprintf(stderr, "       converts the daily *.eosreport files (or with --namespace the per-path report files)\n");
+    fprintf(stderr, "       into the binary report store (default <store-dir> = <text-report-dir>)\n");
+    fprintf(stderr, "       eos-ioreport-convert --dump <store-dir> [<from> [<to> [<path>]]]\n");
+    fprintf(stderr, "       prints the records closed in [<from>, <to>] (unix time, 0 = unbounded) in text format\n");
+    exit(-1);
+  }
+
+  std::string storepath = (args.size() == 2) ? args[1] : args[0];
+  store_map_t stores;
+  bool ok = ConvertTree(args[0], storepath, ns, stores);
+
+  for (store_map_t::iterator it = stores.begin(); it != stores.end(); ++it)
+  {
+    it->second->Close();
+    delete it->second;
+  }
+
+  fprintf(stdout, "info: converted %llu records from %llu files into %s\n",
+          nrecords, nfiles, storepath.c_str());
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,277 @@
+// ----------------------------------------------------------------------
+// File: EosCapabilityBenchmark.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*-----------------------------------------------------------------------------*/
+/* Encode (MGM) and decode (FST) rate of the capabilities in the legacy and    */
+/* in the binary format, the latter also with the FST verification cache.      */
+/* Every format is first checked to give back the env it was created from.    */
+/*                                                                             */
+/* usage: eoscapabilitybench [n capabilities] [n extracts per capability]      */
+/*-----------------------------------------------------------------------------*/
+#include "authz/XrdCapability.hh"
+#include "common/SymKeys.hh"
+#include "common/Timing.hh"
+/*-----------------------------------------------------------------------------*/
+#include "XrdOuc/XrdOucEnv.hh"
+#include "XrdOuc/XrdOucString.hh"
+/*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+/*-----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+// Build the capability of a file creation like XrdMgmOfsFile::open does
+//------------------------------------------------------------------------------
+void
+BuildCapability (unsigned long long fid, XrdOucString &capability)
+{
+  char buffer[4096];
+  snprintf(buffer, sizeof(buffer),
+           "&mgm.access=create&mgm.ruid=12345&mgm.rgid=1234&mgm.uid=12345"
+           "&mgm.gid=1234&mgm.path=/eos/dev/user/a/alice/data/run%llu/file.root"
+           "&mgm.manager=eosdev.cern.ch:1094&mgm.fid=%08llx&mgm.cid=%llu"
+           "&mgm.sec=krb5|alice|lxplus001.cern.ch||alice|xroot|"
+           "&mgm.lid=1048850&mgm.bookingsize=0&mgm.fsid=%llu"
+           "&mgm.url0=root://fst01.cern.ch:1095//&mgm.fsid0=%llu"
+           "&mgm.url1=root://fst02.cern.ch:1095//&mgm.fsid1=%llu",
+           fid, fid, fid / 1000, fid % 100, fid % 100, (fid + 1) % 100);
+  capability = buffer;
+}
+
+//------------------------------------------------------------------------------
+// Split an opaque env into its sorted key/value pairs
+//------------------------------------------------------------------------------
+std::vector<std::pair<std::string, std::string> >
+SplitEnv (const char* env)
+{
+  std::vector<std::pair<std::string, std::string> > pairs;
+  std::string s = env ? env : "";
+  size_t pos = 0;
+
+  while (pos < s.size()) {
+    size_t end = s.find('&', pos);
+
+    if (end == std::string::npos)
+      end = s.size();
+
+    if (end > pos) {
+      std::string item = s.substr(pos, end - pos);
+      size_t eq = item.find('=');
+
+      if (eq == std::string::npos)
+        pairs.push_back(std::make_pair(item, std::string()));
+      else
+        pairs.push_back(std::make_pair(item.substr(0, eq), item.substr(eq + 1)));
+    }
+
+    pos = end + 1;
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+//------------------------------------------------------------------------------
+// Check that Extract(Create(env)) gives back env plus cap.valid, also when
+// served from the cache
+//------------------------------------------------------------------------------
+bool
+RoundTrip (const char* name, XrdCapability::eFormat format, size_t cachesize,
+           const char* env, eos::common::SymKey* key)
+{
+  XrdCapability::SetFormat(format);
+  XrdCapability::SetCacheSize(cachesize);
+  XrdOucEnv incapability(env);
+  XrdOucEnv* cap = 0;
+
+  if (XrdCapability::Create(&incapability, cap, key, 3600)) {
+    fprintf(stderr, "error: %s: failed to create capability for %s\n", name, env);
+    return false;
+  }
+
+  std::vector<std::pair<std::string, std::string> > expected = SplitEnv(env);
+  bool ok = true;
+
+  for (int pass = 0; ok && (pass < 2); pass++) {
+    XrdOucEnv* outenv = 0;
+    int rc = XrdCapability::Extract(cap, outenv);
+    int envlen = 0;
+    std::vector<std::pair<std::string, std::string> > got =
+      SplitEnv((!rc && outenv) ? outenv->Env(envlen) : "");
+    std::vector<std::pair<std::string, std::string> > rest;
+
+    for (size_t i = 0; i < got.size(); i++) {
+      if (got[i].first != "cap.valid")
+        rest.push_back(got[i]);
+    }
+
+    if (rc || (rest != expected) || (got.size() != rest.size() + 1)) {
+      fprintf(stderr, "error: %s: extract pass %d of %s gave rc=%d env=%s\n",
+              name, pass, env, rc,
+              outenv ? outenv->Env(envlen) : "");
+      ok = false;
+    }
+
+    delete outenv;
+  }
+
+  delete cap;
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Run the round trip of one format for a set of envs
+//------------------------------------------------------------------------------
+bool
+RoundTripFormat (const char* name, XrdCapability::eFormat format,
+                 size_t cachesize, eos::common::SymKey* key)
+{
+  static const char* envs[] = {
+    // plain numbers are stored as fixed fields
+    "&mgm.uid=0&mgm.gid=0&mgm.ruid=4294967295&mgm.rgid=1&mgm.fid=0000002a"
+    "&mgm.cid=18446744073709551615&mgm.fsid=7&mgm.lid=1048850"
+    "&mgm.bookingsize=0&mgm.path=/eos/a b/c",
+    // numbers which don't print back to the same text stay text
+    "&mgm.uid=0123&mgm.gid=-1&mgm.fid=2a&mgm.cid=18446744073709551616"
+    "&mgm.fsid=&mgm.lid=1e3&mgm.bookingsize=+5",
+    // unknown keys, empty values, values with '=' and keys without value
+    "&mgm.access=read&x.y=1&empty=&mgm.sec=a=b=c&novalue&mgm.path=/x",
+    // a key given twice
+    "&mgm.fsid=1&mgm.fsid=2&mgm.url0=root://fst//&mgm.url0=root://fst2//",
+    0
+  };
+  XrdOucString capability;
+  BuildCapability(12345, capability);
+
+  if (!RoundTrip(name, format, cachesize, capability.c_str(), key))
+    return false;
+
+  for (size_t i = 0; envs[i]; i++) {
+    if (!RoundTrip(name, format, cachesize, envs[i], key))
+      return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Run one format
+//------------------------------------------------------------------------------
+bool
+RunFormat (const char* name, XrdCapability::eFormat format, size_t cachesize,
+           size_t ncaps, size_t nextracts, eos::common::SymKey* key)
+{
+  std::vector<XrdOucEnv*> caps(ncaps);
+  XrdCapability::SetFormat(format);
+  XrdCapability::SetCacheSize(cachesize);
+  eos::common::Timing tm("Capability");
+  COMMONTIMING("START", &tm);
+
+  for (size_t i = 0; i < ncaps; i++) {
+    XrdOucString capability;
+    BuildCapability(i + 1, capability);
+    XrdOucEnv incapability(capability.c_str());
+
+    if (XrdCapability::Create(&incapability, caps[i], key, 3600)) {
+      fprintf(stderr, "error: failed to create capability\n");
+      return false;
+    }
+  }
+
+  COMMONTIMING("CREATE", &tm);
+
+  for (size_t n = 0; n < nextracts; n++) {
+    for (size_t i = 0; i < ncaps; i++) {
+      XrdOucEnv* outenv = 0;
+
+      if (XrdCapability::Extract(caps[i], outenv) || !outenv->Get("mgm.path")) {
+        fprintf(stderr, "error: failed to extract capability\n");
+        delete outenv;
+        return false;
+      }
+
+      delete outenv;
+    }
+  }
+
+  COMMONTIMING("EXTRACT", &tm);
+  int envlen = 0;
+  size_t caplen = strlen(caps[0]->Env(envlen));
+
+  for (size_t i = 0; i < ncaps; i++)
+    delete caps[i];
+
+  double create = tm.GetTagTimelapse("START", "CREATE");
+  double extract = tm.GetTagTimelapse("CREATE", "EXTRACT");
+  printf("%-24s %12.0f %12.0f %12lu\n", name,
+         create ? ncaps * 1000.0 / create : 0,
+         extract ? ncaps * nextracts * 1000.0 / extract : 0,
+         (unsigned long) caplen);
+  return true;
+}
+
+int
+main (int argc, char* argv[])
+{
+  size_t ncaps = (argc > 1) ? atoi(argv[1]) : 100000;
+  size_t nextracts = (argc > 2) ? atoi(argv[2]) : 4;
+  char binkey[SHA_DIGEST_LENGTH];
+
+  for (int i = 0; i < SHA_DIGEST_LENGTH; i++)
+    binkey[i] = random();
+
+  XrdOucString key64;
+  eos::common::SymKey::Base64Encode(binkey, SHA_DIGEST_LENGTH, key64);
+  eos::common::SymKey* key = eos::common::gSymKeyStore.SetKey64(key64.c_str(), 0);
+
+  if (!key) {
+    fprintf(stderr, "error: failed to set the symmetric key\n");
+    return -1;
+  }
+
+  if (!RoundTripFormat("legacy", XrdCapability::kLegacyFormat, 0, key) ||
+      !RoundTripFormat("binary", XrdCapability::kBinaryFormat, 0, key) ||
+      !RoundTripFormat("binary+cache", XrdCapability::kBinaryFormat, 16, key))
+    return -1;
+
+  printf("round trip of every format ok\n");
+  printf("%lu capabilities, each extracted %lu times\n\n",
+         (unsigned long) ncaps, (unsigned long) nextracts);
+  printf("%-24s %12s %12s %12s\n", "format", "create/s", "extract/s",
+         "cap length");
+
+  if (!RunFormat("legacy", XrdCapability::kLegacyFormat, 0, ncaps, nextracts,
+                 key) ||
+      !RunFormat("binary", XrdCapability::kBinaryFormat, 0, ncaps, nextracts,
+                 key) ||
+      !RunFormat("binary+cache", XrdCapability::kBinaryFormat, ncaps, ncaps,
+                 nextracts, key))
+    return -1;
+
+  return 0;
+}
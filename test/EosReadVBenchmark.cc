@@ -0,0 +1,264 @@
+// ----------------------------------------------------------------------
+// File: EosReadVBenchmark.cc
+// Author: agent <agent@local>
+// ----------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2015 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*-----------------------------------------------------------------------------*/
+/* Vector read latency with the access pattern of a ROOT analysis job: the     */
+/* file is cut into clusters holding one basket (1-64 kB) per branch, the job  */
+/* reads a fraction of the branches and every vector read fetches the baskets  */
+/* of these branches in one cluster, sorted by offset like the TTreeCache does */
+/* (or unsorted with -u). The baskets are verified against plain reads.        */
+/*                                                                             */
+/* usage: eosreadvbench [-b <branches>] [-p <percent read>] [-n <readvs>]      */
+/*                      [-u] [-r] root://host//path                            */
+/*-----------------------------------------------------------------------------*/
+#include "XrdCl/XrdClFile.hh"
+/*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <vector>
+/*-----------------------------------------------------------------------------*/
+
+static const size_t sMaxChunks = 1024; ///< chunk limit of one xrootd readv
+
+struct Basket
+{
+  uint64_t offset;
+  uint32_t length;
+};
+
+static double
+Now ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static bool
+OffsetLess (const XrdCl::ChunkInfo& a, const XrdCl::ChunkInfo& b)
+{
+  return a.offset < b.offset;
+}
+
+//------------------------------------------------------------------------------
+// Cut the file into clusters of one basket per branch
+//------------------------------------------------------------------------------
+static void
+BuildLayout (uint64_t size, size_t nbranches,
+             std::vector< std::vector<Basket> >& clusters)
+{
+  uint64_t offset = 0;
+
+  while (true)
+  {
+    std::vector<Basket> cluster(nbranches);
+
+    for (size_t i = 0; i < nbranches; i++)
+    {
+      // mostly small baskets with a tail of large ones
+      cluster[i].length = (random() % 4) ? 1024 + random() % 8192 :
+        8192 + random() % 57344;
+      cluster[i].offset = offset;
+      offset += cluster[i].length;
+    }
+
+    if (offset > size)
+      break;
+
+    clusters.push_back(cluster);
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  int c;
+  size_t nbranches = 400;
+  size_t percent = 20;
+  size_t nreadv = 1000;
+  bool sorted = true;
+  bool randomcluster = false;
+
+  while ((c = getopt(argc, argv, "b:p:n:urh")) != -1)
+  {
+    switch (c)
+    {
+    case 'b':
+      nbranches = strtoul(optarg, 0, 10);
+      break;
+    case 'p':
+      percent = strtoul(optarg, 0, 10);
+      break;
+    case 'n':
+      nreadv = strtoul(optarg, 0, 10);
+      break;
+    case 'u':
+      sorted = false;
+      break;
+    case 'r':
+      randomcluster = true;
+      break;
+    default:
+      fprintf(stderr, "usage: eosreadvbench [-b <branches>] [-p <percent read>] "
+              "[-n <readvs>] [-u] [-r] root://host//path\n");
+      fprintf(stderr, "       -u sends the chunks unsorted, -r reads the "
+              "clusters in random order\n");
+      return -1;
+    }
+  }
+
+  if ((optind != argc - 1) || !nbranches || !percent || (percent > 100) ||
+      !nreadv)
+  {
+    fprintf(stderr, "error: invalid arguments, see -h\n");
+    return -1;
+  }
+
+  XrdCl::File file;
+  XrdCl::XRootDStatus status = file.Open(argv[optind], XrdCl::OpenFlags::Read);
+  XrdCl::StatInfo* info = 0;
+
+  if (!status.IsOK() || !(status = file.Stat(false, info)).IsOK())
+  {
+    fprintf(stderr, "error: failed to open %s : %s\n", argv[optind],
+            status.ToStr().c_str());
+    return -1;
+  }
+
+  uint64_t size = info->GetSize();
+  delete info;
+  std::vector< std::vector<Basket> > clusters;
+  srandom(1);
+  BuildLayout(size, nbranches, clusters);
+
+  if (clusters.empty())
+  {
+    fprintf(stderr, "error: file too small for one cluster of %lu branches\n",
+            (unsigned long) nbranches);
+    return -1;
+  }
+
+  // the branches read by the job
+  std::vector<size_t> branches;
+
+  for (size_t i = 0; i < nbranches; i++)
+    branches.push_back(i);
+
+  std::random_shuffle(branches.begin(), branches.end());
+  branches.resize(std::max((size_t) 1, std::min(sMaxChunks,
+                                                nbranches * percent / 100)));
+  std::vector<double> latency;
+  std::vector<char> buffer;
+  std::vector<char> check;
+  uint64_t bytes = 0;
+  size_t errors = 0;
+  double start = Now();
+
+  for (size_t n = 0; n < nreadv; n++)
+  {
+    std::vector<Basket>& cluster = clusters[randomcluster ?
+                                            random() % clusters.size() :
+                                            n % clusters.size()];
+    XrdCl::ChunkList chunks;
+    uint32_t length = 0;
+
+    for (size_t i = 0; i < branches.size(); i++)
+      length += cluster[branches[i]].length;
+
+    buffer.resize(length);
+    length = 0;
+
+    for (size_t i = 0; i < branches.size(); i++)
+    {
+      Basket& basket = cluster[branches[i]];
+      chunks.push_back(XrdCl::ChunkInfo(basket.offset, basket.length,
+                                        &buffer[length]));
+      length += basket.length;
+    }
+
+    if (sorted)
+      std::sort(chunks.begin(), chunks.end(), OffsetLess);
+
+    XrdCl::VectorReadInfo* vinfo = 0;
+    double t0 = Now();
+    status = file.VectorRead(chunks, 0, vinfo);
+    latency.push_back(Now() - t0);
+
+    if (!status.IsOK() || (vinfo->GetSize() != length))
+    {
+      fprintf(stderr, "error: vector read failed : %s\n", status.ToStr().c_str());
+      delete vinfo;
+      errors++;
+      break;
+    }
+
+    delete vinfo;
+    bytes += length;
+
+    // verify the first vector reads chunk by chunk
+    for (size_t i = 0; (n < 10) && (i < chunks.size()); i++)
+    {
+      uint32_t nread = 0;
+      check.resize(chunks[i].length);
+
+      if (!file.Read(chunks[i].offset, chunks[i].length, &check[0],
+                     nread).IsOK() || (nread != chunks[i].length) ||
+          memcmp(&check[0], chunks[i].buffer, nread))
+      {
+        fprintf(stderr, "error: chunk at offset %llu differs from a plain read\n",
+                (unsigned long long) chunks[i].offset);
+        errors++;
+      }
+    }
+  }
+
+  double elapsed = Now() - start;
+  file.Close();
+
+  if (latency.empty())
+    return -1;
+
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+
+  for (size_t i = 0; i < latency.size(); i++)
+    sum += latency[i];
+
+  printf("%lu readv of %lu chunks (%lu%% of %lu branches, %s) on %lu clusters\n",
+         (unsigned long) latency.size(), (unsigned long) branches.size(),
+         (unsigned long) percent, (unsigned long) nbranches,
+         sorted ? "sorted" : "unsorted", (unsigned long) clusters.size());
+  printf("latency ms : avg %.02f p50 %.02f p90 %.02f p99 %.02f max %.02f\n",
+         sum * 1000.0 / latency.size(),
+         latency[latency.size() / 2] * 1000.0,
+         latency[latency.size() * 9 / 10] * 1000.0,
+         latency[latency.size() * 99 / 100] * 1000.0,
+         latency.back() * 1000.0);
+  printf("rate       : %.02f readv/s %.02f MB/s\n", latency.size() / elapsed,
+         bytes / elapsed / 1000000.0);
+  return errors ? -1 : 0;
+}